@@ -0,0 +1,10 @@
+/* tee_adaptive_selector--1.0--1.1.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION tee_adaptive_selector UPDATE TO '1.1'" to load this file. \quit
+
+CREATE FUNCTION tee_adaptive_selector_query_hash(query text,
+    OUT hash bigint, OUT sh bigint)
+RETURNS record
+AS 'MODULE_PATHNAME', 'tee_adaptive_selector_query_hash'
+LANGUAGE C PARALLEL SAFE STRICT;
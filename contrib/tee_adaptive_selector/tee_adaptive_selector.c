@@ -1,6 +1,7 @@
 /* tee_adaptive_selector.c: Adaptive meta-optimizer for TEE environments. */
 #include "postgres.h"
 #include "fmgr.h"
+#include "funcapi.h"
 #include "utils/elog.h"
 #include "optimizer/planner.h"
 #include "parser/parsetree.h"
@@ -11,6 +12,7 @@
 #include "catalog/pg_constraint.h"
 #include "nodes/nodes.h"
 #include "utils/timestamp.h"
+#include "utils/builtins.h"
 #include "storage/fd.h"			/* AllocateFile / FreeFile */
 #include "tcop/tcopprot.h"		/* debug_query_string */
 #include "access/heapam.h"
@@ -21,6 +23,8 @@
 #include "lib/stringinfo.h"
 #include "common/pg_prng.h"
 #include "storage/ipc.h"
+#include "tee_adaptive_selector.h"
+#include "tee_plan_tracker/tee_plan_tracker.h"
 #include <ctype.h>
 #include <limits.h>
 #include <stdio.h>
@@ -38,6 +42,14 @@ static bool tee_adaptive_use_cache = true;
 static bool tee_adaptive_cache_populating = false;
 /* GUC: workload selector (job/ceb/stack/tpcds) */
 static char *tee_adaptive_workload = "tpcds";
+/* GUC: fall back from components that tee_plan_tracker saw regress */
+static bool tee_adaptive_use_plan_tracker = false;
+
+/* tee_plan_tracker's routine, if it is loaded */
+static TeePlanTrackerRoutine **plan_tracker = NULL;
+
+/* how the current components were chosen, published for other modules */
+static TeeSelectorDecision last_decision = TEE_DECISION_NONE;
 
 /* Saved hook pointer */
 static planner_hook_type prev_planner_hook = NULL;
@@ -45,6 +57,8 @@ static planner_hook_type prev_planner_hook = NULL;
 /* SQL-callable activation helper */
 PG_FUNCTION_INFO_V1(tee_adaptive_selector_activate);
 Datum	tee_adaptive_selector_activate(PG_FUNCTION_ARGS);
+PG_FUNCTION_INFO_V1(tee_adaptive_selector_query_hash);
+Datum	tee_adaptive_selector_query_hash(PG_FUNCTION_ARGS);
 
 /* Structure to hold extracted query features */
 typedef struct QueryFeatures
@@ -2630,6 +2644,7 @@ apply_adaptive_strategy(QueryFeatures *feats, const char *query_string)
 			case SC_ALL: ce_on = cm_on = jn_on = true; break;
 		}
 		label = cache_should_record ? "Cache (update)" : "Cache";
+		last_decision = TEE_DECISION_CACHE;
 		SetConfigOption(GUC_JN_ENABLE, jn_on ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
 		SetConfigOption(GUC_CE_ENABLE, ce_on ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
 		SetConfigOption(GUC_CM_ENABLE, cm_on ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
@@ -2677,6 +2692,8 @@ apply_adaptive_strategy(QueryFeatures *feats, const char *query_string)
 	jn_on = (jn_score >= component_threshold(COMP_JN, workload));
 
 apply:
+	last_decision = TEE_DECISION_RULES;
+
 	/* Label for logging */
 	if (!jn_on && !ce_on && !cm_on)
 		label = "Auto: None";
@@ -2707,9 +2724,55 @@ apply:
 }
 
 
+static bool
+component_on(const char *name)
+{
+	const char *value = GetConfigOption(name, true, false);
+
+	return value != NULL && strcmp(value, "on") == 0;
+}
+
+/*
+ * If tee_plan_tracker has seen the chosen components produce a plan for this
+ * query that is slower than an earlier plan, switch to the components that
+ * earlier plan ran with.
+ */
+static void
+apply_plan_tracker_fallback(uint64 query_id)
+{
+	uint8		current = 0;
+	uint8		better;
+
+	if (!tee_adaptive_use_plan_tracker || query_id == UINT64CONST(0) ||
+		plan_tracker == NULL || *plan_tracker == NULL)
+		return;
+
+	if (component_on(GUC_CE_ENABLE))
+		current |= TEE_COMPONENT_CE;
+	if (component_on(GUC_CM_ENABLE))
+		current |= TEE_COMPONENT_CM;
+	if (component_on(GUC_JN_ENABLE))
+		current |= TEE_COMPONENT_JN;
+
+	if (!(*plan_tracker)->regressed(query_id, current, &better))
+		return;
+
+	SetConfigOption(GUC_JN_ENABLE, (better & TEE_COMPONENT_JN) ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
+	SetConfigOption(GUC_CE_ENABLE, (better & TEE_COMPONENT_CE) ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
+	SetConfigOption(GUC_CM_ENABLE, (better & TEE_COMPONENT_CM) ? "on" : "off", PGC_USERSET, PGC_S_SESSION);
+	last_decision = TEE_DECISION_TRACKER;
+
+	log_strategy_decision("Plan tracker fallback",
+						  (better & TEE_COMPONENT_JN) ? "on" : "off",
+						  (better & TEE_COMPONENT_CE) ? "on" : "off",
+						  (better & TEE_COMPONENT_CM) ? "on" : "off");
+}
+
 static PlannedStmt *
 tee_adaptive_planner_hook(Query *parse, const char *query_string, int cursorOptions, ParamListInfo boundParams)
 {
+	last_decision = TEE_DECISION_NONE;
+
 	/* Only intervene if enabled and it's a plannable statement (e.g., SELECT, INSERT...) */
 	if (tee_adaptive_enable && parse->commandType != CMD_UTILITY)
 	{
@@ -2727,12 +2790,14 @@ tee_adaptive_planner_hook(Query *parse, const char *query_string, int cursorOpti
 		PG_TRY();
 		{
 			apply_adaptive_strategy(&feats, query_string);
+			apply_plan_tracker_fallback(parse->queryId);
 		}
 		PG_CATCH();
 		{
 			/* If setting GUCs failed, log a warning and proceed without adaptive logic */
 			elog(WARNING, "TEE Adaptive: Failed to set extension options. Are underlying TEE extensions loaded? Proceeding with standard planner.");
 			FlushErrorState();
+			last_decision = TEE_DECISION_NONE;
 		}
 		PG_END_TRY();
 	}
@@ -2752,6 +2817,30 @@ tee_adaptive_selector_activate(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(true);
 }
 
+/*
+ * Return the cache key (H) and similarity hash (sh) of a query text, so that
+ * external tools such as tee_bench can write cache files for this module.
+ */
+Datum
+tee_adaptive_selector_query_hash(PG_FUNCTION_ARGS)
+{
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2] = {false, false};
+	uint32		h;
+	uint32		sh;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	compute_query_hashes(query, &h, &sh);
+	values[0] = Int64GetDatum((int64) h);
+	values[1] = Int64GetDatum((int64) sh);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 
 void
 _PG_init(void)
@@ -2833,6 +2922,21 @@ _PG_init(void)
 							   NULL,
 							   NULL);
 
+	DefineCustomBoolVariable("tee_adaptive_selector.use_plan_tracker",
+							 "Avoid component combinations that tee_plan_tracker saw cause plan regressions.",
+							 NULL,
+							 &tee_adaptive_use_plan_tracker,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	plan_tracker = (TeePlanTrackerRoutine **)
+		find_rendezvous_variable(TEE_PLAN_TRACKER_RENDEZVOUS);
+	*find_rendezvous_variable(TEE_ADAPTIVE_SELECTOR_RENDEZVOUS) = &last_decision;
+
 	DefineCustomBoolVariable("tee_adaptive_selector.log_decisions",
 							 "Log per-query TEE component decisions and timestamps.",
 							 NULL,
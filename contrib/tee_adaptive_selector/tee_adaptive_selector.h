@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_adaptive_selector.h
+ *	  Interface of tee_adaptive_selector for other modules.
+ *
+ * Once tee_adaptive_selector is loaded, the rendezvous variable
+ * TEE_ADAPTIVE_SELECTOR_RENDEZVOUS points to a TeeSelectorDecision telling
+ * how the TEE components of the most recently planned statement were chosen.
+ * It is reset at the start of each planner call, so a module reading it
+ * after planning sees the decision for that plan.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * contrib/tee_adaptive_selector/tee_adaptive_selector.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TEE_ADAPTIVE_SELECTOR_H
+#define TEE_ADAPTIVE_SELECTOR_H
+
+#define TEE_ADAPTIVE_SELECTOR_RENDEZVOUS	"tee_adaptive_selector"
+
+typedef enum TeeSelectorDecision
+{
+	TEE_DECISION_NONE,			/* selector disabled or not involved */
+	TEE_DECISION_RULES,			/* scored by the workload rules */
+	TEE_DECISION_CACHE,			/* taken from the decision cache */
+	TEE_DECISION_TRACKER		/* tee_plan_tracker regression fallback */
+} TeeSelectorDecision;
+
+#endif							/* TEE_ADAPTIVE_SELECTOR_H */
@@ -0,0 +1,14 @@
+
+# Copyright (c) 2021-2023, PostgreSQL Global Development Group
+
+use strict;
+use warnings;
+
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+program_help_ok('tee_bench');
+program_version_ok('tee_bench');
+program_options_handling_ok('tee_bench');
+
+done_testing();
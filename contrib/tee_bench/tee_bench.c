@@ -0,0 +1,759 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_bench.c
+ *	  Benchmark a query workload under every combination of the TEE planner
+ *	  components, and write the adaptive selector's cache from the results.
+ *
+ * Each *.sql file of each workload directory is run under all eight on/off
+ * combinations of the cardinality estimator (CE), cost model (CM) and join
+ * enumerator (JN), with a number of repetitions.  The order of combinations
+ * is rotated between repetitions so that none of them systematically runs
+ * first.  Caches are either warmed by unmeasured runs, or emptied before
+ * every measured run by a user-supplied command.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_bench/tee_bench.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "common/logging.h"
+#include "common/string.h"
+#include "getopt_long.h"
+#include "lib/stringinfo.h"
+#include "libpq-fe.h"
+#include "portability/instr_time.h"
+#include "tee_plan_tracker/tee_plan_tracker.h"
+
+/* the selector holds at most this many queries per cache file */
+#define SELECTOR_MAX_ENTRIES	256
+
+typedef struct ComboStats
+{
+	double	   *times;			/* successful run times, in ms */
+	int			nruns;
+	int			nfailures;
+	double		median;
+	double		p95;
+	double		ci_low;			/* 95% confidence interval of the median */
+	double		ci_high;
+} ComboStats;
+
+typedef struct BenchQuery
+{
+	char	   *filename;
+	char	   *sql;
+	uint32		hash;			/* selector cache key */
+	uint32		sh;				/* selector similarity hash */
+	ComboStats	combos[TEE_COMPONENT_COMBINATIONS];
+} BenchQuery;
+
+typedef struct Workload
+{
+	char	   *name;
+	char	   *dir;
+	char	   *dbname;
+	BenchQuery *queries;
+	int			nqueries;
+} Workload;
+
+/* options */
+static const char *progname;
+static char *pghost = NULL;
+static char *pgport = NULL;
+static char *username = NULL;
+static char *default_dbname = NULL;
+static int	repetitions = 5;
+static int	warmup_runs = 1;
+static char *cold_command = NULL;
+static int	statement_timeout = 0;
+static char *cache_dir = NULL;
+static char *output_file = NULL;
+static bool verbose = false;
+
+
+static void
+usage(void)
+{
+	printf("%s runs query workloads under every combination of the TEE planner\n"
+		   "components, and writes tee_adaptive_selector cache files from the results.\n\n",
+		   progname);
+	printf("Usage:\n");
+	printf("  %s [OPTION]... WORKLOAD_DIR[=DBNAME]...\n\n", progname);
+	printf("Options:\n");
+	printf("  -C, --cache-dir=DIR          write selector cache files into DIR\n");
+	printf("      --cold-command=COMMAND   run COMMAND to empty caches before each run\n");
+	printf("  -d, --dbname=DBNAME          database for workloads not naming their own\n");
+	printf("  -n, --repetitions=NUM        measured runs per combination (default: 5)\n");
+	printf("  -o, --output=FILE            write per-query statistics as CSV to FILE\n");
+	printf("  -t, --timeout=MS             cancel runs taking longer than MS milliseconds\n");
+	printf("  -v, --verbose                report every combination, not just the best\n");
+	printf("  -V, --version                output version information, then exit\n");
+	printf("  -W, --warmup=NUM             warm-up runs per combination (default: 1)\n");
+	printf("  -?, --help                   show this help, then exit\n");
+	printf("\nConnection options:\n");
+	printf("  -h, --host=HOSTNAME          database server host or socket directory\n");
+	printf("  -p, --port=PORT              database server port\n");
+	printf("  -U, --username=USERNAME      connect as specified database user\n");
+	printf("\nThe workload's name is its directory name without \"_queries\".  The\n"
+		   "cardinality estimation, cost model and join enumerator modules must be loaded\n"
+		   "on the server; writing cache files also needs tee_adaptive_selector 1.1.\n");
+	printf("\nReport bugs to <%s>.\n", PACKAGE_BUGREPORT);
+	printf("%s home page: <%s>\n", PACKAGE_NAME, PACKAGE_URL);
+}
+
+static int
+parse_int_option(const char *arg, const char *optname, int min)
+{
+	char	   *endptr;
+	long		val;
+
+	errno = 0;
+	val = strtol(arg, &endptr, 10);
+	if (*endptr != '\0' || errno != 0 || val < min || val > PG_INT32_MAX)
+		pg_fatal("invalid value \"%s\" for option %s", arg, optname);
+	return (int) val;
+}
+
+/*
+ * Derive a workload's name from its directory, following the repository's
+ * workloads/<name>_queries layout.  The Stack Overflow workload is called
+ * "stack" everywhere else.
+ */
+static char *
+workload_name(const char *dir)
+{
+	const char *base = last_dir_separator(dir);
+	char	   *name;
+	size_t		len;
+
+	base = base ? base + 1 : dir;
+	name = pg_strdup(base);
+	len = strlen(name);
+	if (len > 8 && strcmp(name + len - 8, "_queries") == 0)
+		name[len - 8] = '\0';
+	if (strcmp(name, "so") == 0)
+	{
+		pg_free(name);
+		name = pg_strdup("stack");
+	}
+	return name;
+}
+
+static int
+filename_cmp(const void *a, const void *b)
+{
+	return strcmp(((const BenchQuery *) a)->filename,
+				  ((const BenchQuery *) b)->filename);
+}
+
+static char *
+read_file(const char *path)
+{
+	StringInfoData buf;
+	FILE	   *f;
+	char		tmp[8192];
+	size_t		nread;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		pg_fatal("could not open file \"%s\": %m", path);
+	initStringInfo(&buf);
+	while ((nread = fread(tmp, 1, sizeof(tmp), f)) > 0)
+		appendBinaryStringInfo(&buf, tmp, nread);
+	if (ferror(f))
+		pg_fatal("could not read file \"%s\": %m", path);
+	fclose(f);
+	return buf.data;
+}
+
+/*
+ * Read all non-empty *.sql files of a workload directory, in name order.
+ */
+static void
+load_workload(Workload *wl)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	int			maxqueries = 64;
+
+	dir = opendir(wl->dir);
+	if (dir == NULL)
+		pg_fatal("could not open directory \"%s\": %m", wl->dir);
+
+	wl->queries = pg_malloc0(maxqueries * sizeof(BenchQuery));
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		size_t		len = strlen(de->d_name);
+		char		path[MAXPGPATH];
+		char	   *sql;
+
+		if (len <= 4 || strcmp(de->d_name + len - 4, ".sql") != 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", wl->dir, de->d_name);
+		sql = read_file(path);
+		if (strspn(sql, " \t\r\n") == strlen(sql))
+		{
+			pg_free(sql);
+			continue;
+		}
+
+		if (wl->nqueries >= maxqueries)
+		{
+			wl->queries = pg_realloc(wl->queries,
+									 maxqueries * 2 * sizeof(BenchQuery));
+			memset(wl->queries + maxqueries, 0, maxqueries * sizeof(BenchQuery));
+			maxqueries *= 2;
+		}
+		wl->queries[wl->nqueries].filename = pg_strdup(de->d_name);
+		wl->queries[wl->nqueries].sql = sql;
+		wl->nqueries++;
+	}
+	if (errno)
+		pg_fatal("could not read directory \"%s\": %m", wl->dir);
+	closedir(dir);
+
+	if (wl->nqueries == 0)
+		pg_fatal("no queries found in directory \"%s\"", wl->dir);
+	qsort(wl->queries, wl->nqueries, sizeof(BenchQuery), filename_cmp);
+
+	for (int i = 0; i < wl->nqueries; i++)
+		for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+			wl->queries[i].combos[c].times =
+				pg_malloc(repetitions * sizeof(double));
+}
+
+static void
+run_command(PGconn *conn, const char *sql)
+{
+	PGresult   *res = PQexec(conn, sql);
+
+	if (PQresultStatus(res) != PGRES_COMMAND_OK &&
+		PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("query failed: %s\nquery was: %s", PQerrorMessage(conn), sql);
+	PQclear(res);
+}
+
+/*
+ * Connect to a workload's database and prepare the session: the selector is
+ * disabled, so that it doesn't override the combination being measured, and
+ * the three components must really be loaded, since setting the GUCs of an
+ * unloaded module would silently measure the baseline eight times.
+ */
+static PGconn *
+connect_db(const char *dbname)
+{
+	const char *keywords[6];
+	const char *values[6];
+	PGconn	   *conn;
+	PGresult   *res;
+	char		sql[128];
+
+	keywords[0] = "host";
+	values[0] = pghost;
+	keywords[1] = "port";
+	values[1] = pgport;
+	keywords[2] = "user";
+	values[2] = username;
+	keywords[3] = "dbname";
+	values[3] = dbname;
+	keywords[4] = "fallback_application_name";
+	values[4] = progname;
+	keywords[5] = NULL;
+	values[5] = NULL;
+
+	conn = PQconnectdbParams(keywords, values, true);
+	if (conn == NULL)
+		pg_fatal("could not connect to database \"%s\", out of memory",
+				 dbname ? dbname : "");
+	if (PQstatus(conn) != CONNECTION_OK)
+		pg_fatal("%s", PQerrorMessage(conn));
+
+	res = PQexec(conn,
+				 "SELECT count(*) FROM pg_catalog.pg_settings WHERE name IN "
+				 "('tee_cardinality_estimation.enable_sev_snp_ce', "
+				 "'tee_cost_model.enable', 'tee_join_enumerator.jn_enabled')");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("query failed: %s", PQerrorMessage(conn));
+	if (strcmp(PQgetvalue(res, 0, 0), "3") != 0)
+	{
+		pg_log_error("the TEE planner components are not all loaded in database \"%s\"",
+					 PQdb(conn));
+		pg_log_error_hint("Add tee_cardinality_estimation, tee_cost_model and tee_join_enumerator to shared_preload_libraries.");
+		exit(1);
+	}
+	PQclear(res);
+
+	run_command(conn, "SET tee_adaptive_selector.enable = off");
+	snprintf(sql, sizeof(sql), "SET statement_timeout = %d", statement_timeout);
+	run_command(conn, sql);
+
+	return conn;
+}
+
+static void
+set_combo(PGconn *conn, int combo)
+{
+	char		sql[256];
+
+	snprintf(sql, sizeof(sql),
+			 "SET tee_cardinality_estimation.enable_sev_snp_ce = %s; "
+			 "SET tee_cost_model.enable = %s; "
+			 "SET tee_join_enumerator.jn_enabled = %s",
+			 (combo & TEE_COMPONENT_CE) ? "on" : "off",
+			 (combo & TEE_COMPONENT_CM) ? "on" : "off",
+			 (combo & TEE_COMPONENT_JN) ? "on" : "off");
+	run_command(conn, sql);
+}
+
+/*
+ * Run a query to completion, returning its elapsed time in milliseconds as
+ * seen by the client, or -1 if it failed.
+ */
+static double
+time_query(PGconn *conn, const BenchQuery *q)
+{
+	instr_time	start,
+				duration;
+	PGresult   *res;
+	bool		ok = true;
+
+	INSTR_TIME_SET_CURRENT(start);
+	if (!PQsendQuery(conn, q->sql))
+		pg_fatal("could not send query: %s", PQerrorMessage(conn));
+	while ((res = PQgetResult(conn)) != NULL)
+	{
+		if (PQresultStatus(res) != PGRES_COMMAND_OK &&
+			PQresultStatus(res) != PGRES_TUPLES_OK)
+		{
+			if (ok)
+				pg_log_warning("query \"%s\" failed: %s",
+							   q->filename, PQresultErrorMessage(res));
+			ok = false;
+		}
+		PQclear(res);
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	if (PQstatus(conn) != CONNECTION_OK)
+		pg_fatal("connection to server lost: %s", PQerrorMessage(conn));
+
+	return ok ? INSTR_TIME_GET_MILLISEC(duration) : -1;
+}
+
+/*
+ * Run the command that empties the caches.  It may well restart the server,
+ * so the connection is re-established afterwards.
+ */
+static PGconn *
+make_cold(PGconn *conn, const char *dbname)
+{
+	int			rc;
+
+	PQfinish(conn);
+	fflush(NULL);
+	rc = system(cold_command);
+	if (rc != 0)
+		pg_fatal("cold-cache command failed with exit status %d: %s",
+				 rc, cold_command);
+	return connect_db(dbname);
+}
+
+static void
+fetch_query_hashes(PGconn *conn, Workload *wl)
+{
+	for (int i = 0; i < wl->nqueries; i++)
+	{
+		BenchQuery *q = &wl->queries[i];
+		const char *params[1] = {q->sql};
+		PGresult   *res;
+
+		res = PQexecParams(conn,
+						   "SELECT hash, sh FROM tee_adaptive_selector_query_hash($1)",
+						   1, NULL, params, NULL, NULL, 0);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		{
+			pg_log_error("could not compute selector hashes: %s",
+						 PQerrorMessage(conn));
+			pg_log_error_hint("Install or update the tee_adaptive_selector extension to version 1.1 in database \"%s\".",
+							  PQdb(conn));
+			exit(1);
+		}
+		q->hash = (uint32) strtoul(PQgetvalue(res, 0, 0), NULL, 10);
+		q->sh = (uint32) strtoul(PQgetvalue(res, 0, 1), NULL, 10);
+		PQclear(res);
+	}
+}
+
+static int
+double_cmp(const void *a, const void *b)
+{
+	double		x = *(const double *) a;
+	double		y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Compute median, 95th percentile and a distribution-free 95% confidence
+ * interval for the median.  The interval's bounds are the order statistics
+ * at ranks n/2 -/+ 1.96*sqrt(n)/2; with few runs it widens to the whole
+ * range of the sample, which is the honest answer.
+ */
+static void
+compute_stats(ComboStats *cs)
+{
+	int			n = cs->nruns;
+	double		half_width;
+	int			lo,
+				hi;
+
+	if (n == 0)
+		return;
+
+	qsort(cs->times, n, sizeof(double), double_cmp);
+	if (n % 2 == 1)
+		cs->median = cs->times[n / 2];
+	else
+		cs->median = (cs->times[n / 2 - 1] + cs->times[n / 2]) / 2;
+	cs->p95 = cs->times[(int) ceil(0.95 * n) - 1];
+
+	half_width = 1.96 * sqrt(n) / 2;
+	lo = (int) floor(n / 2.0 - half_width);
+	hi = (int) ceil(1 + n / 2.0 + half_width);
+	cs->ci_low = cs->times[Max(lo, 1) - 1];
+	cs->ci_high = cs->times[Min(hi, n) - 1];
+}
+
+static void
+run_workload(Workload *wl)
+{
+	PGconn	   *conn;
+
+	conn = connect_db(wl->dbname);
+	if (cache_dir)
+		fetch_query_hashes(conn, wl);
+
+	for (int i = 0; i < wl->nqueries; i++)
+	{
+		BenchQuery *q = &wl->queries[i];
+
+		if (verbose)
+			pg_log_info("running %s/%s (%d of %d)",
+						wl->name, q->filename, i + 1, wl->nqueries);
+
+		/* Warm-up runs are pointless if caches get emptied before each run */
+		if (cold_command == NULL)
+		{
+			for (int w = 0; w < warmup_runs; w++)
+			{
+				for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+				{
+					set_combo(conn, c);
+					(void) time_query(conn, q);
+				}
+			}
+		}
+
+		for (int r = 0; r < repetitions; r++)
+		{
+			for (int k = 0; k < TEE_COMPONENT_COMBINATIONS; k++)
+			{
+				int			c = (k + r) % TEE_COMPONENT_COMBINATIONS;
+				ComboStats *cs = &q->combos[c];
+				double		t;
+
+				/* don't keep rerunning a combination that failed or timed out */
+				if (cs->nfailures > 0)
+					continue;
+
+				if (cold_command)
+					conn = make_cold(conn, wl->dbname);
+				set_combo(conn, c);
+				t = time_query(conn, q);
+				if (t < 0)
+					cs->nfailures++;
+				else
+					cs->times[cs->nruns++] = t;
+			}
+		}
+
+		for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+			compute_stats(&q->combos[c]);
+	}
+
+	PQfinish(conn);
+}
+
+/*
+ * Return the combination with the lowest median, considering only those
+ * that never failed, or -1 if none qualifies.
+ */
+static int
+best_combo(const BenchQuery *q)
+{
+	int			best = -1;
+
+	for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+	{
+		const ComboStats *cs = &q->combos[c];
+
+		if (cs->nfailures > 0 || cs->nruns == 0)
+			continue;
+		if (best < 0 || cs->median < q->combos[best].median)
+			best = c;
+	}
+	return best;
+}
+
+static void
+report_workload(const Workload *wl, FILE *out)
+{
+	printf("workload \"%s\" (%d queries, database \"%s\"):\n",
+		   wl->name, wl->nqueries, wl->dbname ? wl->dbname : "");
+
+	for (int i = 0; i < wl->nqueries; i++)
+	{
+		const BenchQuery *q = &wl->queries[i];
+		const ComboStats *base = &q->combos[0];
+		int			best = best_combo(q);
+
+		if (best < 0)
+			printf("  %-16s all combinations failed\n", q->filename);
+		else if (base->nfailures > 0 || base->nruns == 0)
+			printf("  %-16s best %-10s median %.3f ms (baseline failed)\n",
+				   q->filename, tee_component_name(best), q->combos[best].median);
+		else
+			printf("  %-16s best %-10s median %.3f ms, speedup %.3f over baseline\n",
+				   q->filename, tee_component_name(best), q->combos[best].median,
+				   base->median / q->combos[best].median);
+
+		for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+		{
+			const ComboStats *cs = &q->combos[c];
+
+			if (verbose)
+			{
+				if (cs->nfailures > 0)
+					printf("      %-10s failed\n", tee_component_name(c));
+				else
+					printf("      %-10s median %.3f ms, p95 %.3f ms, 95%% CI [%.3f, %.3f] ms\n",
+						   tee_component_name(c), cs->median, cs->p95,
+						   cs->ci_low, cs->ci_high);
+			}
+			if (out)
+				fprintf(out, "%s,%s,%s,%d,%d,%d,%.3f,%.3f,%.3f,%.3f\n",
+						wl->name, q->filename, tee_component_name(c), c,
+						cs->nruns, cs->nfailures,
+						cs->median, cs->p95, cs->ci_low, cs->ci_high);
+		}
+	}
+}
+
+/*
+ * Write the workload's selector cache file.  Every query gets a full bucket
+ * of measured combinations, fastest first, so the selector uses the best one
+ * directly instead of exploring.  Combinations that failed are left out.
+ */
+static void
+write_cache_file(const Workload *wl)
+{
+	char		path[MAXPGPATH];
+	FILE	   *f;
+
+	if (wl->nqueries > SELECTOR_MAX_ENTRIES)
+		pg_log_warning("workload \"%s\" has %d queries, but the selector only keeps the first %d",
+					   wl->name, wl->nqueries, SELECTOR_MAX_ENTRIES);
+
+	snprintf(path, sizeof(path), "%s/%s_cache.csv", cache_dir, wl->name);
+	f = fopen(path, "w");
+	if (f == NULL)
+		pg_fatal("could not open file \"%s\" for writing: %m", path);
+
+	fprintf(f, "hash,version,time,sh,cb\n");
+	for (int i = 0; i < wl->nqueries; i++)
+	{
+		const BenchQuery *q = &wl->queries[i];
+		int			order[TEE_COMPONENT_COMBINATIONS];
+		int			n = 0;
+
+		for (int c = 0; c < TEE_COMPONENT_COMBINATIONS; c++)
+		{
+			int			j;
+
+			if (q->combos[c].nfailures > 0 || q->combos[c].nruns == 0)
+				continue;
+			/* insertion sort by median */
+			for (j = n; j > 0 &&
+				 q->combos[order[j - 1]].median > q->combos[c].median; j--)
+				order[j] = order[j - 1];
+			order[j] = c;
+			n++;
+		}
+
+		for (int v = 0; v < n; v++)
+			fprintf(f, "%u,%d,%.3f,%u,%d\n",
+					q->hash, v, q->combos[order[v]].median, q->sh, order[v]);
+	}
+
+	if (fclose(f) != 0)
+		pg_fatal("could not write file \"%s\": %m", path);
+	printf("wrote selector cache for workload \"%s\" to \"%s\"\n",
+		   wl->name, path);
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"cache-dir", required_argument, NULL, 'C'},
+		{"dbname", required_argument, NULL, 'd'},
+		{"host", required_argument, NULL, 'h'},
+		{"repetitions", required_argument, NULL, 'n'},
+		{"output", required_argument, NULL, 'o'},
+		{"port", required_argument, NULL, 'p'},
+		{"timeout", required_argument, NULL, 't'},
+		{"username", required_argument, NULL, 'U'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"version", no_argument, NULL, 'V'},
+		{"warmup", required_argument, NULL, 'W'},
+		{"cold-command", required_argument, NULL, 1},
+		{"help", no_argument, NULL, '?'},
+		{NULL, 0, NULL, 0}
+	};
+
+	Workload   *workloads;
+	int			nworkloads;
+	FILE	   *out = NULL;
+	int			c;
+	int			optindex;
+
+	pg_logging_init(argv[0]);
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("tee_bench (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "C:d:h:n:o:p:t:U:vW:",
+							long_options, &optindex)) != -1)
+	{
+		switch (c)
+		{
+			case 'C':
+				cache_dir = pg_strdup(optarg);
+				break;
+			case 'd':
+				default_dbname = pg_strdup(optarg);
+				break;
+			case 'h':
+				pghost = pg_strdup(optarg);
+				break;
+			case 'n':
+				repetitions = parse_int_option(optarg, "-n/--repetitions", 1);
+				break;
+			case 'o':
+				output_file = pg_strdup(optarg);
+				break;
+			case 'p':
+				pgport = pg_strdup(optarg);
+				break;
+			case 't':
+				statement_timeout = parse_int_option(optarg, "-t/--timeout", 0);
+				break;
+			case 'U':
+				username = pg_strdup(optarg);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			case 'W':
+				warmup_runs = parse_int_option(optarg, "-W/--warmup", 0);
+				break;
+			case 1:
+				cold_command = pg_strdup(optarg);
+				break;
+			default:
+				/* getopt_long already emitted a complaint */
+				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+				exit(1);
+		}
+	}
+
+	if (optind >= argc)
+	{
+		pg_log_error("no workload directory specified");
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+
+	if (cache_dir)
+	{
+		struct stat st;
+
+		if (stat(cache_dir, &st) != 0 || !S_ISDIR(st.st_mode))
+			pg_fatal("cache directory \"%s\" does not exist", cache_dir);
+	}
+
+	/* Load all workloads up front, so that mistakes show up right away */
+	nworkloads = argc - optind;
+	workloads = pg_malloc0(nworkloads * sizeof(Workload));
+	for (int i = 0; i < nworkloads; i++)
+	{
+		Workload   *wl = &workloads[i];
+		char	   *arg = pg_strdup(argv[optind + i]);
+		char	   *eq = strchr(arg, '=');
+
+		if (eq)
+		{
+			*eq = '\0';
+			wl->dbname = eq + 1;
+		}
+		else
+			wl->dbname = default_dbname;
+		canonicalize_path(arg);
+		wl->dir = arg;
+		wl->name = workload_name(arg);
+		load_workload(wl);
+	}
+
+	if (output_file)
+	{
+		out = fopen(output_file, "w");
+		if (out == NULL)
+			pg_fatal("could not open file \"%s\" for writing: %m", output_file);
+		fprintf(out, "workload,query,combo,cb,runs,failures,median_ms,p95_ms,ci_low_ms,ci_high_ms\n");
+	}
+
+	for (int i = 0; i < nworkloads; i++)
+	{
+		run_workload(&workloads[i]);
+		report_workload(&workloads[i], out);
+		if (cache_dir)
+			write_cache_file(&workloads[i]);
+	}
+
+	if (out && fclose(out) != 0)
+		pg_fatal("could not write file \"%s\": %m", output_file);
+
+	return 0;
+}
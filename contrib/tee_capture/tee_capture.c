@@ -0,0 +1,728 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_capture.c
+ *	  Capture client workloads for replay by tee_replay.
+ *
+ * To compare the same traffic on an ordinary and a confidential VM, the
+ * workload has to be recorded once and replayed faithfully on both.  This
+ * module records every completed top-level statement of every client
+ * session: its text, bind parameters, arrival time, duration and row count,
+ * along with the settings the session was started with.  Sessions are kept
+ * in separate files, so that tee_replay can reproduce the original
+ * concurrency and inter-arrival times.  See tee_capture.h for the format.
+ *
+ * Plannable statements are recorded at ExecutorEnd; this includes those
+ * executed through the extended query protocol, whose bind parameters are
+ * the executor's ParamListInfo.  Utility statements (transaction control,
+ * SET, PREPARE/EXECUTE, COPY...) are recorded by the ProcessUtility hook.
+ *
+ * A statement that fails while executing is recorded too, flagged as failed,
+ * since it leaves its transaction block aborted: the COMMIT that ends the
+ * block is then executed as ROLLBACK, and is flagged as such, so that a
+ * replay ends the transaction the same way even if the statement succeeds
+ * there.  Statements that fail before execution, in parse analysis or
+ * planning, are not recorded.
+ *
+ * Nothing that could fail again may run while an error is propagating, so
+ * the statement text and bind parameters are formatted when the statement
+ * starts, into memory that outlives the executor.  The error path merely
+ * marks the statement failed; its record is written by the transaction or
+ * subtransaction abort callback.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_capture/tee_capture.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "executor/executor.h"
+#include "lib/ilist.h"
+#include "lib/stringinfo.h"
+#include "libpq/libpq-be.h"
+#include "miscadmin.h"
+#include "nodes/queryjumble.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "tcop/utility.h"
+#include "tee_capture.h"
+#include "utils/guc.h"
+#include "utils/guc_tables.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+PG_MODULE_MAGIC;
+
+/*
+ * A top-level statement being executed, or one that failed and is waiting
+ * for its (sub)transaction abort to be written.  It lives in CaptureContext.
+ * A plannable statement is unlinked and freed by a callback when the
+ * executor's query context goes away, unless it failed first.
+ */
+typedef struct CapturedQuery
+{
+	dlist_node	node;
+	QueryDesc  *queryDesc;		/* NULL for utility statements */
+	TimestampTz start;
+	TimestampTz end;			/* end of the latest run, or 0 */
+	uint64		rows;
+	uint64		queryId;
+	uint8		flags;
+	StringInfoData body;		/* statement text and bind parameters */
+	MemoryContextCallback *callback;	/* in the executor's query context */
+} CapturedQuery;
+
+/* GUC variables */
+static bool capture_enabled = false;
+static char *capture_directory = NULL;
+
+/* Current nesting depth of ExecutorRun/Finish and ProcessUtility calls */
+static int	nesting_level = 0;
+
+/* Top-level plannable statements being executed */
+static dlist_head active_queries = DLIST_STATIC_INIT(active_queries);
+
+/* Top-level statements that failed, to be written at abort */
+static dlist_head failed_queries = DLIST_STATIC_INIT(failed_queries);
+
+/* Memory context for CapturedQuery entries */
+static MemoryContext CaptureContext = NULL;
+
+/* This session's capture file, and whether writing it failed */
+static FILE *capture_file = NULL;
+static char *capture_path = NULL;
+static bool capture_failed = false;
+
+/* When the previous captured statement of this session ended */
+static TimestampTz last_end = 0;
+
+/* Saved hook values */
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+static ProcessUtility_hook_type prev_ProcessUtility = NULL;
+
+
+/*
+ * Is the statement starting at the current nesting level to be captured?
+ * Only client sessions are, not background workers.
+ */
+#define capture_active() \
+	(capture_enabled && !capture_failed && nesting_level == 0 && \
+	 MyBackendType == B_BACKEND && MyProcPort != NULL)
+
+static void
+put_varint(StringInfo buf, uint64 value)
+{
+	while (value >= 0x80)
+	{
+		appendStringInfoChar(buf, (char) ((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	appendStringInfoChar(buf, (char) value);
+}
+
+static void
+put_string(StringInfo buf, const char *str, int len)
+{
+	put_varint(buf, len);
+	appendBinaryStringInfo(buf, str, len);
+}
+
+static void
+put_cstring(StringInfo buf, const char *str)
+{
+	put_string(buf, str ? str : "", str ? strlen(str) : 0);
+}
+
+/*
+ * Stop capturing in this session after a file error.  errno must be set.
+ */
+static void
+capture_give_up(void)
+{
+	ereport(WARNING,
+			(errcode_for_file_access(),
+			 errmsg("could not write capture file \"%s\": %m", capture_path),
+			 errdetail("Workload capture is stopped for this session.")));
+	if (capture_file)
+		fclose(capture_file);
+	capture_file = NULL;
+	capture_failed = true;
+}
+
+static void
+capture_write(StringInfo buf)
+{
+	if (fwrite(buf->data, 1, buf->len, capture_file) != buf->len)
+		capture_give_up();
+}
+
+static void
+capture_shutdown(int code, Datum arg)
+{
+	if (capture_file)
+		fclose(capture_file);
+	capture_file = NULL;
+}
+
+/*
+ * Append the settings a replay has to reproduce: those given at connection
+ * time or changed by SET before capture began.  Later SETs are captured as
+ * statements.
+ */
+static void
+put_session_settings(StringInfo buf)
+{
+	struct config_generic **vars;
+	int			nvars;
+	StringInfoData settings;
+	int			nsettings = 0;
+
+	initStringInfo(&settings);
+	vars = get_guc_variables(&nvars);
+	for (int i = 0; i < nvars; i++)
+	{
+		struct config_generic *conf = vars[i];
+		char	   *value;
+
+		if (conf->source != PGC_S_CLIENT && conf->source != PGC_S_SESSION)
+			continue;
+		if (conf->context != PGC_USERSET && conf->context != PGC_SUSET)
+			continue;
+		if (conf->flags & (GUC_NO_RESET_ALL | GUC_NO_SHOW_ALL))
+			continue;
+		if (strncmp(conf->name, "tee_capture.", 12) == 0)
+			continue;
+
+		value = ShowGUCOption(conf, false);
+		put_cstring(&settings, conf->name);
+		put_cstring(&settings, value);
+		pfree(value);
+		nsettings++;
+	}
+
+	put_varint(buf, nsettings);
+	appendBinaryStringInfo(buf, settings.data, settings.len);
+	pfree(settings.data);
+}
+
+/*
+ * Open this session's capture file if needed, writing the session record.
+ * Returns false if capture isn't possible.
+ */
+static bool
+capture_open(void)
+{
+	static bool exit_registered = false;
+	char		path[MAXPGPATH];
+	StringInfoData buf;
+
+	if (capture_file)
+		return true;
+	if (capture_failed)
+		return false;
+
+	snprintf(path, sizeof(path), "%s/" INT64_FORMAT "-%d" TEE_CAPTURE_SUFFIX,
+			 capture_directory, (int64) MyStartTimestamp, MyProcPid);
+	capture_path = MemoryContextStrdup(TopMemoryContext, path);
+
+	if (MakePGDirectory(capture_directory) < 0 && errno != EEXIST)
+	{
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not create directory \"%s\": %m",
+						capture_directory),
+				 errdetail("Workload capture is stopped for this session.")));
+		capture_failed = true;
+		return false;
+	}
+
+	capture_file = fopen(path, PG_BINARY_W);
+	if (capture_file == NULL)
+	{
+		ereport(WARNING,
+				(errcode_for_file_access(),
+				 errmsg("could not create capture file \"%s\": %m", path),
+				 errdetail("Workload capture is stopped for this session.")));
+		capture_failed = true;
+		return false;
+	}
+
+	if (!exit_registered)
+	{
+		on_proc_exit(capture_shutdown, (Datum) 0);
+		exit_registered = true;
+	}
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, TEE_CAPTURE_MAGIC, TEE_CAPTURE_MAGIC_LEN);
+	appendStringInfoChar(&buf, TEE_CAPTURE_VERSION);
+	appendStringInfoChar(&buf, TEE_CAPTURE_SESSION);
+	put_varint(&buf, MyStartTimestamp);
+	put_varint(&buf, MyProcPid);
+	put_cstring(&buf, MyProcPort->database_name);
+	put_cstring(&buf, MyProcPort->user_name);
+	put_cstring(&buf, application_name);
+	put_session_settings(&buf);
+	capture_write(&buf);
+	pfree(buf.data);
+
+	return capture_file != NULL;
+}
+
+/*
+ * Set up a CapturedQuery for a top-level statement that is starting, with
+ * its text and bind parameters formatted.  The statement is the part of
+ * sourceText given by location and len, as in PlannedStmt.
+ */
+static CapturedQuery *
+new_query(QueryDesc *queryDesc, uint64 queryId, uint8 flags,
+		  const char *sourceText, int location, int len,
+		  ParamListInfo params)
+{
+	MemoryContext oldcontext;
+	CapturedQuery *cq;
+	const char *text;
+	int			nparams = params ? params->numParams : 0;
+
+	if (CaptureContext == NULL)
+		CaptureContext = AllocSetContextCreate(TopMemoryContext,
+											   "tee_capture",
+											   ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(CaptureContext);
+
+	cq = palloc0(sizeof(CapturedQuery));
+	cq->queryDesc = queryDesc;
+	cq->start = Max(GetCurrentStatementStartTimestamp(), last_end);
+	cq->queryId = queryId;
+	cq->flags = flags;
+	if (nparams > 0)
+		cq->flags |= TEE_CAPTURE_EXTENDED;
+
+	initStringInfo(&cq->body);
+	text = CleanQuerytext(sourceText, &location, &len);
+
+	put_string(&cq->body, text, len);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * Parameter values are formatted in the caller's context, since output
+	 * functions may leak.
+	 */
+	put_varint(&cq->body, nparams);
+	for (int i = 0; i < nparams; i++)
+	{
+		ParamExternData *prm;
+		ParamExternData prmdata;
+
+		if (params->paramFetch != NULL)
+			prm = params->paramFetch(params, i + 1, false, &prmdata);
+		else
+			prm = &params->params[i];
+
+		put_varint(&cq->body, prm->ptype);
+		if (prm->isnull || !OidIsValid(prm->ptype))
+			put_varint(&cq->body, 0);
+		else
+		{
+			Oid			typoutput;
+			bool		typisvarlena;
+			char	   *value;
+			int			valuelen;
+
+			getTypeOutputInfo(prm->ptype, &typoutput, &typisvarlena);
+			value = OidOutputFunctionCall(typoutput, prm->value);
+			valuelen = strlen(value);
+			put_varint(&cq->body, valuelen + 1);
+			appendBinaryStringInfo(&cq->body, value, valuelen);
+			pfree(value);
+		}
+	}
+
+	return cq;
+}
+
+static void
+free_query(CapturedQuery *cq)
+{
+	pfree(cq->body.data);
+	pfree(cq);
+}
+
+/*
+ * Write the statement record of a CapturedQuery whose end, row count and
+ * flags are set.
+ */
+static void
+capture_query(CapturedQuery *cq)
+{
+	MemoryContext oldcontext;
+	StringInfoData buf;
+
+	if (!capture_open())
+		return;
+
+	oldcontext = MemoryContextSwitchTo(CaptureContext);
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, TEE_CAPTURE_STATEMENT);
+	put_varint(&buf, Max(cq->start - MyStartTimestamp, 0));
+	put_varint(&buf, Max(cq->end - cq->start, 0));
+	put_varint(&buf, cq->rows);
+	put_varint(&buf, cq->queryId);
+	appendStringInfoChar(&buf, (char) cq->flags);
+	appendBinaryStringInfo(&buf, cq->body.data, cq->body.len);
+	capture_write(&buf);
+	pfree(buf.data);
+	MemoryContextSwitchTo(oldcontext);
+
+	last_end = cq->end;
+}
+
+static void
+forget_query(void *arg)
+{
+	CapturedQuery *cq = (CapturedQuery *) arg;
+
+	/* a failed statement is detached, and freed once it's written */
+	if (cq == NULL)
+		return;
+
+	dlist_delete(&cq->node);
+	free_query(cq);
+}
+
+static CapturedQuery *
+find_query(QueryDesc *queryDesc)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &active_queries)
+	{
+		CapturedQuery *cq = dlist_container(CapturedQuery, node, iter.cur);
+
+		if (cq->queryDesc == queryDesc)
+			return cq;
+	}
+	return NULL;
+}
+
+/* Note the end of a top-level run of the executor */
+static void
+note_run_end(QueryDesc *queryDesc)
+{
+	if (nesting_level == 0 && !dlist_is_empty(&active_queries))
+	{
+		CapturedQuery *cq = find_query(queryDesc);
+
+		if (cq)
+			cq->end = GetCurrentTimestamp();
+	}
+}
+
+/*
+ * Mark a top-level statement failed, while its error is propagating.  This
+ * must not do anything that could fail: the record is written at abort.
+ */
+static void
+mark_failed(CapturedQuery *cq, uint64 rows)
+{
+	cq->end = GetCurrentTimestamp();
+	cq->rows = rows;
+	cq->flags |= TEE_CAPTURE_FAILED;
+	dlist_push_tail(&failed_queries, &cq->node);
+}
+
+/*
+ * Note that a top-level run of the executor raised an error.  ExecutorEnd
+ * won't be called for the statement, so detach it from the executor's
+ * memory, which goes away at abort.
+ */
+static void
+note_run_failure(QueryDesc *queryDesc)
+{
+	CapturedQuery *cq;
+
+	if (nesting_level != 0 || dlist_is_empty(&active_queries))
+		return;
+	cq = find_query(queryDesc);
+	if (cq == NULL)
+		return;
+
+	cq->callback->arg = NULL;
+	cq->callback = NULL;
+	dlist_delete(&cq->node);
+	mark_failed(cq, queryDesc->estate->es_processed);
+}
+
+/* Write the records of the statements that failed, at abort */
+static void
+capture_failed_queries(void)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &failed_queries)
+	{
+		CapturedQuery *cq = dlist_container(CapturedQuery, node, iter.cur);
+
+		dlist_delete(&cq->node);
+		capture_query(cq);
+		free_query(cq);
+	}
+}
+
+/*
+ * Write failed statements at abort, and flush at transaction end, so that
+ * the file is current whenever the session is idle.
+ */
+static void
+capture_xact_callback(XactEvent event, void *arg)
+{
+	if (event == XACT_EVENT_ABORT)
+		capture_failed_queries();
+
+	if ((event == XACT_EVENT_COMMIT || event == XACT_EVENT_ABORT ||
+		 event == XACT_EVENT_PREPARE) &&
+		capture_file != NULL && fflush(capture_file) != 0)
+		capture_give_up();
+}
+
+/*
+ * A statement that fails after a SAVEPOINT aborts only the subtransaction.
+ */
+static void
+capture_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						 SubTransactionId parentSubid, void *arg)
+{
+	if (event == SUBXACT_EVENT_ABORT_SUB)
+		capture_failed_queries();
+}
+
+/*
+ * ExecutorStart hook: remember when a top-level statement arrived, and
+ * format its text and parameters.  It arrived when its message was received,
+ * which includes parsing and planning, or when the previous statement of the
+ * same message ended.
+ */
+static void
+capture_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (capture_active() && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+	{
+		MemoryContext cxt = queryDesc->estate->es_query_cxt;
+		PlannedStmt *pstmt = queryDesc->plannedstmt;
+		CapturedQuery *cq;
+
+		cq = new_query(queryDesc, pstmt->queryId, 0, queryDesc->sourceText,
+					   pstmt->stmt_location, pstmt->stmt_len,
+					   queryDesc->params);
+		cq->callback = MemoryContextAlloc(cxt, sizeof(MemoryContextCallback));
+		cq->callback->func = forget_query;
+		cq->callback->arg = cq;
+		MemoryContextRegisterResetCallback(cxt, cq->callback);
+		dlist_push_head(&active_queries, &cq->node);
+	}
+}
+
+/*
+ * ExecutorRun hook: all we need to do is track nesting depth, and the end
+ * of the run, since a portal may be dropped long after its last fetch.
+ */
+static void
+capture_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+					uint64 count, bool execute_once)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorRun)
+			prev_ExecutorRun(queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_CATCH();
+	{
+		nesting_level--;
+		note_run_failure(queryDesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	nesting_level--;
+
+	note_run_end(queryDesc);
+}
+
+/*
+ * ExecutorFinish hook: as above
+ */
+static void
+capture_ExecutorFinish(QueryDesc *queryDesc)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorFinish)
+			prev_ExecutorFinish(queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+	}
+	PG_CATCH();
+	{
+		nesting_level--;
+		note_run_failure(queryDesc);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	nesting_level--;
+
+	note_run_end(queryDesc);
+}
+
+/*
+ * ExecutorEnd hook: write the statement record.  The CapturedQuery is freed
+ * along with the executor's memory.
+ */
+static void
+capture_ExecutorEnd(QueryDesc *queryDesc)
+{
+	CapturedQuery *cq = NULL;
+
+	if (nesting_level == 0 && !dlist_is_empty(&active_queries))
+		cq = find_query(queryDesc);
+
+	if (cq)
+	{
+		if (cq->end == 0)
+			cq->end = GetCurrentTimestamp();
+		cq->rows = queryDesc->estate->es_processed;
+		capture_query(cq);
+	}
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * ProcessUtility hook: capture top-level utility statements.  Statements
+ * they execute themselves, such as the query of EXECUTE or DECLARE CURSOR,
+ * are nested and not captured separately.
+ */
+static void
+capture_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
+					   bool readOnlyTree,
+					   ProcessUtilityContext context,
+					   ParamListInfo params, QueryEnvironment *queryEnv,
+					   DestReceiver *dest, QueryCompletion *qc)
+{
+	CapturedQuery *cq = NULL;
+
+	if (capture_active())
+		cq = new_query(NULL, pstmt->queryId, TEE_CAPTURE_UTILITY,
+					   queryString, pstmt->stmt_location, pstmt->stmt_len,
+					   NULL);
+
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ProcessUtility)
+			prev_ProcessUtility(pstmt, queryString, readOnlyTree,
+								context, params, queryEnv,
+								dest, qc);
+		else
+			standard_ProcessUtility(pstmt, queryString, readOnlyTree,
+									context, params, queryEnv,
+									dest, qc);
+	}
+	PG_CATCH();
+	{
+		nesting_level--;
+		if (cq)
+			mark_failed(cq, qc ? qc->nprocessed : 0);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	nesting_level--;
+
+	if (cq == NULL)
+		return;
+
+	/*
+	 * COMMIT and PREPARE TRANSACTION report a ROLLBACK if the transaction
+	 * block had failed.
+	 */
+	if (IsA(pstmt->utilityStmt, TransactionStmt) &&
+		qc && qc->commandTag == CMDTAG_ROLLBACK)
+	{
+		TransactionStmt *stmt = (TransactionStmt *) pstmt->utilityStmt;
+
+		if (stmt->kind == TRANS_STMT_COMMIT ||
+			stmt->kind == TRANS_STMT_PREPARE)
+			cq->flags |= TEE_CAPTURE_ROLLED_BACK;
+	}
+
+	cq->end = GetCurrentTimestamp();
+	cq->rows = qc ? qc->nprocessed : 0;
+	capture_query(cq);
+	free_query(cq);
+}
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	DefineCustomBoolVariable("tee_capture.enable",
+							 "Captures the statements of client sessions for replay.",
+							 NULL,
+							 &capture_enabled,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomStringVariable("tee_capture.directory",
+							   "Sets the directory capture files are written to.",
+							   "A relative path is relative to the data directory.",
+							   &capture_directory,
+							   "pg_tee_capture",
+							   PGC_SIGHUP,
+							   GUC_SUPERUSER_ONLY,
+							   NULL,
+							   NULL,
+							   NULL);
+
+	MarkGUCPrefixReserved("tee_capture");
+
+	/* statements are grouped by query identifier when compared */
+	EnableQueryId();
+
+	RegisterXactCallback(capture_xact_callback, NULL);
+	RegisterSubXactCallback(capture_subxact_callback, NULL);
+
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = capture_ExecutorStart;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = capture_ExecutorRun;
+	prev_ExecutorFinish = ExecutorFinish_hook;
+	ExecutorFinish_hook = capture_ExecutorFinish;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = capture_ExecutorEnd;
+	prev_ProcessUtility = ProcessUtility_hook;
+	ProcessUtility_hook = capture_ProcessUtility;
+}
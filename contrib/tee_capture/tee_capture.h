@@ -0,0 +1,63 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_capture.h
+ *	  Format of the workload capture files written by tee_capture and read
+ *	  by tee_replay.
+ *
+ * Each client session that executes a captured statement writes one file,
+ * named <session start>-<pid>.tcap.  The file starts with the magic string
+ * and a version byte, followed by one session record and then one statement
+ * record per completed or failed top-level statement, in order of
+ * completion.
+ *
+ * Integers are unsigned LEB128 varints, strings are a varint length followed
+ * by that many bytes without terminator.
+ *
+ * Session record:
+ *		byte	TEE_CAPTURE_SESSION
+ *		varint	session start, microseconds since 2000-01-01 UTC
+ *		varint	backend PID
+ *		string	database, session user, application_name
+ *		varint	number of settings, then for each: string name, string value
+ *
+ * Statement record:
+ *		byte	TEE_CAPTURE_STATEMENT
+ *		varint	start, microseconds since session start
+ *		varint	duration, microseconds
+ *		varint	rows processed
+ *		varint	query identifier (0 if not computed)
+ *		byte	flags (TEE_CAPTURE_*)
+ *		string	statement text
+ *		varint	number of bind parameters, then for each: varint type OID,
+ *				varint value length plus one (0 for NULL), value bytes in text
+ *				format
+ *
+ * This header is included by frontend code too, so it must not depend on
+ * anything but c.h.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * contrib/tee_capture/tee_capture.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TEE_CAPTURE_H
+#define TEE_CAPTURE_H
+
+#define TEE_CAPTURE_MAGIC		"TCAP"
+#define TEE_CAPTURE_MAGIC_LEN	4
+#define TEE_CAPTURE_VERSION		1
+#define TEE_CAPTURE_SUFFIX		".tcap"
+
+/* record types */
+#define TEE_CAPTURE_SESSION		'S'
+#define TEE_CAPTURE_STATEMENT	'Q'
+
+/* statement flags */
+#define TEE_CAPTURE_EXTENDED	0x01	/* executed with bind parameters */
+#define TEE_CAPTURE_UTILITY		0x02	/* utility statement */
+#define TEE_CAPTURE_FAILED		0x04	/* raised an error */
+#define TEE_CAPTURE_ROLLED_BACK	0x08	/* COMMIT or PREPARE TRANSACTION that
+										 * rolled back instead */
+
+#endif							/* TEE_CAPTURE_H */
@@ -0,0 +1,48 @@
+CREATE EXTENSION tee_cost_calibration;
+
+CREATE TABLE cc (a int, b text);
+INSERT INTO cc SELECT g, 'x' || g FROM generate_series(1, 1000) g;
+ANALYZE cc;
+
+SELECT tee_cost_calibration_reset();
+
+-- Every node that ran is observed under its own node type
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SELECT count(*) FROM cc c1 JOIN cc c2 USING (a);
+SELECT count(*) FROM cc c1 JOIN cc c2 USING (a);
+RESET enable_mergejoin;
+RESET enable_nestloop;
+SELECT b FROM cc ORDER BY a DESC LIMIT 1;
+
+SELECT node_type, components, samples, loops, mean_actual_rows
+  FROM tee_cost_calibration
+  WHERE node_type <> 'Result'
+  ORDER BY node_type;
+
+-- Node types seen often enough get a verdict
+SELECT node_type, samples, verdict IS NOT NULL AS has_verdict
+  FROM tee_cost_calibration_report(min_samples => 2)
+  ORDER BY node_type;
+
+SELECT tee_cost_calibration_reset();
+SELECT count(*) FROM tee_cost_calibration WHERE node_type <> 'Result';
+
+-- Interleaved portals are each observed
+SELECT tee_cost_calibration_reset();
+BEGIN;
+DECLARE c1 CURSOR FOR SELECT a FROM cc WHERE a <= 2;
+DECLARE c2 CURSOR FOR SELECT b FROM cc ORDER BY b;
+FETCH c1;
+FETCH c2;
+CLOSE c1;
+FETCH c2;
+CLOSE c2;
+COMMIT;
+SELECT node_type, samples
+  FROM tee_cost_calibration
+  WHERE node_type <> 'Result'
+  ORDER BY node_type;
+
+DROP TABLE cc;
+DROP EXTENSION tee_cost_calibration;
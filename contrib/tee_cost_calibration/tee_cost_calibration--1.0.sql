@@ -0,0 +1,95 @@
+/* contrib/tee_cost_calibration/tee_cost_calibration--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION tee_cost_calibration" to load this file. \quit
+
+CREATE FUNCTION tee_cost_calibration(
+    OUT node_type text,
+    OUT components text,
+    OUT samples bigint,
+    OUT loops bigint,
+    OUT mean_startup_cost float8,
+    OUT mean_total_cost float8,
+    OUT mean_startup_time float8,
+    OUT mean_total_time float8,
+    OUT var_total_cost float8,
+    OUT var_total_time float8,
+    OUT covar_cost_time float8,
+    OUT mean_plan_rows float8,
+    OUT mean_actual_rows float8,
+    OUT shared_blks_hit bigint,
+    OUT shared_blks_read bigint
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW tee_cost_calibration AS
+  SELECT * FROM tee_cost_calibration();
+
+GRANT SELECT ON tee_cost_calibration TO PUBLIC;
+
+-- Fit actual time against estimated cost per node type, and compare each
+-- node type's time per cost unit with that of all node types under the same
+-- components.  A node type that takes more than threshold times the common
+-- time per cost unit is underpriced, one that takes less than 1/threshold
+-- of it is overpriced.
+CREATE FUNCTION tee_cost_calibration_report(
+    threshold float8 DEFAULT 2.0,
+    min_samples bigint DEFAULT 30,
+    OUT node_type text,
+    OUT components text,
+    OUT samples bigint,
+    OUT ms_per_cost float8,
+    OUT slope float8,
+    OUT intercept float8,
+    OUT correlation float8,
+    OUT relative_price float8,
+    OUT rows_ratio float8,
+    OUT verdict text
+)
+RETURNS SETOF record
+LANGUAGE sql STABLE PARALLEL SAFE
+AS $$
+  WITH c AS (
+    SELECT * FROM @extschema@.tee_cost_calibration
+    WHERE samples >= min_samples AND mean_total_cost > 0
+  ), common AS (
+    SELECT components,
+           sum(mean_total_time * samples) / sum(mean_total_cost * samples)
+             AS ms_per_cost
+    FROM c GROUP BY components
+  ), fit AS (
+    SELECT c.node_type, c.components, c.samples,
+           c.mean_total_time / c.mean_total_cost AS ms_per_cost,
+           CASE WHEN c.var_total_cost > 0
+                THEN c.covar_cost_time / c.var_total_cost END AS slope,
+           CASE WHEN c.var_total_cost > 0 AND c.var_total_time > 0
+                THEN c.covar_cost_time /
+                     sqrt(c.var_total_cost * c.var_total_time) END
+             AS correlation,
+           (c.mean_total_time / c.mean_total_cost) /
+             nullif(common.ms_per_cost, 0) AS relative_price,
+           greatest(c.mean_plan_rows, 1) / greatest(c.mean_actual_rows, 1)
+             AS rows_ratio,
+           c.mean_total_cost, c.mean_total_time
+    FROM c JOIN common USING (components)
+  )
+  SELECT node_type, components, samples, ms_per_cost, slope,
+         mean_total_time - slope * mean_total_cost,
+         correlation, relative_price, rows_ratio,
+         CASE WHEN relative_price IS NULL THEN NULL
+              WHEN relative_price > threshold THEN 'underpriced'
+              WHEN relative_price < 1.0 / threshold THEN 'overpriced'
+              ELSE 'ok' END
+  FROM fit
+  ORDER BY abs(ln(nullif(relative_price, 0))) DESC NULLS LAST, node_type, components
+$$;
+
+CREATE FUNCTION tee_cost_calibration_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+
+-- Don't want this to be available to non-superusers.
+REVOKE ALL ON FUNCTION tee_cost_calibration_reset() FROM PUBLIC;
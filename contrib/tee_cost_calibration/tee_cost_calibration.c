@@ -0,0 +1,532 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_cost_calibration.c
+ *	  Estimated cost against actual time, per plan node type, for checking
+ *	  how well the taxed costs of tee_cost_model track runtime.
+ *
+ * A sample of top-level statements is executed with per-node
+ * instrumentation, as auto_explain does with log_analyze.  At executor end
+ * every node that ran contributes one observation to the entry for its node
+ * type and the TEE planner components enabled: its estimated startup and
+ * total cost, its actual startup and total time per loop, estimated and
+ * actual rows, loops and buffer accesses.  Cost and time are both inclusive
+ * of the node's children, as in EXPLAIN ANALYZE.
+ *
+ * The means, variances and covariance of cost and time are kept with
+ * Welford's method, so that the SQL side can fit time against cost by least
+ * squares and compute the correlation without storing the observations.
+ *
+ * Statistics are not kept across server restarts.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_cost_calibration/tee_cost_calibration.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "common/pg_prng.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tee_plan_tracker/tee_plan_tracker.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+
+PG_MODULE_MAGIC;
+
+/* every node type under every component combination fits easily */
+#define CALIBRATION_MAX_ENTRIES	1024
+
+typedef struct CalibrationKey
+{
+	int32		node_tag;		/* NodeTag of the Plan node */
+	uint8		components;		/* TEE_COMPONENT_* enabled when executed */
+} CalibrationKey;
+
+typedef struct CalibrationCounters
+{
+	int64		samples;		/* nodes observed */
+	int64		loops;
+	double		mean_cost;		/* estimated total cost */
+	double		mean_time;		/* actual total time per loop, ms */
+	double		sum_var_cost;	/* Welford sums of squared deviations */
+	double		sum_var_time;
+	double		sum_covar;		/* ... and of cross deviations */
+	double		sum_startup_cost;
+	double		sum_startup_time;	/* ms per loop */
+	double		sum_plan_rows;
+	double		sum_actual_rows;	/* per loop */
+	int64		shared_blks_hit;
+	int64		shared_blks_read;
+} CalibrationCounters;
+
+typedef struct CalibrationEntry
+{
+	CalibrationKey key;			/* hash key of entry - MUST BE FIRST */
+	slock_t		mutex;			/* protects the counters */
+	CalibrationCounters counters;
+} CalibrationEntry;
+
+typedef struct CalibrationSharedState
+{
+	LWLock	   *lock;			/* protects hashtable search/modification */
+} CalibrationSharedState;
+
+/*
+ * A sampled query, between ExecutorStart and ExecutorEnd.  Portals can be
+ * interleaved, so the sampling decision belongs to the QueryDesc.  It lives
+ * in the executor's query context, and unlinks itself when that goes away.
+ */
+typedef struct SampledQuery
+{
+	dlist_node	node;
+	QueryDesc  *queryDesc;
+	uint8		components;		/* TEE_COMPONENT_* enabled at start */
+	MemoryContextCallback callback;
+} SampledQuery;
+
+/* GUC variables */
+static double calibration_sample_rate = 0.01;
+
+/* Links to shared memory state */
+static CalibrationSharedState *calibration = NULL;
+static HTAB *calibration_hash = NULL;
+
+/* Current nesting depth of ExecutorRun+ExecutorFinish calls */
+static int	nesting_level = 0;
+
+/* Top-level queries being sampled */
+static dlist_head sampled_queries = DLIST_STATIC_INIT(sampled_queries);
+
+/* Saved hook values */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+
+/* Linkage to tee_plan_tracker's node labels, loaded on first use */
+typedef const char *(*tee_plan_node_label_t) (NodeTag tag);
+static tee_plan_node_label_t tee_plan_node_label_p = NULL;
+
+PG_FUNCTION_INFO_V1(tee_cost_calibration);
+PG_FUNCTION_INFO_V1(tee_cost_calibration_reset);
+
+#define calibration_enabled() \
+	(calibration_sample_rate > 0 && calibration_hash != NULL && \
+	 !IsParallelWorker())
+
+
+static Size
+calibration_memsize(void)
+{
+	return add_size(MAXALIGN(sizeof(CalibrationSharedState)),
+					hash_estimate_size(CALIBRATION_MAX_ENTRIES,
+									   sizeof(CalibrationEntry)));
+}
+
+static void
+calibration_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(calibration_memsize());
+	RequestNamedLWLockTranche("tee_cost_calibration", 1);
+}
+
+static void
+calibration_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	calibration = NULL;
+	calibration_hash = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	calibration = ShmemInitStruct("tee_cost_calibration",
+								  sizeof(CalibrationSharedState),
+								  &found);
+	if (!found)
+		calibration->lock =
+			&(GetNamedLWLockTranche("tee_cost_calibration"))->lock;
+
+	info.keysize = sizeof(CalibrationKey);
+	info.entrysize = sizeof(CalibrationEntry);
+	calibration_hash = ShmemInitHash("tee_cost_calibration hash",
+									 CALIBRATION_MAX_ENTRIES,
+									 CALIBRATION_MAX_ENTRIES,
+									 &info,
+									 HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Add the observation of one executed node to its entry.
+ */
+static void
+calibration_store(Plan *plan, Instrumentation *instr, uint8 components)
+{
+	CalibrationKey key;
+	CalibrationEntry *entry;
+	CalibrationCounters *c;
+	double		cost = plan->total_cost;
+	double		time = 1000.0 * instr->total / instr->nloops;
+	double		dcost;
+	double		dtime;
+
+	/* Clear padding of the key, since it's hashed as a blob */
+	memset(&key, 0, sizeof(key));
+	key.node_tag = (int32) nodeTag(plan);
+	key.components = components;
+
+	LWLockAcquire(calibration->lock, LW_SHARED);
+
+	entry = (CalibrationEntry *) hash_search(calibration_hash, &key,
+											 HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bool		found;
+
+		LWLockRelease(calibration->lock);
+		LWLockAcquire(calibration->lock, LW_EXCLUSIVE);
+		entry = (CalibrationEntry *) hash_search(calibration_hash, &key,
+												 HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+		{
+			/* can't happen with the node types that exist, but be safe */
+			LWLockRelease(calibration->lock);
+			return;
+		}
+		if (!found)
+		{
+			SpinLockInit(&entry->mutex);
+			memset(&entry->counters, 0, sizeof(CalibrationCounters));
+		}
+	}
+
+	SpinLockAcquire(&entry->mutex);
+
+	c = &entry->counters;
+	c->samples++;
+	c->loops += (int64) instr->nloops;
+
+	/* Welford's method, extended to the covariance */
+	dcost = cost - c->mean_cost;
+	dtime = time - c->mean_time;
+	c->mean_cost += dcost / c->samples;
+	c->mean_time += dtime / c->samples;
+	c->sum_var_cost += dcost * (cost - c->mean_cost);
+	c->sum_var_time += dtime * (time - c->mean_time);
+	c->sum_covar += dcost * (time - c->mean_time);
+
+	c->sum_startup_cost += plan->startup_cost;
+	c->sum_startup_time += 1000.0 * instr->startup / instr->nloops;
+	c->sum_plan_rows += plan->plan_rows;
+	c->sum_actual_rows += instr->ntuples / instr->nloops;
+	c->shared_blks_hit += instr->bufusage.shared_blks_hit;
+	c->shared_blks_read += instr->bufusage.shared_blks_read;
+
+	SpinLockRelease(&entry->mutex);
+	LWLockRelease(calibration->lock);
+}
+
+/*
+ * Collect the observations of a plan state tree, subplans included.
+ */
+static bool
+calibration_collect(PlanState *planstate, void *context)
+{
+	Instrumentation *instr = planstate->instrument;
+
+	if (instr)
+	{
+		InstrEndLoop(instr);
+
+		/* nodes that never ran tell nothing about their cost */
+		if (instr->nloops > 0)
+			calibration_store(planstate->plan, instr, *(uint8 *) context);
+	}
+
+	return planstate_tree_walker(planstate, calibration_collect, context);
+}
+
+static void
+forget_sampled_query(void *arg)
+{
+	SampledQuery *sq = (SampledQuery *) arg;
+
+	dlist_delete(&sq->node);
+}
+
+static SampledQuery *
+find_sampled_query(QueryDesc *queryDesc)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &sampled_queries)
+	{
+		SampledQuery *sq = dlist_container(SampledQuery, node, iter.cur);
+
+		if (sq->queryDesc == queryDesc)
+			return sq;
+	}
+	return NULL;
+}
+
+/*
+ * ExecutorStart hook: decide whether to sample the query, and if so, ask for
+ * per-node instrumentation
+ */
+static void
+calibration_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	bool		sampled = false;
+
+	/* as in auto_explain, nested statements belong to their top level */
+	if (nesting_level == 0)
+	{
+		sampled = calibration_enabled() &&
+			(eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+			pg_prng_double(&pg_global_prng_state) < calibration_sample_rate;
+		if (sampled)
+			queryDesc->instrument_options |=
+				INSTRUMENT_TIMER | INSTRUMENT_ROWS | INSTRUMENT_BUFFERS;
+	}
+
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (sampled)
+	{
+		MemoryContext cxt = queryDesc->estate->es_query_cxt;
+		SampledQuery *sq;
+
+		sq = MemoryContextAlloc(cxt, sizeof(SampledQuery));
+		sq->queryDesc = queryDesc;
+		sq->components = tee_current_components();
+		sq->callback.func = forget_sampled_query;
+		sq->callback.arg = sq;
+		MemoryContextRegisterResetCallback(cxt, &sq->callback);
+		dlist_push_head(&sampled_queries, &sq->node);
+	}
+}
+
+/*
+ * ExecutorRun hook: all we need do is track nesting depth
+ */
+static void
+calibration_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+						uint64 count, bool execute_once)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorRun)
+			prev_ExecutorRun(queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_FINALLY();
+	{
+		nesting_level--;
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorFinish hook: all we need do is track nesting depth
+ */
+static void
+calibration_ExecutorFinish(QueryDesc *queryDesc)
+{
+	nesting_level++;
+	PG_TRY();
+	{
+		if (prev_ExecutorFinish)
+			prev_ExecutorFinish(queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+	}
+	PG_FINALLY();
+	{
+		nesting_level--;
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorEnd hook: collect the observations of a sampled query
+ */
+static void
+calibration_ExecutorEnd(QueryDesc *queryDesc)
+{
+	SampledQuery *sq = NULL;
+
+	if (!dlist_is_empty(&sampled_queries))
+		sq = find_sampled_query(queryDesc);
+
+	if (sq && calibration_hash != NULL && queryDesc->planstate != NULL)
+		calibration_collect(queryDesc->planstate, &sq->components);
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * Return the accumulated observations of every node type and component
+ * combination.
+ */
+Datum
+tee_cost_calibration(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	CalibrationEntry *entry;
+
+	if (!calibration || !calibration_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_cost_calibration must be loaded via shared_preload_libraries")));
+
+	/*
+	 * Not loaded in _PG_init, since loading tee_plan_tracker while shared
+	 * libraries are preloaded would set it up as if it were preloaded too.
+	 */
+	if (tee_plan_node_label_p == NULL)
+	{
+		AssertVariableIsOfType(&tee_plan_node_label, tee_plan_node_label_t);
+		tee_plan_node_label_p = (tee_plan_node_label_t)
+			load_external_function("$libdir/tee_plan_tracker",
+								   "tee_plan_node_label", true, NULL);
+	}
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(calibration->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, calibration_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[15];
+		bool		nulls[15] = {0};
+		CalibrationCounters c;
+		int			i = 0;
+
+		SpinLockAcquire(&entry->mutex);
+		c = entry->counters;
+		SpinLockRelease(&entry->mutex);
+
+		if (c.samples == 0)
+			continue;
+
+		values[i++] = CStringGetTextDatum(tee_plan_node_label_p((NodeTag) entry->key.node_tag));
+		values[i++] = CStringGetTextDatum(tee_component_name(entry->key.components));
+		values[i++] = Int64GetDatum(c.samples);
+		values[i++] = Int64GetDatum(c.loops);
+		values[i++] = Float8GetDatum(c.sum_startup_cost / c.samples);
+		values[i++] = Float8GetDatum(c.mean_cost);
+		values[i++] = Float8GetDatum(c.sum_startup_time / c.samples);
+		values[i++] = Float8GetDatum(c.mean_time);
+		values[i++] = Float8GetDatum(c.sum_var_cost / c.samples);
+		values[i++] = Float8GetDatum(c.sum_var_time / c.samples);
+		values[i++] = Float8GetDatum(c.sum_covar / c.samples);
+		values[i++] = Float8GetDatum(c.sum_plan_rows / c.samples);
+		values[i++] = Float8GetDatum(c.sum_actual_rows / c.samples);
+		values[i++] = Int64GetDatum(c.shared_blks_hit);
+		values[i++] = Int64GetDatum(c.shared_blks_read);
+		Assert(i == lengthof(values));
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(calibration->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * Forget all observations.
+ */
+Datum
+tee_cost_calibration_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	CalibrationEntry *entry;
+
+	if (!calibration || !calibration_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_cost_calibration must be loaded via shared_preload_libraries")));
+
+	LWLockAcquire(calibration->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, calibration_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(calibration_hash, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(calibration->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomRealVariable("tee_cost_calibration.sample_rate",
+							 "Fraction of queries to collect cost calibration observations from.",
+							 "Sampled queries run with per-node timing, which slows them down.",
+							 &calibration_sample_rate,
+							 0.01,
+							 0.0,
+							 1.0,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	MarkGUCPrefixReserved("tee_cost_calibration");
+
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = calibration_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = calibration_shmem_startup;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = calibration_ExecutorStart;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = calibration_ExecutorRun;
+	prev_ExecutorFinish = ExecutorFinish_hook;
+	ExecutorFinish_hook = calibration_ExecutorFinish;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = calibration_ExecutorEnd;
+}
@@ -0,0 +1,48 @@
+CREATE EXTENSION tee_plan_tracker;
+
+CREATE TABLE pt (a int, b text);
+INSERT INTO pt SELECT g, 'x' || g FROM generate_series(1, 1000) g;
+CREATE INDEX pt_a ON pt (a);
+ANALYZE pt;
+
+SELECT tee_plan_tracker_reset();
+
+-- Flip the plan of a query between an index scan and a sequential scan
+SET enable_seqscan = off;
+SELECT b FROM pt WHERE a = 42;
+SELECT b FROM pt WHERE a = 42;
+RESET enable_seqscan;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT b FROM pt WHERE a = 42;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+
+-- Likewise for the join method
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SELECT count(*) FROM pt p1 JOIN pt p2 USING (a) WHERE p1.b < 'x2';
+SET enable_nestloop = off;
+SET enable_hashjoin = on;
+SELECT count(*) FROM pt p1 JOIN pt p2 USING (a) WHERE p1.b < 'x2';
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+
+-- Each query has one row per shape.  A later shape is compared with the
+-- earlier one, and the histogram adds up to the calls.
+SELECT t.shape, t.components, t.calls,
+       b.shape AS baseline_shape, t.slowdown IS NOT NULL AS has_slowdown,
+       (SELECT sum(h) FROM unnest(t.histogram) h) = t.calls AS histogram_ok,
+       t.first_seen <= t.last_seen AS seen_ok,
+       count(*) OVER (PARTITION BY t.queryid) AS shapes
+  FROM tee_plan_tracker t
+  LEFT JOIN tee_plan_tracker b
+    ON b.queryid = t.queryid AND b.planid = t.baseline_planid
+ WHERE t.shape LIKE '%pt%'
+ ORDER BY t.shape COLLATE "C";
+
+SELECT tee_plan_tracker_reset();
+SELECT count(*) FROM tee_plan_tracker WHERE shape LIKE '%pt%';
+
+DROP TABLE pt;
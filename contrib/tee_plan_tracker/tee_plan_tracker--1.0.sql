@@ -0,0 +1,42 @@
+/* contrib/tee_plan_tracker/tee_plan_tracker--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION tee_plan_tracker" to load this file. \quit
+
+CREATE FUNCTION tee_plan_tracker(
+    OUT dbid oid,
+    OUT queryid bigint,
+    OUT planid bigint,
+    OUT components text,
+    OUT shape text,
+    OUT calls bigint,
+    OUT total_time float8,
+    OUT min_time float8,
+    OUT max_time float8,
+    OUT mean_time float8,
+    OUT stddev_time float8,
+    OUT histogram bigint[],
+    OUT first_seen timestamptz,
+    OUT last_seen timestamptz,
+    OUT baseline_planid bigint,
+    OUT slowdown float8,
+    OUT regressed boolean
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE VIEW tee_plan_tracker AS
+  SELECT * FROM tee_plan_tracker();
+
+CREATE FUNCTION tee_plan_tracker_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+
+-- Plan shapes name relations, so don't show them to everyone
+REVOKE ALL ON FUNCTION tee_plan_tracker() FROM PUBLIC;
+REVOKE ALL ON tee_plan_tracker FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION tee_plan_tracker() TO pg_read_all_stats;
+GRANT SELECT ON tee_plan_tracker TO pg_read_all_stats;
+REVOKE ALL ON FUNCTION tee_plan_tracker_reset() FROM PUBLIC;
@@ -0,0 +1,1025 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_plan_tracker.c
+ *	  Track execution times per plan shape of each query, and detect plan
+ *	  regressions.
+ *
+ * When the TEE planner components or new statistics make the planner switch
+ * to a different plan for a query, and the new plan is slower, nothing
+ * tells us.  This module hashes the shape of each executed plan (node types,
+ * join order and types, scanned relations and indexes) and keeps execution
+ * time statistics, including a histogram, for every shape of every query
+ * identifier in shared memory.  A shape whose mean time exceeds that of an
+ * earlier shape of the same query by tee_plan_tracker.regression_threshold
+ * is flagged as regressed, in the tee_plan_tracker view and, optionally, in
+ * the server log.
+ *
+ * Shapes are also distinguished by the TEE planner components that were
+ * enabled when they ran, so that tee_adaptive_selector can ask, through the
+ * routine exported in tee_plan_tracker.h, whether the components it chose
+ * produced a regression, and which components did better.
+ *
+ * Statistics are not kept across server restarts.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_plan_tracker/tee_plan_tracker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/parallel.h"
+#include "catalog/pg_type_d.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "funcapi.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "nodes/queryjumble.h"
+#include "parser/parsetree.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tee_plan_tracker.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+PG_MODULE_MAGIC;
+
+/* plan shapes remembered per query */
+#define TRACKER_MAX_SHAPES		8
+
+/* longest shape description kept, including terminator */
+#define TRACKER_SHAPE_LEN		256
+
+/*
+ * Execution time histogram: bucket i counts times in [2^i, 2^(i+1))
+ * microseconds, except that the first and last buckets are open-ended.
+ */
+#define TRACKER_HIST_BUCKETS	32
+
+typedef struct TrackerKey
+{
+	Oid			dbid;
+	uint64		queryid;
+} TrackerKey;
+
+typedef struct ShapeStats
+{
+	uint64		planid;			/* hash of the plan shape, 0 if unused */
+	uint8		components;		/* TEE_COMPONENT_* enabled during execution */
+	bool		alerted;		/* regression already logged */
+	int64		calls;
+	double		total_time;		/* ms */
+	double		min_time;
+	double		max_time;
+	double		mean_time;
+	double		sum_var_time;	/* sum of variances, as in pg_stat_statements */
+	int64		histogram[TRACKER_HIST_BUCKETS];
+	TimestampTz first_seen;
+	TimestampTz last_seen;
+	char		shape[TRACKER_SHAPE_LEN];
+} ShapeStats;
+
+typedef struct TrackerEntry
+{
+	TrackerKey	key;			/* hash key of entry - MUST BE FIRST */
+	slock_t		mutex;			/* protects the fields below */
+	TimestampTz last_seen;
+	ShapeStats	shapes[TRACKER_MAX_SHAPES];
+} TrackerEntry;
+
+typedef struct TrackerSharedState
+{
+	LWLock	   *lock;			/* protects hashtable search/modification */
+} TrackerSharedState;
+
+/* GUC variables */
+static int	tracker_max = 1000;
+static bool tracker_enabled = true;
+static int	tracker_min_calls = 10;
+static double tracker_regression_threshold = 1.5;
+static bool tracker_log_regressions = true;
+
+/* Links to shared memory state */
+static TrackerSharedState *tracker = NULL;
+static HTAB *tracker_hash = NULL;
+
+/* Saved hook values */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+
+PG_FUNCTION_INFO_V1(tee_plan_tracker);
+PG_FUNCTION_INFO_V1(tee_plan_tracker_reset);
+
+static bool tracker_regressed(uint64 queryid, uint8 components, uint8 *better);
+
+static TeePlanTrackerRoutine tracker_routine = {
+	tracker_regressed
+};
+
+#define tracker_active(queryDesc) \
+	(tracker_enabled && tracker_hash != NULL && !IsParallelWorker() && \
+	 (queryDesc)->plannedstmt->queryId != UINT64CONST(0))
+
+
+static Size
+tracker_memsize(void)
+{
+	return add_size(MAXALIGN(sizeof(TrackerSharedState)),
+					hash_estimate_size(tracker_max, sizeof(TrackerEntry)));
+}
+
+static void
+tracker_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(tracker_memsize());
+	RequestNamedLWLockTranche("tee_plan_tracker", 1);
+}
+
+static void
+tracker_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	tracker = NULL;
+	tracker_hash = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	tracker = ShmemInitStruct("tee_plan_tracker",
+							  sizeof(TrackerSharedState),
+							  &found);
+	if (!found)
+		tracker->lock = &(GetNamedLWLockTranche("tee_plan_tracker"))->lock;
+
+	info.keysize = sizeof(TrackerKey);
+	info.entrysize = sizeof(TrackerEntry);
+	tracker_hash = ShmemInitHash("tee_plan_tracker hash",
+								 tracker_max, tracker_max,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Short name of a plan node type, as shown in plan shapes.  Exported for
+ * tee_cost_calibration, which labels its entries with it.
+ */
+const char *
+tee_plan_node_label(NodeTag tag)
+{
+	switch (tag)
+	{
+		case T_Result:
+			return "Result";
+		case T_ProjectSet:
+			return "ProjectSet";
+		case T_ModifyTable:
+			return "ModifyTable";
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "MergeAppend";
+		case T_RecursiveUnion:
+			return "RecursiveUnion";
+		case T_BitmapAnd:
+			return "BitmapAnd";
+		case T_BitmapOr:
+			return "BitmapOr";
+		case T_SeqScan:
+			return "SeqScan";
+		case T_SampleScan:
+			return "SampleScan";
+		case T_IndexScan:
+			return "IndexScan";
+		case T_IndexOnlyScan:
+			return "IndexOnlyScan";
+		case T_BitmapIndexScan:
+			return "BitmapIndexScan";
+		case T_BitmapHeapScan:
+			return "BitmapHeapScan";
+		case T_TidScan:
+			return "TidScan";
+		case T_TidRangeScan:
+			return "TidRangeScan";
+		case T_SubqueryScan:
+			return "SubqueryScan";
+		case T_FunctionScan:
+			return "FunctionScan";
+		case T_ValuesScan:
+			return "ValuesScan";
+		case T_TableFuncScan:
+			return "TableFuncScan";
+		case T_CteScan:
+			return "CteScan";
+		case T_NamedTuplestoreScan:
+			return "NamedTuplestoreScan";
+		case T_WorkTableScan:
+			return "WorkTableScan";
+		case T_ForeignScan:
+			return "ForeignScan";
+		case T_CustomScan:
+			return "CustomScan";
+		case T_NestLoop:
+			return "NestLoop";
+		case T_MergeJoin:
+			return "MergeJoin";
+		case T_HashJoin:
+			return "HashJoin";
+		case T_AdaptiveJoin:
+			return "AdaptiveJoin";
+		case T_Material:
+			return "Material";
+		case T_Memoize:
+			return "Memoize";
+		case T_Sort:
+			return "Sort";
+		case T_IncrementalSort:
+			return "IncrementalSort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			return "Agg";
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_Gather:
+			return "Gather";
+		case T_GatherMerge:
+			return "GatherMerge";
+		case T_Hash:
+			return "Hash";
+		case T_SetOp:
+			return "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		default:
+			return "Plan";
+	}
+}
+
+static const char *
+join_type_label(JoinType jointype)
+{
+	switch (jointype)
+	{
+		case JOIN_INNER:
+			return NULL;
+		case JOIN_LEFT:
+			return "Left";
+		case JOIN_FULL:
+			return "Full";
+		case JOIN_RIGHT:
+			return "Right";
+		case JOIN_SEMI:
+			return "Semi";
+		case JOIN_ANTI:
+			return "Anti";
+		case JOIN_RIGHT_ANTI:
+			return "RightAnti";
+		default:
+			return "?";
+	}
+}
+
+static void
+append_rel_name(StringInfo buf, const char *prefix, Oid relid)
+{
+	char	   *name = get_rel_name(relid);
+
+	appendStringInfo(buf, "%s%s", prefix, name ? name : "?");
+}
+
+static uint64 plan_shape(Plan *plan, List *rtable, StringInfo buf);
+
+/* Add a child's shape to its parent's */
+static uint64
+add_child_shape(uint64 hash, Plan *child, List *rtable, StringInfo buf,
+				bool *first)
+{
+	if (child == NULL)
+		return hash;
+	if (buf)
+		appendStringInfoString(buf, *first ? "(" : ", ");
+	*first = false;
+	return hash_combine64(hash, plan_shape(child, rtable, buf));
+}
+
+/*
+ * Hash the shape of a plan tree, describing it in buf unless that's NULL.
+ *
+ * Only what identifies the plan's strategy goes in: node types, join types
+ * and order, aggregation strategies, scanned relations and indexes, and
+ * parallelism.  Costs and row estimates don't, since they change with every
+ * ANALYZE without the plan changing.
+ */
+static uint64
+plan_shape(Plan *plan, List *rtable, StringInfo buf)
+{
+	uint64		hash;
+	uint32		variant = 0;
+	Oid			relid = InvalidOid;
+	Oid			indexid = InvalidOid;
+	List	   *children = NIL;
+	bool		first = true;
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return 0;
+
+	switch (nodeTag(plan))
+	{
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			variant = ((Join *) plan)->jointype;
+			break;
+		case T_AdaptiveJoin:
+			variant = ((Join *) plan)->jointype;
+			children = list_make1(((AdaptiveJoin *) plan)->hashplan);
+			break;
+		case T_Agg:
+			variant = ((Agg *) plan)->aggstrategy;
+			break;
+		case T_SetOp:
+			variant = ((SetOp *) plan)->strategy;
+			break;
+		case T_IndexScan:
+			indexid = ((IndexScan *) plan)->indexid;
+			break;
+		case T_IndexOnlyScan:
+			indexid = ((IndexOnlyScan *) plan)->indexid;
+			break;
+		case T_BitmapIndexScan:
+			indexid = ((BitmapIndexScan *) plan)->indexid;
+			break;
+		case T_Append:
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_SubqueryScan:
+			children = list_make1(((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			children = ((CustomScan *) plan)->custom_plans;
+			break;
+		default:
+			break;
+	}
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_TidRangeScan:
+		case T_ForeignScan:
+		case T_CustomScan:
+			{
+				Index		scanrelid = ((Scan *) plan)->scanrelid;
+
+				if (scanrelid > 0)
+				{
+					RangeTblEntry *rte = rt_fetch(scanrelid, rtable);
+
+					if (rte->rtekind == RTE_RELATION)
+						relid = rte->relid;
+				}
+			}
+			break;
+		default:
+			break;
+	}
+
+	hash = hash_combine64((uint64) nodeTag(plan), variant);
+	hash = hash_combine64(hash, plan->parallel_aware);
+	hash = hash_combine64(hash, relid);
+	hash = hash_combine64(hash, indexid);
+
+	if (buf)
+	{
+		if (plan->parallel_aware)
+			appendStringInfoString(buf, "Parallel ");
+		appendStringInfoString(buf, tee_plan_node_label(nodeTag(plan)));
+		if (IsA(plan, NestLoop) || IsA(plan, MergeJoin) || IsA(plan, HashJoin))
+		{
+			const char *label = join_type_label((JoinType) variant);
+
+			if (label)
+				appendStringInfo(buf, "/%s", label);
+		}
+		if (OidIsValid(relid))
+			append_rel_name(buf, " ", relid);
+		if (OidIsValid(indexid))
+			append_rel_name(buf, IsA(plan, BitmapIndexScan) ? " " : " using ",
+							indexid);
+	}
+
+	/* a join's outer side comes first, so the join order is part of this */
+	hash = add_child_shape(hash, plan->lefttree, rtable, buf, &first);
+	hash = add_child_shape(hash, plan->righttree, rtable, buf, &first);
+	foreach(lc, children)
+		hash = add_child_shape(hash, (Plan *) lfirst(lc), rtable, buf, &first);
+	if (buf && !first)
+		appendStringInfoChar(buf, ')');
+
+	return hash;
+}
+
+/*
+ * Hash the shape of a whole statement, including its subplans, and describe
+ * it in buf unless that's NULL.
+ */
+static uint64
+statement_shape(PlannedStmt *pstmt, StringInfo buf)
+{
+	uint64		hash;
+	ListCell   *lc;
+
+	hash = plan_shape(pstmt->planTree, pstmt->rtable, buf);
+	foreach(lc, pstmt->subplans)
+	{
+		Plan	   *subplan = (Plan *) lfirst(lc);
+
+		if (subplan == NULL)
+			continue;
+		if (buf)
+			appendStringInfoString(buf, "; SubPlan ");
+		hash = hash_combine64(hash, plan_shape(subplan, pstmt->rtable, buf));
+	}
+
+	/* zero marks unused slots */
+	return hash != 0 ? hash : 1;
+}
+
+static int
+histogram_bucket(double time_ms)
+{
+	double		us = time_ms * 1000.0;
+	int			bucket;
+
+	if (us < 2.0)
+		return 0;
+	bucket = (int) floor(log2(us));
+	return Min(bucket, TRACKER_HIST_BUCKETS - 1);
+}
+
+/*
+ * Find the fastest shape of an entry that was first seen before the given
+ * one and is a different plan, among those with enough calls to judge.
+ * Returns its index, or -1.  Caller must hold the entry's mutex.
+ */
+static int
+best_earlier_shape(TrackerEntry *entry, int which)
+{
+	ShapeStats *current = &entry->shapes[which];
+	int			best = -1;
+
+	for (int i = 0; i < TRACKER_MAX_SHAPES; i++)
+	{
+		ShapeStats *s = &entry->shapes[i];
+
+		if (s->planid == 0 || s->planid == current->planid ||
+			s->calls < tracker_min_calls ||
+			s->first_seen >= current->first_seen)
+			continue;
+		if (best < 0 || s->mean_time < entry->shapes[best].mean_time)
+			best = i;
+	}
+	return best;
+}
+
+/*
+ * Is the given shape a regression?  If so, return the shape it regressed
+ * against in *best.  Caller must hold the entry's mutex.
+ */
+static bool
+shape_regressed(TrackerEntry *entry, int which, int *best)
+{
+	ShapeStats *s = &entry->shapes[which];
+
+	if (s->planid == 0 || s->calls < tracker_min_calls)
+		return false;
+	*best = best_earlier_shape(entry, which);
+	return *best >= 0 &&
+		s->mean_time > entry->shapes[*best].mean_time * tracker_regression_threshold;
+}
+
+/*
+ * Find the slot of a shape in an entry, or -1.  Caller must hold the
+ * entry's mutex.
+ */
+static int
+find_shape(TrackerEntry *entry, uint64 planid, uint8 components)
+{
+	for (int i = 0; i < TRACKER_MAX_SHAPES; i++)
+	{
+		if (entry->shapes[i].planid == planid &&
+			entry->shapes[i].components == components)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Allocate an entry, evicting the least recently executed query if the
+ * table is full.  Caller must hold an exclusive lock on tracker->lock.
+ */
+static TrackerEntry *
+entry_alloc(TrackerKey *key)
+{
+	TrackerEntry *entry;
+	bool		found;
+
+	if (hash_get_num_entries(tracker_hash) >= tracker_max)
+	{
+		HASH_SEQ_STATUS hash_seq;
+		TrackerEntry *victim = NULL;
+
+		hash_seq_init(&hash_seq, tracker_hash);
+		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		{
+			if (victim == NULL || entry->last_seen < victim->last_seen)
+				victim = entry;
+		}
+		if (victim)
+			hash_search(tracker_hash, &victim->key, HASH_REMOVE, NULL);
+	}
+
+	entry = (TrackerEntry *) hash_search(tracker_hash, key, HASH_ENTER, &found);
+	if (!found)
+	{
+		SpinLockInit(&entry->mutex);
+		entry->last_seen = 0;
+		memset(entry->shapes, 0, sizeof(entry->shapes));
+	}
+	return entry;
+}
+
+/*
+ * Record one execution of a statement.
+ */
+static void
+tracker_store(PlannedStmt *pstmt, double total_time)
+{
+	TrackerKey	key;
+	TrackerEntry *entry;
+	ShapeStats *s;
+	uint64		planid;
+	uint8		components;
+	TimestampTz now = GetCurrentTimestamp();
+	int			slot;
+	int			best = -1;
+	bool		alert = false;
+	ShapeStats	regressed_copy;
+	ShapeStats	best_copy;
+
+	planid = statement_shape(pstmt, NULL);
+	components = tee_current_components();
+
+	/* Clear padding of the key, since it's hashed as a blob */
+	memset(&key, 0, sizeof(key));
+	key.dbid = MyDatabaseId;
+	key.queryid = pstmt->queryId;
+
+	LWLockAcquire(tracker->lock, LW_SHARED);
+
+	entry = (TrackerEntry *) hash_search(tracker_hash, &key, HASH_FIND, NULL);
+	slot = -1;
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		slot = find_shape(entry, planid, components);
+		SpinLockRelease(&entry->mutex);
+	}
+
+	if (slot < 0)
+	{
+		StringInfoData buf;
+		int			len;
+
+		/*
+		 * Describe the new shape.  That needs catalog access, so do it
+		 * without holding the lock, then look the entry up again.
+		 */
+		LWLockRelease(tracker->lock);
+		initStringInfo(&buf);
+		statement_shape(pstmt, &buf);
+		len = pg_mbcliplen(buf.data, buf.len, TRACKER_SHAPE_LEN - 1);
+
+		LWLockAcquire(tracker->lock, LW_SHARED);
+		entry = (TrackerEntry *) hash_search(tracker_hash, &key, HASH_FIND, NULL);
+		if (entry == NULL)
+		{
+			LWLockRelease(tracker->lock);
+			LWLockAcquire(tracker->lock, LW_EXCLUSIVE);
+			entry = entry_alloc(&key);
+		}
+
+		SpinLockAcquire(&entry->mutex);
+		slot = find_shape(entry, planid, components);
+		if (slot < 0)
+		{
+			/* use a free slot, or else the least recently executed shape */
+			slot = 0;
+			for (int i = 0; i < TRACKER_MAX_SHAPES; i++)
+			{
+				if (entry->shapes[i].planid == 0)
+				{
+					slot = i;
+					break;
+				}
+				if (entry->shapes[i].last_seen < entry->shapes[slot].last_seen)
+					slot = i;
+			}
+			s = &entry->shapes[slot];
+			memset(s, 0, sizeof(ShapeStats));
+			s->planid = planid;
+			s->components = components;
+			s->first_seen = now;
+			memcpy(s->shape, buf.data, len);
+			s->shape[len] = '\0';
+		}
+		SpinLockRelease(&entry->mutex);
+		pfree(buf.data);
+	}
+
+	SpinLockAcquire(&entry->mutex);
+
+	s = &entry->shapes[slot];
+	/* the slot may have been reused by a concurrent backend meanwhile */
+	if (s->planid == planid && s->components == components)
+	{
+		double		old_mean = s->mean_time;
+
+		s->calls++;
+		s->total_time += total_time;
+		if (s->calls == 1)
+		{
+			s->min_time = total_time;
+			s->max_time = total_time;
+			s->mean_time = total_time;
+		}
+		else
+		{
+			/* Welford's method, as in pg_stat_statements */
+			s->mean_time += (total_time - old_mean) / s->calls;
+			s->sum_var_time += (total_time - old_mean) * (total_time - s->mean_time);
+			s->min_time = Min(s->min_time, total_time);
+			s->max_time = Max(s->max_time, total_time);
+		}
+		s->histogram[histogram_bucket(total_time)]++;
+		s->last_seen = now;
+		entry->last_seen = now;
+
+		if (tracker_log_regressions && !s->alerted &&
+			shape_regressed(entry, slot, &best))
+		{
+			s->alerted = true;
+			alert = true;
+			regressed_copy = *s;
+			best_copy = entry->shapes[best];
+		}
+	}
+
+	SpinLockRelease(&entry->mutex);
+	LWLockRelease(tracker->lock);
+
+	if (alert)
+		ereport(LOG,
+				(errmsg("plan regression detected for query " INT64_FORMAT,
+						(int64) key.queryid),
+				 errdetail("Plan " INT64_FORMAT " (%s) averages %.3f ms over " INT64_FORMAT " executions, against %.3f ms over " INT64_FORMAT " executions of earlier plan " INT64_FORMAT " (%s).\nNew plan: %s\nEarlier plan: %s",
+						   (int64) regressed_copy.planid,
+						   tee_component_name(regressed_copy.components),
+						   regressed_copy.mean_time, regressed_copy.calls,
+						   best_copy.mean_time, best_copy.calls,
+						   (int64) best_copy.planid,
+						   tee_component_name(best_copy.components),
+						   regressed_copy.shape, best_copy.shape)));
+}
+
+/*
+ * ExecutorStart hook: set up timing of trackable statements
+ */
+static void
+tracker_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (tracker_active(queryDesc) && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		queryDesc->totaltime == NULL)
+	{
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+		queryDesc->totaltime = InstrAlloc(1, INSTRUMENT_TIMER, false);
+		MemoryContextSwitchTo(oldcxt);
+	}
+}
+
+/*
+ * ExecutorEnd hook: record the execution
+ */
+static void
+tracker_ExecutorEnd(QueryDesc *queryDesc)
+{
+	if (tracker_active(queryDesc) && queryDesc->totaltime &&
+		(queryDesc->estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+	{
+		InstrEndLoop(queryDesc->totaltime);
+		tracker_store(queryDesc->plannedstmt,
+					  queryDesc->totaltime->total * 1000.0);
+	}
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * Exported through the rendezvous variable: see tee_plan_tracker.h.
+ */
+static bool
+tracker_regressed(uint64 queryid, uint8 components, uint8 *better)
+{
+	TrackerKey	key;
+	TrackerEntry *entry;
+	bool		result = false;
+
+	if (tracker_hash == NULL || queryid == UINT64CONST(0))
+		return false;
+
+	memset(&key, 0, sizeof(key));
+	key.dbid = MyDatabaseId;
+	key.queryid = queryid;
+
+	LWLockAcquire(tracker->lock, LW_SHARED);
+	entry = (TrackerEntry *) hash_search(tracker_hash, &key, HASH_FIND, NULL);
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		for (int i = 0; i < TRACKER_MAX_SHAPES && !result; i++)
+		{
+			int			best;
+
+			if (entry->shapes[i].components == components &&
+				shape_regressed(entry, i, &best) &&
+				entry->shapes[best].components != components)
+			{
+				*better = entry->shapes[best].components;
+				result = true;
+			}
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(tracker->lock);
+
+	return result;
+}
+
+/*
+ * Return the statistics of every plan shape of every tracked query.
+ */
+Datum
+tee_plan_tracker(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	TrackerEntry *entry;
+	TrackerEntry *copy;
+
+	if (!tracker || !tracker_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_plan_tracker must be loaded via shared_preload_libraries")));
+
+	InitMaterializedSRF(fcinfo, 0);
+	copy = palloc(sizeof(TrackerEntry));
+
+	LWLockAcquire(tracker->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, tracker_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		SpinLockAcquire(&entry->mutex);
+		memcpy(copy, entry, sizeof(TrackerEntry));
+		SpinLockRelease(&entry->mutex);
+
+		for (int i = 0; i < TRACKER_MAX_SHAPES; i++)
+		{
+			ShapeStats *s = &copy->shapes[i];
+			Datum		values[17];
+			bool		nulls[17] = {0};
+			Datum		buckets[TRACKER_HIST_BUCKETS];
+			int			best = -1;
+			bool		regressed;
+			int			j = 0;
+
+			if (s->planid == 0 || s->calls == 0)
+				continue;
+
+			regressed = shape_regressed(copy, i, &best);
+			if (best < 0)
+				best = best_earlier_shape(copy, i);
+
+			for (int b = 0; b < TRACKER_HIST_BUCKETS; b++)
+				buckets[b] = Int64GetDatum(s->histogram[b]);
+
+			values[j++] = ObjectIdGetDatum(copy->key.dbid);
+			values[j++] = Int64GetDatum((int64) copy->key.queryid);
+			values[j++] = Int64GetDatum((int64) s->planid);
+			values[j++] = CStringGetTextDatum(tee_component_name(s->components));
+			values[j++] = CStringGetTextDatum(s->shape);
+			values[j++] = Int64GetDatum(s->calls);
+			values[j++] = Float8GetDatum(s->total_time);
+			values[j++] = Float8GetDatum(s->min_time);
+			values[j++] = Float8GetDatum(s->max_time);
+			values[j++] = Float8GetDatum(s->mean_time);
+			values[j++] = Float8GetDatum(s->calls > 1 ?
+										 sqrt(s->sum_var_time / s->calls) : 0.0);
+			values[j++] = PointerGetDatum(construct_array_builtin(buckets,
+																  TRACKER_HIST_BUCKETS,
+																  INT8OID));
+			values[j++] = TimestampTzGetDatum(s->first_seen);
+			values[j++] = TimestampTzGetDatum(s->last_seen);
+			if (best >= 0)
+			{
+				values[j++] = Int64GetDatum((int64) copy->shapes[best].planid);
+				values[j++] = Float8GetDatum(copy->shapes[best].mean_time > 0 ?
+											 s->mean_time / copy->shapes[best].mean_time : 0.0);
+			}
+			else
+			{
+				nulls[j++] = true;
+				nulls[j++] = true;
+			}
+			values[j++] = BoolGetDatum(regressed);
+
+			tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+								 values, nulls);
+		}
+	}
+
+	LWLockRelease(tracker->lock);
+	pfree(copy);
+
+	return (Datum) 0;
+}
+
+/*
+ * Forget all tracked queries.
+ */
+Datum
+tee_plan_tracker_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	TrackerEntry *entry;
+
+	if (!tracker || !tracker_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_plan_tracker must be loaded via shared_preload_libraries")));
+
+	LWLockAcquire(tracker->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, tracker_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(tracker_hash, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(tracker->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	TeePlanTrackerRoutine **routine;
+
+	/*
+	 * The shared hash table can only be set up at postmaster start, but the
+	 * routine below must be published in every process.
+	 */
+	routine = (TeePlanTrackerRoutine **)
+		find_rendezvous_variable(TEE_PLAN_TRACKER_RENDEZVOUS);
+	*routine = &tracker_routine;
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("tee_plan_tracker.max",
+							"Sets the maximum number of queries tracked by tee_plan_tracker.",
+							NULL,
+							&tracker_max,
+							1000,
+							100,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("tee_plan_tracker.track",
+							 "Selects whether executions are tracked by tee_plan_tracker.",
+							 NULL,
+							 &tracker_enabled,
+							 true,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("tee_plan_tracker.min_calls",
+							"Sets the number of executions of a plan needed before it is compared with others.",
+							NULL,
+							&tracker_min_calls,
+							10,
+							1,
+							INT_MAX,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("tee_plan_tracker.regression_threshold",
+							 "Sets how many times slower than an earlier plan a new plan must be to count as a regression.",
+							 NULL,
+							 &tracker_regression_threshold,
+							 1.5,
+							 1.0,
+							 1000.0,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("tee_plan_tracker.log_regressions",
+							 "Logs plan regressions when they are detected.",
+							 NULL,
+							 &tracker_log_regressions,
+							 true,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	MarkGUCPrefixReserved("tee_plan_tracker");
+
+	/* queries are tracked by query identifier */
+	EnableQueryId();
+
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = tracker_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = tracker_shmem_startup;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = tracker_ExecutorStart;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = tracker_ExecutorEnd;
+}
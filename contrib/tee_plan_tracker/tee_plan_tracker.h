@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_plan_tracker.h
+ *	  Interface of tee_plan_tracker for other modules.
+ *
+ * A module that wants to consult the tracker looks up the rendezvous
+ * variable TEE_PLAN_TRACKER_RENDEZVOUS; once tee_plan_tracker is loaded,
+ * it points to a TeePlanTrackerRoutine.
+ *
+ * The component bits and names are usable by frontend code too.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * contrib/tee_plan_tracker/tee_plan_tracker.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TEE_PLAN_TRACKER_H
+#define TEE_PLAN_TRACKER_H
+
+#define TEE_PLAN_TRACKER_RENDEZVOUS	"tee_plan_tracker"
+
+/* TEE planner component bits, as in tee_adaptive_selector's cache */
+#define TEE_COMPONENT_CE		0x01
+#define TEE_COMPONENT_CM		0x02
+#define TEE_COMPONENT_JN		0x04
+#define TEE_COMPONENT_COMBINATIONS	8
+
+/*
+ * Name of a combination of components, as in tee_bench's
+ * best_combination_*.csv files.
+ */
+static inline const char *
+tee_component_name(uint8 components)
+{
+	static const char *const names[TEE_COMPONENT_COMBINATIONS] = {
+		"baseline", "ce", "cm", "ce_cm", "jn", "ce_jn", "cm_jn", "all_three"
+	};
+
+	Assert(components < TEE_COMPONENT_COMBINATIONS);
+	return names[components];
+}
+
+#ifndef FRONTEND
+
+#include "nodes/nodes.h"
+#include "utils/guc.h"
+
+/*
+ * Which TEE planner components are enabled?  Modules that aren't loaded
+ * count as disabled.
+ */
+static inline bool
+tee_component_enabled(const char *name)
+{
+	const char *value = GetConfigOption(name, true, false);
+
+	return value != NULL && strcmp(value, "on") == 0;
+}
+
+static inline uint8
+tee_current_components(void)
+{
+	uint8		components = 0;
+
+	if (tee_component_enabled("tee_cardinality_estimation.enable_sev_snp_ce"))
+		components |= TEE_COMPONENT_CE;
+	if (tee_component_enabled("tee_cost_model.enable"))
+		components |= TEE_COMPONENT_CM;
+	if (tee_component_enabled("tee_join_enumerator.jn_enabled"))
+		components |= TEE_COMPONENT_JN;
+	return components;
+}
+
+/*
+ * Short name of a plan node type, as shown in plan shapes.  Other modules
+ * should look it up with load_external_function(), so as not to depend on
+ * the load order of the libraries.
+ */
+extern PGDLLEXPORT const char *tee_plan_node_label(NodeTag tag);
+
+typedef struct TeePlanTrackerRoutine
+{
+	/*
+	 * Has a plan of the query in the current database, executed with the
+	 * given TEE components, regressed against an earlier plan?  If so,
+	 * returns true and sets *better to the components the faster plan was
+	 * executed with.
+	 */
+	bool		(*regressed) (uint64 queryid, uint8 components, uint8 *better);
+} TeePlanTrackerRoutine;
+
+#endif							/* FRONTEND */
+
+#endif							/* TEE_PLAN_TRACKER_H */
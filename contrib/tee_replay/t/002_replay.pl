@@ -0,0 +1,61 @@
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Capture a workload with tee_capture and replay it with tee_replay.
+
+use strict;
+use warnings;
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf',
+	"shared_preload_libraries = 'tee_capture'");
+$node->start;
+
+$node->safe_psql('postgres',
+	"CREATE TABLE t (a int PRIMARY KEY); INSERT INTO t VALUES (1);");
+
+# Capture a session with a transaction block that fails, and so ends in a
+# ROLLBACK although the client said COMMIT.
+$node->append_conf('postgresql.conf', "tee_capture.enable = on");
+$node->reload;
+$node->poll_query_until('postgres', "SHOW tee_capture.enable", 'on')
+  or die "timed out waiting for capture to be enabled";
+my ($ret, $stdout, $stderr) = $node->psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO t VALUES (5);
+INSERT INTO t VALUES (1);
+COMMIT;
+INSERT INTO t VALUES (2);
+SELECT a / 0 FROM t WHERE a = 2;
+},
+	on_error_stop => 0);
+like($stderr, qr/duplicate key value/, 'captured transaction fails');
+$node->append_conf('postgresql.conf', "tee_capture.enable = off");
+$node->reload;
+$node->poll_query_until('postgres', "SHOW tee_capture.enable", 'off')
+  or die "timed out waiting for capture to be disabled";
+is($node->safe_psql('postgres', "SELECT string_agg(a::text, ',' ORDER BY a) FROM t"),
+	'1,2', 'capture only committed row 2');
+
+# Replay without row 1, so that the failed INSERT succeeds this time.  The
+# transaction must still roll back.
+$node->safe_psql('postgres', "TRUNCATE t");
+my $capture_dir = $node->data_dir . '/pg_tee_capture';
+command_like(
+	[
+		'tee_replay', '-h', $node->host, '-p', $node->port, '-s', '0',
+		$capture_dir
+	],
+	qr/, 1 failed \(captured: 2\)\n/,
+	'replay reports failed statements');
+is($node->safe_psql('postgres', "SELECT string_agg(a::text, ',' ORDER BY a) FROM t"),
+	'2', 'replay rolls back the transaction that rolled back in the capture');
+
+$node->stop;
+
+done_testing();
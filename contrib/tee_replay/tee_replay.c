@@ -0,0 +1,1101 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_replay.c
+ *	  Replay a workload captured by tee_capture, and compare statement
+ *	  latencies with the capture.
+ *
+ * Every captured session is replayed on its own connection, opened at the
+ * session's original offset from the start of the capture.  Each statement
+ * is sent at its original offset from the session start, or as soon as the
+ * previous statement of the session has completed if that is later, so the
+ * original concurrency and inter-arrival times are reproduced as far as the
+ * server keeps up.  Time can be scaled with --speed.
+ *
+ * Results are aggregated per query identifier, like pg_stat_statements, so
+ * that replays on different machines can be compared statement by
+ * statement.
+ *
+ * All sessions are driven from a single thread with asynchronous libpq
+ * calls.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_replay/tee_replay.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#if defined(WIN32) && FD_SETSIZE < 1024
+#error FD_SETSIZE needs to have been increased
+#endif
+
+#include "postgres_fe.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/select.h>
+#endif
+
+#include "access/transam.h"
+#include "common/logging.h"
+#include "getopt_long.h"
+#include "lib/stringinfo.h"
+#include "libpq-fe.h"
+#include "portability/instr_time.h"
+#include "tee_capture/tee_capture.h"
+
+/* number of fingerprints shown without --verbose */
+#define REPORT_LIMIT	20
+
+/* longest query text shown in the report */
+#define REPORT_QUERY_LEN	60
+
+typedef struct Statement
+{
+	int64		offset;			/* captured start, us after session start */
+	int64		duration;		/* captured duration, us */
+	uint64		rows;
+	uint64		queryid;
+	uint8		flags;
+	char	   *text;
+	int			nparams;
+	Oid		   *paramtypes;
+	char	  **paramvalues;
+	int			seqno;			/* position in the capture file */
+
+	/* replay results */
+	int64		replay_duration;	/* us */
+	uint64		replay_rows;
+	bool		failed;
+} Statement;
+
+typedef enum SessionState
+{
+	SESSION_WAITING,			/* not connected yet */
+	SESSION_CONNECTING,			/* connection being established */
+	SESSION_SETUP,				/* restoring the captured settings */
+	SESSION_IDLE,				/* waiting for the next statement to be due */
+	SESSION_BUSY,				/* statement sent, waiting for its results */
+	SESSION_DONE
+} SessionState;
+
+typedef struct Session
+{
+	char	   *path;
+	int64		start;			/* captured start, us since 2000-01-01 */
+	int			pid;
+	char	   *dbname;
+	char	   *username;
+	char	   *appname;
+	int			nsettings;
+	char	  **setting_names;
+	char	  **setting_values;
+	Statement  *stmts;
+	int			nstmts;
+
+	/* replay state */
+	SessionState state;
+	PGconn	   *conn;
+	PostgresPollingStatusType poll; /* last PQconnectPoll result */
+	int			setting;		/* setting being restored */
+	int			next;			/* statement being or to be sent */
+	instr_time	sent;
+} Session;
+
+/* Results of one query identifier */
+typedef struct Fingerprint
+{
+	uint64		queryid;
+	const char *query;
+	int64		calls;
+	int64		errors;
+	double		captured_time;	/* ms */
+	double		replayed_time;	/* ms */
+	uint64		captured_rows;
+	uint64		replayed_rows;
+} Fingerprint;
+
+/* Cursor over a capture file's contents */
+typedef struct Reader
+{
+	const char *data;
+	size_t		len;
+	size_t		pos;
+} Reader;
+
+/* options */
+static const char *progname;
+static char *pghost = NULL;
+static char *pgport = NULL;
+static char *username = NULL;
+static char *dbname = NULL;
+static double speed = 1.0;
+static char *output_file = NULL;
+static bool verbose = false;
+
+/* sessions not yet done */
+static int	active_sessions = 0;
+
+/* statistics on how faithfully the schedule was kept, in us */
+static int64 nsent = 0;
+static int64 total_lag = 0;
+static int64 max_lag = 0;
+
+
+static void
+usage(void)
+{
+	printf("%s replays a workload captured by tee_capture, and compares statement\n"
+		   "latencies with those of the capture.\n\n", progname);
+	printf("Usage:\n");
+	printf("  %s [OPTION]... CAPTURE...\n\n", progname);
+	printf("Options:\n");
+	printf("  -d, --dbname=DBNAME      replay all sessions in this database\n");
+	printf("  -o, --output=FILE        write per-query statistics as CSV to FILE\n");
+	printf("  -s, --speed=FACTOR       replay FACTOR times faster, 0 for no waits\n"
+		   "                           (default: 1)\n");
+	printf("  -v, --verbose            report failures, and all queries\n");
+	printf("  -V, --version            output version information, then exit\n");
+	printf("  -?, --help               show this help, then exit\n");
+	printf("\nConnection options:\n");
+	printf("  -h, --host=HOSTNAME      database server host or socket directory\n");
+	printf("  -p, --port=PORT          database server port\n");
+	printf("  -U, --username=USERNAME  connect as this user instead of the captured one\n");
+	printf("\nEach CAPTURE is a capture file, or a directory of them.\n");
+	printf("\nReport bugs to <%s>.\n", PACKAGE_BUGREPORT);
+	printf("%s home page: <%s>\n", PACKAGE_NAME, PACKAGE_URL);
+}
+
+static int64
+elapsed_us(instr_time start)
+{
+	instr_time	now;
+
+	INSTR_TIME_SET_CURRENT(now);
+	INSTR_TIME_SUBTRACT(now, start);
+	return INSTR_TIME_GET_MICROSEC(now);
+}
+
+/* Convert a captured interval to a replay interval */
+static int64
+scaled(int64 us)
+{
+	return speed > 0 ? (int64) (us / speed) : 0;
+}
+
+static bool
+get_byte(Reader *r, uint8 *value)
+{
+	if (r->pos >= r->len)
+		return false;
+	*value = (uint8) r->data[r->pos++];
+	return true;
+}
+
+static bool
+get_varint(Reader *r, uint64 *value)
+{
+	uint64		result = 0;
+
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		uint8		b;
+
+		if (!get_byte(r, &b))
+			return false;
+		result |= (uint64) (b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+		{
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Read a string of the given length as a NUL-terminated copy */
+static bool
+get_bytes(Reader *r, uint64 len, char **value)
+{
+	if (len > r->len - r->pos)
+		return false;
+	*value = pg_malloc(len + 1);
+	memcpy(*value, r->data + r->pos, len);
+	(*value)[len] = '\0';
+	r->pos += len;
+	return true;
+}
+
+static bool
+get_string(Reader *r, char **value)
+{
+	uint64		len;
+
+	return get_varint(r, &len) && get_bytes(r, len, value);
+}
+
+static bool
+read_statement(Reader *r, Statement *st)
+{
+	uint64		offset,
+				duration,
+				nparams;
+
+	if (!get_varint(r, &offset) ||
+		!get_varint(r, &duration) ||
+		!get_varint(r, &st->rows) ||
+		!get_varint(r, &st->queryid) ||
+		!get_byte(r, &st->flags) ||
+		!get_string(r, &st->text) ||
+		!get_varint(r, &nparams) ||
+		nparams > PG_UINT16_MAX)
+		return false;
+
+	st->offset = (int64) offset;
+	st->duration = (int64) duration;
+	st->nparams = (int) nparams;
+	st->paramtypes = pg_malloc0(Max(st->nparams, 1) * sizeof(Oid));
+	st->paramvalues = pg_malloc0(Max(st->nparams, 1) * sizeof(char *));
+	for (int i = 0; i < st->nparams; i++)
+	{
+		uint64		type;
+		uint64		len;
+
+		if (!get_varint(r, &type) || !get_varint(r, &len))
+			return false;
+
+		/* let the server infer types that may not have the same OID */
+		st->paramtypes[i] = type < FirstNormalObjectId ? (Oid) type : InvalidOid;
+		if (len > 0 && !get_bytes(r, len - 1, &st->paramvalues[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool
+read_session(Reader *r, Session *s)
+{
+	uint64		start,
+				pid,
+				nsettings;
+
+	if (!get_varint(r, &start) ||
+		!get_varint(r, &pid) ||
+		!get_string(r, &s->dbname) ||
+		!get_string(r, &s->username) ||
+		!get_string(r, &s->appname) ||
+		!get_varint(r, &nsettings) ||
+		nsettings > PG_INT32_MAX)
+		return false;
+
+	s->start = (int64) start;
+	s->pid = (int) pid;
+	s->nsettings = (int) nsettings;
+	s->setting_names = pg_malloc0(Max(s->nsettings, 1) * sizeof(char *));
+	s->setting_values = pg_malloc0(Max(s->nsettings, 1) * sizeof(char *));
+	for (int i = 0; i < s->nsettings; i++)
+	{
+		if (!get_string(r, &s->setting_names[i]) ||
+			!get_string(r, &s->setting_values[i]))
+			return false;
+	}
+	return true;
+}
+
+static int
+statement_cmp(const void *a, const void *b)
+{
+	const Statement *sa = (const Statement *) a;
+	const Statement *sb = (const Statement *) b;
+
+	if (sa->offset != sb->offset)
+		return sa->offset < sb->offset ? -1 : 1;
+	return sa->seqno - sb->seqno;
+}
+
+/*
+ * Load one capture file.  A file cut short, as when its backend crashed,
+ * yields the records before the damage.
+ */
+static void
+load_capture(const char *path, Session *s)
+{
+	StringInfoData buf;
+	FILE	   *f;
+	char		tmp[8192];
+	size_t		nread;
+	Reader		r;
+	uint8		b;
+	int			maxstmts = 64;
+
+	f = fopen(path, PG_BINARY_R);
+	if (f == NULL)
+		pg_fatal("could not open file \"%s\": %m", path);
+	initStringInfo(&buf);
+	while ((nread = fread(tmp, 1, sizeof(tmp), f)) > 0)
+		appendBinaryStringInfo(&buf, tmp, nread);
+	if (ferror(f))
+		pg_fatal("could not read file \"%s\": %m", path);
+	fclose(f);
+
+	r.data = buf.data;
+	r.len = buf.len;
+	r.pos = TEE_CAPTURE_MAGIC_LEN + 1;
+	if (buf.len < r.pos ||
+		memcmp(buf.data, TEE_CAPTURE_MAGIC, TEE_CAPTURE_MAGIC_LEN) != 0)
+		pg_fatal("file \"%s\" is not a capture file", path);
+	if (buf.data[TEE_CAPTURE_MAGIC_LEN] != TEE_CAPTURE_VERSION)
+		pg_fatal("capture file \"%s\" has unsupported version %d",
+				 path, buf.data[TEE_CAPTURE_MAGIC_LEN]);
+	if (!get_byte(&r, &b) || b != TEE_CAPTURE_SESSION || !read_session(&r, s))
+		pg_fatal("capture file \"%s\" has no valid session record", path);
+
+	s->path = pg_strdup(path);
+	s->stmts = pg_malloc0(maxstmts * sizeof(Statement));
+	while (get_byte(&r, &b))
+	{
+		Statement  *st;
+
+		if (b != TEE_CAPTURE_STATEMENT)
+		{
+			pg_log_warning("capture file \"%s\" has an invalid record at offset %zu, ignoring the rest",
+						   path, r.pos - 1);
+			break;
+		}
+		if (s->nstmts >= maxstmts)
+		{
+			s->stmts = pg_realloc(s->stmts, maxstmts * 2 * sizeof(Statement));
+			memset(s->stmts + maxstmts, 0, maxstmts * sizeof(Statement));
+			maxstmts *= 2;
+		}
+		st = &s->stmts[s->nstmts];
+		if (!read_statement(&r, st))
+		{
+			pg_log_warning("capture file \"%s\" ends with an incomplete record",
+						   path);
+			break;
+		}
+		st->seqno = s->nstmts++;
+	}
+	pg_free(buf.data);
+
+	/* statements were written as they completed; replay them as they began */
+	qsort(s->stmts, s->nstmts, sizeof(Statement), statement_cmp);
+}
+
+static int
+path_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/*
+ * Collect the capture files named on the command line, expanding
+ * directories to the capture files in them.
+ */
+static char **
+collect_files(char **args, int nargs, int *nfiles)
+{
+	char	  **files;
+	int			maxfiles = 64;
+
+	*nfiles = 0;
+	files = pg_malloc(maxfiles * sizeof(char *));
+	for (int i = 0; i < nargs; i++)
+	{
+		struct stat st;
+		DIR		   *dir;
+		struct dirent *de;
+		int			first = *nfiles;
+
+		if (stat(args[i], &st) != 0)
+			pg_fatal("could not stat file \"%s\": %m", args[i]);
+		if (!S_ISDIR(st.st_mode))
+		{
+			if (*nfiles >= maxfiles)
+				files = pg_realloc(files, (maxfiles *= 2) * sizeof(char *));
+			files[(*nfiles)++] = pg_strdup(args[i]);
+			continue;
+		}
+
+		dir = opendir(args[i]);
+		if (dir == NULL)
+			pg_fatal("could not open directory \"%s\": %m", args[i]);
+		while (errno = 0, (de = readdir(dir)) != NULL)
+		{
+			size_t		len = strlen(de->d_name);
+			size_t		suffixlen = strlen(TEE_CAPTURE_SUFFIX);
+
+			if (len <= suffixlen ||
+				strcmp(de->d_name + len - suffixlen, TEE_CAPTURE_SUFFIX) != 0)
+				continue;
+			if (*nfiles >= maxfiles)
+				files = pg_realloc(files, (maxfiles *= 2) * sizeof(char *));
+			files[(*nfiles)++] = psprintf("%s/%s", args[i], de->d_name);
+		}
+		if (errno)
+			pg_fatal("could not read directory \"%s\": %m", args[i]);
+		closedir(dir);
+
+		if (*nfiles == first)
+			pg_log_warning("no capture files found in directory \"%s\"", args[i]);
+		qsort(files + first, *nfiles - first, sizeof(char *), path_cmp);
+	}
+	return files;
+}
+
+/* Give up on the rest of a session */
+static void
+end_session(Session *s, bool failed)
+{
+	if (failed)
+	{
+		for (int i = s->next; i < s->nstmts; i++)
+			s->stmts[i].failed = true;
+	}
+	if (s->conn)
+		PQfinish(s->conn);
+	s->conn = NULL;
+	s->state = SESSION_DONE;
+	active_sessions--;
+}
+
+/*
+ * Start connecting a session.  The connection is completed by
+ * advance_connection(), and then the settings the session was captured with
+ * are restored, all without blocking the other sessions.
+ */
+static void
+start_session(Session *s)
+{
+	const char *keywords[7];
+	const char *values[7];
+
+	keywords[0] = "host";
+	values[0] = pghost;
+	keywords[1] = "port";
+	values[1] = pgport;
+	keywords[2] = "user";
+	values[2] = username ? username : s->username;
+	keywords[3] = "dbname";
+	values[3] = dbname ? dbname : s->dbname;
+	keywords[4] = "application_name";
+	values[4] = s->appname[0] ? s->appname : NULL;
+	keywords[5] = "fallback_application_name";
+	values[5] = progname;
+	keywords[6] = NULL;
+	values[6] = NULL;
+
+	s->conn = PQconnectStartParams(keywords, values, false);
+	if (s->conn == NULL)
+		pg_fatal("out of memory");
+	if (PQstatus(s->conn) == CONNECTION_BAD)
+	{
+		pg_log_error("could not replay session of process %d: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+		return;
+	}
+
+	/* as if PQconnectPoll had returned PGRES_POLLING_WRITING */
+	s->poll = PGRES_POLLING_WRITING;
+	s->state = SESSION_CONNECTING;
+}
+
+/*
+ * Send the next captured setting of a session to restore, or make the
+ * session idle if there are no more.
+ */
+static void
+send_setting(Session *s)
+{
+	const char *params[2];
+
+	if (s->setting >= s->nsettings)
+	{
+		s->state = SESSION_IDLE;
+		return;
+	}
+
+	params[0] = s->setting_names[s->setting];
+	params[1] = s->setting_values[s->setting];
+	if (!PQsendQueryParams(s->conn, "SELECT pg_catalog.set_config($1, $2, false)",
+						   2, NULL, params, NULL, NULL, 0))
+	{
+		pg_log_error("could not restore settings of process %d: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+		return;
+	}
+	s->state = SESSION_SETUP;
+}
+
+/* Continue connecting a session whose socket is ready */
+static void
+advance_connection(Session *s)
+{
+	s->poll = PQconnectPoll(s->conn);
+	if (s->poll == PGRES_POLLING_FAILED)
+	{
+		pg_log_error("could not replay session of process %d: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+	}
+	else if (s->poll == PGRES_POLLING_OK)
+	{
+		s->setting = 0;
+		send_setting(s);
+	}
+}
+
+/* Absorb whatever results have arrived for the setting being restored */
+static void
+collect_setting(Session *s)
+{
+	if (!PQconsumeInput(s->conn))
+	{
+		pg_log_error("connection of process %d lost: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+		return;
+	}
+
+	while (!PQisBusy(s->conn))
+	{
+		PGresult   *res = PQgetResult(s->conn);
+
+		if (res == NULL)
+		{
+			s->setting++;
+			send_setting(s);
+			return;
+		}
+
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pg_log_warning("could not restore setting \"%s\" of process %d: %s",
+						   s->setting_names[s->setting], s->pid,
+						   PQresultErrorMessage(res));
+		PQclear(res);
+	}
+}
+
+static void
+send_statement(Session *s, int64 lag)
+{
+	Statement  *st = &s->stmts[s->next];
+	int			ok;
+
+	nsent++;
+	total_lag += lag;
+	max_lag = Max(max_lag, lag);
+
+	INSTR_TIME_SET_CURRENT(s->sent);
+
+	/*
+	 * A COMMIT that rolled back in the capture rolls back here too, even if
+	 * the statement that failed in its transaction didn't fail this time.
+	 */
+	if (st->flags & TEE_CAPTURE_ROLLED_BACK)
+		ok = PQsendQuery(s->conn, "ROLLBACK");
+	else if (st->flags & TEE_CAPTURE_EXTENDED)
+		ok = PQsendQueryParams(s->conn, st->text, st->nparams, st->paramtypes,
+							   (const char *const *) st->paramvalues,
+							   NULL, NULL, 0);
+	else
+		ok = PQsendQuery(s->conn, st->text);
+
+	if (!ok)
+	{
+		pg_log_error("could not send statement of process %d: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+		return;
+	}
+	s->state = SESSION_BUSY;
+}
+
+/*
+ * Absorb whatever results have arrived for a session's current statement.
+ * COPY data isn't captured, so COPY FROM STDIN is made to fail.
+ */
+static void
+collect_results(Session *s)
+{
+	Statement  *st = &s->stmts[s->next];
+
+	if (!PQconsumeInput(s->conn))
+	{
+		pg_log_error("connection of process %d lost: %s",
+					 s->pid, PQerrorMessage(s->conn));
+		end_session(s, true);
+		return;
+	}
+
+	while (!PQisBusy(s->conn))
+	{
+		PGresult   *res = PQgetResult(s->conn);
+		char	   *buf;
+
+		if (res == NULL)
+		{
+			instr_time	now;
+
+			INSTR_TIME_SET_CURRENT(now);
+			INSTR_TIME_SUBTRACT(now, s->sent);
+			st->replay_duration = INSTR_TIME_GET_MICROSEC(now);
+			s->next++;
+			s->state = SESSION_IDLE;
+			return;
+		}
+
+		switch (PQresultStatus(res))
+		{
+			case PGRES_TUPLES_OK:
+				st->replay_rows += PQntuples(res);
+				break;
+			case PGRES_COMMAND_OK:
+				st->replay_rows += strtou64(PQcmdTuples(res), NULL, 10);
+				break;
+			case PGRES_COPY_IN:
+				PQputCopyEnd(s->conn, "COPY data is not replayed");
+				break;
+			case PGRES_COPY_OUT:
+				while (PQgetCopyData(s->conn, &buf, 0) > 0)
+					PQfreemem(buf);
+				break;
+			default:
+				st->failed = true;
+				if (verbose)
+					pg_log_warning("statement of process %d failed: %s\nstatement was: %s",
+								   s->pid, PQresultErrorMessage(res), st->text);
+				break;
+		}
+		PQclear(res);
+	}
+}
+
+/*
+ * Replay all sessions concurrently, each on the schedule it was captured
+ * with.  Returns the wall-clock time taken, in us.
+ */
+static int64
+replay(Session *sessions, int nsessions)
+{
+	instr_time	replay_start;
+	int64		base = PG_INT64_MAX;
+
+	for (int i = 0; i < nsessions; i++)
+		base = Min(base, sessions[i].start);
+	active_sessions = nsessions;
+
+	INSTR_TIME_SET_CURRENT(replay_start);
+	while (active_sessions > 0)
+	{
+		int64		now = elapsed_us(replay_start);
+		int64		wakeup = PG_INT64_MAX;
+		fd_set		readfds;
+		fd_set		writefds;
+		int			maxfd = -1;
+
+		FD_ZERO(&readfds);
+		FD_ZERO(&writefds);
+		for (int i = 0; i < nsessions; i++)
+		{
+			Session    *s = &sessions[i];
+			int64		session_due = scaled(s->start - base);
+
+			if (s->state == SESSION_WAITING)
+			{
+				if (session_due > now)
+				{
+					wakeup = Min(wakeup, session_due);
+					continue;
+				}
+				start_session(s);
+				now = elapsed_us(replay_start);
+			}
+
+			if (s->state == SESSION_IDLE)
+			{
+				int64		due;
+
+				if (s->next >= s->nstmts)
+					end_session(s, false);
+				else
+				{
+					due = session_due + scaled(s->stmts[s->next].offset);
+					if (due > now)
+						wakeup = Min(wakeup, due);
+					else
+						send_statement(s, now - due);
+				}
+			}
+
+			if (s->state == SESSION_CONNECTING || s->state == SESSION_SETUP ||
+				s->state == SESSION_BUSY)
+			{
+				int			sock = PQsocket(s->conn);
+
+#ifndef WIN32
+				if (sock < 0 || sock >= FD_SETSIZE)
+				{
+					pg_log_error("socket file descriptor out of range for select(): %d",
+								 sock);
+					pg_log_error_hint("Replay fewer concurrent sessions.");
+					exit(1);
+				}
+#endif
+				if (s->state == SESSION_CONNECTING &&
+					s->poll == PGRES_POLLING_WRITING)
+					FD_SET(sock, &writefds);
+				else
+					FD_SET(sock, &readfds);
+				maxfd = Max(maxfd, sock);
+			}
+		}
+
+		if (active_sessions == 0)
+			break;
+
+		/*
+		 * Sleep until a connection makes progress, results arrive, or the
+		 * next session or statement is due
+		 */
+		if (maxfd < 0)
+		{
+			if (wakeup > now)
+				pg_usleep(wakeup - now);
+		}
+		else
+		{
+			struct timeval timeout;
+			struct timeval *tvp = NULL;
+
+			if (wakeup != PG_INT64_MAX)
+			{
+				int64		delay = Max(wakeup - now, 0);
+
+				timeout.tv_sec = delay / 1000000;
+				timeout.tv_usec = delay % 1000000;
+				tvp = &timeout;
+			}
+			if (select(maxfd + 1, &readfds, &writefds, NULL, tvp) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				pg_fatal("select() failed: %m");
+			}
+
+			for (int i = 0; i < nsessions; i++)
+			{
+				Session    *s = &sessions[i];
+				int			sock;
+
+				if (s->state != SESSION_CONNECTING &&
+					s->state != SESSION_SETUP && s->state != SESSION_BUSY)
+					continue;
+				sock = PQsocket(s->conn);
+				if (!FD_ISSET(sock, &readfds) && !FD_ISSET(sock, &writefds))
+					continue;
+
+				if (s->state == SESSION_CONNECTING)
+					advance_connection(s);
+				else if (s->state == SESSION_SETUP)
+					collect_setting(s);
+				else
+					collect_results(s);
+			}
+		}
+	}
+
+	return elapsed_us(replay_start);
+}
+
+static int
+fingerprint_cmp(const void *a, const void *b)
+{
+	const Statement *sa = *(const Statement *const *) a;
+	const Statement *sb = *(const Statement *const *) b;
+
+	if (sa->queryid != sb->queryid)
+		return sa->queryid < sb->queryid ? -1 : 1;
+	/* without a query identifier, only identical texts are comparable */
+	if (sa->queryid == 0)
+		return strcmp(sa->text, sb->text);
+	return 0;
+}
+
+static int
+captured_time_cmp(const void *a, const void *b)
+{
+	const Fingerprint *fa = (const Fingerprint *) a;
+	const Fingerprint *fb = (const Fingerprint *) b;
+
+	if (fa->captured_time != fb->captured_time)
+		return fa->captured_time > fb->captured_time ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Group the statements of all sessions by query identifier.
+ */
+static Fingerprint *
+aggregate(Session *sessions, int nsessions, int *nfingerprints)
+{
+	Statement **all;
+	int			nall = 0;
+	Fingerprint *fps;
+	int			nfps = 0;
+
+	for (int i = 0; i < nsessions; i++)
+		nall += sessions[i].nstmts;
+	all = pg_malloc(Max(nall, 1) * sizeof(Statement *));
+	nall = 0;
+	for (int i = 0; i < nsessions; i++)
+		for (int j = 0; j < sessions[i].nstmts; j++)
+			all[nall++] = &sessions[i].stmts[j];
+	qsort(all, nall, sizeof(Statement *), fingerprint_cmp);
+
+	fps = pg_malloc0(Max(nall, 1) * sizeof(Fingerprint));
+	for (int i = 0; i < nall; i++)
+	{
+		Statement  *st = all[i];
+		Fingerprint *fp;
+
+		if (i == 0 || fingerprint_cmp(&all[i - 1], &all[i]) != 0)
+		{
+			fp = &fps[nfps++];
+			fp->queryid = st->queryid;
+			fp->query = st->text;
+		}
+		fp = &fps[nfps - 1];
+		fp->calls++;
+		if (st->failed)
+			fp->errors++;
+		fp->captured_time += st->duration / 1000.0;
+		fp->replayed_time += st->replay_duration / 1000.0;
+		fp->captured_rows += st->rows;
+		fp->replayed_rows += st->replay_rows;
+	}
+	pg_free(all);
+
+	qsort(fps, nfps, sizeof(Fingerprint), captured_time_cmp);
+	*nfingerprints = nfps;
+	return fps;
+}
+
+static void
+write_csv_string(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (const char *p = str; *p; p++)
+	{
+		if (*p == '"')
+			fputc('"', out);
+		fputc(*p, out);
+	}
+	fputc('"', out);
+}
+
+static void
+report(Session *sessions, int nsessions, int64 elapsed)
+{
+	Fingerprint *fps;
+	int			nfps;
+	int64		nstmts = 0;
+	int64		nfailed = 0;
+	int64		ncaptured_failed = 0;
+	int64		captured_span = 0;
+	int64		base = PG_INT64_MAX;
+
+	for (int i = 0; i < nsessions; i++)
+		base = Min(base, sessions[i].start);
+	for (int i = 0; i < nsessions; i++)
+	{
+		Session    *s = &sessions[i];
+
+		nstmts += s->nstmts;
+		for (int j = 0; j < s->nstmts; j++)
+		{
+			Statement  *st = &s->stmts[j];
+
+			if (st->failed)
+				nfailed++;
+			if (st->flags & TEE_CAPTURE_FAILED)
+				ncaptured_failed++;
+			captured_span = Max(captured_span,
+								s->start - base + st->offset + st->duration);
+		}
+	}
+
+	printf("replayed " INT64_FORMAT " statements of %d sessions in %.3f s (captured: %.3f s), " INT64_FORMAT " failed (captured: " INT64_FORMAT ")\n",
+		   nstmts, nsessions, elapsed / 1000000.0, captured_span / 1000000.0,
+		   nfailed, ncaptured_failed);
+	if (nsent > 0)
+		printf("statements were sent %.3f ms late on average, %.3f ms at most\n",
+			   total_lag / 1000.0 / nsent, max_lag / 1000.0);
+
+	fps = aggregate(sessions, nsessions, &nfps);
+
+	printf("\n%20s %8s %6s %13s %13s %7s  %s\n",
+		   "queryid", "calls", "errors", "captured_ms", "replayed_ms", "ratio",
+		   "query");
+	for (int i = 0; i < nfps && (verbose || i < REPORT_LIMIT); i++)
+	{
+		Fingerprint *fp = &fps[i];
+		char		query[REPORT_QUERY_LEN + 1];
+		int			len = 0;
+
+		/* show the start of the query on one line */
+		for (const char *p = fp->query; *p && len < REPORT_QUERY_LEN; p++)
+		{
+			if (isspace((unsigned char) *p))
+			{
+				if (len > 0 && query[len - 1] != ' ')
+					query[len++] = ' ';
+			}
+			else
+				query[len++] = *p;
+		}
+		query[len] = '\0';
+
+		printf("%20" INT64_MODIFIER "d %8" INT64_MODIFIER "d %6" INT64_MODIFIER "d %13.3f %13.3f ",
+			   (int64) fp->queryid, fp->calls, fp->errors,
+			   fp->captured_time, fp->replayed_time);
+		if (fp->captured_time > 0 && fp->errors < fp->calls)
+			printf("%7.2f", fp->replayed_time / fp->captured_time);
+		else
+			printf("%7s", "");
+		printf("  %s\n", query);
+	}
+	if (!verbose && nfps > REPORT_LIMIT)
+		printf("(%d more queries; use --verbose or --output to see all)\n",
+			   nfps - REPORT_LIMIT);
+
+	if (output_file)
+	{
+		FILE	   *out = fopen(output_file, "w");
+
+		if (out == NULL)
+			pg_fatal("could not open file \"%s\" for writing: %m", output_file);
+		fprintf(out, "queryid,calls,errors,captured_total_time,captured_mean_time,"
+				"replayed_total_time,replayed_mean_time,captured_rows,"
+				"replayed_rows,query\n");
+		for (int i = 0; i < nfps; i++)
+		{
+			Fingerprint *fp = &fps[i];
+
+			fprintf(out, INT64_FORMAT "," INT64_FORMAT "," INT64_FORMAT ",%.3f,%.3f,%.3f,%.3f," UINT64_FORMAT "," UINT64_FORMAT ",",
+					(int64) fp->queryid, fp->calls, fp->errors,
+					fp->captured_time, fp->captured_time / fp->calls,
+					fp->replayed_time, fp->replayed_time / fp->calls,
+					fp->captured_rows, fp->replayed_rows);
+			write_csv_string(out, fp->query);
+			fputc('\n', out);
+		}
+		if (fclose(out) != 0)
+			pg_fatal("could not write file \"%s\": %m", output_file);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"dbname", required_argument, NULL, 'd'},
+		{"host", required_argument, NULL, 'h'},
+		{"output", required_argument, NULL, 'o'},
+		{"port", required_argument, NULL, 'p'},
+		{"speed", required_argument, NULL, 's'},
+		{"username", required_argument, NULL, 'U'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"version", no_argument, NULL, 'V'},
+		{"help", no_argument, NULL, '?'},
+		{NULL, 0, NULL, 0}
+	};
+
+	char	  **files;
+	int			nfiles;
+	Session    *sessions;
+	int64		elapsed;
+	int			c;
+	int			optindex;
+	char	   *endptr;
+
+	pg_logging_init(argv[0]);
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("tee_replay (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "d:h:o:p:s:U:v",
+							long_options, &optindex)) != -1)
+	{
+		switch (c)
+		{
+			case 'd':
+				dbname = pg_strdup(optarg);
+				break;
+			case 'h':
+				pghost = pg_strdup(optarg);
+				break;
+			case 'o':
+				output_file = pg_strdup(optarg);
+				break;
+			case 'p':
+				pgport = pg_strdup(optarg);
+				break;
+			case 's':
+				errno = 0;
+				speed = strtod(optarg, &endptr);
+				if (*endptr != '\0' || errno != 0 || speed < 0)
+					pg_fatal("invalid value \"%s\" for option %s",
+							 optarg, "-s/--speed");
+				break;
+			case 'U':
+				username = pg_strdup(optarg);
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				/* getopt_long already emitted a complaint */
+				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+				exit(1);
+		}
+	}
+
+	if (optind >= argc)
+	{
+		pg_log_error("no capture specified");
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+
+	files = collect_files(argv + optind, argc - optind, &nfiles);
+	if (nfiles == 0)
+		pg_fatal("no capture files to replay");
+
+	sessions = pg_malloc0(nfiles * sizeof(Session));
+	for (int i = 0; i < nfiles; i++)
+		load_capture(files[i], &sessions[i]);
+
+	elapsed = replay(sessions, nfiles);
+	report(sessions, nfiles, elapsed);
+
+	return 0;
+}
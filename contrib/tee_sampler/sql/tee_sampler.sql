@@ -0,0 +1,38 @@
+-- EXPLAIN (MEMORY) must see the same node memory whether or not the
+-- sampler's ExecProcNode wrapper is installed.
+CREATE FUNCTION top_node_peak_kb(query text) RETURNS int
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN
+        EXECUTE 'EXPLAIN (ANALYZE, MEMORY, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+    LOOP
+        IF ln ~ 'Node Memory: peak=' THEN
+            RETURN substring(ln FROM 'peak=(\d+)kB')::int;
+        END IF;
+    END LOOP;
+    RETURN NULL;
+END;
+$$;
+
+-- The first group's state is large and the last one's is small, so the
+-- peak is only seen by sampling while tuples are returned, not at shutdown.
+SET enable_hashagg = off;
+
+SET tee_sampler.track_nodes = off;
+SELECT top_node_peak_kb($$
+    SELECT g < 2, length(string_agg(repeat('x', 100), ','))
+      FROM generate_series(1, 20000) g GROUP BY 1 ORDER BY 1
+$$) > 1024 AS large_peak;
+
+SET tee_sampler.track_nodes = on;
+SELECT top_node_peak_kb($$
+    SELECT g < 2, length(string_agg(repeat('x', 100), ','))
+      FROM generate_series(1, 20000) g GROUP BY 1 ORDER BY 1
+$$) > 1024 AS large_peak;
+
+RESET tee_sampler.track_nodes;
+RESET enable_hashagg;
+DROP FUNCTION top_node_peak_kb(text);
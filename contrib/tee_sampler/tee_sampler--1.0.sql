@@ -0,0 +1,78 @@
+/* contrib/tee_sampler/tee_sampler--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION tee_sampler" to load this file. \quit
+
+CREATE FUNCTION tee_sampler_samples(
+    OUT sample_time timestamptz,
+    OUT pid integer,
+    OUT dbid oid,
+    OUT queryid bigint,
+    OUT node_type text,
+    OUT wait_event_type text,
+    OUT wait_event text
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION tee_sampler_profile(
+    OUT dbid oid,
+    OUT queryid bigint,
+    OUT node_type text,
+    OUT wait_event_type text,
+    OUT wait_event text,
+    OUT samples bigint,
+    OUT stats_reset timestamptz
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
+
+CREATE FUNCTION tee_sampler_reset()
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE VIEW tee_sampler_samples AS
+  SELECT * FROM tee_sampler_samples();
+
+CREATE VIEW tee_sampler_profile AS
+  SELECT * FROM tee_sampler_profile();
+
+-- Where each query spends its time; samples not waiting are on CPU
+CREATE VIEW tee_sampler_by_query AS
+  SELECT dbid, queryid,
+         coalesce(wait_event_type, 'CPU') AS wait_event_type,
+         coalesce(wait_event, 'CPU') AS wait_event,
+         sum(samples) AS samples,
+         round(100.0 * sum(samples) /
+               sum(sum(samples)) OVER (PARTITION BY dbid, queryid), 2) AS percent
+  FROM tee_sampler_profile()
+  GROUP BY 1, 2, 3, 4;
+
+-- Likewise, per plan node type over all queries
+CREATE VIEW tee_sampler_by_node AS
+  SELECT coalesce(node_type, 'none') AS node_type,
+         coalesce(wait_event_type, 'CPU') AS wait_event_type,
+         coalesce(wait_event, 'CPU') AS wait_event,
+         sum(samples) AS samples,
+         round(100.0 * sum(samples) /
+               sum(sum(samples)) OVER (PARTITION BY coalesce(node_type, 'none')), 2) AS percent
+  FROM tee_sampler_profile()
+  GROUP BY 1, 2, 3;
+
+-- Samples show what other sessions run, so don't show them to everyone
+REVOKE ALL ON FUNCTION tee_sampler_samples() FROM PUBLIC;
+REVOKE ALL ON FUNCTION tee_sampler_profile() FROM PUBLIC;
+REVOKE ALL ON tee_sampler_samples FROM PUBLIC;
+REVOKE ALL ON tee_sampler_profile FROM PUBLIC;
+REVOKE ALL ON tee_sampler_by_query FROM PUBLIC;
+REVOKE ALL ON tee_sampler_by_node FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION tee_sampler_samples() TO pg_read_all_stats;
+GRANT EXECUTE ON FUNCTION tee_sampler_profile() TO pg_read_all_stats;
+GRANT SELECT ON tee_sampler_samples TO pg_read_all_stats;
+GRANT SELECT ON tee_sampler_profile TO pg_read_all_stats;
+GRANT SELECT ON tee_sampler_by_query TO pg_read_all_stats;
+GRANT SELECT ON tee_sampler_by_node TO pg_read_all_stats;
+REVOKE ALL ON FUNCTION tee_sampler_reset() FROM PUBLIC;
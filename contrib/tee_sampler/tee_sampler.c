@@ -0,0 +1,804 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_sampler.c
+ *	  Sampling profiler of wait events and executor plan nodes.
+ *
+ * A background worker wakes up tee_sampler.rate times per second and, for
+ * every process that is executing a statement, records its wait event and
+ * the plan node it is in.  Samples go to a ring buffer in shared memory,
+ * for a look at the last few seconds, and are also counted per database,
+ * query identifier, plan node type and wait event, for a profile of where
+ * statements spend their time: waiting for I/O or locks, or on CPU in a
+ * particular kind of node.
+ *
+ * Each backend publishes the query identifier it is executing and, with
+ * tee_sampler.track_nodes, the plan node it is in, in a slot of a shared
+ * array indexed by pgprocno.  The node is tracked by wrapping the
+ * ExecProcNode function of every plan node when the executor starts, which
+ * costs a couple of stores per tuple per node.  The wait event is read from
+ * PGPROC, like pg_stat_activity does.  Slots and wait events are read
+ * without locking, so a sample may mix the state of two instants; that
+ * doesn't matter over many samples.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_sampler/tee_sampler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/queryjumble.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/timestamp.h"
+#include "utils/wait_event.h"
+
+PG_MODULE_MAGIC;
+
+#define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
+
+/* What a backend is executing, read by the sampler */
+typedef struct SamplerSlot
+{
+	pg_atomic_uint64 queryid;	/* 0 if not executing a statement */
+	pg_atomic_uint32 node_tag;	/* NodeTag of current plan node, or T_Invalid */
+} SamplerSlot;
+
+typedef struct Sample
+{
+	TimestampTz time;
+	uint64		queryid;
+	int32		pid;
+	Oid			dbid;
+	uint32		wait_event_info;	/* 0 if on CPU */
+	int32		node_tag;
+} Sample;
+
+typedef struct ProfileKey
+{
+	Oid			dbid;
+	int32		node_tag;
+	uint64		queryid;
+	uint32		wait_event_info;
+} ProfileKey;
+
+typedef struct ProfileEntry
+{
+	ProfileKey	key;			/* hash key of entry - MUST BE FIRST */
+	int64		samples;
+	uint64		last_round;		/* sampling round that last counted here */
+} ProfileEntry;
+
+typedef struct SamplerSharedState
+{
+	LWLock	   *lock;			/* protects everything but the slots */
+	uint64		rounds;			/* sampling rounds since start */
+	uint64		nsamples;		/* samples ever written to the ring */
+	TimestampTz stats_reset;	/* when the profile was last reset */
+} SamplerSharedState;
+
+/* GUC variables */
+static int	sampler_rate = 100;
+static int	sampler_buffer_size = 100000;
+static int	sampler_max = 10000;
+static bool sampler_track_nodes = true;
+
+/* Links to shared memory state */
+static SamplerSharedState *sampler = NULL;
+static SamplerSlot *sampler_slots = NULL;
+static Sample *sampler_ring = NULL;
+static HTAB *profile_hash = NULL;
+
+/* This backend's slot, once it has one */
+static SamplerSlot *my_slot = NULL;
+
+/* Saved hook values */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
+
+PGDLLEXPORT void tee_sampler_main(Datum main_arg);
+
+PG_FUNCTION_INFO_V1(tee_sampler_samples);
+PG_FUNCTION_INFO_V1(tee_sampler_profile);
+PG_FUNCTION_INFO_V1(tee_sampler_reset);
+
+
+static Size
+sampler_memsize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(SamplerSharedState));
+	size = add_size(size, mul_size(MaxBackends, sizeof(SamplerSlot)));
+	size = add_size(size, mul_size(sampler_buffer_size, sizeof(Sample)));
+	size = add_size(size, hash_estimate_size(sampler_max, sizeof(ProfileEntry)));
+	return size;
+}
+
+static void
+sampler_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(sampler_memsize());
+	RequestNamedLWLockTranche("tee_sampler", 1);
+}
+
+static void
+sampler_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	sampler = NULL;
+	sampler_slots = NULL;
+	sampler_ring = NULL;
+	profile_hash = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	sampler = ShmemInitStruct("tee_sampler",
+							  sizeof(SamplerSharedState),
+							  &found);
+	if (!found)
+	{
+		sampler->lock = &(GetNamedLWLockTranche("tee_sampler"))->lock;
+		sampler->rounds = 0;
+		sampler->nsamples = 0;
+		sampler->stats_reset = GetCurrentTimestamp();
+	}
+
+	sampler_slots = ShmemInitStruct("tee_sampler slots",
+									mul_size(MaxBackends, sizeof(SamplerSlot)),
+									&found);
+	if (!found)
+	{
+		for (int i = 0; i < MaxBackends; i++)
+		{
+			pg_atomic_init_u64(&sampler_slots[i].queryid, 0);
+			pg_atomic_init_u32(&sampler_slots[i].node_tag, T_Invalid);
+		}
+	}
+
+	sampler_ring = ShmemInitStruct("tee_sampler ring",
+								   mul_size(sampler_buffer_size, sizeof(Sample)),
+								   &found);
+
+	info.keysize = sizeof(ProfileKey);
+	info.entrysize = sizeof(ProfileEntry);
+	profile_hash = ShmemInitHash("tee_sampler profile",
+								 sampler_max, sampler_max,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+static const char *
+node_type_name(int32 tag)
+{
+	switch ((NodeTag) tag)
+	{
+		case T_Result:
+			return "Result";
+		case T_ProjectSet:
+			return "ProjectSet";
+		case T_ModifyTable:
+			return "ModifyTable";
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "MergeAppend";
+		case T_RecursiveUnion:
+			return "RecursiveUnion";
+		case T_SeqScan:
+			return "SeqScan";
+		case T_SampleScan:
+			return "SampleScan";
+		case T_IndexScan:
+			return "IndexScan";
+		case T_IndexOnlyScan:
+			return "IndexOnlyScan";
+		case T_BitmapHeapScan:
+			return "BitmapHeapScan";
+		case T_TidScan:
+			return "TidScan";
+		case T_TidRangeScan:
+			return "TidRangeScan";
+		case T_SubqueryScan:
+			return "SubqueryScan";
+		case T_FunctionScan:
+			return "FunctionScan";
+		case T_ValuesScan:
+			return "ValuesScan";
+		case T_TableFuncScan:
+			return "TableFuncScan";
+		case T_CteScan:
+			return "CteScan";
+		case T_NamedTuplestoreScan:
+			return "NamedTuplestoreScan";
+		case T_WorkTableScan:
+			return "WorkTableScan";
+		case T_ForeignScan:
+			return "ForeignScan";
+		case T_CustomScan:
+			return "CustomScan";
+		case T_NestLoop:
+			return "NestLoop";
+		case T_MergeJoin:
+			return "MergeJoin";
+		case T_HashJoin:
+			return "HashJoin";
+		case T_AdaptiveJoin:
+			return "AdaptiveJoin";
+		case T_Material:
+			return "Material";
+		case T_Memoize:
+			return "Memoize";
+		case T_Sort:
+			return "Sort";
+		case T_IncrementalSort:
+			return "IncrementalSort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			return "Agg";
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_Gather:
+			return "Gather";
+		case T_GatherMerge:
+			return "GatherMerge";
+		case T_SetOp:
+			return "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		case T_Invalid:
+			return NULL;
+		default:
+			return "Plan";
+	}
+}
+
+/*
+ * Clear this backend's slot at exit, so that the next process using the
+ * same PGPROC doesn't inherit a query.
+ */
+static void
+sampler_clear_slot(int code, Datum arg)
+{
+	pg_atomic_write_u64(&my_slot->queryid, 0);
+	pg_atomic_write_u32(&my_slot->node_tag, T_Invalid);
+}
+
+static bool
+sampler_attach_slot(void)
+{
+	if (my_slot)
+		return true;
+	if (sampler_slots == NULL || MyProc == NULL ||
+		MyProc->pgprocno >= MaxBackends)
+		return false;
+
+	my_slot = &sampler_slots[MyProc->pgprocno];
+	before_shmem_exit(sampler_clear_slot, (Datum) 0);
+	return true;
+}
+
+/*
+ * ExecProcNode wrapper: note the node in our slot while it runs.
+ *
+ * This replaces ExecProcNodeFirst, so it does its stack depth check, here on
+ * every call rather than just the first.  Instrumented nodes go through
+ * ExecProcNodeInstr, as they would have without us.
+ */
+static TupleTableSlot *
+sampler_ExecProcNode(PlanState *node)
+{
+	uint32		outer = pg_atomic_read_u32(&my_slot->node_tag);
+	TupleTableSlot *result;
+
+	check_stack_depth();
+
+	pg_atomic_write_u32(&my_slot->node_tag, (uint32) nodeTag(node->plan));
+
+	if (node->instrument)
+		result = ExecProcNodeInstr(node);
+	else
+		result = node->ExecProcNodeReal(node);
+
+	pg_atomic_write_u32(&my_slot->node_tag, outer);
+
+	return result;
+}
+
+static bool
+sampler_wrap_node(PlanState *planstate, void *context)
+{
+	planstate->ExecProcNode = sampler_ExecProcNode;
+	return planstate_tree_walker(planstate, sampler_wrap_node, context);
+}
+
+/*
+ * ExecutorStart hook: wrap the plan nodes
+ *
+ * Nodes that reset their ExecProcNode while running (a Parallel Hash Join
+ * after the parallel plan is set up) lose the wrapper; samples in them are
+ * then attributed to the node above.
+ */
+static void
+sampler_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (sampler_track_nodes && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		sampler_attach_slot())
+		sampler_wrap_node(queryDesc->planstate, NULL);
+}
+
+/*
+ * ExecutorRun hook: publish the query identifier while executing
+ */
+static void
+sampler_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+					uint64 count, bool execute_once)
+{
+	uint64		outer_queryid = 0;
+	uint32		outer_node = T_Invalid;
+	bool		attached = sampler_attach_slot();
+
+	if (attached)
+	{
+		outer_queryid = pg_atomic_read_u64(&my_slot->queryid);
+		outer_node = pg_atomic_read_u32(&my_slot->node_tag);
+		if (queryDesc->plannedstmt->queryId != UINT64CONST(0))
+			pg_atomic_write_u64(&my_slot->queryid,
+								queryDesc->plannedstmt->queryId);
+	}
+
+	PG_TRY();
+	{
+		if (prev_ExecutorRun)
+			prev_ExecutorRun(queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_FINALLY();
+	{
+		if (attached)
+		{
+			pg_atomic_write_u64(&my_slot->queryid, outer_queryid);
+			pg_atomic_write_u32(&my_slot->node_tag, outer_node);
+		}
+	}
+	PG_END_TRY();
+}
+
+/*
+ * ExecutorFinish hook: likewise, since AFTER triggers run here
+ */
+static void
+sampler_ExecutorFinish(QueryDesc *queryDesc)
+{
+	uint64		outer_queryid = 0;
+	uint32		outer_node = T_Invalid;
+	bool		attached = sampler_attach_slot();
+
+	if (attached)
+	{
+		outer_queryid = pg_atomic_read_u64(&my_slot->queryid);
+		outer_node = pg_atomic_read_u32(&my_slot->node_tag);
+		if (queryDesc->plannedstmt->queryId != UINT64CONST(0))
+			pg_atomic_write_u64(&my_slot->queryid,
+								queryDesc->plannedstmt->queryId);
+	}
+
+	PG_TRY();
+	{
+		if (prev_ExecutorFinish)
+			prev_ExecutorFinish(queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+	}
+	PG_FINALLY();
+	{
+		if (attached)
+		{
+			pg_atomic_write_u64(&my_slot->queryid, outer_queryid);
+			pg_atomic_write_u32(&my_slot->node_tag, outer_node);
+		}
+	}
+	PG_END_TRY();
+}
+
+/*
+ * Count a sample in the profile, evicting the entry that went longest
+ * without a sample if the profile is full.  Caller must hold the lock
+ * exclusively.
+ */
+static void
+profile_count(Sample *s)
+{
+	ProfileKey	key;
+	ProfileEntry *entry;
+	bool		found;
+
+	/* Clear padding of the key, since it's hashed as a blob */
+	memset(&key, 0, sizeof(key));
+	key.dbid = s->dbid;
+	key.node_tag = s->node_tag;
+	key.queryid = s->queryid;
+	key.wait_event_info = s->wait_event_info;
+
+	entry = (ProfileEntry *) hash_search(profile_hash, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		if (hash_get_num_entries(profile_hash) >= sampler_max)
+		{
+			HASH_SEQ_STATUS hash_seq;
+			ProfileEntry *victim = NULL;
+
+			hash_seq_init(&hash_seq, profile_hash);
+			while ((entry = hash_seq_search(&hash_seq)) != NULL)
+			{
+				if (victim == NULL || entry->last_round < victim->last_round)
+					victim = entry;
+			}
+			if (victim)
+				hash_search(profile_hash, &victim->key, HASH_REMOVE, NULL);
+		}
+
+		entry = (ProfileEntry *) hash_search(profile_hash, &key, HASH_ENTER,
+											 &found);
+		entry->samples = 0;
+	}
+
+	entry->samples++;
+	entry->last_round = sampler->rounds;
+}
+
+/*
+ * Take one sample of every process executing a statement.
+ */
+static void
+sample_processes(TimestampTz now)
+{
+	int			nprocs = Min(ProcGlobal->allProcCount, MaxBackends);
+
+	LWLockAcquire(sampler->lock, LW_EXCLUSIVE);
+
+	sampler->rounds++;
+
+	for (int i = 0; i < nprocs; i++)
+	{
+		PGPROC	   *proc = &ProcGlobal->allProcs[i];
+		SamplerSlot *slot = &sampler_slots[i];
+		Sample		s;
+
+		s.queryid = pg_atomic_read_u64(&slot->queryid);
+		if (s.queryid == UINT64CONST(0) || proc->pid == 0)
+			continue;
+
+		s.time = now;
+		s.pid = proc->pid;
+		s.dbid = proc->databaseId;
+		s.wait_event_info = UINT32_ACCESS_ONCE(proc->wait_event_info);
+		s.node_tag = (int32) pg_atomic_read_u32(&slot->node_tag);
+
+		sampler_ring[sampler->nsamples % sampler_buffer_size] = s;
+		sampler->nsamples++;
+		profile_count(&s);
+	}
+
+	LWLockRelease(sampler->lock);
+}
+
+/*
+ * Main entry point of the sampler worker.
+ */
+void
+tee_sampler_main(Datum main_arg)
+{
+	TimestampTz next_sample;
+
+	/* Establish signal handlers; once that's done, unblock signals. */
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	BackgroundWorkerUnblockSignals();
+
+	next_sample = GetCurrentTimestamp();
+
+	while (!ShutdownRequestPending)
+	{
+		/* In case of a SIGHUP, just reload the configuration. */
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (sampler_rate <= 0)
+		{
+			/* Sampling is paused, so just wait for a reload. */
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+							 -1L,
+							 PG_WAIT_EXTENSION);
+			next_sample = GetCurrentTimestamp();
+		}
+		else
+		{
+			TimestampTz now = GetCurrentTimestamp();
+			int64		interval = 1000000 / sampler_rate;
+
+			if (now >= next_sample)
+			{
+				sample_processes(now);
+
+				/* if we fell behind, don't try to catch up */
+				next_sample += interval;
+				if (next_sample <= now)
+					next_sample = now + interval;
+				continue;
+			}
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 TimestampDifferenceMilliseconds(now, next_sample),
+							 PG_WAIT_EXTENSION);
+		}
+
+		ResetLatch(MyLatch);
+	}
+}
+
+static void
+set_wait_event(Datum *values, bool *nulls, uint32 wait_event_info)
+{
+	const char *type = pgstat_get_wait_event_type(wait_event_info);
+	const char *event = pgstat_get_wait_event(wait_event_info);
+
+	if (type)
+		values[0] = CStringGetTextDatum(type);
+	else
+		nulls[0] = true;
+	if (event)
+		values[1] = CStringGetTextDatum(event);
+	else
+		nulls[1] = true;
+}
+
+static void
+set_node_type(Datum *value, bool *isnull, int32 node_tag)
+{
+	const char *name = node_type_name(node_tag);
+
+	if (name)
+		*value = CStringGetTextDatum(name);
+	else
+		*isnull = true;
+}
+
+static void
+check_loaded(void)
+{
+	if (!sampler || !profile_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_sampler must be loaded via shared_preload_libraries")));
+}
+
+/*
+ * Return the samples in the ring buffer, oldest first.
+ */
+Datum
+tee_sampler_samples(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	uint64		first;
+
+	check_loaded();
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(sampler->lock, LW_SHARED);
+
+	first = sampler->nsamples > (uint64) sampler_buffer_size ?
+		sampler->nsamples - sampler_buffer_size : 0;
+
+	for (uint64 n = first; n < sampler->nsamples; n++)
+	{
+		Sample	   *s = &sampler_ring[n % sampler_buffer_size];
+		Datum		values[7];
+		bool		nulls[7] = {0};
+
+		values[0] = TimestampTzGetDatum(s->time);
+		values[1] = Int32GetDatum(s->pid);
+		values[2] = ObjectIdGetDatum(s->dbid);
+		values[3] = Int64GetDatum((int64) s->queryid);
+		set_node_type(&values[4], &nulls[4], s->node_tag);
+		set_wait_event(&values[5], &nulls[5], s->wait_event_info);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(sampler->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * Return the sample counts per database, query, node type and wait event.
+ */
+Datum
+tee_sampler_profile(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	ProfileEntry *entry;
+
+	check_loaded();
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(sampler->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, profile_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[7];
+		bool		nulls[7] = {0};
+
+		values[0] = ObjectIdGetDatum(entry->key.dbid);
+		values[1] = Int64GetDatum((int64) entry->key.queryid);
+		set_node_type(&values[2], &nulls[2], entry->key.node_tag);
+		set_wait_event(&values[3], &nulls[3], entry->key.wait_event_info);
+		values[5] = Int64GetDatum(entry->samples);
+		values[6] = TimestampTzGetDatum(sampler->stats_reset);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(sampler->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * Discard the profile and the ring buffer.
+ */
+Datum
+tee_sampler_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	ProfileEntry *entry;
+
+	check_loaded();
+
+	LWLockAcquire(sampler->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, profile_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(profile_hash, &entry->key, HASH_REMOVE, NULL);
+	sampler->nsamples = 0;
+	sampler->stats_reset = GetCurrentTimestamp();
+	LWLockRelease(sampler->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	BackgroundWorker worker;
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("tee_sampler.rate",
+							"Sets how many times per second processes are sampled.",
+							"Zero pauses sampling.",
+							&sampler_rate,
+							100,
+							0,
+							1000,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("tee_sampler.buffer_size",
+							"Sets the number of recent samples kept.",
+							NULL,
+							&sampler_buffer_size,
+							100000,
+							1000,
+							(int) (INT_MAX / sizeof(Sample)),
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("tee_sampler.max",
+							"Sets the maximum number of entries in the profile.",
+							NULL,
+							&sampler_max,
+							10000,
+							100,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("tee_sampler.track_nodes",
+							 "Selects whether the plan node being executed is sampled.",
+							 NULL,
+							 &sampler_track_nodes,
+							 true,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	MarkGUCPrefixReserved("tee_sampler");
+
+	/* samples are attributed to query identifiers */
+	EnableQueryId();
+
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = sampler_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = sampler_shmem_startup;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = sampler_ExecutorStart;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = sampler_ExecutorRun;
+	prev_ExecutorFinish = ExecutorFinish_hook;
+	ExecutorFinish_hook = sampler_ExecutorFinish;
+
+	memset(&worker, 0, sizeof(BackgroundWorker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = 10;
+	strcpy(worker.bgw_library_name, "tee_sampler");
+	strcpy(worker.bgw_function_name, "tee_sampler_main");
+	strcpy(worker.bgw_name, "tee_sampler");
+	strcpy(worker.bgw_type, "tee_sampler");
+	RegisterBackgroundWorker(&worker);
+}
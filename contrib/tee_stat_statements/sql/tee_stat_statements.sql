@@ -0,0 +1,35 @@
+CREATE EXTENSION pg_stat_statements;
+CREATE EXTENSION tee_stat_statements;
+
+CREATE TABLE tss_t (a int);
+INSERT INTO tss_t SELECT g % 10 FROM generate_series(1, 100) g;
+
+SELECT tee_stat_statements_reset();
+
+-- A generic plan is made with no components enabled, and cached
+SET plan_cache_mode = force_generic_plan;
+PREPARE q1(int) AS SELECT count(*) FROM tss_t WHERE a = $1;
+EXECUTE q1(1);
+
+-- The same query is planned again with a component enabled.  The component
+-- only has to look enabled, so its module needn't be loaded.
+SET tee_cost_model.enable = on;
+PREPARE q2(int) AS SELECT count(*) FROM tss_t WHERE a = $1;
+EXECUTE q2(2);
+
+-- Executing the cached plan counts under the components it was made with
+EXECUTE q1(3);
+EXECUTE q1(4);
+
+RESET tee_cost_model.enable;
+RESET plan_cache_mode;
+
+SELECT t.components, t.decision, t.plans, t.calls, t.rows
+  FROM tee_stat_statements t
+  JOIN pg_stat_statements s USING (userid, dbid, queryid)
+ WHERE s.query LIKE '%tss_t WHERE%'
+ ORDER BY t.components COLLATE "C";
+
+DEALLOCATE q1;
+DEALLOCATE q2;
+DROP TABLE tss_t;
@@ -0,0 +1,556 @@
+/*-------------------------------------------------------------------------
+ *
+ * tee_stat_statements.c
+ *	  Planning and execution statistics per query, TEE planner component
+ *	  combination and selector decision.
+ *
+ * pg_stat_statements tells how long a query takes, but not which of the TEE
+ * planner components were enabled when it was planned, nor whether
+ * tee_adaptive_selector chose them from its cache, by its rules or on
+ * tee_plan_tracker's advice.  This module keeps, in shared memory and keyed
+ * like pg_stat_statements by user, database and query identifier, separate
+ * counters for every component combination and decision source, so that a
+ * slowdown caused by a component choice can be told apart from one caused
+ * by data growth.  Join the view with pg_stat_statements on (userid, dbid,
+ * queryid) to get the query text.
+ *
+ * The components and decision are those in effect when the plan was made;
+ * they are carried in the plan until it is executed, which may be much later
+ * for a prepared statement.
+ *
+ * Statistics are not kept across server restarts.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/tee_stat_statements/tee_stat_statements.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/parallel.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/queryjumble.h"
+#include "optimizer/planner.h"
+#include "portability/instr_time.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tee_adaptive_selector/tee_adaptive_selector.h"
+#include "tee_plan_tracker/tee_plan_tracker.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+PG_MODULE_MAGIC;
+
+/* name of our entry in PlannedStmt.extensionState */
+#define TSS_PLAN_STATE_NAME		"tee_stat_statements"
+
+typedef struct TssKey
+{
+	Oid			userid;
+	Oid			dbid;
+	uint64		queryid;
+	uint8		components;		/* TEE_COMPONENT_* enabled when planned */
+	uint8		decision;		/* TeeSelectorDecision */
+} TssKey;
+
+typedef struct TssCounters
+{
+	int64		plans;
+	double		total_plan_time;	/* ms */
+	double		min_plan_time;
+	double		max_plan_time;
+	int64		calls;
+	double		total_exec_time;	/* ms */
+	double		min_exec_time;
+	double		max_exec_time;
+	double		mean_exec_time;
+	double		sum_var_exec_time;	/* as in pg_stat_statements */
+	int64		rows;
+} TssCounters;
+
+typedef struct TssEntry
+{
+	TssKey		key;			/* hash key of entry - MUST BE FIRST */
+	slock_t		mutex;			/* protects the fields below */
+	TimestampTz last_seen;
+	TssCounters counters;
+} TssEntry;
+
+typedef struct TssSharedState
+{
+	LWLock	   *lock;			/* protects hashtable search/modification */
+} TssSharedState;
+
+/* names of the decision sources, indexed by TeeSelectorDecision */
+static const char *const decision_names[] = {
+	"none", "rules", "cache", "tracker"
+};
+
+/* GUC variables */
+static int	tss_max = 5000;
+static bool tss_track = true;
+
+/* Links to shared memory state */
+static TssSharedState *tss = NULL;
+static HTAB *tss_hash = NULL;
+
+/* The selector's decision, if it is loaded */
+static TeeSelectorDecision **selector_decision = NULL;
+
+/* Saved hook values */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static planner_hook_type prev_planner_hook = NULL;
+static ExecutorStart_hook_type prev_ExecutorStart = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+
+PG_FUNCTION_INFO_V1(tee_stat_statements);
+PG_FUNCTION_INFO_V1(tee_stat_statements_reset);
+
+#define tss_enabled() \
+	(tss_track && tss_hash != NULL && !IsParallelWorker())
+
+
+static Size
+tss_memsize(void)
+{
+	return add_size(MAXALIGN(sizeof(TssSharedState)),
+					hash_estimate_size(tss_max, sizeof(TssEntry)));
+}
+
+static void
+tss_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(tss_memsize());
+	RequestNamedLWLockTranche("tee_stat_statements", 1);
+}
+
+static void
+tss_shmem_startup(void)
+{
+	bool		found;
+	HASHCTL		info;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/* reset in case this is a restart within the postmaster */
+	tss = NULL;
+	tss_hash = NULL;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	tss = ShmemInitStruct("tee_stat_statements",
+						  sizeof(TssSharedState),
+						  &found);
+	if (!found)
+		tss->lock = &(GetNamedLWLockTranche("tee_stat_statements"))->lock;
+
+	info.keysize = sizeof(TssKey);
+	info.entrysize = sizeof(TssEntry);
+	tss_hash = ShmemInitHash("tee_stat_statements hash",
+							 tss_max, tss_max,
+							 &info,
+							 HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+/*
+ * Remember how a plan was made, for when it is executed.  This is stored in
+ * the plan itself, since a plan can be cached and executed much later, after
+ * the same query has been planned differently.
+ */
+static void
+remember_plan_decision(PlannedStmt *pstmt, uint8 components, uint8 decision)
+{
+	pstmt->extensionState =
+		lappend(pstmt->extensionState,
+				makeDefElem(TSS_PLAN_STATE_NAME,
+							(Node *) list_make2_int(components, decision),
+							-1));
+}
+
+static void
+lookup_plan_decision(PlannedStmt *pstmt, uint8 *components, uint8 *decision)
+{
+	ListCell   *lc;
+
+	foreach(lc, pstmt->extensionState)
+	{
+		DefElem    *def = lfirst_node(DefElem, lc);
+
+		if (strcmp(def->defname, TSS_PLAN_STATE_NAME) == 0)
+		{
+			List	   *state = (List *) def->arg;
+
+			*components = (uint8) linitial_int(state);
+			*decision = (uint8) lsecond_int(state);
+			return;
+		}
+	}
+
+	/* planned while we weren't tracking; best guess */
+	*components = tee_current_components();
+	*decision = TEE_DECISION_NONE;
+}
+
+/*
+ * Allocate a new entry, evicting the least recently used one if we're full.
+ * Caller must hold an exclusive lock.
+ */
+static TssEntry *
+entry_alloc(TssKey *key)
+{
+	TssEntry   *entry;
+	bool		found;
+
+	if (hash_get_num_entries(tss_hash) >= tss_max)
+	{
+		HASH_SEQ_STATUS hash_seq;
+		TssEntry   *victim = NULL;
+
+		hash_seq_init(&hash_seq, tss_hash);
+		while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		{
+			if (victim == NULL || entry->last_seen < victim->last_seen)
+				victim = entry;
+		}
+		if (victim)
+			hash_search(tss_hash, &victim->key, HASH_REMOVE, NULL);
+	}
+
+	entry = (TssEntry *) hash_search(tss_hash, key, HASH_ENTER, &found);
+	if (!found)
+	{
+		SpinLockInit(&entry->mutex);
+		entry->last_seen = 0;
+		memset(&entry->counters, 0, sizeof(TssCounters));
+	}
+	return entry;
+}
+
+/*
+ * Record a planning (plan_time >= 0) or an execution (exec_time >= 0).
+ */
+static void
+tss_store(uint64 queryid, uint8 components, uint8 decision,
+		  double plan_time, double exec_time, uint64 rows)
+{
+	TssKey		key;
+	TssEntry   *entry;
+	TssCounters *c;
+
+	/* Clear padding of the key, since it's hashed as a blob */
+	memset(&key, 0, sizeof(key));
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = queryid;
+	key.components = components;
+	key.decision = decision;
+
+	LWLockAcquire(tss->lock, LW_SHARED);
+
+	entry = (TssEntry *) hash_search(tss_hash, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		LWLockRelease(tss->lock);
+		LWLockAcquire(tss->lock, LW_EXCLUSIVE);
+		entry = entry_alloc(&key);
+	}
+
+	SpinLockAcquire(&entry->mutex);
+
+	c = &entry->counters;
+	if (plan_time >= 0)
+	{
+		c->plans++;
+		c->total_plan_time += plan_time;
+		if (c->plans == 1)
+			c->min_plan_time = c->max_plan_time = plan_time;
+		else
+		{
+			c->min_plan_time = Min(c->min_plan_time, plan_time);
+			c->max_plan_time = Max(c->max_plan_time, plan_time);
+		}
+	}
+	if (exec_time >= 0)
+	{
+		double		old_mean = c->mean_exec_time;
+
+		c->calls++;
+		c->total_exec_time += exec_time;
+		c->rows += rows;
+		if (c->calls == 1)
+		{
+			c->min_exec_time = c->max_exec_time = exec_time;
+			c->mean_exec_time = exec_time;
+		}
+		else
+		{
+			/* Welford's method, as in pg_stat_statements */
+			c->mean_exec_time += (exec_time - old_mean) / c->calls;
+			c->sum_var_exec_time += (exec_time - old_mean) *
+				(exec_time - c->mean_exec_time);
+			c->min_exec_time = Min(c->min_exec_time, exec_time);
+			c->max_exec_time = Max(c->max_exec_time, exec_time);
+		}
+	}
+	entry->last_seen = GetCurrentTimestamp();
+
+	SpinLockRelease(&entry->mutex);
+	LWLockRelease(tss->lock);
+}
+
+/*
+ * Planner hook: time the planning, and note which components were enabled
+ * and how they were chosen.
+ *
+ * If tee_adaptive_selector's hook runs inside ours, the planning time
+ * includes its overhead, which is part of what the components cost.
+ */
+static PlannedStmt *
+tss_planner(Query *parse, const char *query_string, int cursorOptions,
+			ParamListInfo boundParams)
+{
+	PlannedStmt *result;
+	instr_time	start;
+	instr_time	duration;
+	uint8		components;
+	uint8		decision;
+
+	if (!tss_enabled() || parse->queryId == UINT64CONST(0))
+	{
+		if (prev_planner_hook)
+			return prev_planner_hook(parse, query_string, cursorOptions,
+									 boundParams);
+		return standard_planner(parse, query_string, cursorOptions,
+								boundParams);
+	}
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	if (prev_planner_hook)
+		result = prev_planner_hook(parse, query_string, cursorOptions,
+								   boundParams);
+	else
+		result = standard_planner(parse, query_string, cursorOptions,
+								  boundParams);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	components = tee_current_components();
+	decision = TEE_DECISION_NONE;
+	if (selector_decision != NULL && *selector_decision != NULL)
+		decision = **selector_decision;
+
+	remember_plan_decision(result, components, decision);
+	tss_store(parse->queryId, components, decision,
+			  INSTR_TIME_GET_MILLISEC(duration), -1, 0);
+
+	return result;
+}
+
+/*
+ * ExecutorStart hook: set up timing of tracked statements
+ */
+static void
+tss_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (prev_ExecutorStart)
+		prev_ExecutorStart(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (tss_enabled() && queryDesc->plannedstmt->queryId != UINT64CONST(0) &&
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		queryDesc->totaltime == NULL)
+	{
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(queryDesc->estate->es_query_cxt);
+		queryDesc->totaltime = InstrAlloc(1, INSTRUMENT_TIMER, false);
+		MemoryContextSwitchTo(oldcxt);
+	}
+}
+
+/*
+ * ExecutorEnd hook: record the execution under the plan's decision
+ */
+static void
+tss_ExecutorEnd(QueryDesc *queryDesc)
+{
+	uint64		queryid = queryDesc->plannedstmt->queryId;
+
+	if (tss_enabled() && queryid != UINT64CONST(0) && queryDesc->totaltime &&
+		(queryDesc->estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
+	{
+		uint8		components;
+		uint8		decision;
+
+		InstrEndLoop(queryDesc->totaltime);
+		lookup_plan_decision(queryDesc->plannedstmt, &components, &decision);
+		tss_store(queryid, components, decision, -1,
+				  queryDesc->totaltime->total * 1000.0,
+				  queryDesc->estate->es_processed);
+	}
+
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+}
+
+/*
+ * Return the statistics of every query, component combination and decision.
+ */
+Datum
+tee_stat_statements(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	TssEntry   *entry;
+
+	if (!tss || !tss_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_stat_statements must be loaded via shared_preload_libraries")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(tss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, tss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[17];
+		bool		nulls[17] = {0};
+		TssCounters c;
+		int			i = 0;
+
+		SpinLockAcquire(&entry->mutex);
+		c = entry->counters;
+		SpinLockRelease(&entry->mutex);
+
+		values[i++] = ObjectIdGetDatum(entry->key.userid);
+		values[i++] = ObjectIdGetDatum(entry->key.dbid);
+		values[i++] = Int64GetDatum((int64) entry->key.queryid);
+		values[i++] = CStringGetTextDatum(tee_component_name(entry->key.components));
+		values[i++] = CStringGetTextDatum(decision_names[entry->key.decision]);
+		values[i++] = Int64GetDatum(c.plans);
+		values[i++] = Float8GetDatum(c.total_plan_time);
+		values[i++] = Float8GetDatum(c.min_plan_time);
+		values[i++] = Float8GetDatum(c.max_plan_time);
+		values[i++] = Float8GetDatum(c.plans > 0 ?
+									 c.total_plan_time / c.plans : 0.0);
+		values[i++] = Int64GetDatum(c.calls);
+		values[i++] = Float8GetDatum(c.total_exec_time);
+		values[i++] = Float8GetDatum(c.min_exec_time);
+		values[i++] = Float8GetDatum(c.max_exec_time);
+		values[i++] = Float8GetDatum(c.mean_exec_time);
+		values[i++] = Float8GetDatum(c.calls > 1 ?
+									 sqrt(c.sum_var_exec_time / c.calls) : 0.0);
+		values[i++] = Int64GetDatum(c.rows);
+		Assert(i == lengthof(values));
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(tss->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * Forget all statistics.
+ */
+Datum
+tee_stat_statements_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	TssEntry   *entry;
+
+	if (!tss || !tss_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("tee_stat_statements must be loaded via shared_preload_libraries")));
+
+	LWLockAcquire(tss->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, tss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(tss_hash, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(tss->lock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	DefineCustomIntVariable("tee_stat_statements.max",
+							"Sets the maximum number of entries kept by tee_stat_statements.",
+							"Each query has one entry per component combination and decision source.",
+							&tss_max,
+							5000,
+							100,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("tee_stat_statements.track",
+							 "Selects whether statements are tracked by tee_stat_statements.",
+							 NULL,
+							 &tss_track,
+							 true,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	MarkGUCPrefixReserved("tee_stat_statements");
+
+	/* statements are tracked by query identifier */
+	EnableQueryId();
+
+	selector_decision = (TeeSelectorDecision **)
+		find_rendezvous_variable(TEE_ADAPTIVE_SELECTOR_RENDEZVOUS);
+
+	prev_shmem_request_hook = shmem_request_hook;
+	shmem_request_hook = tss_shmem_request;
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = tss_shmem_startup;
+	prev_planner_hook = planner_hook;
+	planner_hook = tss_planner;
+	prev_ExecutorStart = ExecutorStart_hook;
+	ExecutorStart_hook = tss_ExecutorStart;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = tss_ExecutorEnd;
+}
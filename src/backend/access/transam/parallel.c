@@ -33,12 +33,14 @@
 #include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "storage/ipc.h"
+#include "postmaster/bgworker.h"
 #include "storage/predicate.h"
 #include "storage/sinval.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/combocid.h"
 #include "utils/guc.h"
+#include "utils/guc_hooks.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/relmapper.h"
@@ -107,6 +109,61 @@ typedef struct FixedParallelState
 	XLogRecPtr	last_xlog_end;
 } FixedParallelState;
 
+/*
+ * Pool of parallel workers started ahead of time (see
+ * parallel_worker_prestart).  A leader that uses the pool creates it in a DSM
+ * segment of its own, which it keeps mapped for the rest of its session.
+ * Each slot describes at most one worker; the worker connects to the leader's
+ * database as the leader's authenticated user and then sleeps until the
+ * leader hands it the DSM segment of a parallel context to join.  A worker
+ * serves exactly one parallel context and then exits, like any other parallel
+ * worker, so it never has to shed the state it picks up from the leader.
+ */
+typedef enum PrestartSlotState
+{
+	PRESTART_SLOT_UNUSED,		/* no worker; leader may start one */
+	PRESTART_SLOT_STARTING,		/* worker registered but not yet connected */
+	PRESTART_SLOT_IDLE,			/* worker waiting to be assigned */
+	PRESTART_SLOT_ASSIGNED,		/* leader has given the worker a context */
+	PRESTART_SLOT_RETIRING		/* leader is terminating the worker */
+} PrestartSlotState;
+
+typedef struct PrestartSlot
+{
+	slock_t		mutex;
+	PrestartSlotState state;
+	PGPROC	   *proc;			/* worker's PGPROC, once idle */
+	dsm_handle	seg_handle;		/* context to join, once assigned */
+	int			worker_number;	/* ParallelWorkerNumber, once assigned */
+} PrestartSlot;
+
+typedef struct PrestartPool
+{
+	Oid			database_id;
+	Oid			authenticated_user_id;
+	bool		authenticated_user_is_superuser;
+	int			nslots;
+	PrestartSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} PrestartPool;
+
+/* GUC: number of idle parallel workers a leader keeps started. */
+int			parallel_worker_prestart = 0;
+
+/*
+ * Leader's pool, if any.  prestart_handles[i] is the leader's handle for the
+ * worker in slot i, or NULL if the slot is unused or its worker has been
+ * handed to a parallel context (which then owns the handle).
+ */
+static dsm_segment *PrestartSeg = NULL;
+static PrestartPool *MyPrestartPool = NULL;
+static BackgroundWorkerHandle **PrestartHandles = NULL;
+
+/* Has parallel_worker_prestart been lowered since we last looked? */
+static bool PrestartSurplusPending = false;
+
+/* In a prestarted worker, our slot until we've been assigned a context. */
+static PrestartSlot *MyPrestartSlot = NULL;
+
 /*
  * Our parallel worker number.  We initialize this to -1, meaning that we are
  * not a parallel worker.  In parallel workers, it will be set to a value >= 0
@@ -157,6 +214,13 @@ static void HandleParallelMessage(ParallelContext *pcxt, int i, StringInfo msg);
 static void WaitForParallelWorkersToExit(ParallelContext *pcxt);
 static parallel_worker_main_type LookupParallelWorkerFunction(const char *libraryname, const char *funcname);
 static void ParallelWorkerShutdown(int code, Datum arg);
+static void ParallelWorkerRun(dsm_handle handle, int worker_number,
+							  bool connected);
+static BackgroundWorkerHandle *ClaimPrestartedWorker(dsm_handle handle,
+													 int worker_number);
+static void MaintainPrestartedWorkers(void);
+static void ShutdownPrestartedWorkers(int code, Datum arg);
+static void PrestartedWorkerShutdown(int code, Datum arg);
 
 
 /*
@@ -611,6 +675,17 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	 */
 	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
 	{
+		/* Prefer a worker that is already connected and waiting. */
+		if (!any_registrations_failed &&
+			(pcxt->worker[i].bgwhandle =
+			 ClaimPrestartedWorker(dsm_segment_handle(pcxt->seg), i)) != NULL)
+		{
+			shm_mq_set_handle(pcxt->worker[i].error_mqh,
+							  pcxt->worker[i].bgwhandle);
+			pcxt->nworkers_launched++;
+			continue;
+		}
+
 		memcpy(worker.bgw_extra, &i, sizeof(int));
 		if (!any_registrations_failed &&
 			RegisterDynamicBackgroundWorker(&worker,
@@ -651,6 +726,231 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 
 	/* Restore previous memory context. */
 	MemoryContextSwitchTo(oldcontext);
+
+	/* Replace any prestarted workers we just used up. */
+	MaintainPrestartedWorkers();
+}
+
+/*
+ * Hand the parallel context with the given DSM handle to one of our idle
+ * prestarted workers, if we have one.  Returns the worker's handle, which
+ * now belongs to the caller, or NULL.
+ */
+static BackgroundWorkerHandle *
+ClaimPrestartedWorker(dsm_handle handle, int worker_number)
+{
+	int			i;
+
+	if (MyPrestartPool == NULL)
+		return NULL;
+
+	for (i = 0; i < MyPrestartPool->nslots; ++i)
+	{
+		PrestartSlot *slot = &MyPrestartPool->slots[i];
+		BackgroundWorkerHandle *bgwhandle;
+		PGPROC	   *proc = NULL;
+
+		if (PrestartHandles[i] == NULL)
+			continue;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == PRESTART_SLOT_IDLE)
+		{
+			slot->state = PRESTART_SLOT_ASSIGNED;
+			slot->seg_handle = handle;
+			slot->worker_number = worker_number;
+			proc = slot->proc;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		if (proc == NULL)
+			continue;
+
+		SetLatch(&proc->procLatch);
+		bgwhandle = PrestartHandles[i];
+		PrestartHandles[i] = NULL;
+		return bgwhandle;
+	}
+
+	return NULL;
+}
+
+/*
+ * Bring the number of prestarted workers we keep back to
+ * parallel_worker_prestart, forgetting workers that have gone away, starting
+ * new ones and retiring any surplus.
+ */
+static void
+MaintainPrestartedWorkers(void)
+{
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	int			nactive = 0;
+	int			i;
+
+	if (MyPrestartPool == NULL)
+	{
+		Size		size;
+
+		if (parallel_worker_prestart <= 0)
+			return;
+
+		size = add_size(offsetof(PrestartPool, slots),
+						mul_size(max_worker_processes, sizeof(PrestartSlot)));
+		PrestartSeg = dsm_create(size, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+		if (PrestartSeg == NULL)
+			return;
+		dsm_pin_mapping(PrestartSeg);
+
+		MyPrestartPool = dsm_segment_address(PrestartSeg);
+		MyPrestartPool->database_id = MyDatabaseId;
+		MyPrestartPool->authenticated_user_id = GetAuthenticatedUserId();
+		MyPrestartPool->authenticated_user_is_superuser =
+			GetAuthenticatedUserIsSuperuser();
+		MyPrestartPool->nslots = max_worker_processes;
+		for (i = 0; i < MyPrestartPool->nslots; ++i)
+		{
+			SpinLockInit(&MyPrestartPool->slots[i].mutex);
+			MyPrestartPool->slots[i].state = PRESTART_SLOT_UNUSED;
+			MyPrestartPool->slots[i].proc = NULL;
+		}
+		PrestartHandles = MemoryContextAllocZero(TopMemoryContext,
+												 sizeof(BackgroundWorkerHandle *) *
+												 MyPrestartPool->nslots);
+		before_shmem_exit(ShutdownPrestartedWorkers, (Datum) 0);
+	}
+
+	/* Forget workers that have exited, and retire any we no longer want. */
+	for (i = 0; i < MyPrestartPool->nslots; ++i)
+	{
+		PrestartSlot *slot = &MyPrestartPool->slots[i];
+		PrestartSlotState state;
+		pid_t		pid;
+
+		if (PrestartHandles[i] == NULL)
+			continue;
+
+		if (GetBackgroundWorkerPid(PrestartHandles[i], &pid) == BGWH_STOPPED)
+		{
+			SpinLockAcquire(&slot->mutex);
+			slot->state = PRESTART_SLOT_UNUSED;
+			slot->proc = NULL;
+			SpinLockRelease(&slot->mutex);
+		}
+
+		SpinLockAcquire(&slot->mutex);
+		state = slot->state;
+		if ((state == PRESTART_SLOT_STARTING || state == PRESTART_SLOT_IDLE) &&
+			nactive >= parallel_worker_prestart)
+			slot->state = state = PRESTART_SLOT_RETIRING;
+		SpinLockRelease(&slot->mutex);
+
+		if (state == PRESTART_SLOT_UNUSED)
+		{
+			pfree(PrestartHandles[i]);
+			PrestartHandles[i] = NULL;
+		}
+		else if (state == PRESTART_SLOT_RETIRING)
+			TerminateBackgroundWorker(PrestartHandles[i]);
+		else
+			nactive++;
+	}
+
+	if (nactive >= parallel_worker_prestart)
+		return;
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel worker for PID %d",
+			 MyProcPid);
+	snprintf(worker.bgw_type, BGW_MAXLEN, "parallel worker");
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION
+		| BGWORKER_CLASS_PARALLEL;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "ParallelWorkerPrestartMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(PrestartSeg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	for (i = 0; i < MyPrestartPool->nslots && nactive < parallel_worker_prestart; ++i)
+	{
+		PrestartSlot *slot = &MyPrestartPool->slots[i];
+		bool		claimed = false;
+
+		if (PrestartHandles[i] != NULL)
+			continue;
+
+		/* An assigned worker gives its slot back once it has read it. */
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == PRESTART_SLOT_UNUSED)
+		{
+			slot->state = PRESTART_SLOT_STARTING;
+			claimed = true;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		if (!claimed)
+			continue;
+
+		memcpy(worker.bgw_extra, &i, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker, &PrestartHandles[i]))
+		{
+			/* Out of worker slots; try again at the next launch. */
+			SpinLockAcquire(&slot->mutex);
+			slot->state = PRESTART_SLOT_UNUSED;
+			SpinLockRelease(&slot->mutex);
+			PrestartHandles[i] = NULL;
+			break;
+		}
+		nactive++;
+	}
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * GUC assign hook for parallel_worker_prestart.  Terminating workers isn't
+ * something to do from an assign hook, which may run during transaction
+ * abort, so just note that the pool may have grown too large; the leader
+ * retires the surplus in AdjustPrestartedWorkers when it next goes idle.
+ */
+void
+assign_parallel_worker_prestart(int newval, void *extra)
+{
+	if (MyPrestartPool != NULL && newval < parallel_worker_prestart)
+		PrestartSurplusPending = true;
+}
+
+/*
+ * Retire idle prestarted workers beyond parallel_worker_prestart, if the
+ * setting has been lowered.  Called by the leader between queries, so that
+ * lowering or resetting the setting gives the workers back at once instead
+ * of at the next parallel operation.
+ */
+void
+AdjustPrestartedWorkers(void)
+{
+	if (!PrestartSurplusPending)
+		return;
+
+	PrestartSurplusPending = false;
+	MaintainPrestartedWorkers();
+}
+
+/*
+ * Terminate our prestarted workers when the leader exits.
+ */
+static void
+ShutdownPrestartedWorkers(int code, Datum arg)
+{
+	int			i;
+
+	for (i = 0; i < MyPrestartPool->nslots; ++i)
+	{
+		if (PrestartHandles[i] != NULL)
+			TerminateBackgroundWorker(PrestartHandles[i]);
+	}
 }
 
 /*
@@ -1279,6 +1579,124 @@ AtEOXact_Parallel(bool isCommit)
  */
 void
 ParallelWorkerMain(Datum main_arg)
+{
+	int			worker_number;
+
+	/* Set flag to indicate that we're initializing a parallel worker. */
+	InitializingParallelWorker = true;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+	ParallelWorkerRun(DatumGetUInt32(main_arg), worker_number, false);
+}
+
+/*
+ * Main entrypoint for prestarted parallel workers.
+ *
+ * We connect to the leader's database as the leader's authenticated user,
+ * which is everything in a parallel worker's startup that doesn't depend on
+ * the parallel context, and then wait for the leader to assign us one.
+ */
+void
+ParallelWorkerPrestartMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	PrestartPool *pool;
+	int			slotno;
+	dsm_handle	handle = DSM_HANDLE_INVALID;
+	int			worker_number = -1;
+
+	/* Set flag to indicate that we're initializing a parallel worker. */
+	InitializingParallelWorker = true;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Find our slot in the leader's pool. */
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	pool = dsm_segment_address(seg);
+	memcpy(&slotno, MyBgworkerEntry->bgw_extra, sizeof(int));
+	Assert(slotno >= 0 && slotno < pool->nslots);
+	MyPrestartSlot = &pool->slots[slotno];
+	before_shmem_exit(PrestartedWorkerShutdown, (Datum) 0);
+
+	/* See ParallelWorkerRun for why no authorization checks are needed. */
+	SetAuthenticatedUserId(pool->authenticated_user_id,
+						   pool->authenticated_user_is_superuser);
+	SetSessionAuthorization(pool->authenticated_user_id,
+							pool->authenticated_user_is_superuser);
+	BackgroundWorkerInitializeConnectionByOid(pool->database_id,
+											  pool->authenticated_user_id,
+											  BGWORKER_BYPASS_ALLOWCONN);
+
+	SpinLockAcquire(&MyPrestartSlot->mutex);
+	if (MyPrestartSlot->state == PRESTART_SLOT_STARTING)
+	{
+		MyPrestartSlot->state = PRESTART_SLOT_IDLE;
+		MyPrestartSlot->proc = MyProc;
+	}
+	SpinLockRelease(&MyPrestartSlot->mutex);
+
+	for (;;)
+	{
+		SpinLockAcquire(&MyPrestartSlot->mutex);
+		if (MyPrestartSlot->state == PRESTART_SLOT_ASSIGNED)
+		{
+			handle = MyPrestartSlot->seg_handle;
+			worker_number = MyPrestartSlot->worker_number;
+			MyPrestartSlot->state = PRESTART_SLOT_UNUSED;
+			MyPrestartSlot->proc = NULL;
+		}
+		SpinLockRelease(&MyPrestartSlot->mutex);
+
+		if (worker_number >= 0)
+			break;
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_PARALLEL_WORKER_PRESTART);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* The slot is the leader's again; we're done with the pool. */
+	MyPrestartSlot = NULL;
+	dsm_detach(seg);
+
+	ParallelWorkerRun(handle, worker_number, true);
+}
+
+/*
+ * Give a prestarted worker's slot back to the leader if the worker exits
+ * before taking an assignment.
+ */
+static void
+PrestartedWorkerShutdown(int code, Datum arg)
+{
+	if (MyPrestartSlot == NULL)
+		return;
+
+	SpinLockAcquire(&MyPrestartSlot->mutex);
+	MyPrestartSlot->state = PRESTART_SLOT_UNUSED;
+	MyPrestartSlot->proc = NULL;
+	SpinLockRelease(&MyPrestartSlot->mutex);
+}
+
+/*
+ * Join the parallel context whose DSM segment has the given handle, as the
+ * given worker number, and run its entrypoint.  If "connected" is true, we
+ * are a prestarted worker that has already connected to the leader's
+ * database as the leader's authenticated user.
+ */
+static void
+ParallelWorkerRun(dsm_handle handle, int worker_number, bool connected)
 {
 	dsm_segment *seg;
 	shm_toc    *toc;
@@ -1306,16 +1724,9 @@ ParallelWorkerMain(Datum main_arg)
 	Snapshot	tsnapshot;
 	Snapshot	asnapshot;
 
-	/* Set flag to indicate that we're initializing a parallel worker. */
-	InitializingParallelWorker = true;
-
-	/* Establish signal handlers. */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/* Determine and set our parallel worker number. */
+	/* Set our parallel worker number. */
 	Assert(ParallelWorkerNumber == -1);
-	memcpy(&ParallelWorkerNumber, MyBgworkerEntry->bgw_extra, sizeof(int));
+	ParallelWorkerNumber = worker_number;
 
 	/* Set up a memory context to work in, just for cleanliness. */
 	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
@@ -1331,7 +1742,7 @@ ParallelWorkerMain(Datum main_arg)
 	 * exit, which is fine.  If there were a ResourceOwner, it would acquire
 	 * ownership of the mapping, but we have no need for that.
 	 */
-	seg = dsm_attach(DatumGetUInt32(main_arg));
+	seg = dsm_attach(handle);
 	if (seg == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1418,10 +1829,12 @@ ParallelWorkerMain(Datum main_arg)
 	 * Restore current session authorization and role id.  No verification
 	 * happens here, we just blindly adopt the leader's state.  Note that this
 	 * has to happen before InitPostgres, since InitializeSessionUserId will
-	 * not set these variables.
+	 * not set these variables.  A prestarted worker already adopted the
+	 * leader's authenticated user when it connected.
 	 */
-	SetAuthenticatedUserId(fps->authenticated_user_id,
-						   fps->authenticated_user_is_superuser);
+	if (!connected)
+		SetAuthenticatedUserId(fps->authenticated_user_id,
+							   fps->authenticated_user_is_superuser);
 	SetSessionAuthorization(fps->session_user_id,
 							fps->session_user_is_superuser);
 	SetCurrentRoleId(fps->outer_user_id, fps->role_is_superuser);
@@ -1432,9 +1845,11 @@ ParallelWorkerMain(Datum main_arg)
 	 * (b) we do not want parallel mode to cause these failures, because that
 	 * would make use of parallel query plans not transparent to applications.
 	 */
-	BackgroundWorkerInitializeConnectionByOid(fps->database_id,
-											  fps->authenticated_user_id,
-											  BGWORKER_BYPASS_ALLOWCONN);
+	if (!connected)
+		BackgroundWorkerInitializeConnectionByOid(fps->database_id,
+												  fps->authenticated_user_id,
+												  BGWORKER_BYPASS_ALLOWCONN);
+	Assert(MyDatabaseId == fps->database_id);
 
 	/*
 	 * Set the client encoding to the database encoding, since that is what
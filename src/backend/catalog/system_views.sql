@@ -636,6 +636,14 @@ GRANT SELECT ON pg_shmem_allocations TO pg_read_all_stats;
 REVOKE EXECUTE ON FUNCTION pg_get_shmem_allocations() FROM PUBLIC;
 GRANT EXECUTE ON FUNCTION pg_get_shmem_allocations() TO pg_read_all_stats;
 
+CREATE VIEW pg_dsm_segments AS
+    SELECT * FROM pg_get_dsm_segments();
+
+REVOKE ALL ON pg_dsm_segments FROM PUBLIC;
+GRANT SELECT ON pg_dsm_segments TO pg_read_all_stats;
+REVOKE EXECUTE ON FUNCTION pg_get_dsm_segments() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_get_dsm_segments() TO pg_read_all_stats;
+
 CREATE VIEW pg_backend_memory_contexts AS
     SELECT * FROM pg_get_backend_memory_contexts();
 
@@ -644,6 +652,14 @@ GRANT SELECT ON pg_backend_memory_contexts TO pg_read_all_stats;
 REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
 GRANT EXECUTE ON FUNCTION pg_get_backend_memory_contexts() TO pg_read_all_stats;
 
+CREATE VIEW pg_memory_reservations AS
+    SELECT * FROM pg_get_memory_reservations();
+
+REVOKE ALL ON pg_memory_reservations FROM PUBLIC;
+GRANT SELECT ON pg_memory_reservations TO pg_read_all_stats;
+REVOKE EXECUTE ON FUNCTION pg_get_memory_reservations() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_get_memory_reservations() TO pg_read_all_stats;
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -1141,6 +1157,28 @@ SELECT
        b.stats_reset
 FROM pg_stat_get_io() b;
 
+CREATE VIEW pg_stat_io_histogram AS
+SELECT
+       b.backend_type,
+       b.object,
+       b.context,
+       b.op,
+       b.histogram,
+       b.stats_reset
+FROM pg_stat_get_io_histogram() b;
+
+CREATE VIEW pg_stat_io_relation_histogram AS
+SELECT
+       r.relfilenode,
+       r.reltablespace,
+       r.reldatabase,
+       r.op,
+       r.operations,
+       r.total_time,
+       r.histogram,
+       r.stats_reset
+FROM pg_stat_get_io_relation_histogram() r;
+
 CREATE VIEW pg_stat_wal AS
     SELECT
         w.wal_records,
@@ -123,6 +123,8 @@ static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_adaptivejoin_info(AdaptiveJoinState *ajstate,
+								   ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
 static void show_hashagg_info(AggState *aggstate, ExplainState *es);
@@ -136,6 +138,8 @@ static const char *explain_get_index_name(Oid indexId);
 static void show_buffer_usage(ExplainState *es, const BufferUsage *usage,
 							  bool planning);
 static void show_wal_usage(ExplainState *es, const WalUsage *usage);
+static void show_node_memory(ExplainState *es, Size mem_peak);
+static void show_fault_usage(ExplainState *es, const FaultUsage *usage);
 static void ExplainIndexScanDetails(Oid indexid, ScanDirection indexorderdir,
 									ExplainState *es);
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
@@ -253,6 +257,10 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 			es->buffers = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "wal") == 0)
 			es->wal = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "memory") == 0)
+			es->memory = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "faults") == 0)
+			es->faults = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "settings") == 0)
 			es->settings = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "generic_plan") == 0)
@@ -300,6 +308,16 @@ ExplainQuery(ParseState *pstate, ExplainStmt *stmt,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("EXPLAIN option WAL requires ANALYZE")));
 
+	/* likewise MEMORY and FAULTS */
+	if (es->memory && !es->analyze)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("EXPLAIN option MEMORY requires ANALYZE")));
+	if (es->faults && !es->analyze)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("EXPLAIN option FAULTS requires ANALYZE")));
+
 	/* if the timing was not set explicitly, set default value */
 	es->timing = (timing_set) ? es->timing : es->analyze;
 
@@ -647,6 +665,10 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 		instrument_option |= INSTRUMENT_BUFFERS;
 	if (es->wal)
 		instrument_option |= INSTRUMENT_WAL;
+	if (es->memory)
+		instrument_option |= INSTRUMENT_MEMORY;
+	if (es->faults)
+		instrument_option |= INSTRUMENT_FAULTS;
 
 	/*
 	 * We always collect timing for the entire statement, even when node-level
@@ -1355,6 +1377,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			pname = "Hash";		/* "Join" gets added by jointype switch */
 			sname = "Hash Join";
 			break;
+		case T_AdaptiveJoin:
+			pname = "Adaptive";	/* "Join" gets added by jointype switch */
+			sname = "Adaptive Join";
+			break;
 		case T_SeqScan:
 			pname = sname = "Seq Scan";
 			break;
@@ -1638,6 +1664,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_NestLoop:
 		case T_MergeJoin:
 		case T_HashJoin:
+		case T_AdaptiveJoin:
 			{
 				const char *jointype;
 
@@ -1861,6 +1888,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_NestLoop:
 		case T_MergeJoin:
 		case T_HashJoin:
+		case T_AdaptiveJoin:
 			/* try not to be too chatty about this in text mode */
 			if (es->format != EXPLAIN_FORMAT_TEXT ||
 				(es->verbose && ((Join *) plan)->inner_unique))
@@ -2116,6 +2144,23 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
 			break;
+		case T_AdaptiveJoin:
+			show_upper_qual(((AdaptiveJoin *) plan)->join.joinqual,
+							"Join Filter", planstate, ancestors, es);
+			show_upper_qual(((AdaptiveJoin *) plan)->hashclauses,
+							"Hash Cond", planstate, ancestors, es);
+			show_upper_qual(((AdaptiveJoin *) plan)->hashjoinqual,
+							"Hash Join Filter", planstate, ancestors, es);
+			if (((AdaptiveJoin *) plan)->join.joinqual ||
+				((AdaptiveJoin *) plan)->hashjoinqual)
+				show_instrumentation_count("Rows Removed by Join Filter", 1,
+										   planstate, es);
+			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
+			if (plan->qual)
+				show_instrumentation_count("Rows Removed by Filter", 2,
+										   planstate, es);
+			show_adaptivejoin_info(castNode(AdaptiveJoinState, planstate), es);
+			break;
 		case T_Agg:
 			show_agg_keys(castNode(AggState, planstate), ancestors, es);
 			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
@@ -2176,6 +2221,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			break;
 	}
 
+	/* Show the memory limit assigned out of query_work_mem, if any */
+	if (plan->workmem_limit > 0)
+		ExplainPropertyInteger("Memory Limit", "kB", plan->workmem_limit, es);
+
 	/*
 	 * Prepare per-worker JIT instrumentation.  As with the overall JIT
 	 * summary, this is printed only if printing costs is enabled.
@@ -2196,14 +2245,19 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		}
 	}
 
-	/* Show buffer/WAL usage */
+	/* Show buffer/WAL usage, node memory and page faults */
 	if (es->buffers && planstate->instrument)
 		show_buffer_usage(es, &planstate->instrument->bufusage, false);
 	if (es->wal && planstate->instrument)
 		show_wal_usage(es, &planstate->instrument->walusage);
-
-	/* Prepare per-worker buffer/WAL usage */
-	if (es->workers_state && (es->buffers || es->wal) && es->verbose)
+	if (es->memory && planstate->instrument)
+		show_node_memory(es, planstate->instrument->mem_peak);
+	if (es->faults && planstate->instrument)
+		show_fault_usage(es, &planstate->instrument->faults);
+
+	/* Prepare per-worker buffer/WAL usage, node memory and page faults */
+	if (es->workers_state &&
+		(es->buffers || es->wal || es->memory || es->faults) && es->verbose)
 	{
 		WorkerInstrumentation *w = planstate->worker_instrument;
 
@@ -2220,6 +2274,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				show_buffer_usage(es, &instrument->bufusage, false);
 			if (es->wal)
 				show_wal_usage(es, &instrument->walusage);
+			if (es->memory)
+				show_node_memory(es, instrument->mem_peak);
+			if (es->faults)
+				show_fault_usage(es, &instrument->faults);
 			ExplainCloseWorker(n, es);
 		}
 	}
@@ -2262,6 +2320,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		IsA(plan, BitmapAnd) ||
 		IsA(plan, BitmapOr) ||
 		IsA(plan, SubqueryScan) ||
+		IsA(plan, AdaptiveJoin) ||
 		(IsA(planstate, CustomScanState) &&
 		 ((CustomScanState *) planstate)->custom_ps != NIL) ||
 		planstate->subPlan;
@@ -2313,6 +2372,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			ExplainNode(((SubqueryScanState *) planstate)->subplan, ancestors,
 						"Subquery", NULL, es);
 			break;
+		case T_AdaptiveJoin:
+			ExplainNode((PlanState *) ((AdaptiveJoinState *) planstate)->aj_HashState,
+						ancestors, "Inner", NULL, es);
+			break;
 		case T_CustomScan:
 			ExplainCustomChildren((CustomScanState *) planstate,
 								  ancestors, es);
@@ -3239,6 +3302,45 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show where an adaptive join was planned to switch to hashing, and, with
+ * ANALYZE, where it did in its last scan.
+ */
+static void
+show_adaptivejoin_info(AdaptiveJoinState *ajstate, ExplainState *es)
+{
+	AdaptiveJoin *aj = (AdaptiveJoin *) ajstate->js.ps.plan;
+
+	if (es->costs)
+		ExplainPropertyFloat("Crossover Rows", NULL, aj->crossover_rows, 0,
+							 es);
+
+	if (!es->analyze || !ajstate->js.ps.instrument ||
+		ajstate->js.ps.instrument->nloops <= 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyBool("Switched To Hash", ajstate->aj_SwitchedAt > 0,
+							es);
+		ExplainPropertyInteger("Outer Rows Before Switch", NULL,
+							   ajstate->aj_SwitchedAt, es);
+	}
+	else if (ajstate->aj_SwitchedAt > 0)
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Switched to Hash: after " INT64_FORMAT " outer rows\n",
+						 ajstate->aj_SwitchedAt);
+	}
+	else if (!ajstate->aj_CanSwitch)
+	{
+		ExplainIndentText(es);
+		appendStringInfoString(es->str,
+							   "Switched to Hash: no, hash table too large\n");
+	}
+}
+
 /*
  * Show information on memoize hits/misses/evictions and memory usage.
  */
@@ -3836,6 +3938,60 @@ show_wal_usage(ExplainState *es, const WalUsage *usage)
 	}
 }
 
+/*
+ * Show the peak memory held in a node's private storage.  Only nodes that
+ * keep tuples or hash tables have any, so in text format we omit zeroes.
+ */
+static void
+show_node_memory(ExplainState *es, Size mem_peak)
+{
+	int64		peakKb = (mem_peak + 1023) / 1024;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		if (mem_peak > 0)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str, "Node Memory: peak=" INT64_FORMAT "kB\n",
+							 peakKb);
+		}
+	}
+	else
+		ExplainPropertyInteger("Peak Node Memory", "kB", peakKb, es);
+}
+
+/*
+ * Show page faults taken while the node (and its children) were running.
+ */
+static void
+show_fault_usage(ExplainState *es, const FaultUsage *usage)
+{
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		/* Show only positive counter values. */
+		if (usage->minor_faults > 0 || usage->major_faults > 0)
+		{
+			ExplainIndentText(es);
+			appendStringInfoString(es->str, "Page Faults:");
+
+			if (usage->minor_faults > 0)
+				appendStringInfo(es->str, " minor=%lld",
+								 (long long) usage->minor_faults);
+			if (usage->major_faults > 0)
+				appendStringInfo(es->str, " major=%lld",
+								 (long long) usage->major_faults);
+			appendStringInfoChar(es->str, '\n');
+		}
+	}
+	else
+	{
+		ExplainPropertyInteger("Minor Page Faults", NULL,
+							   usage->minor_faults, es);
+		ExplainPropertyInteger("Major Page Faults", NULL,
+							   usage->major_faults, es);
+	}
+}
+
 /*
  * Add some additional details about an IndexScan or IndexOnlyScan
  */
@@ -1191,6 +1191,19 @@ show_unix_socket_permissions(void)
  * in builds that don't support them.
  */
 
+bool
+check_backend_pool_size(int *newval, void **extra, GucSource source)
+{
+#ifdef EXEC_BACKEND
+	if (*newval != 0)
+	{
+		GUC_check_errmsg("pre-forked backends are not supported by this build");
+		return false;
+	}
+#endif
+	return true;
+}
+
 bool
 check_bonjour(bool *newval, void **extra, GucSource source)
 {
@@ -15,6 +15,7 @@
 #include "access/amapi.h"
 #include "access/htup_details.h"
 #include "executor/execdebug.h"
+#include "executor/nodeAdaptivejoin.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeBitmapAnd.h"
@@ -79,7 +80,12 @@ ExecReScan(PlanState *node)
 {
 	/* If collecting timing stats, update them */
 	if (node->instrument)
+	{
+		/* note what the node held before the rescan releases it */
+		if (node->instrument->need_memory)
+			ExecSampleNodeMemory(node);
 		InstrEndLoop(node->instrument);
+	}
 
 	/*
 	 * If we have changed parameters, propagate that info.
@@ -251,6 +257,10 @@ ExecReScan(PlanState *node)
 			ExecReScanHashJoin((HashJoinState *) node);
 			break;
 
+		case T_AdaptiveJoinState:
+			ExecReScanAdaptiveJoin((AdaptiveJoinState *) node);
+			break;
+
 		case T_MaterialState:
 			ExecReScanMaterial((MaterialState *) node);
 			break;
@@ -140,7 +140,8 @@ execTuplesHashPrepare(int numCols,
  *	nbuckets: initial estimate of hashtable size
  *	additionalsize: size of data stored in ->additional
  *	metacxt: memory context for long-lived allocation, but not per-entry data
- *	tablecxt: memory context in which to store table entries
+ *	tablecxt: memory context in which to store table entries; entries are
+ *		never freed individually, so this may be a bump context
  *	tempcxt: short-lived context for evaluation hash and comparison functions
  *
  * The function arrays may be made with execTuplesHashPrepare().  Note they
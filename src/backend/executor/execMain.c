@@ -39,6 +39,7 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/transam.h"
@@ -62,6 +63,7 @@
 #include "utils/acl.h"
 #include "utils/backend_status.h"
 #include "utils/lsyscache.h"
+#include "utils/membroker.h"
 #include "utils/memutils.h"
 #include "utils/partcache.h"
 #include "utils/rls.h"
@@ -252,6 +254,7 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_top_eflags = eflags;
 	estate->es_instrument = queryDesc->instrument_options;
 	estate->es_jit_flags = queryDesc->plannedstmt->jitFlags;
+	estate->es_work_mem_scale = queryDesc->work_mem_scale;
 
 	/*
 	 * Set up an AFTER-trigger statement context, unless told not to, or
@@ -260,6 +263,20 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	if (!(eflags & (EXEC_FLAG_SKIP_TRIGGERS | EXEC_FLAG_EXPLAIN_ONLY)))
 		AfterTriggerBeginQuery();
 
+	/*
+	 * Reserve the plan's work memory from the instance-wide budget, if there
+	 * is one.  This has to happen before the nodes are initialized, as they
+	 * look at their memory limits while doing so.  Parallel workers are
+	 * accounted for by their leader, and scale their limits as it does (see
+	 * ExecInitParallelPlan).
+	 */
+	if (queryDesc->plannedstmt->planMemory > 0 &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY) && !IsParallelWorker())
+		estate->es_mem_reserved =
+			MemoryBrokerReserve((Size) queryDesc->plannedstmt->planMemory * 1024,
+								queryDesc->plannedstmt->queryId,
+								&estate->es_work_mem_scale);
+
 	/*
 	 * Initialize the plan state tree
 	 */
@@ -500,6 +517,10 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	UnregisterSnapshot(estate->es_snapshot);
 	UnregisterSnapshot(estate->es_crosscheck_snapshot);
 
+	/* give back the work memory reserved at ExecutorStart */
+	if (queryDesc->plannedstmt->planMemory > 0)
+		MemoryBrokerRelease(estate->es_mem_reserved);
+
 	/*
 	 * Must switch out of context before destroying it
 	 */
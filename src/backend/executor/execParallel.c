@@ -76,8 +76,10 @@ typedef struct FixedParallelExecutorState
 {
 	int64		tuples_needed;	/* tuple bound, see ExecSetTupleBound */
 	dsa_pointer param_exec;
+	dsa_pointer tqueue_chunks;	/* tuple queue chunk pools, if any */
 	int			eflags;
 	int			jit_flags;
+	double		work_mem_scale; /* see MemoryBrokerReserve */
 } FixedParallelExecutorState;
 
 /*
@@ -138,7 +140,9 @@ static bool ExecParallelRetrieveInstrumentation(PlanState *planstate,
 												SharedExecutorInstrumentation *instrumentation);
 
 /* Helper function that runs in the parallel worker. */
-static DestReceiver *ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc);
+static DestReceiver *ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc,
+											 dsa_area *area,
+											 dsa_pointer tqueue_chunks);
 
 /*
  * Create a serialized representation of the plan to be sent to each worker.
@@ -737,8 +741,10 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes = shm_toc_allocate(pcxt->toc, sizeof(FixedParallelExecutorState));
 	fpes->tuples_needed = tuples_needed;
 	fpes->param_exec = InvalidDsaPointer;
+	fpes->tqueue_chunks = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+	fpes->work_mem_scale = estate->es_work_mem_scale;
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
 	/* Store query string */
@@ -836,6 +842,19 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 													   pei->area);
 			fpes->param_exec = pei->param_exec;
 		}
+
+		/*
+		 * If requested, set up DSA chunks for the workers to pass us their
+		 * result tuples in, rather than copying them through the tuple
+		 * queues.  This relies on tuple batching.
+		 */
+		if (parallel_tuple_zero_copy && parallel_tuple_batch_size > 0 &&
+			pcxt->nworkers > 0)
+		{
+			pei->tqueue_chunks = CreateTupleQueueChunkPools(pei->area,
+															pcxt->nworkers);
+			fpes->tqueue_chunks = pei->tqueue_chunks;
+		}
 	}
 
 	/*
@@ -887,6 +906,11 @@ ExecParallelCreateReaders(ParallelExecutorInfo *pei)
 			shm_mq_set_handle(pei->tqueue[i],
 							  pei->pcxt->worker[i].bgwhandle);
 			pei->reader[i] = CreateTupleQueueReader(pei->tqueue[i]);
+			if (DsaPointerIsValid(pei->tqueue_chunks))
+				TupleQueueReaderUseChunks(pei->reader[i], pei->area,
+										  GetTupleQueueChunkPool(pei->area,
+																 pei->tqueue_chunks,
+																 i));
 		}
 	}
 }
@@ -935,6 +959,11 @@ ExecParallelReinitialize(PlanState *planstate,
 		fpes->param_exec = pei->param_exec;
 	}
 
+	/* Reclaim any tuple queue chunks the last round left unconsumed. */
+	if (DsaPointerIsValid(pei->tqueue_chunks))
+		ResetTupleQueueChunkPools(pei->area, pei->tqueue_chunks,
+								  pei->pcxt->nworkers);
+
 	/* Traverse plan tree and let each child node reset associated state. */
 	estate->es_query_dsa = pei->area;
 	ExecParallelReInitializeDSM(planstate, pei->pcxt);
@@ -1194,6 +1223,12 @@ ExecParallelCleanup(ParallelExecutorInfo *pei)
 		dsa_free(pei->area, pei->param_exec);
 		pei->param_exec = InvalidDsaPointer;
 	}
+	if (DsaPointerIsValid(pei->tqueue_chunks))
+	{
+		FreeTupleQueueChunkPools(pei->area, pei->tqueue_chunks,
+								 pei->pcxt->nworkers);
+		pei->tqueue_chunks = InvalidDsaPointer;
+	}
 	if (pei->area != NULL)
 	{
 		dsa_detach(pei->area);
@@ -1212,16 +1247,27 @@ ExecParallelCleanup(ParallelExecutorInfo *pei)
  * for that purpose.
  */
 static DestReceiver *
-ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc)
+ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc, dsa_area *area,
+						dsa_pointer tqueue_chunks)
 {
 	char	   *mqspace;
 	shm_mq	   *mq;
+	DestReceiver *receiver;
 
 	mqspace = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE, false);
 	mqspace += ParallelWorkerNumber * PARALLEL_TUPLE_QUEUE_SIZE;
 	mq = (shm_mq *) mqspace;
 	shm_mq_set_sender(mq, MyProc);
-	return CreateTupleQueueDestReceiver(shm_mq_attach(mq, seg, NULL));
+	receiver = CreateTupleQueueDestReceiver(shm_mq_attach(mq, seg, NULL));
+
+	/* Write our tuples into DSA chunks, if the leader set them up. */
+	if (DsaPointerIsValid(tqueue_chunks))
+		TupleQueueDestReceiverUseChunks(receiver, area,
+										GetTupleQueueChunkPool(area,
+															   tqueue_chunks,
+															   ParallelWorkerNumber));
+
+	return receiver;
 }
 
 /*
@@ -1409,8 +1455,12 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Get fixed-size state. */
 	fpes = shm_toc_lookup(toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
 
+	/* Attach to the dynamic shared memory area. */
+	area_space = shm_toc_lookup(toc, PARALLEL_KEY_DSA, false);
+	area = dsa_attach_in_place(area_space, seg);
+
 	/* Set up DestReceiver, SharedExecutorInstrumentation, and QueryDesc. */
-	receiver = ExecParallelGetReceiver(seg, toc);
+	receiver = ExecParallelGetReceiver(seg, toc, area, fpes->tqueue_chunks);
 	instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_INSTRUMENTATION, true);
 	if (instrumentation != NULL)
 		instrument_options = instrumentation->instrument_options;
@@ -1424,12 +1474,9 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Report workers' query for monitoring purposes */
 	pgstat_report_activity(STATE_RUNNING, debug_query_string);
 
-	/* Attach to the dynamic shared memory area. */
-	area_space = shm_toc_lookup(toc, PARALLEL_KEY_DSA, false);
-	area = dsa_attach_in_place(area_space, seg);
-
 	/* Start up the executor */
 	queryDesc->plannedstmt->jitFlags = fpes->jit_flags;
+	queryDesc->work_mem_scale = fpes->work_mem_scale;
 	ExecutorStart(queryDesc, fpes->eflags);
 
 	/* Special executor initialization steps for parallel workers */
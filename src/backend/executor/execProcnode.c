@@ -73,6 +73,8 @@
 #include "postgres.h"
 
 #include "executor/executor.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeAdaptivejoin.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeBitmapAnd.h"
@@ -118,10 +120,12 @@
 #include "executor/nodeWorktablescan.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
-static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
 static bool ExecShutdownNode_walker(PlanState *node, void *context);
+static Size ExecNodeMemoryAllocated(PlanState *node);
 
 
 /* ------------------------------------------------------------------------
@@ -309,6 +313,11 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 													estate, eflags);
 			break;
 
+		case T_AdaptiveJoin:
+			result = (PlanState *) ExecInitAdaptiveJoin((AdaptiveJoin *) node,
+														estate, eflags);
+			break;
+
 			/*
 			 * materialization nodes
 			 */
@@ -468,9 +477,10 @@ ExecProcNodeFirst(PlanState *node)
 /*
  * ExecProcNode wrapper that performs instrumentation calls.  By keeping
  * this a separate function, we avoid overhead in the normal case where
- * no instrumentation is wanted.
+ * no instrumentation is wanted.  Extensions that install their own wrapper
+ * should call this for instrumented nodes rather than redo its work.
  */
-static TupleTableSlot *
+TupleTableSlot *
 ExecProcNodeInstr(PlanState *node)
 {
 	TupleTableSlot *result;
@@ -481,6 +491,19 @@ ExecProcNodeInstr(PlanState *node)
 
 	InstrStopNode(node->instrument, TupIsNull(result) ? 0.0 : 1.0);
 
+	/*
+	 * Memory held by a node mostly grows before its first tuple is returned
+	 * or between rescans, so for EXPLAIN (MEMORY) it's enough to look at the
+	 * end of each cycle and after exponentially spaced tuples in between.
+	 */
+	if (unlikely(node->instrument->need_memory))
+	{
+		int64		ntuples = (int64) node->instrument->tuplecount;
+
+		if (TupIsNull(result) || (ntuples & (ntuples - 1)) == 0)
+			ExecSampleNodeMemory(node);
+	}
+
 	return result;
 }
 
@@ -538,6 +561,9 @@ MultiExecProcNode(PlanState *node)
 			break;
 	}
 
+	if (node->instrument && node->instrument->need_memory)
+		ExecSampleNodeMemory(node);
+
 	return result;
 }
 
@@ -706,6 +732,10 @@ ExecEndNode(PlanState *node)
 			ExecEndHashJoin((HashJoinState *) node);
 			break;
 
+		case T_AdaptiveJoinState:
+			ExecEndAdaptiveJoin((AdaptiveJoinState *) node);
+			break;
+
 			/*
 			 * materialization nodes
 			 */
@@ -794,10 +824,18 @@ ExecShutdownNode_walker(PlanState *node, void *context)
 	 * that it has.
 	 */
 	if (node->instrument && node->instrument->running)
+	{
+		/* shutting down can fault in memory too, so always count it */
+		node->instrument->faults_sampling = node->instrument->need_faults;
 		InstrStartNode(node->instrument);
+	}
 
 	planstate_tree_walker(node, ExecShutdownNode_walker, context);
 
+	/* Last chance to see what the node holds, e.g. a hash join's batches */
+	if (node->instrument && node->instrument->need_memory)
+		ExecSampleNodeMemory(node);
+
 	switch (nodeTag(node))
 	{
 		case T_GatherState:
@@ -829,6 +867,128 @@ ExecShutdownNode_walker(PlanState *node, void *context)
 	return false;
 }
 
+/*
+ * ExecSampleNodeMemory
+ *
+ * Record the memory currently held by a node in its instrumentation, for
+ * EXPLAIN (MEMORY).  Called at node boundaries (end of a cycle, rescan,
+ * shutdown, and sparsely while tuples are being returned), so the recorded
+ * peak can miss memory that is allocated and released in between.
+ */
+void
+ExecSampleNodeMemory(PlanState *node)
+{
+	InstrUpdateMemory(node->instrument, ExecNodeMemoryAllocated(node));
+}
+
+/*
+ * ExecNodeMemoryAllocated
+ *
+ * Return the memory held in a node's private storage: hash tables, sort and
+ * tuplestore space, and aggregate state.  Per-tuple expression memory is not
+ * counted; it's reset constantly and every node has some.
+ */
+static Size
+ExecNodeMemoryAllocated(PlanState *node)
+{
+	Size		total = 0;
+
+	switch (nodeTag(node))
+	{
+		case T_HashState:
+			{
+				HashJoinTable hashtable = ((HashState *) node)->hashtable;
+
+				if (hashtable != NULL && hashtable->hashCxt != NULL)
+					total += MemoryContextMemAllocated(hashtable->hashCxt, true);
+			}
+			break;
+
+		case T_SortState:
+			{
+				SortState  *sortstate = (SortState *) node;
+
+				if (sortstate->tuplesortstate != NULL)
+					total += tuplesort_memory_allocated((Tuplesortstate *) sortstate->tuplesortstate);
+			}
+			break;
+
+		case T_IncrementalSortState:
+			{
+				IncrementalSortState *sortstate = (IncrementalSortState *) node;
+
+				if (sortstate->fullsort_state != NULL)
+					total += tuplesort_memory_allocated(sortstate->fullsort_state);
+				if (sortstate->prefixsort_state != NULL)
+					total += tuplesort_memory_allocated(sortstate->prefixsort_state);
+			}
+			break;
+
+		case T_AggState:
+			{
+				AggState   *aggstate = (AggState *) node;
+
+				for (int i = 0; i < aggstate->maxsets; i++)
+					total += MemoryContextMemAllocated(aggstate->aggcontexts[i]->ecxt_per_tuple_memory,
+													   true);
+				if (aggstate->hashcontext != NULL)
+					total += MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+													   true);
+				if (aggstate->hash_metacxt != NULL)
+					total += MemoryContextMemAllocated(aggstate->hash_metacxt, true);
+				if (aggstate->hash_tablecxt != NULL)
+					total += MemoryContextMemAllocated(aggstate->hash_tablecxt, true);
+			}
+			break;
+
+		case T_MemoizeState:
+			total += MemoryContextMemAllocated(((MemoizeState *) node)->tableContext,
+											   true);
+			break;
+
+		case T_MaterialState:
+			{
+				MaterialState *matstate = (MaterialState *) node;
+
+				if (matstate->tuplestorestate != NULL)
+					total += tuplestore_memory_used(matstate->tuplestorestate);
+			}
+			break;
+
+		case T_SetOpState:
+			{
+				SetOpState *setopstate = (SetOpState *) node;
+
+				if (setopstate->tableContext != NULL)
+					total += MemoryContextMemAllocated(setopstate->tableContext, true);
+			}
+			break;
+
+		case T_RecursiveUnionState:
+			{
+				RecursiveUnionState *rustate = (RecursiveUnionState *) node;
+
+				if (rustate->tableContext != NULL)
+					total += MemoryContextMemAllocated(rustate->tableContext, true);
+			}
+			break;
+
+		case T_WindowAggState:
+			{
+				WindowAggState *winstate = (WindowAggState *) node;
+
+				total += MemoryContextMemAllocated(winstate->partcontext, true);
+				total += MemoryContextMemAllocated(winstate->aggcontext, true);
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return total;
+}
+
 /*
  * ExecSetTupleBound
  *
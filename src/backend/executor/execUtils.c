@@ -38,6 +38,9 @@
  *		GetAttributeByName		Runtime extraction of columns from tuples.
  *		GetAttributeByNum
  *
+ *		ExecGetWorkMem			Memory limits of memory-consuming nodes.
+ *		ExecGetHashMemLimit
+ *
  *	 NOTES
  *		This file has traditionally been the place to stick misc.
  *		executor support stuff that doesn't really go anyplace else.
@@ -52,6 +55,7 @@
 #include "access/transam.h"
 #include "executor/executor.h"
 #include "executor/execPartition.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeModifyTable.h"
 #include "jit/jit.h"
 #include "mb/pg_wchar.h"
@@ -167,6 +171,9 @@ CreateExecutorState(void)
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
 
+	estate->es_mem_reserved = 0;
+	estate->es_work_mem_scale = 1.0;
+
 	/*
 	 * Return the executor state structure
 	 */
@@ -1434,3 +1441,49 @@ ExecGetResultRelCheckAsUser(ResultRelInfo *relInfo, EState *estate)
 
 	return perminfo->checkAsUser ? perminfo->checkAsUser : GetUserId();
 }
+
+/*
+ * ExecGetWorkMem
+ *		Returns the memory limit, in kB, of a node that would normally be
+ *		limited by work_mem.
+ *
+ * The planner may have assigned the node its own limit out of
+ * query_work_mem; see assign_query_work_mem().  If the memory broker could
+ * not grant the query all the memory it asked for, the limit is scaled down
+ * accordingly, though never below the minimum of work_mem.
+ */
+int
+ExecGetWorkMem(PlanState *planstate)
+{
+	Plan	   *plan = planstate->plan;
+	double		scale = planstate->state->es_work_mem_scale;
+	int			limit;
+
+	limit = plan->workmem_limit > 0 ? plan->workmem_limit : work_mem;
+	if (scale < 1.0)
+		limit = Max((int) (limit * scale), 64);
+
+	return limit;
+}
+
+/*
+ * ExecGetHashMemLimit
+ *		Like ExecGetWorkMem, for nodes normally limited by hash_mem; but the
+ *		result is in bytes, as for get_hash_memory_limit().
+ */
+size_t
+ExecGetHashMemLimit(PlanState *planstate)
+{
+	Plan	   *plan = planstate->plan;
+	double		scale = planstate->state->es_work_mem_scale;
+	size_t		limit;
+
+	if (plan->workmem_limit > 0)
+		limit = (size_t) plan->workmem_limit * 1024;
+	else
+		limit = get_hash_memory_limit();
+	if (scale < 1.0)
+		limit = Max((size_t) (limit * scale), 64 * 1024);
+
+	return limit;
+}
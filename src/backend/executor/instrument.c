@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include "executor/instrument.h"
@@ -24,6 +25,28 @@ static WalUsage save_pgWalUsage;
 
 static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void WalUsageAdd(WalUsage *dst, WalUsage *add);
+static void GetFaultUsage(FaultUsage *usage);
+
+/* GUC variable */
+int			timing_clock_source = TIMING_CLOCK_SOURCE_AUTO;
+
+
+/*
+ * Select the clock behind instr_time, per timing_clock_source.  This is done
+ * once at postmaster (or standalone backend) start, after the configuration
+ * files have been read; child processes inherit the result.
+ */
+void
+InstrInitTiming(void)
+{
+	if (!pg_initialize_timing((TimingClockSource) timing_clock_source) &&
+		timing_clock_source == TIMING_CLOCK_SOURCE_TSC)
+		ereport(LOG,
+				(errmsg("time stamp counter is not usable for timing, using %s instead",
+						pg_timing_clock_source_name())));
+
+	elog(DEBUG1, "using %s for timing", pg_timing_clock_source_name());
+}
 
 
 /* Allocate new instrumentation structure(s) */
@@ -34,10 +57,13 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 
 	/* initialize all fields to zeroes, then modify as needed */
 	instr = palloc0(n * sizeof(Instrumentation));
-	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL))
+	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL |
+							  INSTRUMENT_MEMORY | INSTRUMENT_FAULTS))
 	{
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
+		bool		need_memory = (instrument_options & INSTRUMENT_MEMORY) != 0;
+		bool		need_faults = (instrument_options & INSTRUMENT_FAULTS) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 		int			i;
 
@@ -45,6 +71,8 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 		{
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
+			instr[i].need_memory = need_memory;
+			instr[i].need_faults = need_faults;
 			instr[i].need_timer = need_timer;
 			instr[i].async_mode = async_mode;
 		}
@@ -60,6 +88,8 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	memset(instr, 0, sizeof(Instrumentation));
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
+	instr->need_memory = (instrument_options & INSTRUMENT_MEMORY) != 0;
+	instr->need_faults = (instrument_options & INSTRUMENT_FAULTS) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
 }
 
@@ -77,6 +107,25 @@ InstrStartNode(Instrumentation *instr)
 
 	if (instr->need_walusage)
 		instr->walusage_start = pgWalUsage;
+
+	/*
+	 * Reading the fault counters costs a system call, so only count them
+	 * over some calls: the first of each cycle (which is where a node builds
+	 * its hash table or sorts its input), calls after exponentially spaced
+	 * tuples, and any call the caller asked for by setting faults_sampling,
+	 * as ExecShutdownNode does.  This matches where ExecSampleNodeMemory()
+	 * looks at a node's memory.
+	 */
+	if (instr->need_faults)
+	{
+		int64		ntuples = (int64) instr->tuplecount;
+
+		if (instr->faults_sampling || (ntuples & (ntuples - 1)) == 0)
+		{
+			GetFaultUsage(&instr->faults_start);
+			instr->faults_sampling = true;
+		}
+	}
 }
 
 /* Exit from a plan node */
@@ -95,7 +144,7 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		if (INSTR_TIME_IS_ZERO(instr->starttime))
 			elog(ERROR, "InstrStopNode called without start");
 
-		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_SET_CURRENT_FAST(endtime);
 		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
 
 		INSTR_TIME_SET_ZERO(instr->starttime);
@@ -110,6 +159,18 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		WalUsageAccumDiff(&instr->walusage,
 						  &pgWalUsage, &instr->walusage_start);
 
+	if (instr->faults_sampling)
+	{
+		FaultUsage	now;
+
+		GetFaultUsage(&now);
+		instr->faults.minor_faults +=
+			now.minor_faults - instr->faults_start.minor_faults;
+		instr->faults.major_faults +=
+			now.major_faults - instr->faults_start.major_faults;
+		instr->faults_sampling = false;
+	}
+
 	/* Is this the first tuple of this cycle? */
 	if (!instr->running)
 	{
@@ -164,6 +225,17 @@ InstrEndLoop(Instrumentation *instr)
 	instr->tuplecount = 0;
 }
 
+/*
+ * Note the memory currently held by a node, keeping the largest value seen.
+ * The caller decides how often to sample; see ExecSampleNodeMemory().
+ */
+void
+InstrUpdateMemory(Instrumentation *instr, Size bytes)
+{
+	if (bytes > instr->mem_peak)
+		instr->mem_peak = bytes;
+}
+
 /* aggregate instrumentation information */
 void
 InstrAggNode(Instrumentation *dst, Instrumentation *add)
@@ -193,6 +265,16 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 
 	if (dst->need_walusage)
 		WalUsageAdd(&dst->walusage, &add->walusage);
+
+	if (dst->need_faults)
+	{
+		dst->faults.minor_faults += add->faults.minor_faults;
+		dst->faults.major_faults += add->faults.major_faults;
+	}
+
+	/* each process has its own memory, so the peak is the largest of them */
+	if (dst->need_memory)
+		dst->mem_peak = Max(dst->mem_peak, add->mem_peak);
 }
 
 /* note current values during parallel executor startup */
@@ -283,3 +365,22 @@ WalUsageAccumDiff(WalUsage *dst, const WalUsage *add, const WalUsage *sub)
 	dst->wal_records += add->wal_records - sub->wal_records;
 	dst->wal_fpi += add->wal_fpi - sub->wal_fpi;
 }
+
+/*
+ * Read the process's page fault counters.  Windows' getrusage() emulation
+ * doesn't provide them, so they simply stay zero there.
+ */
+static void
+GetFaultUsage(FaultUsage *usage)
+{
+#ifndef WIN32
+	struct rusage r;
+
+	getrusage(RUSAGE_SELF, &r);
+	usage->minor_faults = r.ru_minflt;
+	usage->major_faults = r.ru_majflt;
+#else
+	usage->minor_faults = 0;
+	usage->major_faults = 0;
+#endif
+}
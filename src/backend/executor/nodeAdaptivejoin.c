@@ -0,0 +1,607 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeAdaptivejoin.c
+ *	  routines to support adaptive joins, which start out as a nested loop
+ *	  and switch to a hash join once the outer relation proves large
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeAdaptivejoin.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ *	 INTERFACE ROUTINES
+ *		ExecAdaptiveJoin	 - process an adaptive join of two plans
+ *		ExecInitAdaptiveJoin - initialize the join
+ *		ExecEndAdaptiveJoin  - shut down the join
+ *
+ *	 NOTES
+ *		The join has three children: the outer plan, the inner plan of the
+ *		nested loop, which is parameterized by the outer tuple as in
+ *		NestLoop, and a Hash node over an unparameterized plan for the same
+ *		inner relation.  Outer tuples are joined by rescanning the inner
+ *		plan until more than crossover_rows of them have been read; then the
+ *		Hash node builds a hash table, and every later outer tuple is joined
+ *		by probing it, as in HashJoin.  Each outer tuple is joined in just
+ *		one of the two ways, so switching neither loses nor duplicates rows,
+ *		and the output keeps the order of the outer relation.
+ *
+ *		Only join types that never need to remember which inner tuples were
+ *		matched are supported, and the hash table must fit in a single
+ *		batch; if it turns out not to, we keep going as a nested loop.
+ */
+
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeAdaptivejoin.h"
+#include "executor/nodeHash.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
+
+
+static bool ExecAdaptiveJoinBuildHashTable(AdaptiveJoinState *node);
+static bool ExecAdaptiveJoinScanBucket(AdaptiveJoinState *node,
+									   ExprContext *econtext);
+static void ExecAdaptiveJoinDestroyHashTable(AdaptiveJoinState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecAdaptiveJoin(node)
+ *
+ *		Returns the next tuple joined from inner and outer tuples which
+ *		satisfies the qualification clause, as ExecNestLoop does, except
+ *		that past the crossover point the inner tuples matching an outer
+ *		tuple come from the hash table rather than from a rescan of the
+ *		inner plan.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecAdaptiveJoin(PlanState *pstate)
+{
+	AdaptiveJoinState *node = castNode(AdaptiveJoinState, pstate);
+	AdaptiveJoin *aj;
+	PlanState  *innerPlan;
+	PlanState  *outerPlan;
+	TupleTableSlot *outerTupleSlot;
+	TupleTableSlot *innerTupleSlot;
+	ExprState  *joinqual;
+	ExprState  *otherqual;
+	ExprContext *econtext;
+	ListCell   *lc;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * get information from the node
+	 */
+	aj = (AdaptiveJoin *) node->js.ps.plan;
+	otherqual = node->js.ps.qual;
+	outerPlan = outerPlanState(node);
+	innerPlan = innerPlanState(node);
+	econtext = node->js.ps.ps_ExprContext;
+
+	/*
+	 * Reset per-tuple memory context to free any expression evaluation
+	 * storage allocated in the previous tuple cycle.
+	 */
+	ResetExprContext(econtext);
+
+	for (;;)
+	{
+		/*
+		 * If we don't have an outer tuple, get the next one and prepare to
+		 * look for its matches.
+		 */
+		if (node->aj_NeedNewOuter)
+		{
+			outerTupleSlot = ExecProcNode(outerPlan);
+
+			/*
+			 * if there are no more outer tuples, then the join is complete..
+			 */
+			if (TupIsNull(outerTupleSlot))
+				return NULL;
+
+			econtext->ecxt_outertuple = outerTupleSlot;
+			node->aj_NeedNewOuter = false;
+			node->aj_MatchedOuter = false;
+			node->aj_OuterRows++;
+
+			/*
+			 * Once past the crossover point, hash the inner relation, unless
+			 * it already turned out not to fit in memory.
+			 */
+			if (!node->aj_HashMode && node->aj_CanSwitch &&
+				node->aj_OuterRows > aj->crossover_rows)
+				(void) ExecAdaptiveJoinBuildHashTable(node);
+
+			if (node->aj_HashMode)
+			{
+				bool		fill_outer = (node->js.jointype == JOIN_LEFT ||
+										  node->js.jointype == JOIN_ANTI);
+				int			batchno;
+
+				/*
+				 * Compute the hash value of the outer tuple's join keys.  If
+				 * one of them is null and we needn't emit unmatched outer
+				 * tuples, the tuple can't join and we can skip it.
+				 */
+				if (!ExecHashGetHashValue(node->aj_HashTable, econtext,
+										  node->aj_OuterHashKeys,
+										  true, /* outer tuple */
+										  fill_outer,
+										  &node->aj_CurHashValue))
+				{
+					node->aj_NeedNewOuter = true;
+					continue;
+				}
+				ExecHashGetBucketAndBatch(node->aj_HashTable,
+										  node->aj_CurHashValue,
+										  &node->aj_CurBucketNo, &batchno);
+				Assert(batchno == 0);
+				node->aj_CurTuple = NULL;
+			}
+			else
+			{
+				/*
+				 * fetch the values of any outer Vars that must be passed to
+				 * the inner scan, and store them in the appropriate
+				 * PARAM_EXEC slots.
+				 */
+				foreach(lc, aj->nestParams)
+				{
+					NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+					int			paramno = nlp->paramno;
+					ParamExecData *prm;
+
+					prm = &(econtext->ecxt_param_exec_vals[paramno]);
+					/* Param value should be an OUTER_VAR var */
+					Assert(IsA(nlp->paramval, Var));
+					Assert(nlp->paramval->varno == OUTER_VAR);
+					Assert(nlp->paramval->varattno > 0);
+					prm->value = slot_getattr(outerTupleSlot,
+											  nlp->paramval->varattno,
+											  &(prm->isnull));
+					/* Flag parameter value as changed */
+					innerPlan->chgParam = bms_add_member(innerPlan->chgParam,
+														 paramno);
+				}
+
+				/*
+				 * now rescan the inner plan
+				 */
+				ExecReScan(innerPlan);
+			}
+		}
+
+		/*
+		 * we have an outerTuple, try to get the next matching inner tuple. In
+		 * hash mode the hash clauses have already been checked.
+		 */
+		if (node->aj_HashMode)
+		{
+			if (ExecAdaptiveJoinScanBucket(node, econtext))
+				innerTupleSlot = econtext->ecxt_innertuple;
+			else
+				innerTupleSlot = NULL;
+			joinqual = node->aj_HashJoinQual;
+		}
+		else
+		{
+			innerTupleSlot = ExecProcNode(innerPlan);
+			econtext->ecxt_innertuple = innerTupleSlot;
+			joinqual = node->js.joinqual;
+		}
+
+		if (TupIsNull(innerTupleSlot))
+		{
+			node->aj_NeedNewOuter = true;
+
+			if (!node->aj_MatchedOuter &&
+				(node->js.jointype == JOIN_LEFT ||
+				 node->js.jointype == JOIN_ANTI))
+			{
+				/*
+				 * We are doing an outer join and there were no join matches
+				 * for this outer tuple.  Generate a fake join tuple with
+				 * nulls for the inner tuple, and return it if it passes the
+				 * non-join quals.
+				 */
+				econtext->ecxt_innertuple = node->aj_NullInnerTupleSlot;
+
+				if (otherqual == NULL || ExecQual(otherqual, econtext))
+					return ExecProject(node->js.ps.ps_ProjInfo);
+				else
+					InstrCountFiltered2(node, 1);
+			}
+
+			/*
+			 * Otherwise just return to top of loop for a new outer tuple.
+			 */
+			continue;
+		}
+
+		/*
+		 * at this point we have a new pair of inner and outer tuples so we
+		 * test them against the join quals of the current mode.
+		 *
+		 * Only the joinquals determine MatchedOuter status, but all quals
+		 * must pass to actually return the tuple.
+		 */
+		if (ExecQual(joinqual, econtext))
+		{
+			node->aj_MatchedOuter = true;
+
+			/* In an antijoin, we never return a matched tuple */
+			if (node->js.jointype == JOIN_ANTI)
+			{
+				node->aj_NeedNewOuter = true;
+				continue;		/* return to top of loop */
+			}
+
+			/*
+			 * If we only need to join to the first matching inner tuple, then
+			 * consider returning this one, but after that continue with next
+			 * outer tuple.
+			 */
+			if (node->js.single_match)
+				node->aj_NeedNewOuter = true;
+
+			if (otherqual == NULL || ExecQual(otherqual, econtext))
+				return ExecProject(node->js.ps.ps_ProjInfo);
+			else
+				InstrCountFiltered2(node, 1);
+		}
+		else
+			InstrCountFiltered1(node, 1);
+
+		/*
+		 * Tuple fails qual, so free per-tuple memory and try again.
+		 */
+		ResetExprContext(econtext);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAdaptiveJoinBuildHashTable
+ *
+ *		Switch to hash mode by building the hash table.  Returns false,
+ *		and disables further attempts, if the table won't fit in memory in
+ *		a single batch.
+ * ----------------------------------------------------------------
+ */
+static bool
+ExecAdaptiveJoinBuildHashTable(AdaptiveJoinState *node)
+{
+	AdaptiveJoin *aj = (AdaptiveJoin *) node->js.ps.plan;
+	HashState  *hashNode = node->aj_HashState;
+	HashJoinTable hashtable;
+
+	Assert(node->aj_HashTable == NULL);
+
+	hashtable = ExecHashTableCreate(hashNode,
+									aj->hashoperators,
+									aj->hashcollations,
+									false);
+	if (hashtable->nbatch > 1)
+	{
+		ExecHashTableDestroy(hashtable);
+		node->aj_CanSwitch = false;
+		return false;
+	}
+
+	/*
+	 * We have nowhere to put tuples of later batches, so if the inner
+	 * relation is larger than estimated, have the Hash node stop once the
+	 * table outgrows its memory, and carry on as a nested loop.
+	 */
+	hashtable->stopWhenFull = true;
+
+	hashNode->hashtable = hashtable;
+	(void) MultiExecProcNode((PlanState *) hashNode);
+
+	node->aj_HashTable = hashtable;
+	if (hashtable->spaceUsed > hashtable->spaceAllowed)
+	{
+		ExecAdaptiveJoinDestroyHashTable(node);
+		node->aj_CanSwitch = false;
+		return false;
+	}
+
+	node->aj_HashMode = true;
+	node->aj_SwitchedAt = node->aj_OuterRows - 1;
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAdaptiveJoinScanBucket
+ *
+ *		Find the next inner tuple in the current bucket that satisfies the
+ *		hash clauses, like ExecScanHashBucket without skew buckets.  If one
+ *		is found, store it in aj_HashTupleSlot, make it the econtext's inner
+ *		tuple and return true.
+ * ----------------------------------------------------------------
+ */
+static bool
+ExecAdaptiveJoinScanBucket(AdaptiveJoinState *node, ExprContext *econtext)
+{
+	HashJoinTable hashtable = node->aj_HashTable;
+	HashJoinTuple hashTuple = node->aj_CurTuple;
+	uint32		hashvalue = node->aj_CurHashValue;
+
+	/*
+	 * aj_CurTuple is the address of the tuple last returned from the current
+	 * bucket, or NULL if it's time to start scanning the bucket.
+	 */
+	if (hashTuple != NULL)
+		hashTuple = hashTuple->next.unshared;
+	else
+		hashTuple = hashtable->buckets.unshared[node->aj_CurBucketNo];
+
+	while (hashTuple != NULL)
+	{
+		if (hashTuple->hashvalue == hashvalue)
+		{
+			TupleTableSlot *inntuple;
+
+			/* insert hashtable's tuple into exec slot so ExecQual sees it */
+			inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+											 node->aj_HashTupleSlot,
+											 false);	/* do not pfree */
+			econtext->ecxt_innertuple = inntuple;
+
+			if (ExecQualAndReset(node->aj_HashClauses, econtext))
+			{
+				node->aj_CurTuple = hashTuple;
+				return true;
+			}
+		}
+
+		hashTuple = hashTuple->next.unshared;
+	}
+
+	/*
+	 * no match
+	 */
+	return false;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAdaptiveJoinDestroyHashTable
+ *
+ *		Free the hash table, keeping its statistics for EXPLAIN as
+ *		ExecShutdownHash would.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecAdaptiveJoinDestroyHashTable(AdaptiveJoinState *node)
+{
+	HashState  *hashNode = node->aj_HashState;
+
+	Assert(hashNode->hashtable == node->aj_HashTable);
+	if (hashNode->ps.instrument && !hashNode->hinstrument)
+		hashNode->hinstrument = (HashInstrumentation *)
+			palloc0(sizeof(HashInstrumentation));
+	if (hashNode->hinstrument)
+		ExecHashAccumInstrumentation(hashNode->hinstrument,
+									 hashNode->hashtable);
+	/* for safety, be sure to clear child plan node's pointer too */
+	hashNode->hashtable = NULL;
+
+	ExecHashTableDestroy(node->aj_HashTable);
+	node->aj_HashTable = NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitAdaptiveJoin
+ * ----------------------------------------------------------------
+ */
+AdaptiveJoinState *
+ExecInitAdaptiveJoin(AdaptiveJoin *node, EState *estate, int eflags)
+{
+	AdaptiveJoinState *ajstate;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	ajstate = makeNode(AdaptiveJoinState);
+	ajstate->js.ps.plan = (Plan *) node;
+	ajstate->js.ps.state = estate;
+	ajstate->js.ps.ExecProcNode = ExecAdaptiveJoin;
+	ajstate->js.jointype = node->join.jointype;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * create expression context for node
+	 */
+	ExecAssignExprContext(estate, &ajstate->js.ps);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * The inner plan is rescanned with fresh parameter values for each outer
+	 * tuple, so REWIND support would be wasted on it, as in NestLoop.
+	 */
+	outerPlanState(ajstate) = ExecInitNode(outerPlan(node), estate, eflags);
+	innerPlanState(ajstate) = ExecInitNode(innerPlan(node), estate,
+										   eflags & ~EXEC_FLAG_REWIND);
+	ajstate->aj_HashState = castNode(HashState,
+									 ExecInitNode(node->hashplan, estate,
+												  eflags));
+
+	/*
+	 * Inner tuples come from either the inner plan or the hash table, whose
+	 * slots are of different kinds, so expressions must not assume either.
+	 */
+	ajstate->js.ps.inneropsset = true;
+	ajstate->js.ps.inneropsfixed = false;
+	ajstate->js.ps.innerops = NULL;
+
+	/*
+	 * Initialize result slot, type and projection.
+	 */
+	ExecInitResultTupleSlotTL(&ajstate->js.ps, &TTSOpsVirtual);
+	ExecAssignProjectionInfo(&ajstate->js.ps, NULL);
+
+	/*
+	 * As in HashJoin, the Hash node's result slot serves to hold tuples
+	 * fetched from the hash table.
+	 */
+	ajstate->aj_HashTupleSlot = ajstate->aj_HashState->ps.ps_ResultTupleSlot;
+
+	/*
+	 * initialize child expressions
+	 */
+	ajstate->js.ps.qual =
+		ExecInitQual(node->join.plan.qual, (PlanState *) ajstate);
+	ajstate->js.joinqual =
+		ExecInitQual(node->join.joinqual, (PlanState *) ajstate);
+	ajstate->aj_HashClauses =
+		ExecInitQual(node->hashclauses, (PlanState *) ajstate);
+	ajstate->aj_HashJoinQual =
+		ExecInitQual(node->hashjoinqual, (PlanState *) ajstate);
+	ajstate->aj_OuterHashKeys = ExecInitExprList(node->hashkeys,
+												 (PlanState *) ajstate);
+
+	/*
+	 * detect whether we need only consider the first matching inner tuple
+	 */
+	ajstate->js.single_match = (node->join.inner_unique ||
+								node->join.jointype == JOIN_SEMI);
+
+	/* set up null tuples for outer joins, if needed */
+	switch (node->join.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_SEMI:
+			break;
+		case JOIN_LEFT:
+		case JOIN_ANTI:
+			ajstate->aj_NullInnerTupleSlot =
+				ExecInitNullTupleSlot(estate,
+									  ExecGetResultType(innerPlanState(ajstate)),
+									  &TTSOpsVirtual);
+			break;
+		default:
+			elog(ERROR, "unrecognized join type: %d",
+				 (int) node->join.jointype);
+	}
+
+	/*
+	 * start out as a nested loop, and wipe the current outer tuple clean.
+	 */
+	ajstate->aj_NeedNewOuter = true;
+	ajstate->aj_MatchedOuter = false;
+	ajstate->aj_HashMode = false;
+	ajstate->aj_CanSwitch = true;
+	ajstate->aj_OuterRows = 0;
+	ajstate->aj_SwitchedAt = 0;
+	ajstate->aj_HashTable = NULL;
+	ajstate->aj_CurHashValue = 0;
+	ajstate->aj_CurBucketNo = 0;
+	ajstate->aj_CurTuple = NULL;
+
+	return ajstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndAdaptiveJoin
+ *
+ *		closes down scans and frees allocated storage
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndAdaptiveJoin(AdaptiveJoinState *node)
+{
+	/*
+	 * Free hash table
+	 */
+	if (node->aj_HashTable)
+	{
+		ExecHashTableDestroy(node->aj_HashTable);
+		node->aj_HashTable = NULL;
+		node->aj_HashState->hashtable = NULL;
+	}
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->js.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->js.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->aj_HashTupleSlot);
+
+	/*
+	 * close down subplans
+	 */
+	ExecEndNode(outerPlanState(node));
+	ExecEndNode(innerPlanState(node));
+	ExecEndNode((PlanState *) node->aj_HashState);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanAdaptiveJoin
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanAdaptiveJoin(AdaptiveJoinState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+	HashState  *hashNode = node->aj_HashState;
+
+	/*
+	 * ExecReScan only passes changed parameters on to the outer and inner
+	 * plans; the Hash node is ours to look after.
+	 */
+	if (node->js.ps.chgParam != NULL)
+		UpdateChangedParamSet((PlanState *) hashNode, node->js.ps.chgParam);
+
+	/*
+	 * If the hash table was built and its input is unaffected by the
+	 * parameter changes, keep it and stay in hash mode: it has been paid for
+	 * already.  Otherwise start over as a nested loop.  The Hash node will be
+	 * rescanned by MultiExecProcNode if need be.
+	 */
+	if (hashNode->ps.chgParam != NULL)
+	{
+		if (node->aj_HashTable != NULL)
+			ExecAdaptiveJoinDestroyHashTable(node);
+		node->aj_HashMode = false;
+		node->aj_CanSwitch = true;
+		node->aj_SwitchedAt = 0;
+	}
+
+	/*
+	 * If outerPlan->chgParam is not null then plan will be automatically
+	 * re-scanned by first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+
+	/*
+	 * innerPlan is re-scanned for each new outer tuple and MUST NOT be
+	 * re-scanned from here or you'll get troubles from inner index scans when
+	 * outer Vars are used as run-time keys...
+	 */
+
+	node->aj_NeedNewOuter = true;
+	node->aj_MatchedOuter = false;
+	node->aj_OuterRows = 0;
+	node->aj_CurHashValue = 0;
+	node->aj_CurBucketNo = 0;
+	node->aj_CurTuple = NULL;
+}
@@ -189,6 +189,16 @@ MultiExecPrivateHash(HashState *node)
 			}
 			hashtable->totalTuples += 1;
 		}
+
+		/*
+		 * A caller that can't use more batches would rather give up than have
+		 * the table outgrow its memory; it checks spaceUsed afterwards.
+		 */
+		if (hashtable->stopWhenFull &&
+			hashtable->spaceUsed +
+			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
+			> hashtable->spaceAllowed)
+			break;
 	}
 
 	/* resize the hash table if needed (NTUP_PER_BUCKET exceeded) */
@@ -472,6 +482,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 							state->parallel_state != NULL,
 							state->parallel_state != NULL ?
 							state->parallel_state->nparticipants - 1 : 0,
+							ExecGetHashMemLimit(&state->ps),
 							&space_allowed,
 							&nbuckets, &nbatch, &num_skew_mcvs);
 
@@ -504,6 +515,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->nbatch_original = nbatch;
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
+	hashtable->stopWhenFull = false;
 	hashtable->totalTuples = 0;
 	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
@@ -512,6 +524,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->spaceUsed = 0;
 	hashtable->spacePeak = 0;
 	hashtable->spaceAllowed = space_allowed;
+	hashtable->hashMemLimit = ExecGetHashMemLimit(&state->ps);
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
@@ -537,6 +550,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->batchCxt = AllocSetContextCreate(hashtable->hashCxt,
 												"HashBatchContext",
 												ALLOCSET_DEFAULT_SIZES);
+	AllocSetUseHugePages(hashtable->batchCxt);
 
 	hashtable->spillCxt = AllocSetContextCreate(hashtable->hashCxt,
 												"HashSpillContext",
@@ -669,7 +683,8 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 
 /*
  * Compute appropriate size for hashtable given the estimated size of the
- * relation to be hashed (number of rows and average row width).
+ * relation to be hashed (number of rows and average row width), and the
+ * memory limit in bytes (normally get_hash_memory_limit()).
  *
  * This is exported so that the planner's costsize.c can use it.
  */
@@ -681,6 +696,7 @@ void
 ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 						bool try_combined_hash_mem,
 						int parallel_workers,
+						size_t hash_mem_limit,
 						size_t *space_allowed,
 						int *numbuckets,
 						int *numbatches,
@@ -710,9 +726,10 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	inner_rel_bytes = ntuples * tupsize;
 
 	/*
-	 * Compute in-memory hashtable size limit from GUCs.
+	 * The in-memory hashtable size limit is normally hash_mem, but the
+	 * planner may have assigned the node a limit of its own.
 	 */
-	hash_table_bytes = get_hash_memory_limit();
+	hash_table_bytes = hash_mem_limit;
 
 	/*
 	 * Parallel Hash tries to use the combined hash_mem of all workers to
@@ -831,6 +848,7 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 		{
 			ExecChooseHashTableSize(ntuples, tupwidth, useskew,
 									false, parallel_workers,
+									hash_mem_limit,
 									space_allowed,
 									numbuckets,
 									numbatches,
@@ -929,7 +947,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	HashMemoryChunk oldchunks;
 
 	/* do nothing if we've decided to shut off growth */
-	if (!hashtable->growEnabled)
+	if (!hashtable->growEnabled || hashtable->stopWhenFull)
 		return;
 
 	/* safety check to avoid overflow */
@@ -1129,7 +1147,7 @@ ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable)
 					 * to switch from one large combined memory budget to the
 					 * regular hash_mem budget.
 					 */
-					pstate->space_allowed = get_hash_memory_limit();
+					pstate->space_allowed = hashtable->hashMemLimit;
 
 					/*
 					 * The combined hash_mem of all participants wasn't
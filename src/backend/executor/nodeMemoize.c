@@ -1027,12 +1027,13 @@ ExecInitMemoize(Memoize *node, EState *estate, int eflags)
 	mstate->mem_used = 0;
 
 	/* Limit the total memory consumed by the cache to this */
-	mstate->mem_limit = get_hash_memory_limit();
+	mstate->mem_limit = ExecGetHashMemLimit(&mstate->ss.ps);
 
 	/* A memory context dedicated for the cache */
 	mstate->tableContext = AllocSetContextCreate(CurrentMemoryContext,
 												 "MemoizeHashTable",
 												 ALLOCSET_DEFAULT_SIZES);
+	AllocSetUseHugePages(mstate->tableContext);
 
 	dlist_init(&mstate->lru_list);
 	mstate->last_tuple = NULL;
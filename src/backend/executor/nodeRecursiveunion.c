@@ -127,7 +127,7 @@ ExecRecursiveUnion(PlanState *pstate)
 
 			/* create new empty intermediate table */
 			node->intermediate_table = tuplestore_begin_heap(false, false,
-															 work_mem);
+															 ExecGetWorkMem(&node->ps));
 			node->intermediate_empty = true;
 
 			/* reset the recursive term */
@@ -189,14 +189,17 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 	/* initialize processing state */
 	rustate->recursing = false;
 	rustate->intermediate_empty = true;
-	rustate->working_table = tuplestore_begin_heap(false, false, work_mem);
-	rustate->intermediate_table = tuplestore_begin_heap(false, false, work_mem);
+	rustate->working_table =
+		tuplestore_begin_heap(false, false, ExecGetWorkMem(&rustate->ps));
+	rustate->intermediate_table =
+		tuplestore_begin_heap(false, false, ExecGetWorkMem(&rustate->ps));
 
 	/*
 	 * If hashing, we need a per-tuple memory context for comparisons, and a
 	 * longer-lived context to store the hash table.  The table can't just be
 	 * kept in the per-query context because we want to be able to throw it
-	 * away when rescanning.
+	 * away when rescanning.  Entries are never freed individually, so the
+	 * latter can be a bump context.
 	 */
 	if (node->numCols > 0)
 	{
@@ -205,9 +208,9 @@ ExecInitRecursiveUnion(RecursiveUnion *node, EState *estate, int eflags)
 								  "RecursiveUnion",
 								  ALLOCSET_DEFAULT_SIZES);
 		rustate->tableContext =
-			AllocSetContextCreate(CurrentMemoryContext,
-								  "RecursiveUnion hash table",
-								  ALLOCSET_DEFAULT_SIZES);
+			BumpContextCreate(CurrentMemoryContext,
+							  "RecursiveUnion hash table",
+							  ALLOCSET_DEFAULT_SIZES);
 	}
 
 	/*
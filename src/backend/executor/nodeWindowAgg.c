@@ -1125,7 +1125,8 @@ begin_partition(WindowAggState *winstate)
 	}
 
 	/* Create new tuplestore for this partition */
-	winstate->buffer = tuplestore_begin_heap(false, false, work_mem);
+	winstate->buffer = tuplestore_begin_heap(false, false,
+											 ExecGetWorkMem(&winstate->ss.ps));
 
 	/*
 	 * Set up read pointers for the tuplestore.  The current pointer doesn't
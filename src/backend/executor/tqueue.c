@@ -8,6 +8,33 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * To cut down on the number of shm_mq_send and shm_mq_receive calls, each
+ * of which touches the queue's shared state, the sender packs consecutive
+ * tuples into a single message of up to parallel_tuple_batch_size bytes.
+ * A message is simply a sequence of MinimalTuples, each starting at a
+ * MAXALIGN'd offset; a message holding one tuple is therefore the same as
+ * an unbatched message, and the reader needs no separate code path for it.
+ *
+ * A batch that fills up slowly, for example because the worker's plan
+ * spends a long time between result rows, must not hold back the tuples
+ * already in it indefinitely.  So when a batch is started we also arm a
+ * timeout of parallel_tuple_batch_delay milliseconds; when it fires, the
+ * next CHECK_FOR_INTERRUPTS sends whatever has been batched so far.  That
+ * send must not wait, since it can happen almost anywhere in the worker, so
+ * if the queue is full it leaves the batch partly sent, and the next call
+ * that sends to the queue finishes the job first.
+ *
+ * Optionally, the batches can instead be built in chunks of a DSA area.
+ * Each queue then has a TupleQueueChunkPool: a fixed set of chunks, plus a
+ * ring of free chunk pointers into which the reader returns chunks once it
+ * has consumed them.  The sender writes tuples straight into a free chunk
+ * and sends only a small TupleQueueChunkRef through the shm_mq, and the
+ * reader returns tuples pointing into the chunk, so the tuple data is never
+ * copied through the queue's ring buffer.  If no chunk is free, the sender
+ * falls back to sending the batch inline; since that blocks once the ring
+ * buffer is full, it also limits how far ahead of the reader a sender can
+ * get.
+ *
  * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -21,30 +48,245 @@
 
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/latch.h"
+#include "utils/timeout.h"
+
+/*
+ * Size of the first batch sent by each DestReceiver.  Every flush doubles
+ * the size of the next batch, up to parallel_tuple_batch_size, so that the
+ * first tuples of a query reach the leader promptly even when batching.
+ */
+#define TQUEUE_INITIAL_BATCH_SIZE	1024
+
+/* Number of DSA chunks in each queue's TupleQueueChunkPool */
+#define TQUEUE_POOL_CHUNKS			8
+
+/* GUC variables */
+int			parallel_tuple_batch_size = 8;
+int			parallel_tuple_batch_delay = 10;
+bool		parallel_tuple_zero_copy = false;
+
+/* Set by the batch delay timeout, processed by HandleTupleQueueFlush */
+volatile sig_atomic_t TupleQueueFlushPending = false;
+
+/*
+ * Shared state for the DSA chunks used by one tuple queue.
+ *
+ * chunks[] lists every chunk of the pool.  freelist[] is a ring of chunks
+ * available to the sender: entries from ntaken up to (but not including)
+ * nreturned, modulo TQUEUE_POOL_CHUNKS, are free.  Only the sender advances
+ * ntaken and only the reader advances nreturned, so no lock is needed.
+ */
+struct TupleQueueChunkPool
+{
+	Size		chunk_size;		/* usable bytes in each chunk */
+	pg_atomic_uint64 ntaken;	/* chunks ever taken by the sender */
+	pg_atomic_uint64 nreturned; /* chunks ever made free by the reader */
+	dsa_pointer chunks[TQUEUE_POOL_CHUNKS];
+	dsa_pointer freelist[TQUEUE_POOL_CHUNKS];
+};
+
+/*
+ * Message sent in place of a batch that was built in a DSA chunk.
+ *
+ * A MinimalTuple never has a t_len of zero, so the leading zero tells the
+ * reader that this is not a tuple.
+ */
+typedef struct TupleQueueChunkRef
+{
+	uint32		zero;			/* always 0 */
+	uint32		len;			/* bytes of the chunk in use */
+	dsa_pointer chunk;			/* the chunk holding the tuples */
+} TupleQueueChunkRef;
 
 /*
  * DestReceiver object's private contents
  *
  * queue is a pointer to data supplied by DestReceiver's caller.
+ *
+ * batch holds tuples that have been received but not yet sent; it is NULL
+ * if batching is disabled.  It points either to local_batch or, if
+ * batch_chunk is valid, to a chunk taken from the pool.
  */
 typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* buffered tuples, or NULL */
+	Size		batch_used;		/* bytes of batch currently in use */
+	Size		batch_target;	/* send the batch once it reaches this size */
+	Size		batch_size;		/* allocated size of batch */
+	char	   *local_batch;	/* backend-local batch buffer */
+	dsa_area   *area;			/* DSA area holding the pool, or NULL */
+	TupleQueueChunkPool *pool;	/* chunks to build batches in, or NULL */
+	dsa_pointer batch_chunk;	/* chunk batch points to, if any */
+	bool		batch_partial;	/* batch partly sent by a nowait flush? */
+	bool		in_send;		/* inside a call that sends to queue? */
+	bool		flush_requested;	/* batch delay expired in there */
 } TQueueDestReceiver;
 
+/*
+ * The batch delay timeout, registered on first use, and the receiver whose
+ * batch it flushes.  A worker has only one tuple queue DestReceiver.
+ */
+static TimeoutId tqueue_flush_timeout = MAX_TIMEOUTS;
+static TQueueDestReceiver *tqueue_flush_receiver = NULL;
+
 /*
  * TupleQueueReader object's private contents
  *
  * queue is a pointer to data supplied by reader's caller.
  *
+ * msg points to the tuples of the message most recently received from the
+ * queue, and msg_offset is the offset of the next tuple within it still to
+ * be returned.  If the message referred to a DSA chunk, msg_chunk is that
+ * chunk, which must be given back to the pool before reading another one.
+ *
  * "typedef struct TupleQueueReader TupleQueueReader" is in tqueue.h
  */
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *msg;			/* current message */
+	Size		msg_len;		/* length of current message */
+	Size		msg_offset;		/* offset of next tuple in message */
+	dsa_area   *area;			/* DSA area holding the pool, or NULL */
+	TupleQueueChunkPool *pool;	/* pool chunks are returned to, or NULL */
+	dsa_pointer msg_chunk;		/* chunk holding current message, if any */
 };
 
+/*
+ * Take a free chunk from the pool, or return InvalidDsaPointer if there is
+ * none.  Only the sender may call this.
+ */
+static dsa_pointer
+tqueueTakeChunk(TupleQueueChunkPool *pool)
+{
+	uint64		ntaken = pg_atomic_read_u64(&pool->ntaken);
+	dsa_pointer chunk;
+
+	if (pg_atomic_read_u64(&pool->nreturned) == ntaken)
+		return InvalidDsaPointer;
+
+	/* Don't read the ring entry until we've seen nreturned advance. */
+	pg_read_barrier();
+	chunk = pool->freelist[ntaken % TQUEUE_POOL_CHUNKS];
+	pg_atomic_write_u64(&pool->ntaken, ntaken + 1);
+
+	return chunk;
+}
+
+/*
+ * Give a chunk back to the pool.  Only the reader may call this.
+ */
+static void
+tqueueReturnChunk(TupleQueueChunkPool *pool, dsa_pointer chunk)
+{
+	uint64		nreturned = pg_atomic_read_u64(&pool->nreturned);
+
+	/*
+	 * The ring can't overflow: it has room for every chunk, and this one is
+	 * not in it.
+	 */
+	Assert(nreturned - pg_atomic_read_u64(&pool->ntaken) < TQUEUE_POOL_CHUNKS);
+	pool->freelist[nreturned % TQUEUE_POOL_CHUNKS] = chunk;
+
+	/*
+	 * Make sure we're done reading the chunk, and that the ring entry is
+	 * visible, before the sender can see that the chunk is free.
+	 */
+	pg_memory_barrier();
+	pg_atomic_write_u64(&pool->nreturned, nreturned + 1);
+}
+
+/*
+ * Send the contents of the batch buffer, if any, as a single message.
+ *
+ * With nowait, SHM_MQ_WOULD_BLOCK means that the batch has been partly sent
+ * and is kept as it is; the next call must send it again, as shm_mq_send
+ * requires, before anything is added to it.
+ */
+static shm_mq_result
+tqueueFlushBatch(TQueueDestReceiver *tqueue, bool nowait)
+{
+	shm_mq_result result;
+
+	if (tqueue->batch_used == 0)
+		return SHM_MQ_SUCCESS;
+
+	if (DsaPointerIsValid(tqueue->batch_chunk))
+	{
+		TupleQueueChunkRef ref;
+
+		ref.zero = 0;
+		ref.len = tqueue->batch_used;
+		ref.chunk = tqueue->batch_chunk;
+		result = shm_mq_send(tqueue->queue, sizeof(ref), &ref, nowait, nowait);
+	}
+	else
+		result = shm_mq_send(tqueue->queue, tqueue->batch_used, tqueue->batch,
+							 nowait, nowait);
+
+	tqueue->batch_partial = (result == SHM_MQ_WOULD_BLOCK);
+	if (tqueue->batch_partial)
+		return result;
+
+	tqueue->batch_chunk = InvalidDsaPointer;
+	tqueue->batch_used = 0;
+	tqueue->batch_target = Min(tqueue->batch_target * 2, tqueue->batch_size);
+
+	return result;
+}
+
+/*
+ * Timeout handler for parallel_tuple_batch_delay.
+ *
+ * We can't send anything from a signal handler, so just arrange for
+ * HandleTupleQueueFlush to be called at the next CHECK_FOR_INTERRUPTS.
+ */
+static void
+tqueueFlushTimeoutHandler(void)
+{
+	TupleQueueFlushPending = true;
+	InterruptPending = true;
+	SetLatch(MyLatch);
+}
+
+/*
+ * Send the current batch because parallel_tuple_batch_delay has expired.
+ *
+ * This is called from ProcessInterrupts.  If we got there from within a
+ * call that sends to the queue, which may be waiting for queue space, the
+ * batch is in an intermediate state; leave the flush to that call instead.
+ *
+ * Otherwise we send without waiting.  If the queue is full, the rest of the
+ * batch goes out with the next tuple, or at the latest when the receiver
+ * shuts down; in the meantime, try again after another delay.  If the
+ * queue has been detached, the next tuple will find that out.
+ */
+void
+HandleTupleQueueFlush(void)
+{
+	TQueueDestReceiver *tqueue = tqueue_flush_receiver;
+
+	TupleQueueFlushPending = false;
+
+	if (tqueue == NULL || tqueue->batch_used == 0)
+		return;
+
+	if (tqueue->in_send)
+	{
+		tqueue->flush_requested = true;
+		return;
+	}
+
+	if (tqueueFlushBatch(tqueue, true) == SHM_MQ_WOULD_BLOCK &&
+		!get_timeout_active(tqueue_flush_timeout))
+		enable_timeout_after(tqueue_flush_timeout, parallel_tuple_batch_delay);
+}
+
 /*
  * Receive a tuple from a query, and send it to the designated shm_mq.
  *
@@ -58,12 +300,77 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	shm_mq_result result;
 	bool		should_free;
 
-	/* Send the tuple itself. */
+	tqueue->in_send = true;
 	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
+
+	if (tqueue->batch != NULL && tuple->t_len <= tqueue->batch_size)
+	{
+		/*
+		 * Make room for the tuple if necessary, then add it to the batch.  A
+		 * batch that a timed flush left partly sent can't take any more.
+		 */
+		if (tqueue->batch_partial ||
+			tqueue->batch_used + MAXALIGN(tuple->t_len) > tqueue->batch_size)
+			result = tqueueFlushBatch(tqueue, false);
+		else
+			result = SHM_MQ_SUCCESS;
+
+		if (result == SHM_MQ_SUCCESS)
+		{
+			/*
+			 * When starting a new batch, build it in a free chunk if we can.
+			 * Not before we know the queue is still there, or the chunk
+			 * would never be given back.
+			 */
+			if (tqueue->batch_used == 0 && tqueue->pool != NULL)
+			{
+				tqueue->batch_chunk = tqueueTakeChunk(tqueue->pool);
+				if (DsaPointerIsValid(tqueue->batch_chunk))
+					tqueue->batch = dsa_get_address(tqueue->area,
+													tqueue->batch_chunk);
+				else
+					tqueue->batch = tqueue->local_batch;
+			}
+
+			/*
+			 * A new batch mustn't wait longer than parallel_tuple_batch_delay
+			 * to be sent.  If the timeout is still running for an earlier
+			 * batch, it will fire sooner than that, which is fine too.
+			 */
+			if (tqueue->batch_used == 0 && parallel_tuple_batch_delay > 0 &&
+				tqueue == tqueue_flush_receiver &&
+				!get_timeout_active(tqueue_flush_timeout))
+				enable_timeout_after(tqueue_flush_timeout,
+									 parallel_tuple_batch_delay);
+
+			memcpy(tqueue->batch + tqueue->batch_used, tuple, tuple->t_len);
+			tqueue->batch_used += MAXALIGN(tuple->t_len);
+
+			if (tqueue->batch_used >= tqueue->batch_target ||
+				tqueue->flush_requested)
+			{
+				tqueue->flush_requested = false;
+				result = tqueueFlushBatch(tqueue, false);
+			}
+		}
+	}
+	else
+	{
+		/*
+		 * Send the tuple itself, after any tuples batched ahead of it, so
+		 * that tuple order is preserved.
+		 */
+		result = SHM_MQ_SUCCESS;
+		if (tqueue->batch != NULL)
+			result = tqueueFlushBatch(tqueue, false);
+		if (result == SHM_MQ_SUCCESS)
+			result = shm_mq_send(tqueue->queue, tuple->t_len, tuple,
+								 false, false);
+	}
 
 	if (should_free)
 		pfree(tuple);
+	tqueue->in_send = false;
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -94,8 +401,28 @@ tqueueShutdownReceiver(DestReceiver *self)
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
 	if (tqueue->queue != NULL)
+	{
+		/*
+		 * Send whatever is left in the batch.  If the receiver has already
+		 * detached, it doesn't want these tuples, so ignore that case; any
+		 * other failure is reported the same way as in tqueueReceiveSlot.
+		 */
+		tqueue->in_send = true;
+		if (tqueueFlushBatch(tqueue, false) == SHM_MQ_WOULD_BLOCK)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not send tuple to shared-memory queue")));
+		tqueue->in_send = false;
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
+
+	if (tqueue_flush_receiver == tqueue)
+	{
+		tqueue_flush_receiver = NULL;
+		if (get_timeout_active(tqueue_flush_timeout))
+			disable_timeout(tqueue_flush_timeout, false);
+	}
 }
 
 /*
@@ -109,6 +436,10 @@ tqueueDestroyReceiver(DestReceiver *self)
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	if (tqueue_flush_receiver == tqueue)
+		tqueue_flush_receiver = NULL;
+	if (tqueue->local_batch != NULL)
+		pfree(tqueue->local_batch);
 	pfree(self);
 }
 
@@ -129,9 +460,51 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
 
+	if (parallel_tuple_batch_size > 0)
+	{
+		self->batch_size = (Size) parallel_tuple_batch_size * 1024;
+		self->batch_target = Min(TQUEUE_INITIAL_BATCH_SIZE, self->batch_size);
+		self->local_batch = palloc(self->batch_size);
+		self->batch = self->local_batch;
+
+		if (handle != NULL)
+		{
+			if (tqueue_flush_timeout == MAX_TIMEOUTS)
+				tqueue_flush_timeout = RegisterTimeout(USER_TIMEOUT,
+													   tqueueFlushTimeoutHandler);
+			tqueue_flush_receiver = self;
+		}
+	}
+	self->batch_chunk = InvalidDsaPointer;
+
 	return (DestReceiver *) self;
 }
 
+/*
+ * Make a tuple queue DestReceiver build its batches in the given pool's
+ * chunks whenever one is free.
+ *
+ * This must be called before any tuples are sent.  The pool's chunks must
+ * be at least as large as the batches, so we do nothing if batching has
+ * since been disabled or made larger; the receiver then just sends its
+ * batches inline.
+ */
+void
+TupleQueueDestReceiverUseChunks(DestReceiver *self, dsa_area *area,
+								TupleQueueChunkPool *pool)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+
+	Assert(tqueue->pub.mydest == DestTupleQueue);
+	Assert(tqueue->batch_used == 0);
+
+	if (tqueue->batch == NULL || tqueue->batch_size > pool->chunk_size)
+		return;
+
+	tqueue->area = area;
+	tqueue->pool = pool;
+}
+
 /*
  * Create a tuple queue reader.
  */
@@ -141,10 +514,25 @@ CreateTupleQueueReader(shm_mq_handle *handle)
 	TupleQueueReader *reader = palloc0(sizeof(TupleQueueReader));
 
 	reader->queue = handle;
+	reader->msg_chunk = InvalidDsaPointer;
 
 	return reader;
 }
 
+/*
+ * Tell a tuple queue reader which pool the chunks sent to it belong to.
+ *
+ * This must be done before reading from a queue whose sender has been
+ * given the same pool with TupleQueueDestReceiverUseChunks.
+ */
+void
+TupleQueueReaderUseChunks(TupleQueueReader *reader, dsa_area *area,
+						  TupleQueueChunkPool *pool)
+{
+	reader->area = area;
+	reader->pool = pool;
+}
+
 /*
  * Destroy a tuple queue reader.
  *
@@ -183,6 +571,26 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/*
+	 * If the last message we received was a batch that still has tuples in
+	 * it, return the next one without touching the queue.  The message stays
+	 * valid until our next shm_mq_receive() call.
+	 */
+	if (reader->msg_offset < reader->msg_len)
+	{
+		tuple = (MinimalTuple) (reader->msg + reader->msg_offset);
+		Assert(reader->msg_offset + tuple->t_len <= reader->msg_len);
+		reader->msg_offset += MAXALIGN(tuple->t_len);
+		return tuple;
+	}
+
+	/* We're done with the previous message's chunk, if it had one. */
+	if (DsaPointerIsValid(reader->msg_chunk))
+	{
+		tqueueReturnChunk(reader->pool, reader->msg_chunk);
+		reader->msg_chunk = InvalidDsaPointer;
+	}
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -201,10 +609,111 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 
 	/*
 	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * sufficiently aligned), remembering where any further tuples of the
+	 * same batch begin.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+
+	/*
+	 * If the message refers to a DSA chunk, return tuples from the chunk
+	 * instead.  The chunk is ours until we return it to the pool.
+	 */
+	if (tuple->t_len == 0)
+	{
+		TupleQueueChunkRef *ref = (TupleQueueChunkRef *) data;
+
+		Assert(nbytes == sizeof(TupleQueueChunkRef));
+		Assert(reader->pool != NULL);
+		reader->msg_chunk = ref->chunk;
+		nbytes = ref->len;
+		data = dsa_get_address(reader->area, ref->chunk);
+		tuple = (MinimalTuple) data;
+	}
+	Assert(tuple->t_len <= nbytes);
+
+	reader->msg = (char *) data;
+	reader->msg_len = nbytes;
+	reader->msg_offset = MAXALIGN(tuple->t_len);
 
 	return tuple;
 }
+
+/*
+ * Create a TupleQueueChunkPool for each of nqueues tuple queues in the given
+ * DSA area, with chunks big enough for batches of the current
+ * parallel_tuple_batch_size.  Returns a pointer to the array of pools.
+ */
+dsa_pointer
+CreateTupleQueueChunkPools(dsa_area *area, int nqueues)
+{
+	dsa_pointer pools_dp;
+	TupleQueueChunkPool *pools;
+	Size		chunk_size = (Size) parallel_tuple_batch_size * 1024;
+
+	Assert(chunk_size > 0);
+
+	pools_dp = dsa_allocate(area, mul_size(sizeof(TupleQueueChunkPool),
+										   nqueues));
+	pools = dsa_get_address(area, pools_dp);
+
+	for (int i = 0; i < nqueues; i++)
+	{
+		pools[i].chunk_size = chunk_size;
+		pg_atomic_init_u64(&pools[i].ntaken, 0);
+		pg_atomic_init_u64(&pools[i].nreturned, 0);
+		for (int j = 0; j < TQUEUE_POOL_CHUNKS; j++)
+			pools[i].chunks[j] = dsa_allocate(area, chunk_size);
+	}
+	ResetTupleQueueChunkPools(area, pools_dp, nqueues);
+
+	return pools_dp;
+}
+
+/*
+ * Mark every chunk of the given pools free again.
+ *
+ * This may only be done while no process is sending to or reading from the
+ * corresponding queues, e.g. before relaunching workers.  Chunks that were
+ * still queued when the previous workers stopped are thereby reclaimed.
+ */
+void
+ResetTupleQueueChunkPools(dsa_area *area, dsa_pointer pools_dp, int nqueues)
+{
+	TupleQueueChunkPool *pools = dsa_get_address(area, pools_dp);
+
+	for (int i = 0; i < nqueues; i++)
+	{
+		for (int j = 0; j < TQUEUE_POOL_CHUNKS; j++)
+			pools[i].freelist[j] = pools[i].chunks[j];
+		pg_atomic_write_u64(&pools[i].ntaken, 0);
+		pg_atomic_write_u64(&pools[i].nreturned, TQUEUE_POOL_CHUNKS);
+	}
+}
+
+/*
+ * Free the given pools and all of their chunks.
+ */
+void
+FreeTupleQueueChunkPools(dsa_area *area, dsa_pointer pools_dp, int nqueues)
+{
+	TupleQueueChunkPool *pools = dsa_get_address(area, pools_dp);
+
+	for (int i = 0; i < nqueues; i++)
+	{
+		for (int j = 0; j < TQUEUE_POOL_CHUNKS; j++)
+			dsa_free(area, pools[i].chunks[j]);
+	}
+	dsa_free(area, pools_dp);
+}
+
+/*
+ * Get the pool for the n'th queue from an array made by
+ * CreateTupleQueueChunkPools.
+ */
+TupleQueueChunkPool *
+GetTupleQueueChunkPool(dsa_area *area, dsa_pointer pools_dp, int n)
+{
+	TupleQueueChunkPool *pools = dsa_get_address(area, pools_dp);
+
+	return &pools[n];
+}
@@ -4484,6 +4484,10 @@ planstate_tree_walker_impl(PlanState *planstate,
 			if (PSWALK(((SubqueryScanState *) planstate)->subplan))
 				return true;
 			break;
+		case T_AdaptiveJoin:
+			if (PSWALK((PlanState *) ((AdaptiveJoinState *) planstate)->aj_HashState))
+				return true;
+			break;
 		case T_CustomScan:
 			foreach(lc, ((CustomScanState *) planstate)->custom_ps)
 			{
@@ -4520,6 +4520,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "HashJoin";
 			join = true;
 			break;
+		case T_AdaptiveJoinPath:
+			ptype = "AdaptiveJoin";
+			join = true;
+			break;
 		case T_AppendPath:
 			ptype = "Append";
 			break;
@@ -153,6 +153,7 @@ bool		enable_parallel_hash = true;
 bool		enable_partition_pruning = true;
 bool		enable_presorted_aggregate = true;
 bool		enable_async_append = true;
+bool		enable_adaptivejoin = false;
 
 /* pg_lab additions */
 
@@ -3053,7 +3054,8 @@ standard_cost_agg(Path *path, PlannerInfo *root,
 		hashentrysize = hash_agg_entry_size(list_length(root->aggtransinfos),
 											input_width,
 											aggcosts->transitionSpace);
-		hash_agg_set_limits(hashentrysize, numGroups, 0, &mem_limit,
+		hash_agg_set_limits(hashentrysize, numGroups, 0,
+							get_hash_memory_limit(), &mem_limit,
 							&ngroups_limit, &num_partitions);
 
 		nbatches = Max((numGroups * hashentrysize) / mem_limit,
@@ -4368,6 +4370,7 @@ standard_initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 							true,	/* useskew */
 							parallel_hash,	/* try_combined_hash_mem */
 							outer_path->parallel_workers,
+							get_hash_memory_limit(),
 							&space_allowed,
 							&numbuckets,
 							&numbatches,
@@ -4681,6 +4684,54 @@ standard_final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	path->jpath.path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * final_cost_adaptivejoin
+ *	  Choose the crossover point of an adaptive join path.
+ *
+ * 'path' is already filled in from the nested loop path it starts as,
+ * including rows and costs, except for crossover_rows
+ * 'hashpath' is the hash join path it turns into past the crossover point
+ *
+ * If the nested loop spends per_nl on each outer row and the hash join
+ * per_hj after spending build up front, switching after
+ *		X = (build - nl_fixed) / (per_nl - per_hj)
+ * outer rows costs at most build more than having chosen the hash join in
+ * the first place, and nothing more than the nested loop if the outer
+ * relation has no more than X rows.  That bound holds whatever the outer
+ * relation's actual size, which is the point of the exercise.
+ *
+ * The path keeps the nested loop's costs, since it is only worth adding
+ * when the estimated outer rows fall short of X.  crossover_rows is left
+ * zero when the hash join never catches up.
+ */
+void
+final_cost_adaptivejoin(PlannerInfo *root, AdaptiveJoinPath *path,
+						HashPath *hashpath)
+{
+	Path	   *outer_path = path->jpath.outerjoinpath;
+	double		outer_rows = clamp_row_est(outer_path->rows);
+	Cost		outer_run_cost;
+	Cost		nl_fixed;
+	Cost		build;
+	Cost		per_nl;
+	Cost		per_hj;
+
+	outer_run_cost = outer_path->total_cost - outer_path->startup_cost;
+	nl_fixed = path->jpath.path.startup_cost - outer_path->startup_cost;
+	build = hashpath->jpath.path.startup_cost - outer_path->startup_cost;
+	per_nl = (path->jpath.path.total_cost - path->jpath.path.startup_cost -
+			  outer_run_cost) / outer_rows;
+	per_hj = (hashpath->jpath.path.total_cost -
+			  hashpath->jpath.path.startup_cost -
+			  outer_run_cost) / outer_rows;
+
+	if (per_nl <= per_hj)
+		path->crossover_rows = 0;
+	else
+		path->crossover_rows = clamp_row_est(Max(build - nl_fixed, 0.0) /
+											 (per_nl - per_hj));
+}
+
 
 /*
  * cost_subplan
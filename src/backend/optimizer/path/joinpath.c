@@ -59,6 +59,11 @@ void		sort_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 static inline bool clause_sides_match_join(RestrictInfo *rinfo,
 										   RelOptInfo *outerrel,
 										   RelOptInfo *innerrel);
+static Path *consider_adaptive_join(PlannerInfo *root,
+									RelOptInfo *joinrel,
+									NestPath *nlpath,
+									JoinType jointype,
+									JoinPathExtraData *extra);
 static void match_unsorted_outer(PlannerInfo *root, RelOptInfo *joinrel,
 								 RelOptInfo *outerrel, RelOptInfo *innerrel,
 								 JoinType jointype, JoinPathExtraData *extra);
@@ -797,6 +802,9 @@ try_nestloop_path(PlannerInfo *root,
 						  workspace.startup_cost, workspace.total_cost,
 						  pathkeys, required_outer))
 	{
+		NestPath   *nlpath;
+		Path	   *path;
+
 		/*
 		 * If the inner path is parameterized, it is parameterized by the
 		 * topmost parent of the outer rel, not the outer rel itself.  Fix
@@ -818,8 +826,7 @@ try_nestloop_path(PlannerInfo *root,
 			}
 		}
 
-		add_path(joinrel, (Path *)
-				 create_nestloop_path(root,
+		nlpath = create_nestloop_path(root,
 									  joinrel,
 									  jointype,
 									  &workspace,
@@ -828,7 +835,20 @@ try_nestloop_path(PlannerInfo *root,
 									  inner_path,
 									  extra->restrictlist,
 									  pathkeys,
-									  required_outer));
+									  required_outer);
+		path = (Path *) nlpath;
+
+		/*
+		 * A nestloop whose inner side is an index probe is only cheap while
+		 * the outer side stays small; if it is allowed to, hedge against that
+		 * estimate being wrong by turning it into an adaptive join.
+		 */
+		if (enable_adaptivejoin && required_outer == NULL &&
+			bms_overlap(inner_paramrels, outerrelids))
+			path = consider_adaptive_join(root, joinrel, nlpath,
+										  jointype, extra);
+
+		add_path(joinrel, path);
 	}
 	else
 	{
@@ -837,6 +857,103 @@ try_nestloop_path(PlannerInfo *root,
 	}
 }
 
+/*
+ * consider_adaptive_join
+ *	  Try to turn a nestloop path whose inner path is parameterized by its
+ *	  outer relation into an adaptive join, which switches to a hash join if
+ *	  the outer relation turns out larger than the crossover point chosen by
+ *	  final_cost_adaptivejoin.  Returns the adaptive join path, or the
+ *	  nestloop path itself if it doesn't qualify.
+ *
+ * The adaptive join path has the same costs and pathkeys as the nestloop,
+ * so it replaces it rather than competing with it in add_path.
+ */
+static Path *
+consider_adaptive_join(PlannerInfo *root,
+					   RelOptInfo *joinrel,
+					   NestPath *nlpath,
+					   JoinType jointype,
+					   JoinPathExtraData *extra)
+{
+	Path	   *outer_path = nlpath->jpath.outerjoinpath;
+	Path	   *inner_path = nlpath->jpath.innerjoinpath;
+	RelOptInfo *outerrel = outer_path->parent;
+	RelOptInfo *innerrel = inner_path->parent;
+	Path	   *hash_inner = innerrel->cheapest_total_path;
+	bool		isouterjoin = IS_OUTER_JOIN(jointype);
+	List	   *hashclauses = NIL;
+	JoinCostWorkspace workspace;
+	HashPath   *hashpath;
+	AdaptiveJoinPath *ajpath;
+	ListCell   *lc;
+
+	/*
+	 * The executor joins each outer row on its own in either mode, which
+	 * rules out join types that need to track unmatched inner rows.
+	 */
+	if (!enable_hashjoin ||
+		!(jointype == JOIN_INNER || jointype == JOIN_LEFT ||
+		  jointype == JOIN_SEMI || jointype == JOIN_ANTI))
+		return (Path *) nlpath;
+
+	/*
+	 * Both inner paths must produce the same columns without needing anything
+	 * from outside the join, and the inner path must get all its parameters
+	 * from the outer relation itself.  Leave partitionwise joins, whose inner
+	 * paths may need reparameterizing, alone.
+	 */
+	if (outerrel->top_parent_relids || innerrel->top_parent_relids ||
+		hash_inner == NULL || hash_inner->param_info != NULL ||
+		hash_inner->pathtarget != inner_path->pathtarget ||
+		!bms_is_subset(PATH_REQ_OUTER(inner_path), outerrel->relids))
+		return (Path *) nlpath;
+
+	/* Find the hashable join clauses, as hash_inner_and_outer does */
+	foreach(lc, extra->restrictlist)
+	{
+		RestrictInfo *restrictinfo = (RestrictInfo *) lfirst(lc);
+
+		if (isouterjoin && RINFO_IS_PUSHED_DOWN(restrictinfo, joinrel->relids))
+			continue;
+
+		if (!restrictinfo->can_join ||
+			restrictinfo->hashjoinoperator == InvalidOid)
+			continue;			/* not hashjoinable */
+
+		if (!clause_sides_match_join(restrictinfo, outerrel, innerrel))
+			continue;			/* no good for these input relations */
+
+		hashclauses = lappend(hashclauses, restrictinfo);
+	}
+	if (hashclauses == NIL)
+		return (Path *) nlpath;
+
+	/* The executor can't spill the hash table, so it must fit in memory */
+	initial_cost_hashjoin(root, &workspace, jointype, hashclauses,
+						  outer_path, hash_inner, extra, false);
+	if (workspace.numbatches != 1)
+		return (Path *) nlpath;
+
+	hashpath = create_hashjoin_path(root,
+									joinrel,
+									jointype,
+									&workspace,
+									extra,
+									outer_path,
+									hash_inner,
+									false,	/* parallel_hash */
+									extra->restrictlist,
+									NULL,
+									hashclauses);
+	ajpath = create_adaptivejoin_path(root, nlpath, hashpath);
+
+	/* Not worth it unless the nestloop is expected to stay ahead */
+	if (ajpath->crossover_rows <= outer_path->rows)
+		return (Path *) nlpath;
+
+	return (Path *) ajpath;
+}
+
 /*
  * try_partial_nestloop_path
  *	  Consider a partial nestloop join path; if it appears useful, push it into
@@ -162,6 +162,8 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static AdaptiveJoin *create_adaptivejoin_plan(PlannerInfo *root,
+											  AdaptiveJoinPath *best_path);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -244,6 +246,14 @@ static Hash *make_hash(Plan *lefttree,
 					   Oid skewTable,
 					   AttrNumber skewColumn,
 					   bool skewInherit);
+static AdaptiveJoin *make_adaptivejoin(List *tlist,
+									   List *joinclauses, List *otherclauses,
+									   List *nestParams,
+									   Plan *hashplan, List *hashclauses,
+									   List *hashoperators, List *hashcollations,
+									   List *hashkeys, List *hashjoinclauses,
+									   Plan *lefttree, Plan *righttree,
+									   JoinType jointype, bool inner_unique);
 static MergeJoin *make_mergejoin(List *tlist,
 								 List *joinclauses, List *otherclauses,
 								 List *mergeclauses,
@@ -414,6 +424,7 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 		case T_HashJoin:
 		case T_MergeJoin:
 		case T_NestLoop:
+		case T_AdaptiveJoin:
 			plan = create_join_plan(root,
 									(JoinPath *) best_path);
 			break;
@@ -1077,6 +1088,10 @@ create_join_plan(PlannerInfo *root, JoinPath *best_path)
 			plan = (Plan *) create_nestloop_plan(root,
 												 (NestPath *) best_path);
 			break;
+		case T_AdaptiveJoin:
+			plan = (Plan *) create_adaptivejoin_plan(root,
+													 (AdaptiveJoinPath *) best_path);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->path.pathtype);
@@ -4874,6 +4889,153 @@ create_hashjoin_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+/*
+ * create_adaptivejoin_plan
+ *	  Create an AdaptiveJoin plan: the nestloop part is built as in
+ *	  create_nestloop_plan, the hash join part as in create_hashjoin_plan.
+ */
+static AdaptiveJoin *
+create_adaptivejoin_plan(PlannerInfo *root,
+						 AdaptiveJoinPath *best_path)
+{
+	AdaptiveJoin *join_plan;
+	Hash	   *hash_plan;
+	Plan	   *outer_plan;
+	Plan	   *inner_plan;
+	Plan	   *hash_inner_plan;
+	List	   *tlist = build_path_tlist(root, &best_path->jpath.path);
+	List	   *joinrestrictclauses = best_path->jpath.joinrestrictinfo;
+	List	   *hashrestrictclauses = best_path->hash_restrictinfo;
+	List	   *joinclauses;
+	List	   *otherclauses;
+	List	   *hashjoinclauses;
+	List	   *hashotherclauses;
+	List	   *hashclauses;
+	List	   *hashoperators = NIL;
+	List	   *hashcollations = NIL;
+	List	   *inner_hashkeys = NIL;
+	List	   *outer_hashkeys = NIL;
+	Relids		outerrelids;
+	List	   *nestParams;
+	Relids		saveOuterRels = root->curOuterRels;
+	ListCell   *lc;
+
+	/* The planner only builds unparameterized adaptive joins */
+	Assert(best_path->jpath.path.param_info == NULL);
+
+	outer_plan = create_plan_recurse(root, best_path->jpath.outerjoinpath, 0);
+
+	/* For a nestloop, include outer relids in curOuterRels for inner side */
+	root->curOuterRels = bms_union(root->curOuterRels,
+								   best_path->jpath.outerjoinpath->parent->relids);
+
+	/*
+	 * Either inner plan may supply the inner tuples the join's quals and
+	 * tlist are evaluated against, so both must produce exactly the same
+	 * columns.
+	 */
+	inner_plan = create_plan_recurse(root, best_path->jpath.innerjoinpath,
+									 CP_EXACT_TLIST);
+
+	/* Restore curOuterRels */
+	bms_free(root->curOuterRels);
+	root->curOuterRels = saveOuterRels;
+
+	hash_inner_plan = create_plan_recurse(root, best_path->hashinnerpath,
+										  CP_EXACT_TLIST);
+	if (!equal(inner_plan->targetlist, hash_inner_plan->targetlist))
+		hash_inner_plan = change_plan_targetlist(hash_inner_plan,
+												 inner_plan->targetlist,
+												 best_path->hashinnerpath->parallel_safe);
+
+	/* Sort join qual clauses into best execution order */
+	joinrestrictclauses = order_qual_clauses(root, joinrestrictclauses);
+	hashrestrictclauses = order_qual_clauses(root, hashrestrictclauses);
+
+	/* Get the join qual clauses (in plain expression form) */
+	/* Any pseudoconstant clauses are ignored here */
+	if (IS_OUTER_JOIN(best_path->jpath.jointype))
+	{
+		extract_actual_join_clauses(joinrestrictclauses,
+									best_path->jpath.path.parent->relids,
+									&joinclauses, &otherclauses);
+		extract_actual_join_clauses(hashrestrictclauses,
+									best_path->jpath.path.parent->relids,
+									&hashjoinclauses, &hashotherclauses);
+	}
+	else
+	{
+		/* We can treat all clauses alike for an inner join */
+		joinclauses = extract_actual_clauses(joinrestrictclauses, false);
+		otherclauses = NIL;
+		hashjoinclauses = extract_actual_clauses(hashrestrictclauses, false);
+		hashotherclauses = NIL;
+	}
+
+	/*
+	 * Only join clauses get moved into the parameterized inner path, so both
+	 * modes filter the joined rows alike.
+	 */
+	Assert(equal(otherclauses, hashotherclauses));
+
+	/* Remove the hashclauses from the join quals of the hash mode */
+	hashclauses = get_actual_clauses(best_path->path_hashclauses);
+	hashjoinclauses = list_difference(hashjoinclauses, hashclauses);
+
+	/*
+	 * Identify any nestloop parameters that should be supplied by this join
+	 * node, and remove them from root->curOuterParams.
+	 */
+	outerrelids = best_path->jpath.outerjoinpath->parent->relids;
+	nestParams = identify_current_nestloop_params(root, outerrelids);
+
+	/*
+	 * Rearrange hashclauses, if needed, so that the outer variable is always
+	 * on the left, and collect hash related information as
+	 * create_hashjoin_plan does.
+	 */
+	hashclauses = get_switched_clauses(best_path->path_hashclauses,
+									   outerrelids);
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+
+		hashoperators = lappend_oid(hashoperators, hclause->opno);
+		hashcollations = lappend_oid(hashcollations, hclause->inputcollid);
+		outer_hashkeys = lappend(outer_hashkeys, linitial(hclause->args));
+		inner_hashkeys = lappend(inner_hashkeys, lsecond(hclause->args));
+	}
+
+	/* The executor never batches, so skew optimization doesn't apply */
+	hash_plan = make_hash(hash_inner_plan,
+						  inner_hashkeys,
+						  InvalidOid,
+						  InvalidAttrNumber,
+						  false);
+	copy_plan_costsize(&hash_plan->plan, hash_inner_plan);
+	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
+
+	join_plan = make_adaptivejoin(tlist,
+								  joinclauses,
+								  otherclauses,
+								  nestParams,
+								  (Plan *) hash_plan,
+								  hashclauses,
+								  hashoperators,
+								  hashcollations,
+								  outer_hashkeys,
+								  hashjoinclauses,
+								  outer_plan,
+								  inner_plan,
+								  best_path->jpath.jointype,
+								  best_path->jpath.inner_unique);
+	join_plan->crossover_rows = best_path->crossover_rows;
+
+	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
+
+	return join_plan;
+}
+
 
 /*****************************************************************************
  *
@@ -5982,6 +6144,43 @@ make_hash(Plan *lefttree,
 	return node;
 }
 
+static AdaptiveJoin *
+make_adaptivejoin(List *tlist,
+				  List *joinclauses,
+				  List *otherclauses,
+				  List *nestParams,
+				  Plan *hashplan,
+				  List *hashclauses,
+				  List *hashoperators,
+				  List *hashcollations,
+				  List *hashkeys,
+				  List *hashjoinclauses,
+				  Plan *lefttree,
+				  Plan *righttree,
+				  JoinType jointype,
+				  bool inner_unique)
+{
+	AdaptiveJoin *node = makeNode(AdaptiveJoin);
+	Plan	   *plan = &node->join.plan;
+
+	plan->targetlist = tlist;
+	plan->qual = otherclauses;
+	plan->lefttree = lefttree;
+	plan->righttree = righttree;
+	node->join.jointype = jointype;
+	node->join.inner_unique = inner_unique;
+	node->join.joinqual = joinclauses;
+	node->nestParams = nestParams;
+	node->hashplan = hashplan;
+	node->hashclauses = hashclauses;
+	node->hashoperators = hashoperators;
+	node->hashcollations = hashcollations;
+	node->hashkeys = hashkeys;
+	node->hashjoinqual = hashjoinclauses;
+
+	return node;
+}
+
 static MergeJoin *
 make_mergejoin(List *tlist,
 			   List *joinclauses,
@@ -518,6 +518,10 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
 
+	/* divide query_work_mem among the plan's memory-consuming nodes */
+	if (query_work_mem > 0)
+		assign_query_work_mem(top_plan, glob->subplans);
+
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
 
@@ -540,11 +544,14 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->relationOids = glob->relationOids;
 	result->invalItems = glob->invalItems;
 	result->paramExecTypes = glob->paramExecTypes;
+	result->extensionState = NIL;
 	/* utilityStmt should be null, but we might as well copy it */
 	result->utilityStmt = parse->utilityStmt;
 	result->stmt_location = parse->stmt_location;
 	result->stmt_len = parse->stmt_len;
 
+	result->planMemory = estimate_plan_memory(top_plan, glob->subplans);
+
 	result->jitFlags = PGJIT_NONE;
 	if (jit_enabled && jit_above_cost >= 0 &&
 		top_plan->total_cost > jit_above_cost)
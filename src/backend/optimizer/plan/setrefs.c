@@ -160,6 +160,9 @@ static Node *fix_scan_expr(PlannerInfo *root, Node *node,
 						   int rtoffset, double num_exec);
 static Node *fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context);
 static bool fix_scan_expr_walker(Node *node, fix_scan_expr_context *context);
+static void fix_nestloop_params(PlannerInfo *root, List *nestParams,
+								Plan *outer_plan, indexed_tlist *outer_itlist,
+								int rtoffset);
 static void set_join_references(PlannerInfo *root, Join *join, int rtoffset);
 static void set_upper_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static void set_param_references(PlannerInfo *root, Plan *plan);
@@ -847,6 +850,14 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 		case T_HashJoin:
 			set_join_references(root, (Join *) plan, rtoffset);
 			break;
+		case T_AdaptiveJoin:
+			{
+				AdaptiveJoin *aj = (AdaptiveJoin *) plan;
+
+				set_join_references(root, (Join *) plan, rtoffset);
+				aj->hashplan = set_plan_refs(root, aj->hashplan, rtoffset);
+			}
+			break;
 
 		case T_Gather:
 		case T_GatherMerge:
@@ -2243,6 +2254,46 @@ fix_scan_expr_walker(Node *node, fix_scan_expr_context *context)
 								  (void *) context);
 }
 
+/*
+ * fix_nestloop_params
+ *	  Make the NestLoopParams of a NestLoop or AdaptiveJoin reference the
+ *	  join's outer plan.
+ */
+static void
+fix_nestloop_params(PlannerInfo *root, List *nestParams, Plan *outer_plan,
+					indexed_tlist *outer_itlist, int rtoffset)
+{
+	ListCell   *lc;
+
+	foreach(lc, nestParams)
+	{
+		NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+
+		/*
+		 * Because we don't reparameterize parameterized paths to match
+		 * the outer-join level at which they are used, Vars seen in the
+		 * NestLoopParam expression may have nullingrels that are just a
+		 * subset of those in the Vars actually available from the outer
+		 * side.  (Lateral references can also cause this, as explained in
+		 * the comments for identify_current_nestloop_params.)  Not
+		 * checking this exactly is a bit grotty, but the work needed to
+		 * make things match up perfectly seems well out of proportion to
+		 * the value.
+		 */
+		nlp->paramval = (Var *) fix_upper_expr(root,
+											   (Node *) nlp->paramval,
+											   outer_itlist,
+											   OUTER_VAR,
+											   rtoffset,
+											   NRM_SUBSET,
+											   NUM_EXEC_TLIST(outer_plan));
+		/* Check we replaced any PlaceHolderVar with simple Var */
+		if (!(IsA(nlp->paramval, Var) &&
+			  nlp->paramval->varno == OUTER_VAR))
+			elog(ERROR, "NestLoopParam was not reduced to a simple Var");
+	}
+}
+
 /*
  * set_join_references
  *	  Modify the target list and quals of a join node to reference its
@@ -2282,35 +2333,9 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 	if (IsA(join, NestLoop))
 	{
 		NestLoop   *nl = (NestLoop *) join;
-		ListCell   *lc;
-
-		foreach(lc, nl->nestParams)
-		{
-			NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
 
-			/*
-			 * Because we don't reparameterize parameterized paths to match
-			 * the outer-join level at which they are used, Vars seen in the
-			 * NestLoopParam expression may have nullingrels that are just a
-			 * subset of those in the Vars actually available from the outer
-			 * side.  (Lateral references can also cause this, as explained in
-			 * the comments for identify_current_nestloop_params.)  Not
-			 * checking this exactly is a bit grotty, but the work needed to
-			 * make things match up perfectly seems well out of proportion to
-			 * the value.
-			 */
-			nlp->paramval = (Var *) fix_upper_expr(root,
-												   (Node *) nlp->paramval,
-												   outer_itlist,
-												   OUTER_VAR,
-												   rtoffset,
-												   NRM_SUBSET,
-												   NUM_EXEC_TLIST(outer_plan));
-			/* Check we replaced any PlaceHolderVar with simple Var */
-			if (!(IsA(nlp->paramval, Var) &&
-				  nlp->paramval->varno == OUTER_VAR))
-				elog(ERROR, "NestLoopParam was not reduced to a simple Var");
-		}
+		fix_nestloop_params(root, nl->nestParams, outer_plan, outer_itlist,
+							rtoffset);
 	}
 	else if (IsA(join, MergeJoin))
 	{
@@ -2350,6 +2375,41 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 											   NRM_EQUAL,
 											   NUM_EXEC_QUAL((Plan *) join));
 	}
+	else if (IsA(join, AdaptiveJoin))
+	{
+		AdaptiveJoin *aj = (AdaptiveJoin *) join;
+
+		fix_nestloop_params(root, aj->nestParams, outer_plan, outer_itlist,
+							rtoffset);
+
+		/*
+		 * The hash clauses and quals are evaluated against tuples from the
+		 * Hash node rather than the righttree, but both emit the same tlist.
+		 */
+		aj->hashclauses = fix_join_expr(root,
+										aj->hashclauses,
+										outer_itlist,
+										inner_itlist,
+										(Index) 0,
+										rtoffset,
+										NRM_EQUAL,
+										NUM_EXEC_QUAL((Plan *) join));
+		aj->hashjoinqual = fix_join_expr(root,
+										 aj->hashjoinqual,
+										 outer_itlist,
+										 inner_itlist,
+										 (Index) 0,
+										 rtoffset,
+										 NRM_EQUAL,
+										 NUM_EXEC_QUAL((Plan *) join));
+		aj->hashkeys = (List *) fix_upper_expr(root,
+											   (Node *) aj->hashkeys,
+											   outer_itlist,
+											   OUTER_VAR,
+											   rtoffset,
+											   NRM_EQUAL,
+											   NUM_EXEC_QUAL((Plan *) join));
+	}
 
 	/*
 	 * Now we need to fix up the targetlist and qpqual, which are logically
@@ -2634,6 +2634,33 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			}
 			break;
 
+		case T_AdaptiveJoin:
+			{
+				AdaptiveJoin *aj = (AdaptiveJoin *) plan;
+
+				finalize_primnode((Node *) aj->join.joinqual, &context);
+				finalize_primnode((Node *) aj->hashclauses, &context);
+				finalize_primnode((Node *) aj->hashjoinqual, &context);
+				finalize_primnode((Node *) aj->hashkeys, &context);
+				/* collect set of params that will be passed to right child */
+				foreach(l, aj->nestParams)
+				{
+					NestLoopParam *nlp = (NestLoopParam *) lfirst(l);
+
+					nestloop_params = bms_add_member(nestloop_params,
+													 nlp->paramno);
+				}
+				/* the Hash node gets no nestloop params */
+				context.paramids =
+					bms_add_members(context.paramids,
+									finalize_plan(root,
+												  aj->hashplan,
+												  gather_param,
+												  valid_params,
+												  scan_params));
+			}
+			break;
+
 		case T_MergeJoin:
 			finalize_primnode((Node *) ((Join *) plan)->joinqual,
 							  &context);
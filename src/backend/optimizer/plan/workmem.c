@@ -0,0 +1,380 @@
+/*-------------------------------------------------------------------------
+ *
+ * workmem.c
+ *	  Divide a query-wide memory budget among the nodes of a finished plan.
+ *
+ * Normally every Sort, Hash, hashed Agg, Memoize, Material, WindowAgg,
+ * RecursiveUnion and CteScan node may use up to work_mem (hash_mem for the
+ * hash-based ones) on its own, so a plan with many such nodes can use many
+ * times work_mem in total.  (SetOp and the duplicate-eliminating hash table
+ * of a RecursiveUnion are not included: their hash tables cannot spill, so
+ * there would be no limit to enforce.)  When
+ * query_work_mem is set, and the plan's nodes could together exceed it, we
+ * instead give each of those nodes an explicit limit (Plan.workmem_limit),
+ * which the executor uses in place of work_mem.
+ *
+ * The budget is shared out "water-filling" style: nodes are considered in
+ * order of their estimated memory needs, smallest first, and each gets what
+ * it needs or an equal share of what is left, whichever is less.  Small
+ * nodes, which are cheap to keep entirely in memory, thus never spill,
+ * while the large ones, which would likely spill anyway, split the rest.
+ * Whatever is left over after that (because the estimates were small) is
+ * handed out again, up to each node's usual limit.  Nodes below a Gather
+ * count once for every process expected to run them.
+ *
+ * We also compute the total memory the plan is expected to use, for the
+ * instance-wide memory broker (see membroker.c).
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/plan/workmem.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeAgg.h"
+#include "executor/nodeHash.h"
+#include "miscadmin.h"
+#include "optimizer/planmain.h"
+#include "utils/guc.h"
+
+/* GUC parameter */
+int			query_work_mem = 0;
+
+/* Smallest limit we ever assign to a node, in kB (the minimum of work_mem) */
+#define MIN_NODE_WORK_MEM	64
+
+/* A memory-consuming plan node, and what we know about its needs */
+typedef struct WorkMemNode
+{
+	Plan	   *plan;
+	double		need;			/* estimated memory needed, in kB */
+	int			default_limit;	/* limit without a budget, in kB */
+	int			copies;			/* number of processes running the node */
+} WorkMemNode;
+
+static void collect_workmem_nodes(Plan *plan, int copies, List **nodes);
+static void collect_workmem_node_list(List *plans, int copies, List **nodes);
+static WorkMemNode *make_workmem_node(Plan *plan, int copies);
+static int	workmem_node_cmp(const void *a, const void *b);
+
+
+/*
+ * assign_query_work_mem
+ *		Assign per-node memory limits out of query_work_mem to the nodes of
+ *		a finished plan, including its subplans.
+ *
+ * This must run after set_plan_references(), so that we see the plan tree
+ * exactly as the executor will.
+ */
+void
+assign_query_work_mem(Plan *top_plan, List *subplans)
+{
+	List	   *nodes = NIL;
+	WorkMemNode *items;
+	int			nitems;
+	double		total_default = 0;
+	double		remaining;
+	int			remaining_copies = 0;
+	ListCell   *lc;
+	int			i;
+
+	if (query_work_mem <= 0)
+		return;
+
+	collect_workmem_nodes(top_plan, 1, &nodes);
+	collect_workmem_node_list(subplans, 1, &nodes);
+
+	nitems = list_length(nodes);
+	if (nitems == 0)
+		return;
+
+	items = palloc_array(WorkMemNode, nitems);
+	i = 0;
+	foreach(lc, nodes)
+	{
+		items[i] = *(WorkMemNode *) lfirst(lc);
+		total_default += (double) items[i].default_limit * items[i].copies;
+		remaining_copies += items[i].copies;
+		i++;
+	}
+
+	/* If the nodes can't exceed the budget anyway, leave them alone */
+	if (total_default <= query_work_mem)
+	{
+		pfree(items);
+		list_free_deep(nodes);
+		return;
+	}
+
+	qsort(items, nitems, sizeof(WorkMemNode), workmem_node_cmp);
+
+	/* First pass: what each node needs, or an equal share of the rest */
+	remaining = query_work_mem;
+	for (i = 0; i < nitems; i++)
+	{
+		double		share = remaining / remaining_copies;
+		double		limit;
+
+		limit = Min(items[i].need, share);
+		limit = Max(limit, MIN_NODE_WORK_MEM);
+		items[i].plan->workmem_limit = (int) limit;
+		remaining = Max(remaining - limit * items[i].copies, 0);
+		remaining_copies -= items[i].copies;
+	}
+
+	/* Second pass: hand out any leftovers, up to each node's usual limit */
+	for (i = 0; i < nitems && remaining >= 1; i++)
+	{
+		Plan	   *plan = items[i].plan;
+		int			extra;
+
+		extra = (int) Min(remaining / items[i].copies,
+						  items[i].default_limit - plan->workmem_limit);
+		if (extra > 0)
+		{
+			plan->workmem_limit += extra;
+			remaining -= (double) extra * items[i].copies;
+		}
+	}
+
+	pfree(items);
+	list_free_deep(nodes);
+}
+
+/*
+ * estimate_plan_memory
+ *		Estimate the total memory, in kB, that the memory-consuming nodes of
+ *		a finished plan will use, across all processes running it.
+ *
+ * Each node is counted at its estimated need, capped by the limit it will
+ * run with, so this must be called after assign_query_work_mem().
+ */
+int
+estimate_plan_memory(Plan *top_plan, List *subplans)
+{
+	List	   *nodes = NIL;
+	double		total = 0;
+	ListCell   *lc;
+
+	collect_workmem_nodes(top_plan, 1, &nodes);
+	collect_workmem_node_list(subplans, 1, &nodes);
+
+	foreach(lc, nodes)
+	{
+		WorkMemNode *item = (WorkMemNode *) lfirst(lc);
+		double		limit = item->default_limit;
+
+		if (item->plan->workmem_limit > 0)
+			limit = item->plan->workmem_limit;
+		total += Min(item->need, limit) * item->copies;
+	}
+
+	list_free_deep(nodes);
+
+	return (int) Min(total, (double) MAX_KILOBYTES);
+}
+
+/*
+ * Walk a plan tree, adding a WorkMemNode to *nodes for each node whose
+ * memory use is limited by work_mem or hash_mem.  "copies" is the number of
+ * processes expected to run the plan.
+ */
+static void
+collect_workmem_nodes(Plan *plan, int copies, List **nodes)
+{
+	WorkMemNode *item;
+
+	if (plan == NULL)
+		return;
+
+	item = make_workmem_node(plan, copies);
+	if (item != NULL)
+		*nodes = lappend(*nodes, item);
+
+	/* Everything below a Gather is run by the workers and the leader */
+	if (IsA(plan, Gather))
+		copies *= ((Gather *) plan)->num_workers + 1;
+	else if (IsA(plan, GatherMerge))
+		copies *= ((GatherMerge *) plan)->num_workers + 1;
+
+	/* Recurse into child plans, including the ones not in lefttree/righttree */
+	switch (nodeTag(plan))
+	{
+		case T_Append:
+			collect_workmem_node_list(((Append *) plan)->appendplans, copies,
+									  nodes);
+			break;
+		case T_MergeAppend:
+			collect_workmem_node_list(((MergeAppend *) plan)->mergeplans, copies,
+									  nodes);
+			break;
+		case T_BitmapAnd:
+			collect_workmem_node_list(((BitmapAnd *) plan)->bitmapplans, copies,
+									  nodes);
+			break;
+		case T_BitmapOr:
+			collect_workmem_node_list(((BitmapOr *) plan)->bitmapplans, copies,
+									  nodes);
+			break;
+		case T_SubqueryScan:
+			collect_workmem_nodes(((SubqueryScan *) plan)->subplan, copies, nodes);
+			break;
+		case T_CustomScan:
+			collect_workmem_node_list(((CustomScan *) plan)->custom_plans, copies,
+									  nodes);
+			break;
+		default:
+			break;
+	}
+
+	collect_workmem_nodes(plan->lefttree, copies, nodes);
+	collect_workmem_nodes(plan->righttree, copies, nodes);
+}
+
+static void
+collect_workmem_node_list(List *plans, int copies, List **nodes)
+{
+	ListCell   *lc;
+
+	foreach(lc, plans)
+		collect_workmem_nodes((Plan *) lfirst(lc), copies, nodes);
+}
+
+/*
+ * If "plan" is a node that the executor limits by work_mem or hash_mem,
+ * return a WorkMemNode describing it, else NULL.
+ *
+ * The estimates are deliberately simple; they only have to be good enough
+ * to tell small nodes from large ones.  Needs are capped at the node's usual
+ * limit, since we never give a node more than it would get without a budget.
+ */
+static WorkMemNode *
+make_workmem_node(Plan *plan, int copies)
+{
+	double		tuplesize = MAXALIGN(plan->plan_width) +
+		MAXALIGN(SizeofMinimalTupleHeader);
+	double		bytes;
+	int			default_limit;
+	WorkMemNode *item;
+
+	switch (nodeTag(plan))
+	{
+		case T_Sort:
+		case T_IncrementalSort:
+			/* tuples plus their SortTuple entries in the memtuples array */
+			bytes = plan->plan_rows * (tuplesize + 3 * sizeof(Datum));
+			default_limit = work_mem;
+			break;
+
+		case T_Material:
+			bytes = plan->plan_rows * tuplesize;
+			default_limit = work_mem;
+			break;
+
+		case T_WindowAgg:
+			{
+				Plan	   *outer = outerPlan(plan);
+
+				/* the tuplestore holds a partition; assume the worst */
+				bytes = outer->plan_rows * (MAXALIGN(outer->plan_width) +
+											MAXALIGN(SizeofMinimalTupleHeader));
+				default_limit = work_mem;
+			}
+			break;
+
+		case T_RecursiveUnion:
+			/* working and intermediate tables, each with the node's limit */
+			bytes = plan->plan_rows * tuplesize;
+			default_limit = work_mem;
+			copies *= 2;
+			break;
+
+		case T_CteScan:
+
+			/*
+			 * The CTE's tuplestore is created with the limit of whichever
+			 * CteScan is initialized first.  We can't tell which one that is,
+			 * so all of them are counted, which errs on the safe side.
+			 */
+			bytes = plan->plan_rows * tuplesize;
+			default_limit = work_mem;
+			break;
+
+		case T_Hash:
+			{
+				Hash	   *hash = (Hash *) plan;
+				Plan	   *inner = outerPlan(plan);
+				double		rows;
+
+				rows = plan->parallel_aware ? hash->rows_total : inner->plan_rows;
+				bytes = rows * (HJTUPLE_OVERHEAD +
+								MAXALIGN(SizeofMinimalTupleHeader) +
+								MAXALIGN(inner->plan_width) +
+								sizeof(HashJoinTuple));
+				default_limit = (int) (get_hash_memory_limit() / 1024);
+			}
+			break;
+
+		case T_Agg:
+			{
+				Agg		   *agg = (Agg *) plan;
+
+				/* only hash aggregation spills according to hash_mem */
+				if (agg->aggstrategy != AGG_HASHED &&
+					agg->aggstrategy != AGG_MIXED)
+					return NULL;
+
+				bytes = (double) agg->numGroups *
+					hash_agg_entry_size(0, outerPlan(plan)->plan_width,
+										agg->transitionSpace);
+				default_limit = (int) (get_hash_memory_limit() / 1024);
+			}
+			break;
+
+		case T_Memoize:
+			{
+				Memoize    *mplan = (Memoize *) plan;
+
+				/* each cache entry holds the tuples for one parameter value */
+				bytes = (double) mplan->est_entries *
+					(Max(plan->plan_rows, 1.0) * tuplesize + 64);
+				default_limit = (int) (get_hash_memory_limit() / 1024);
+			}
+			break;
+
+		default:
+			return NULL;
+	}
+
+	item = palloc_object(WorkMemNode);
+	item->plan = plan;
+	item->copies = copies;
+	item->default_limit = Max(default_limit, MIN_NODE_WORK_MEM);
+	item->need = Min(bytes / 1024.0, (double) item->default_limit);
+	item->need = Max(item->need, MIN_NODE_WORK_MEM);
+
+	return item;
+}
+
+/*
+ * qsort comparator for WorkMemNodes, ordering by increasing need.
+ */
+static int
+workmem_node_cmp(const void *a, const void *b)
+{
+	const WorkMemNode *na = (const WorkMemNode *) a;
+	const WorkMemNode *nb = (const WorkMemNode *) b;
+
+	if (na->need < nb->need)
+		return -1;
+	if (na->need > nb->need)
+		return 1;
+	return 0;
+}
@@ -2722,6 +2722,44 @@ create_hashjoin_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_adaptivejoin_path
+ *	  Creates a pathnode corresponding to an adaptive join, which starts
+ *	  out as a nestloop join and may turn into a hash join.
+ *
+ * 'nlpath' is the nestloop path to start out as; its inner path must be
+ *		parameterized by its outer relation
+ * 'hashpath' is the hash join path to turn into, with the same outer path
+ *		and an unparameterized inner path for the same relation
+ *
+ * The result has the rows, costs and pathkeys of 'nlpath': it never
+ * reorders the outer rows, and is only worth having when the nestloop is
+ * expected to win.  See final_cost_adaptivejoin.
+ */
+AdaptiveJoinPath *
+create_adaptivejoin_path(PlannerInfo *root,
+						 NestPath *nlpath,
+						 HashPath *hashpath)
+{
+	AdaptiveJoinPath *pathnode = makeNode(AdaptiveJoinPath);
+
+	Assert(nlpath->jpath.outerjoinpath == hashpath->jpath.outerjoinpath);
+	Assert(nlpath->jpath.jointype == hashpath->jpath.jointype);
+
+	pathnode->jpath = nlpath->jpath;
+	pathnode->jpath.path.type = T_AdaptiveJoinPath;
+	pathnode->jpath.path.pathtype = T_AdaptiveJoin;
+	pathnode->jpath.path.parallel_safe = nlpath->jpath.path.parallel_safe &&
+		hashpath->jpath.path.parallel_safe;
+	pathnode->hashinnerpath = hashpath->jpath.innerjoinpath;
+	pathnode->path_hashclauses = hashpath->path_hashclauses;
+	pathnode->hash_restrictinfo = hashpath->jpath.joinrestrictinfo;
+
+	final_cost_adaptivejoin(root, pathnode, hashpath);
+
+	return pathnode;
+}
+
 /*
  * create_projection_path
  *	  Creates a pathnode that represents performing a projection.
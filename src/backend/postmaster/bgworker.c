@@ -123,6 +123,9 @@ static const struct
 	{
 		"ParallelWorkerMain", ParallelWorkerMain
 	},
+	{
+		"ParallelWorkerPrestartMain", ParallelWorkerPrestartMain
+	},
 	{
 		"ApplyLauncherMain", ApplyLauncherMain
 	},
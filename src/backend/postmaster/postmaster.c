@@ -97,6 +97,7 @@
 #include "common/ip.h"
 #include "common/pg_prng.h"
 #include "common/string.h"
+#include "executor/instrument.h"
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -121,6 +122,7 @@
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
+#include "storage/shm_prefault.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/datetime.h"
@@ -145,7 +147,8 @@
 #define BACKEND_TYPE_AUTOVAC	0x0002	/* autovacuum worker process */
 #define BACKEND_TYPE_WALSND		0x0004	/* walsender process */
 #define BACKEND_TYPE_BGWORKER	0x0008	/* bgworker process */
-#define BACKEND_TYPE_ALL		0x000F	/* OR of all the above */
+#define BACKEND_TYPE_POOL		0x0010	/* idle pre-forked backend */
+#define BACKEND_TYPE_ALL		0x001F	/* OR of all the above */
 
 /*
  * List of active backends (or child processes anyway; we don't actually
@@ -161,6 +164,12 @@
  * must be done before any operation that needs to distinguish walsenders
  * from normal backends.)
  *
+ * Idle pre-forked backends (see backend_pool_size) are in it too, labeled
+ * BACKEND_TYPE_POOL, until they are handed a connection; at that point we
+ * relabel them BACKEND_TYPE_NORMAL, as if they had just been forked for it.
+ * While idle, pool_sock is our end of the socket over which the connection
+ * will be passed.
+ *
  * Also, "dead_end" children are in it: these are children launched just for
  * the purpose of sending a friendly rejection message to a would-be client.
  * We must track them because they are attached to shared memory, but we know
@@ -181,6 +190,8 @@ typedef struct bkend
 	int			bkend_type;		/* child process flavor, see above */
 	bool		dead_end;		/* is it going to send an error and quit? */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	pgsocket	pool_sock;		/* socket to an idle pooled backend, or
+								 * PGINVALID_SOCKET */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
@@ -234,6 +245,8 @@ bool		EnableSSL = false;
 int			PreAuthDelay = 0;
 int			AuthenticationTimeout = 60;
 
+int			backend_pool_size = 0;
+
 bool		log_hostname;		/* for ps display and logging */
 bool		Log_connections = false;
 bool		Db_user_namespace = false;
@@ -371,6 +384,12 @@ static bool WalReceiverRequested = false;
 static bool StartWorkerNeeded = true;
 static bool HaveCrashedWorker = false;
 
+/* Number of idle pooled backends we could hand a connection to */
+static int	NumIdlePooledBackends = 0;
+
+/* set while the pool is below backend_pool_size and being topped up */
+static bool BackendPoolRefillPending = false;
+
 /* set when signals arrive */
 static volatile sig_atomic_t pending_pm_pmsignal;
 static volatile sig_atomic_t pending_pm_child_exit;
@@ -426,6 +445,15 @@ static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
 static void processCancelRequest(Port *port, void *pkt);
 static void report_fork_failure_to_client(Port *port, int errnum);
+#ifndef EXEC_BACKEND
+static bool StartPooledBackend(void);
+static void PooledBackendMain(pgsocket pool_sock) pg_attribute_noreturn();
+static void PooledBackendDie(SIGNAL_ARGS);
+static bool HandOffToPooledBackend(Port *port);
+static void MaintainBackendPool(void);
+#endif
+static void DetachPooledBackend(Backend *bp);
+static void DrainBackendPool(void);
 static CAC_state canAcceptConnections(int backend_type);
 static bool RandomCancelKey(int32 *cancel_key);
 static void signal_child(pid_t pid, int signal);
@@ -530,6 +558,10 @@ typedef struct
 	bool		query_id_enabled;
 	int			max_safe_fds;
 	int			MaxBackends;
+#ifdef PG_INSTR_TSC
+	bool		pg_instr_use_tsc;
+	double		pg_instr_tsc_ns_per_tick;
+#endif
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -1002,6 +1034,12 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/*
+	 * Choose the clock for instrumentation before anything can take a
+	 * reading; children inherit the choice and its calibration.
+	 */
+	InstrInitTiming();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1615,6 +1653,10 @@ DetermineSleepTime(void)
 {
 	TimestampTz next_wakeup = 0;
 
+	/* Come straight back if the pool of pre-forked backends isn't full */
+	if (BackendPoolRefillPending && Shutdown == NoShutdown)
+		return 0;
+
 	/*
 	 * Normal case: either there are no background workers at all, or we're in
 	 * a shutdown sequence (during which we ignore bgworkers altogether).
@@ -1854,6 +1896,11 @@ ServerLoop(void)
 		if (StartWorkerNeeded || HaveCrashedWorker)
 			maybe_start_bgworkers();
 
+#ifndef EXEC_BACKEND
+		/* Top up the pool of pre-forked backends */
+		MaintainBackendPool();
+#endif
+
 #ifdef HAVE_PTHREAD_IS_THREADED_NP
 
 		/*
@@ -2603,6 +2650,26 @@ ClosePostmasterPorts(bool am_syslogger)
 	ReleaseExternalFD();
 #endif
 
+	/*
+	 * Close the postmaster's ends of the sockets to idle pooled backends, so
+	 * that each of those sees end-of-file as soon as the postmaster closes
+	 * its own copy.  These aren't tracked by fd.c either.
+	 */
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			if (bp->pool_sock != PGINVALID_SOCKET)
+			{
+				closesocket(bp->pool_sock);
+				bp->pool_sock = PGINVALID_SOCKET;
+			}
+		}
+	}
+
 	/*
 	 * Close the postmaster's listen sockets.  These aren't tracked by fd.c,
 	 * so we don't call ReleaseExternalFD() here.
@@ -2778,6 +2845,14 @@ process_pm_reload_request(void)
 		/* Update the starting-point file for future children */
 		write_nondefault_variables(PGC_SIGHUP);
 #endif
+
+		/*
+		 * Idle pooled backends were forked with the old configuration,
+		 * including the old authentication and SSL settings, which they
+		 * would only pick up again after authenticating the client.  Replace
+		 * them with fresh ones.
+		 */
+		DrainBackendPool();
 	}
 }
 
@@ -3258,6 +3333,10 @@ process_pm_child_exit(void)
 			continue;
 		}
 
+		/* Was it a shared memory prefault process? */
+		if (PrefaultChildExited(pid, exitstatus))
+			continue;
+
 		/* Was it one of our background workers? */
 		if (CleanupBackgroundWorker(pid, exitstatus))
 		{
@@ -3453,6 +3532,7 @@ CleanupBackend(int pid,
 				 */
 				BackgroundWorkerStopNotifications(bp->pid);
 			}
+			DetachPooledBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			break;
@@ -3546,6 +3626,7 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			DetachPooledBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			/* Keep looping so we can signal remaining backends */
@@ -4119,6 +4200,12 @@ BackendStartup(Port *port)
 	Backend    *bn;				/* for backend cleanup */
 	pid_t		pid;
 
+#ifndef EXEC_BACKEND
+	/* If an idle pooled backend is available, let it take the connection */
+	if (HandOffToPooledBackend(port))
+		return STATUS_OK;
+#endif
+
 	/*
 	 * Create backend data structure.  Better before the fork() so we can
 	 * handle failure cleanly.
@@ -4162,6 +4249,7 @@ BackendStartup(Port *port)
 
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
+	bn->pool_sock = PGINVALID_SOCKET;
 
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
@@ -4260,6 +4348,400 @@ report_fork_failure_to_client(Port *port, int errnum)
 	} while (rc < 0 && errno == EINTR);
 }
 
+#ifndef EXEC_BACKEND
+
+/*
+ * What the postmaster sends an idle pooled backend along with the client's
+ * socket: the parts of the Port that StreamConnection() filled in.
+ */
+typedef struct PooledConnection
+{
+	SockAddr	laddr;			/* local (server) address */
+	SockAddr	raddr;			/* remote (client) address */
+} PooledConnection;
+
+/*
+ * StartPooledBackend -- fork an idle backend for the pool
+ *
+ * The child does everything BackendStartup's child does before it looks at
+ * the connection, then waits for us to pass it an accepted socket (see
+ * HandOffToPooledBackend).  It can't get any further ahead than that, since
+ * the database and role aren't known until it has read the startup packet.
+ *
+ * Returns true if the child was started.
+ */
+static bool
+StartPooledBackend(void)
+{
+	Backend    *bn;
+	int			socks[2];
+	pid_t		pid;
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	/* As in BackendStartup, the cancel key is chosen before the fork */
+	if (!RandomCancelKey(&MyCancelKey))
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cancel key")));
+		return false;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) < 0)
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for pooled backend: %m")));
+		return false;
+	}
+
+	/* The postmaster must never block on a pooled backend */
+	if (!pg_set_noblock(socks[0]))
+	{
+		closesocket(socks[0]);
+		closesocket(socks[1]);
+		free(bn);
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		return false;
+	}
+
+	bn->cancel_key = MyCancelKey;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->dead_end = false;
+	bn->bgworker_notify = false;
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		free(bn);
+		closesocket(socks[0]);
+
+		/* Detangle from postmaster */
+		InitPostmasterChild();
+
+		/* Close the postmaster's sockets */
+		ClosePostmasterPorts(false);
+
+		/* Wait for a connection, and run the backend */
+		PooledBackendMain(socks[1]);
+	}
+
+	closesocket(socks[1]);
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		closesocket(socks[0]);
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		free(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork pooled backend process: %m")));
+		return false;
+	}
+
+	/* in parent, successful fork */
+	ereport(DEBUG2,
+			(errmsg_internal("forked new pooled backend, pid=%d", (int) pid)));
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_POOL;
+	bn->pool_sock = socks[0];
+	dlist_push_head(&BackendList, &bn->elem);
+	NumIdlePooledBackends++;
+
+	return true;
+}
+
+/*
+ * PooledBackendMain -- wait for a connection in an idle pooled backend
+ *
+ * Once the postmaster sends us a connection, we carry on exactly as the
+ * child forked by BackendStartup does.  If the postmaster closes its end of
+ * the socket instead, because it is draining the pool or because it has
+ * died, we just exit.
+ *
+ * Note that we don't know which database or role we will serve until
+ * BackendInitialize has read the startup packet, and we mustn't touch shared
+ * memory before that anyway (see BackendInitialize), so catalog caches and
+ * everything else InitPostgres sets up are still built after the connection
+ * arrives.  The pool saves the fork and the process setup that comes before
+ * that, no more.
+ */
+static void
+PooledBackendMain(pgsocket pool_sock)
+{
+	PooledConnection conn;
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+	pgsocket	sock = PGINVALID_SOCKET;
+	Port	   *port;
+	ssize_t		rc;
+
+	init_ps_display("pooled backend");
+
+	/*
+	 * While idle we have nothing to clean up, so SIGTERM can just make us
+	 * exit.  The other signals the postmaster sends its children are of no
+	 * interest to us yet, and mustn't be left pending for the backend we are
+	 * going to become, so ignore them.
+	 */
+	pqsignal(SIGTERM, PooledBackendDie);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGHUP, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, SIG_IGN);
+	sigprocmask(SIG_SETMASK, &UnBlockSig, NULL);
+
+	/*
+	 * Until a connection arrives, there's time to take the page faults that
+	 * a freshly forked backend would take on shared memory in its first
+	 * transactions.
+	 */
+	PrefaultPageTables();
+
+	memset(&conn, 0, sizeof(conn));
+	iov.iov_base = &conn;
+	iov.iov_len = sizeof(conn);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do
+	{
+		rc = recvmsg(pool_sock, &msg, MSG_WAITALL);
+	} while (rc < 0 && errno == EINTR);
+
+	/* BackendInitialize expects to start out with signals blocked */
+	sigprocmask(SIG_SETMASK, &BlockSig, NULL);
+
+	if (rc == 0)
+		_exit(0);
+	if (rc < 0)
+		elog(FATAL, "could not receive connection from postmaster: %m");
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+			cmsg->cmsg_type == SCM_RIGHTS &&
+			cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+			memcpy(&sock, CMSG_DATA(cmsg), sizeof(int));
+	}
+	if (rc != sizeof(conn) || sock == PGINVALID_SOCKET)
+		elog(FATAL, "received invalid connection from postmaster");
+
+	closesocket(pool_sock);
+
+	/* Build the Port as ConnCreate would have */
+	if (!(port = (Port *) calloc(1, sizeof(Port))))
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+	port->sock = sock;
+	port->laddr = conn.laddr;
+	port->raddr = conn.raddr;
+	port->canAcceptConnections = CAC_OK;
+
+	/* As far as anyone can tell, this backend starts now */
+	InitProcessGlobals();
+
+	/* From here on, this is the same as in BackendStartup */
+	BackendInitialize(port);
+	InitProcess();
+	BackendRun(port);
+}
+
+/*
+ * SIGTERM handler for idle pooled backends.
+ */
+static void
+PooledBackendDie(SIGNAL_ARGS)
+{
+	_exit(0);
+}
+
+/*
+ * HandOffToPooledBackend -- pass a new connection to an idle pooled backend
+ *
+ * Returns true if a pooled backend took the connection; it is an ordinary
+ * backend from then on, and the caller need only close its copy of the
+ * socket.  Returns false if no pooled backend was available, or passing the
+ * connection to it failed, in which case the caller should fork a new
+ * backend as usual.
+ */
+static bool
+HandOffToPooledBackend(Port *port)
+{
+	dlist_iter	iter;
+
+	/*
+	 * Let BackendStartup deal with connections we can't accept; it knows
+	 * how to tell the client why.
+	 */
+	if (NumIdlePooledBackends == 0 ||
+		canAcceptConnections(BACKEND_TYPE_NORMAL) != CAC_OK)
+		return false;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+		PooledConnection conn;
+		struct msghdr msg;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr hdr;
+			char		buf[CMSG_SPACE(sizeof(int))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		ssize_t		rc;
+
+		if (bp->pool_sock == PGINVALID_SOCKET)
+			continue;
+
+		memset(&conn, 0, sizeof(conn));
+		conn.laddr = port->laddr;
+		conn.raddr = port->raddr;
+		iov.iov_base = &conn;
+		iov.iov_len = sizeof(conn);
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+		msg.msg_control = cmsgbuf.buf;
+		msg.msg_controllen = sizeof(cmsgbuf.buf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &port->sock, sizeof(int));
+
+		do
+		{
+			rc = sendmsg(bp->pool_sock, &msg, 0);
+		} while (rc < 0 && errno == EINTR);
+
+		/* Whatever happened, the child isn't idle in the pool anymore */
+		DetachPooledBackend(bp);
+
+		if (rc != sizeof(conn))
+		{
+			/* The child has presumably died; it'll be reaped as usual */
+			ereport(LOG,
+					(errmsg("could not pass connection to pooled backend process %d: %m",
+							(int) bp->pid)));
+			return false;
+		}
+
+		ereport(DEBUG2,
+				(errmsg_internal("passed connection to pooled backend, pid=%d socket=%d",
+								 (int) bp->pid, (int) port->sock)));
+
+		bp->bkend_type = BACKEND_TYPE_NORMAL;	/* Can change later to WALSND */
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * MaintainBackendPool -- keep backend_pool_size idle pooled backends around
+ *
+ * We only start new ones while normal connections are being accepted.  The
+ * pool never exceeds max_connections, since more pooled backends than could
+ * ever be used at once would just waste child slots.
+ *
+ * At most one backend is forked per call, so that topping up a large pool
+ * doesn't keep ServerLoop from accepting connections; DetermineSleepTime
+ * brings us straight back here until the pool is full.  If a fork fails, we
+ * try again next time around the loop, without hurrying.
+ */
+static void
+MaintainBackendPool(void)
+{
+	int			target = Min(backend_pool_size, MaxConnections);
+
+	/* Shrink the pool, if backend_pool_size has been lowered */
+	if (NumIdlePooledBackends > target)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			if (NumIdlePooledBackends <= target)
+				break;
+			DetachPooledBackend(bp);
+		}
+	}
+
+	BackendPoolRefillPending = false;
+	if (NumIdlePooledBackends < target &&
+		canAcceptConnections(BACKEND_TYPE_NORMAL) == CAC_OK &&
+		StartPooledBackend())
+		BackendPoolRefillPending = (NumIdlePooledBackends < target);
+}
+
+#endif							/* !EXEC_BACKEND */
+
+/*
+ * DetachPooledBackend -- forget that a child is an idle pooled backend
+ *
+ * We close our end of its socket, which makes the child exit unless we have
+ * just passed it a connection.  This is a no-op for other children.
+ */
+static void
+DetachPooledBackend(Backend *bp)
+{
+	if (bp->pool_sock == PGINVALID_SOCKET)
+		return;
+
+	closesocket(bp->pool_sock);
+	bp->pool_sock = PGINVALID_SOCKET;
+	NumIdlePooledBackends--;
+}
+
+/*
+ * DrainBackendPool -- make all idle pooled backends exit
+ *
+ * The ServerLoop replaces them with new ones.
+ */
+static void
+DrainBackendPool(void)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+		DetachPooledBackend(bp);
+	}
+}
+
 
 /*
  * BackendInitialize -- initialize an interactive (postmaster-child)
@@ -5474,6 +5956,7 @@ StartAutovacuumWorker(void)
 			bn->dead_end = false;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 			bn->bgworker_notify = false;
+			bn->pool_sock = PGINVALID_SOCKET;
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
@@ -5877,6 +6360,7 @@ assign_backendlist_entry(RegisteredBgWorker *rw)
 	bn->bkend_type = BACKEND_TYPE_BGWORKER;
 	bn->dead_end = false;
 	bn->bgworker_notify = false;
+	bn->pool_sock = PGINVALID_SOCKET;
 
 	rw->rw_backend = bn;
 	rw->rw_child_slot = bn->child_slot;
@@ -6109,6 +6593,10 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+#ifdef PG_INSTR_TSC
+	param->pg_instr_use_tsc = pg_instr_use_tsc;
+	param->pg_instr_tsc_ns_per_tick = pg_instr_tsc_ns_per_tick;
+#endif
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6342,6 +6830,10 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+#ifdef PG_INSTR_TSC
+	pg_instr_use_tsc = param->pg_instr_use_tsc;
+	pg_instr_tsc_ns_per_tick = param->pg_instr_tsc_ns_per_tick;
+#endif
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
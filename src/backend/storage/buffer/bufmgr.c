@@ -1123,8 +1123,9 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 		smgrread(smgr, forkNum, blockNum, bufBlock);
 
-		pgstat_count_io_op_time(io_object, io_context,
-								IOOP_READ, io_start, 1);
+		pgstat_count_io_op_time_rel(io_object, io_context,
+									IOOP_READ, io_start, 1,
+									&smgr->smgr_rlocator.locator);
 
 		/* check for garbage data */
 		if (!PageIsVerifiedExtended((Page) bufBlock, blockNum,
@@ -2066,8 +2067,9 @@ ExtendBufferedRelShared(BufferManagerRelation bmr,
 	if (!(flags & EB_SKIP_EXTENSION_LOCK))
 		UnlockRelationForExtension(bmr.rel, ExclusiveLock);
 
-	pgstat_count_io_op_time(IOOBJECT_RELATION, io_context, IOOP_EXTEND,
-							io_start, extend_by);
+	pgstat_count_io_op_time_rel(IOOBJECT_RELATION, io_context, IOOP_EXTEND,
+								io_start, extend_by,
+								&bmr.smgr->smgr_rlocator.locator);
 
 	/* Set BM_VALID, terminate IO, and wake up any waiters */
 	for (int i = 0; i < extend_by; i++)
@@ -3456,8 +3458,9 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOObject io_object,
 	 * When a strategy is not in use, the write can only be a "regular" write
 	 * of a dirty shared buffer (IOCONTEXT_NORMAL IOOP_WRITE).
 	 */
-	pgstat_count_io_op_time(IOOBJECT_RELATION, io_context,
-							IOOP_WRITE, io_start, 1);
+	pgstat_count_io_op_time_rel(IOOBJECT_RELATION, io_context,
+								IOOP_WRITE, io_start, 1,
+								&reln->smgr_rlocator.locator);
 
 	pgBufferUsage.shared_blks_written++;
 
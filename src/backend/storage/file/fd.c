@@ -167,6 +167,9 @@ int			recovery_init_sync_method = RECOVERY_INIT_SYNC_METHOD_FSYNC;
 /* Which kinds of files should be opened with PG_O_DIRECT. */
 int			io_direct_flags;
 
+/* Hook for observing file reads and writes */
+file_io_hook_type file_io_hook = NULL;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -2138,6 +2141,8 @@ retry:
 		if (errno == EINTR)
 			goto retry;
 	}
+	else if (file_io_hook && returnCode > 0)
+		(*file_io_hook) (file, buffer, returnCode, false);
 
 	return returnCode;
 }
@@ -2187,6 +2192,9 @@ FileWrite(File file, const void *buffer, size_t amount, off_t offset,
 		}
 	}
 
+	if (file_io_hook)
+		(*file_io_hook) (file, buffer, amount, true);
+
 retry:
 	errno = 0;
 	pgstat_report_wait_start(wait_event_info);
@@ -34,6 +34,7 @@
 #include <sys/stat.h>
 
 #include "common/pg_prng.h"
+#include "funcapi.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
@@ -41,6 +42,7 @@
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/pg_shmem.h"
+#include "utils/builtins.h"
 #include "utils/freepage.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -83,6 +85,8 @@ typedef struct dsm_control_item
 	size_t		npages;
 	void	   *impl_private_pm_handle; /* only needed on Windows */
 	bool		pinned;
+	size_t		size;			/* size of the creator's mapping */
+	size_t		huge_page_bytes;	/* bytes backed by huge pages */
 } dsm_control_item;
 
 /* Layout of the dynamic shared memory control segment. */
@@ -495,6 +499,7 @@ dsm_create(Size size, int flags)
 	size_t		first_page = 0;
 	FreePageManager *dsm_main_space_fpm = dsm_main_space_begin;
 	bool		using_main_dsm_region = false;
+	Size		huge_page_bytes = 0;
 
 	/*
 	 * Unsafe in postmaster. It might seem pointless to allow use of dsm in
@@ -550,6 +555,13 @@ dsm_create(Size size, int flags)
 							&seg->mapped_address, &seg->mapped_size, ERROR))
 				break;
 		}
+
+		/* Account for any huge pages the segment got. */
+		if (dsm_impl_huge_page_size() != 0 &&
+			seg->mapped_size >= dsm_impl_huge_page_size())
+			huge_page_bytes = dsm_impl_huge_pages_mapped(seg->mapped_address,
+														 seg->mapped_size);
+
 		LWLockAcquire(DynamicSharedMemoryControlLock, LW_EXCLUSIVE);
 	}
 
@@ -572,6 +584,8 @@ dsm_create(Size size, int flags)
 			dsm_control->item[i].refcnt = 2;
 			dsm_control->item[i].impl_private_pm_handle = NULL;
 			dsm_control->item[i].pinned = false;
+			dsm_control->item[i].size = seg->mapped_size;
+			dsm_control->item[i].huge_page_bytes = huge_page_bytes;
 			seg->control_slot = i;
 			LWLockRelease(DynamicSharedMemoryControlLock);
 			return seg;
@@ -611,6 +625,8 @@ dsm_create(Size size, int flags)
 	dsm_control->item[nitems].refcnt = 2;
 	dsm_control->item[nitems].impl_private_pm_handle = NULL;
 	dsm_control->item[nitems].pinned = false;
+	dsm_control->item[nitems].size = seg->mapped_size;
+	dsm_control->item[nitems].huge_page_bytes = huge_page_bytes;
 	seg->control_slot = nitems;
 	dsm_control->nitems++;
 	LWLockRelease(DynamicSharedMemoryControlLock);
@@ -1167,6 +1183,48 @@ reset_on_dsm_detach(void)
 	}
 }
 
+/*
+ * SQL SRF showing the dynamic shared memory segments in use, and how much of
+ * each the kernel backed with huge pages when it was created.
+ */
+Datum
+pg_get_dsm_segments(PG_FUNCTION_ARGS)
+{
+#define PG_GET_DSM_SEGMENTS_COLS 4
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[PG_GET_DSM_SEGMENTS_COLS];
+	bool		nulls[PG_GET_DSM_SEGMENTS_COLS];
+	uint32		i;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (!dsm_init_done)
+		dsm_backend_startup();
+
+	memset(nulls, 0, sizeof(nulls));
+
+	LWLockAcquire(DynamicSharedMemoryControlLock, LW_SHARED);
+	for (i = 0; i < dsm_control->nitems; ++i)
+	{
+		dsm_control_item *item = &dsm_control->item[i];
+
+		/* Skip unused and moribund slots. */
+		if (item->refcnt < 2)
+			continue;
+
+		values[0] = Int64GetDatum(item->handle);
+		values[1] = Int64GetDatum(item->size);
+		values[2] = Int64GetDatum(item->huge_page_bytes);
+		values[3] = BoolGetDatum(item->pinned);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+	LWLockRelease(DynamicSharedMemoryControlLock);
+
+	return (Datum) 0;
+}
+
 /*
  * Create a segment descriptor.
  */
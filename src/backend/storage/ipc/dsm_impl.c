@@ -66,15 +66,29 @@
 #include "postmaster/postmaster.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
+#include "storage/pg_shmem.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 
+/* Implementations that can back segments with huge pages. */
+#if defined(USE_DSM_POSIX) && defined(__linux__) && \
+	defined(MADV_HUGEPAGE) && defined(MADV_POPULATE_WRITE)
+#define DSM_POSIX_HUGE_PAGES
+#endif
+#if defined(USE_DSM_SYSV) && defined(SHM_HUGETLB)
+#define DSM_SYSV_HUGE_PAGES
+#endif
+
 #ifdef USE_DSM_POSIX
 static bool dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 						   void **impl_private, void **mapped_address,
 						   Size *mapped_size, int elevel);
 static int	dsm_impl_posix_resize(int fd, off_t size);
 #endif
+#ifdef DSM_POSIX_HUGE_PAGES
+static bool dsm_impl_posix_huge(int fd, char *address, Size size,
+								const char *name, int elevel);
+#endif
 #ifdef USE_DSM_SYSV
 static bool dsm_impl_sysv(dsm_op op, dsm_handle handle, Size request_size,
 						  void **impl_private, void **mapped_address,
@@ -114,6 +128,9 @@ int			dynamic_shared_memory_type = DEFAULT_DYNAMIC_SHARED_MEMORY_TYPE;
 /* Amount of space reserved for DSM segments in the main area. */
 int			min_dynamic_shared_memory;
 
+/* Use of huge pages for segments created by the implementation. */
+int			dynamic_shared_memory_huge_pages = HUGE_PAGES_OFF;
+
 /* Size of buffer to be used for zero-filling. */
 #define ZBUFFER_SIZE				8192
 
@@ -193,6 +210,94 @@ dsm_impl_op(dsm_op op, dsm_handle handle, Size request_size,
 	}
 }
 
+/*
+ * Return the huge page size with which the configured implementation backs
+ * segments, or 0 if it will not use huge pages.  Only segments at least this
+ * large are backed by huge pages, so callers that can choose their segment
+ * sizes may want to round them up to a multiple of it.
+ */
+Size
+dsm_impl_huge_page_size(void)
+{
+#if defined(DSM_POSIX_HUGE_PAGES) || defined(DSM_SYSV_HUGE_PAGES)
+	static Size hugepagesize = 0;
+
+	if (dynamic_shared_memory_huge_pages == HUGE_PAGES_OFF)
+		return 0;
+
+	switch (dynamic_shared_memory_type)
+	{
+#ifdef DSM_POSIX_HUGE_PAGES
+		case DSM_IMPL_POSIX:
+			break;
+#endif
+#ifdef DSM_SYSV_HUGE_PAGES
+		case DSM_IMPL_SYSV:
+			break;
+#endif
+		default:
+			return 0;
+	}
+
+	/* GetHugePageSize() reads /proc/meminfo, so remember the answer. */
+	if (hugepagesize == 0)
+		GetHugePageSize(&hugepagesize, NULL);
+
+	return hugepagesize;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Return the number of bytes of a segment mapped at the given address that
+ * are backed by huge pages, as far as this process's mapping shows.  On
+ * Linux, /proc/self/smaps reports transparent huge pages of a shared memory
+ * file mapped as such under ShmemPmdMapped, and SHM_HUGETLB memory under
+ * Shared_Hugetlb and Private_Hugetlb.  Elsewhere, and if the file can't be
+ * read, this returns 0.
+ */
+Size
+dsm_impl_huge_pages_mapped(void *address, Size size)
+{
+	Size		huge = 0;
+#if defined(DSM_POSIX_HUGE_PAGES) || defined(DSM_SYSV_HUGE_PAGES)
+	FILE	   *file;
+	char		buf[MAXPGPATH + 128];
+	uintptr_t	begin = (uintptr_t) address;
+	bool		in_segment = false;
+
+	file = AllocateFile("/proc/self/smaps", "r");
+	if (file == NULL)
+		return 0;
+
+	while (fgets(buf, sizeof(buf), file))
+	{
+		unsigned long start;
+		unsigned long end;
+		unsigned long kb;
+
+		/* Each mapping starts with a line giving its address range. */
+		if (sscanf(buf, "%lx-%lx ", &start, &end) == 2)
+		{
+			in_segment = start >= begin && end <= begin + size;
+			continue;
+		}
+		if (!in_segment)
+			continue;
+
+		if (sscanf(buf, "ShmemPmdMapped: %lu kB", &kb) == 1 ||
+			sscanf(buf, "Shared_Hugetlb: %lu kB", &kb) == 1 ||
+			sscanf(buf, "Private_Hugetlb: %lu kB", &kb) == 1)
+			huge += (Size) kb * 1024;
+	}
+
+	FreeFile(file);
+#endif
+
+	return huge;
+}
+
 #ifdef USE_DSM_POSIX
 /*
  * Operating system primitives to support POSIX shared memory.
@@ -217,6 +322,7 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 	int			flags;
 	int			fd;
 	char	   *address;
+	Size		hugepagesize = 0;
 
 	snprintf(name, 64, "/PostgreSQL.%u", handle);
 
@@ -293,22 +399,47 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 		}
 		request_size = st.st_size;
 	}
-	else if (dsm_impl_posix_resize(fd, request_size) != 0)
+	else
 	{
-		int			save_errno;
+		int			rc;
 
-		/* Back out what's already been done. */
-		save_errno = errno;
-		close(fd);
-		ReleaseExternalFD();
-		shm_unlink(name);
-		errno = save_errno;
+#ifdef DSM_POSIX_HUGE_PAGES
+		hugepagesize = dsm_impl_huge_page_size();
+		if (hugepagesize != 0 && request_size < hugepagesize)
+			hugepagesize = 0;
+#endif
 
-		ereport(elevel,
-				(errcode_for_dynamic_shared_memory(),
-				 errmsg("could not resize shared memory segment \"%s\" to %zu bytes: %m",
-						name, request_size)));
-		return false;
+		/*
+		 * Memory for a segment backed by huge pages is allocated only after
+		 * it is mapped; see dsm_impl_posix_huge().
+		 */
+		if (hugepagesize != 0)
+		{
+			do
+			{
+				rc = ftruncate(fd, request_size);
+			} while (rc < 0 && errno == EINTR);
+		}
+		else
+			rc = dsm_impl_posix_resize(fd, request_size);
+
+		if (rc != 0)
+		{
+			int			save_errno;
+
+			/* Back out what's already been done. */
+			save_errno = errno;
+			close(fd);
+			ReleaseExternalFD();
+			shm_unlink(name);
+			errno = save_errno;
+
+			ereport(elevel,
+					(errcode_for_dynamic_shared_memory(),
+					 errmsg("could not resize shared memory segment \"%s\" to %zu bytes: %m",
+							name, request_size)));
+			return false;
+		}
 	}
 
 	/* Map it. */
@@ -332,6 +463,18 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 						name)));
 		return false;
 	}
+#ifdef DSM_POSIX_HUGE_PAGES
+	if (hugepagesize != 0 &&
+		!dsm_impl_posix_huge(fd, address, request_size, name, elevel))
+	{
+		/* Back out what's already been done; the error has been reported. */
+		munmap(address, request_size);
+		close(fd);
+		ReleaseExternalFD();
+		shm_unlink(name);
+		return false;
+	}
+#endif
 	*mapped_address = address;
 	*mapped_size = request_size;
 	close(fd);
@@ -340,6 +483,80 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 	return true;
 }
 
+#ifdef DSM_POSIX_HUGE_PAGES
+/*
+ * Allocate the memory of a newly created and mapped segment, using huge pages
+ * if possible.
+ *
+ * tmpfs chooses the page size when it allocates a page, and with the usual
+ * shmem_enabled=advise setting it only chooses huge pages for faults through
+ * a mapping advised with MADV_HUGEPAGE.  posix_fallocate() has no mapping,
+ * so we advise ours and allocate the memory by prefaulting it instead, which
+ * still lets us fail gracefully if tmpfs runs out of space.  If that doesn't
+ * work and huge pages are not required, fall back to the usual allocation.
+ * Succeeding doesn't mean tmpfs used huge pages, though (shmem_enabled may be
+ * "never"), so if they are required, also check that it did.
+ *
+ * Returns false if the segment's memory could not be allocated, after
+ * logging a message at elevel.
+ */
+static bool
+dsm_impl_posix_huge(int fd, char *address, Size size, const char *name,
+					int elevel)
+{
+	int			rc;
+
+	pgstat_report_wait_start(WAIT_EVENT_DSM_ALLOCATE);
+	rc = madvise(address, size, MADV_HUGEPAGE);
+	if (rc == 0)
+		rc = madvise(address, size, MADV_POPULATE_WRITE);
+	pgstat_report_wait_end();
+
+	/*
+	 * The advice is only a request.  If huge pages are required, check that
+	 * the kernel honored it for at least part of the segment.
+	 */
+	if (rc == 0)
+	{
+		if (dynamic_shared_memory_huge_pages == HUGE_PAGES_ON &&
+			dsm_impl_huge_pages_mapped(address, size) == 0)
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("could not back shared memory segment \"%s\" with huge pages",
+							name),
+					 errhint("Check that transparent huge pages are enabled for shared memory, or set \"dynamic_shared_memory_huge_pages\" to \"try\" or \"off\".")));
+			return false;
+		}
+		return true;
+	}
+
+	if (dynamic_shared_memory_huge_pages == HUGE_PAGES_ON)
+	{
+		ereport(elevel,
+				(errcode_for_dynamic_shared_memory(),
+				 errmsg("could not allocate shared memory segment \"%s\" with huge pages: %m",
+						name),
+				 errhint("Check that transparent huge pages are enabled for shared memory, or set \"dynamic_shared_memory_huge_pages\" to \"try\" or \"off\".")));
+		return false;
+	}
+
+	elog(DEBUG1, "could not allocate shared memory segment \"%s\" with huge pages: %m",
+		 name);
+
+	if (dsm_impl_posix_resize(fd, size) != 0)
+	{
+		ereport(elevel,
+				(errcode_for_dynamic_shared_memory(),
+				 errmsg("could not resize shared memory segment \"%s\" to %zu bytes: %m",
+						name, size)));
+		return false;
+	}
+
+	return true;
+}
+#endif							/* DSM_POSIX_HUGE_PAGES */
+
 /*
  * Set the size of a virtual memory region associated with a file descriptor.
  * If necessary, also ensure that virtual memory is actually allocated by the
@@ -506,7 +723,35 @@ dsm_impl_sysv(dsm_op op, dsm_handle handle, Size request_size,
 			segsize = request_size;
 		}
 
-		if ((ident = shmget(key, segsize, flags)) == -1)
+#ifdef DSM_SYSV_HUGE_PAGES
+		if (op == DSM_OP_CREATE)
+		{
+			Size		hugepagesize = dsm_impl_huge_page_size();
+
+			/*
+			 * The kernel rounds a huge page segment up to a whole number of
+			 * huge pages.  If none are free, fall back to ordinary pages
+			 * unless huge pages are required.
+			 */
+			if (hugepagesize != 0 && request_size >= hugepagesize)
+			{
+				ident = shmget(key, segsize, flags | SHM_HUGETLB);
+				if (ident == -1 && errno != EEXIST &&
+					dynamic_shared_memory_huge_pages == HUGE_PAGES_TRY)
+				{
+					elog(DEBUG1, "could not create shared memory segment \"%s\" with huge pages: %m",
+						 name);
+					ident = shmget(key, segsize, flags);
+				}
+			}
+			else
+				ident = shmget(key, segsize, flags);
+		}
+		else
+#endif
+			ident = shmget(key, segsize, flags);
+
+		if (ident == -1)
 		{
 			if (op == DSM_OP_ATTACH || errno != EEXIST)
 			{
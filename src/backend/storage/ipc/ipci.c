@@ -45,9 +45,12 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
+#include "storage/shm_prefault.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
 #include "utils/guc.h"
+#include "utils/membroker.h"
+#include "utils/sharedcatcache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -141,6 +144,8 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, BTreeShmemSize());
 	size = add_size(size, SyncScanShmemSize());
 	size = add_size(size, AsyncShmemSize());
+	size = add_size(size, MemoryBrokerShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
 	size = add_size(size, StatsShmemSize());
 #ifdef EXEC_BACKEND
 	size = add_size(size, ShmemBackendArraySize());
@@ -192,6 +197,13 @@ CreateSharedMemoryAndSemaphores(void)
 
 		InitShmemAccess(seghdr);
 
+		/*
+		 * Fault in the segment ahead of time, if requested.  Only the
+		 * postmaster does this; a standalone backend has no use for it.
+		 */
+		if (IsPostmasterEnvironment)
+			PrefaultSharedMemory(seghdr, seghdr->totalsize);
+
 		/*
 		 * Create semaphores
 		 */
@@ -293,6 +305,8 @@ CreateSharedMemoryAndSemaphores(void)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	MemoryBrokerShmemInit();
+	SharedCatCacheShmemInit();
 	StatsShmemInit();
 
 #ifdef EXEC_BACKEND
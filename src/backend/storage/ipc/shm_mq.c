@@ -169,6 +169,9 @@ static void shm_mq_detach_callback(dsm_segment *seg, Datum arg);
 const Size	shm_mq_minimum_size =
 MAXALIGN(offsetof(shm_mq, mq_ring)) + MAXIMUM_ALIGNOF;
 
+/* Hook for observing sends */
+shm_mq_send_hook_type shm_mq_send_hook = NULL;
+
 #define MQH_INITIAL_BUFSIZE				8192
 
 /*
@@ -384,6 +387,14 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait,
 				 errmsg("cannot send a message of size %zu via shared memory queue",
 						nbytes)));
 
+	/*
+	 * Call the hook once per message, not again when a nonblocking send
+	 * resumes writing one that's partly written.
+	 */
+	if (shm_mq_send_hook && !mqh->mqh_length_word_complete &&
+		mqh->mqh_partial_bytes == 0)
+		(*shm_mq_send_hook) (mqh, nbytes);
+
 	/* Try to write, or finish writing, the length word into the buffer. */
 	while (!mqh->mqh_length_word_complete)
 	{
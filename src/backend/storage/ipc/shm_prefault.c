@@ -0,0 +1,390 @@
+/*-------------------------------------------------------------------------
+ *
+ * shm_prefault.c
+ *	  Pre-touch the main shared memory segment at postmaster startup.
+ *
+ * The main shared memory segment is normally faulted in lazily, one page at
+ * a time, by whichever process first touches it.  On large machines, and
+ * especially on virtual machines where the hypervisor has to accept and
+ * zero each page on first use, that cost ends up being paid in the query
+ * path for a long time after every restart.
+ *
+ * When shared_memory_prefault_workers is set, the postmaster forks that many
+ * short-lived helper processes right after the segment has been created.
+ * Each helper faults in a disjoint slice of the segment, using
+ * MADV_POPULATE_WRITE where available and reading one byte per page
+ * otherwise.  Neither method changes the contents of the segment, so the
+ * helpers can safely keep running while the rest of startup (including
+ * recovery and the autoprewarm worker of pg_prewarm) proceeds, if
+ * shared_memory_prefault_background is enabled.  Otherwise the postmaster
+ * waits for the helpers to finish, reporting progress in the server log.
+ *
+ * PrefaultPageTables() does the per-process part of the same work, for
+ * backends forked ahead of time.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/ipc/shm_prefault.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+#include <unistd.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+#include "miscadmin.h"
+#include "portability/mem.h"
+#include "postmaster/fork_process.h"
+#include "storage/bufmgr.h"
+#include "storage/shm_prefault.h"
+#include "utils/ps_status.h"
+#include "utils/timestamp.h"
+
+/* GUC variables */
+int			shared_memory_prefault_workers = 0;
+bool		shared_memory_prefault_background = false;
+
+/*
+ * Unit of work of a helper.  Progress is published, and postmaster death
+ * checked, once per chunk.  Slices handed to helpers are aligned to this
+ * size, which is a multiple of any huge page size we might be using.
+ */
+#define PREFAULT_CHUNK_SIZE		((Size) 64 * 1024 * 1024)
+
+/* How often the postmaster reports progress while waiting, in ms */
+#define PREFAULT_PROGRESS_INTERVAL	10000
+
+/*
+ * Bytes done by each helper.  This lives in a small anonymous shared
+ * mapping so that the postmaster can see the helpers' progress; each slot is
+ * written by exactly one helper, so no locking is needed.
+ */
+typedef struct PrefaultProgress
+{
+	volatile Size done[MAX_SHMEM_PREFAULT_WORKERS];
+} PrefaultProgress;
+
+static PrefaultProgress *prefault_progress = NULL;
+
+/* Helpers still running in the background, for PrefaultChildExited() */
+static pid_t prefault_pids[MAX_SHMEM_PREFAULT_WORKERS];
+static int	prefault_nrunning = 0;
+static Size prefault_total_size;
+static int	prefault_nworkers;
+static TimestampTz prefault_start_time;
+
+/* The segment, remembered for PrefaultPageTables() in our children */
+static char *segment_base = NULL;
+static Size segment_size = 0;
+
+static void PrefaultRange(char *start, Size len, volatile Size *progress);
+static void PrefaultReport(bool finished);
+
+
+/*
+ * Fault in "len" bytes starting at "start", adding to *progress as we go.
+ *
+ * Reading one byte per page is enough to allocate the page for the shared
+ * mappings we use (shmem and hugetlbfs back even read faults with a real
+ * page), but MADV_POPULATE_WRITE does it without taking a fault per page and
+ * also sets up the page tables for writing.
+ */
+static void
+PrefaultRange(char *start, Size len, volatile Size *progress)
+{
+#ifndef WIN32
+	Size		pagesize = (Size) sysconf(_SC_PAGESIZE);
+#else
+	Size		pagesize = 4096;
+#endif
+
+	while (len > 0)
+	{
+		Size		chunk = Min(len, PREFAULT_CHUNK_SIZE);
+
+#ifdef MADV_POPULATE_WRITE
+		if (madvise(start, chunk, MADV_POPULATE_WRITE) != 0)
+#endif
+		{
+			for (Size off = 0; off < chunk; off += pagesize)
+				(void) *((volatile char *) start + off);
+		}
+
+		*progress += chunk;
+		start += chunk;
+		len -= chunk;
+
+#ifndef WIN32
+		/* No point in carrying on if the postmaster is gone */
+		if (IsUnderPostmaster && getppid() != PostmasterPid)
+			break;
+#endif
+	}
+}
+
+/*
+ * Set up this process's page tables for the main shared memory segment,
+ * apart from the buffer pool.
+ *
+ * Even once the segment has been faulted in, each process forked by the
+ * postmaster takes a minor fault on the first touch of every page of it.  A
+ * new backend touches most of the fixed-size structures in its first few
+ * transactions, so a process started before it is needed, like a pooled
+ * backend, can get those faults out of the way early.  The buffer pool is
+ * left alone, since a backend only ever uses a small part of it.  This does
+ * nothing without MADV_POPULATE_WRITE; faulting page by page gains nothing
+ * over leaving it to the backend.
+ */
+void
+PrefaultPageTables(void)
+{
+#ifdef MADV_POPULATE_WRITE
+	Size		pagesize = (Size) sysconf(_SC_PAGESIZE);
+	char	   *end = segment_base + segment_size;
+	char	   *pool_start;
+	char	   *pool_end;
+
+	if (segment_base == NULL || BufferBlocks == NULL)
+		return;
+
+	pool_start = (char *) TYPEALIGN_DOWN(pagesize, BufferBlocks);
+	pool_end = (char *) TYPEALIGN(pagesize, BufferBlocks + NBuffers * (Size) BLCKSZ);
+
+	/* Failures don't matter; we'd just take the faults later */
+	if (pool_start > segment_base)
+		(void) madvise(segment_base, pool_start - segment_base,
+					   MADV_POPULATE_WRITE);
+	if (end > pool_end)
+		(void) madvise(pool_end, end - pool_end, MADV_POPULATE_WRITE);
+#endif
+}
+
+/*
+ * Report progress, or completion, of the prefault helpers to the log.
+ */
+static void
+PrefaultReport(bool finished)
+{
+	Size		done = 0;
+	long		msecs;
+
+	for (int i = 0; i < prefault_nworkers; i++)
+		done += prefault_progress->done[i];
+	done = Min(done, prefault_total_size);
+	msecs = TimestampDifferenceMilliseconds(prefault_start_time,
+											GetCurrentTimestamp());
+
+	if (finished)
+		ereport(LOG,
+				(errmsg("prefaulted %zu MB of shared memory in %ld.%03d s using %d processes",
+						done / (1024 * 1024), msecs / 1000, (int) (msecs % 1000),
+						prefault_nworkers)));
+	else
+		ereport(LOG,
+				(errmsg("prefaulting shared memory: %zu of %zu MB done (%d%%)",
+						done / (1024 * 1024),
+						prefault_total_size / (1024 * 1024),
+						(int) ((double) done * 100 / prefault_total_size))));
+}
+
+/*
+ * PrefaultSharedMemory
+ *		Fault in the main shared memory segment, if so configured.
+ *
+ * Called by the postmaster right after creating the segment, both at
+ * startup and when reinitializing after a crash.
+ */
+void
+PrefaultSharedMemory(void *base, Size size)
+{
+	Size		slice;
+
+	segment_base = base;
+	segment_size = size;
+
+	if (shared_memory_prefault_workers <= 0 || size == 0)
+		return;
+
+	Assert(!IsUnderPostmaster);
+
+	/*
+	 * Helpers left over from a previous incarnation of shared memory are of
+	 * no use anymore; get rid of them before starting new ones.
+	 */
+#ifndef WIN32
+	for (int i = 0; i < prefault_nworkers; i++)
+	{
+		if (prefault_pids[i] != 0)
+		{
+			kill(prefault_pids[i], SIGKILL);
+			(void) waitpid(prefault_pids[i], NULL, 0);
+			prefault_pids[i] = 0;
+		}
+	}
+	prefault_nrunning = 0;
+#endif
+
+	if (prefault_progress == NULL)
+	{
+#ifndef WIN32
+		prefault_progress = mmap(NULL, sizeof(PrefaultProgress),
+								 PROT_READ | PROT_WRITE,
+								 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (prefault_progress == MAP_FAILED)
+		{
+			prefault_progress = NULL;
+			ereport(LOG,
+					(errmsg("could not map memory for shared memory prefault: %m")));
+			return;
+		}
+#else
+		prefault_progress = malloc(sizeof(PrefaultProgress));
+		if (prefault_progress == NULL)
+			return;
+#endif
+	}
+	memset((void *) prefault_progress, 0, sizeof(PrefaultProgress));
+
+	prefault_nworkers = Min(shared_memory_prefault_workers,
+							MAX_SHMEM_PREFAULT_WORKERS);
+	prefault_total_size = size;
+	prefault_start_time = GetCurrentTimestamp();
+
+	/* Don't split the segment into slices smaller than one chunk */
+	slice = TYPEALIGN(PREFAULT_CHUNK_SIZE,
+					  (size + prefault_nworkers - 1) / prefault_nworkers);
+	prefault_nworkers = Min(prefault_nworkers,
+							(size + slice - 1) / slice);
+
+	ereport(LOG,
+			(errmsg("prefaulting %zu MB of shared memory using %d processes",
+					size / (1024 * 1024), prefault_nworkers)));
+
+#ifndef WIN32
+	for (int i = 0; i < prefault_nworkers; i++)
+	{
+		char	   *start = (char *) base + slice * i;
+		Size		len = Min(slice, size - slice * i);
+		pid_t		pid;
+
+		pid = fork_process();
+		if (pid == 0)
+		{
+			/* in helper process */
+			MyProcPid = getpid();
+			IsUnderPostmaster = true;
+			pqsignal(SIGTERM, SIG_DFL);
+			pqsignal(SIGQUIT, SIG_DFL);
+			pqsignal(SIGINT, SIG_DFL);
+			pqsignal(SIGHUP, SIG_IGN);
+			pqsignal(SIGCHLD, SIG_DFL);
+			init_ps_display("shared memory prefault");
+
+			PrefaultRange(start, len, &prefault_progress->done[i]);
+
+			/* don't run the postmaster's exit callbacks */
+			_exit(0);
+		}
+
+		if (pid < 0)
+		{
+			/* fall back to doing this slice ourselves */
+			ereport(LOG,
+					(errmsg("could not fork shared memory prefault process: %m")));
+			prefault_pids[i] = 0;
+			PrefaultRange(start, len, &prefault_progress->done[i]);
+			continue;
+		}
+
+		prefault_pids[i] = pid;
+		prefault_nrunning++;
+	}
+
+	if (shared_memory_prefault_background)
+	{
+		/* PrefaultChildExited() will report completion */
+		if (prefault_nrunning == 0)
+			PrefaultReport(true);
+		return;
+	}
+
+	/* Wait for the helpers, reporting progress periodically */
+	{
+		TimestampTz last_report = prefault_start_time;
+
+		while (prefault_nrunning > 0)
+		{
+			for (int i = 0; i < prefault_nworkers; i++)
+			{
+				int			status;
+
+				if (prefault_pids[i] != 0 &&
+					waitpid(prefault_pids[i], &status, WNOHANG) == prefault_pids[i])
+				{
+					prefault_pids[i] = 0;
+					prefault_nrunning--;
+				}
+			}
+
+			if (prefault_nrunning == 0)
+				break;
+
+			pg_usleep(100000L);
+
+			if (TimestampDifferenceExceeds(last_report, GetCurrentTimestamp(),
+										   PREFAULT_PROGRESS_INTERVAL))
+			{
+				PrefaultReport(false);
+				last_report = GetCurrentTimestamp();
+			}
+		}
+	}
+#else
+	/* No fork() here; just do it all ourselves */
+	PrefaultRange(base, size, &prefault_progress->done[0]);
+#endif
+
+	PrefaultReport(true);
+}
+
+/*
+ * PrefaultChildExited
+ *		Check whether an exited child of the postmaster was a prefault helper
+ *		running in the background, and if so, forget about it.
+ *
+ * Returns true if the child was one of ours.  A helper failing is not a
+ * reason to restart the cluster; it is just logged.
+ */
+bool
+PrefaultChildExited(int pid, int exitstatus)
+{
+	if (prefault_nrunning == 0)
+		return false;
+
+	for (int i = 0; i < prefault_nworkers; i++)
+	{
+		if (prefault_pids[i] == pid)
+		{
+			prefault_pids[i] = 0;
+			prefault_nrunning--;
+
+			if (exitstatus != 0)
+				ereport(LOG,
+						(errmsg("shared memory prefault process (PID %d) failed: %s",
+								pid, wait_result_to_str(exitstatus))));
+			else if (prefault_nrunning == 0)
+				PrefaultReport(true);
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -22,6 +22,7 @@
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -49,6 +50,9 @@ volatile sig_atomic_t catchupInterruptPending = false;
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	/* Stale shared catcache entries must be gone before anyone is told */
+	SharedCatCacheInvalidateMessages(msgs, n);
+
 	SIInsertDataEntries(msgs, n);
 }
 
@@ -38,6 +38,8 @@
 #include "commands/async.h"
 #include "commands/prepare.h"
 #include "common/pg_prng.h"
+#include "executor/instrument.h"
+#include "executor/tqueue.h"
 #include "jit/jit.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -3464,12 +3466,23 @@ ProcessInterrupts(void)
 		pgstat_report_stat(true);
 	}
 
+	/* Likewise, release retained memory once idle for long enough. */
+	if (IdleMemoryReleaseTimeoutPending &&
+		DoingCommandRead && !IsTransactionOrTransactionBlock())
+	{
+		IdleMemoryReleaseTimeoutPending = false;
+		ReleaseRetainedBlocks();
+	}
+
 	if (ProcSignalBarrierPending)
 		ProcessProcSignalBarrier();
 
 	if (ParallelMessagePending)
 		HandleParallelMessages();
 
+	if (TupleQueueFlushPending)
+		HandleTupleQueueFlush();
+
 	if (LogMemoryContextPending)
 		ProcessLogMemoryContextInterrupt();
 
@@ -4137,6 +4150,8 @@ PostgresSingleUserMain(int argc, char *argv[],
 	/* read control file (error checking and contains config ) */
 	LocalProcessControlFile(false);
 
+	InstrInitTiming();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -4205,6 +4220,7 @@ PostgresMain(const char *dbname, const char *username)
 	volatile bool send_ready_for_query = true;
 	volatile bool idle_in_transaction_timeout_enabled = false;
 	volatile bool idle_session_timeout_enabled = false;
+	volatile bool idle_memory_release_timeout_enabled = false;
 
 	Assert(dbname != NULL);
 	Assert(username != NULL);
@@ -4414,6 +4430,7 @@ PostgresMain(const char *dbname, const char *username)
 		QueryCancelPending = false;
 		idle_in_transaction_timeout_enabled = false;
 		idle_session_timeout_enabled = false;
+		idle_memory_release_timeout_enabled = false;
 
 		/* Not reading from the client anymore. */
 		DoingCommandRead = false;
@@ -4597,6 +4614,9 @@ PostgresMain(const char *dbname, const char *username)
 				if (notifyInterruptPending)
 					ProcessNotifyInterrupt(false);
 
+				/* Give back prestarted workers we no longer want. */
+				AdjustPrestartedWorkers();
+
 				/*
 				 * Check if we need to report stats. If pgstat_report_stat()
 				 * decides it's too soon to flush out pending stats / lock
@@ -4634,6 +4654,15 @@ PostgresMain(const char *dbname, const char *username)
 					enable_timeout_after(IDLE_SESSION_TIMEOUT,
 										 IdleSessionTimeout);
 				}
+
+				/* Start the timer for releasing retained memory */
+				if (retained_work_mem_idle_timeout > 0 &&
+					GetRetainedMemoryStats()->retained_blocks > 0)
+				{
+					idle_memory_release_timeout_enabled = true;
+					enable_timeout_after(IDLE_MEMORY_RELEASE_TIMEOUT,
+										 retained_work_mem_idle_timeout);
+				}
 			}
 
 			/* Report any recently-changed GUC options */
@@ -4674,6 +4703,12 @@ PostgresMain(const char *dbname, const char *username)
 			disable_timeout(IDLE_SESSION_TIMEOUT, false);
 			idle_session_timeout_enabled = false;
 		}
+		if (idle_memory_release_timeout_enabled)
+		{
+			disable_timeout(IDLE_MEMORY_RELEASE_TIMEOUT, false);
+			idle_memory_release_timeout_enabled = false;
+			IdleMemoryReleaseTimeoutPending = false;
+		}
 
 		/*
 		 * (5) disable async signal conditions again.
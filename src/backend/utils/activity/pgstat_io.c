@@ -17,7 +17,11 @@
 #include "postgres.h"
 
 #include "executor/instrument.h"
+#include "miscadmin.h"
+#include "port/pg_bitutils.h"
 #include "storage/bufmgr.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/pgstat_internal.h"
 
 
@@ -25,12 +29,21 @@ typedef struct PgStat_PendingIO
 {
 	PgStat_Counter counts[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
 	instr_time	pending_times[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+	PgStat_Counter hists[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES][PGSTAT_IO_HIST_BUCKETS];
 } PgStat_PendingIO;
 
 
+bool		pgstat_track_io_relations = false;
+
 static PgStat_PendingIO PendingIOStats;
 bool		have_iostats = false;
 
+/* pending per-relation stats, keyed by RelFileLocator */
+static HTAB *PendingIORelations = NULL;
+
+
+static bool pgstat_flush_io_relations(bool nowait);
+
 
 /*
  * Check that stats have not been counted for any combination of IOObject,
@@ -105,19 +118,92 @@ pgstat_prepare_io_time(void)
 	return io_start;
 }
 
+/*
+ * Histogram bucket of an IO operation that took the given time.
+ */
+static inline int
+pgstat_io_hist_bucket(uint64 io_time_us)
+{
+	int			bucket;
+
+	if (io_time_us < 2)
+		return 0;
+	bucket = pg_leftmost_one_pos64(io_time_us);
+	return Min(bucket, PGSTAT_IO_HIST_BUCKETS - 1);
+}
+
+/*
+ * Count a timed IO operation on a relation file in the pending
+ * per-relation stats.
+ *
+ * Adding a relation allocates memory, which is not allowed in a critical
+ * section, so IO there on a relation without pending stats isn't counted.
+ */
+static void
+pgstat_count_io_relation(const RelFileLocator *rlocator, IOOp io_op,
+						 uint64 io_time_us, uint32 cnt)
+{
+	PgStat_RelationIO *entry;
+	bool		found;
+
+	if (PendingIORelations == NULL)
+	{
+		HASHCTL		ctl;
+
+		if (CritSectionCount > 0)
+			return;
+
+		ctl.keysize = sizeof(RelFileLocator);
+		ctl.entrysize = sizeof(PgStat_RelationIO);
+		ctl.hcxt = TopMemoryContext;
+		PendingIORelations = hash_create("pending IO relation stats", 16, &ctl,
+										 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (PgStat_RelationIO *) hash_search(PendingIORelations, rlocator,
+											  CritSectionCount > 0 ? HASH_FIND : HASH_ENTER,
+											  &found);
+	if (entry == NULL)
+		return;
+	if (!found)
+		memset((char *) entry + sizeof(RelFileLocator), 0,
+			   sizeof(PgStat_RelationIO) - sizeof(RelFileLocator));
+
+	entry->rank_time += io_time_us;
+	entry->counts[io_op] += cnt;
+	entry->times[io_op] += io_time_us;
+	entry->hists[io_op][pgstat_io_hist_bucket(io_time_us)]++;
+}
+
 /*
  * Like pgstat_count_io_op_n() except it also accumulates time.
  */
 void
 pgstat_count_io_op_time(IOObject io_object, IOContext io_context, IOOp io_op,
 						instr_time start_time, uint32 cnt)
+{
+	pgstat_count_io_op_time_rel(io_object, io_context, io_op, start_time, cnt,
+								NULL);
+}
+
+/*
+ * Like pgstat_count_io_op_time(), for IO on a single relation file.  With
+ * track_io_relations, the IO is also counted for that relation, unless it is
+ * temporary.
+ */
+void
+pgstat_count_io_op_time_rel(IOObject io_object, IOContext io_context,
+							IOOp io_op, instr_time start_time, uint32 cnt,
+							const RelFileLocator *rlocator)
 {
 	if (track_io_timing)
 	{
 		instr_time	io_time;
+		uint64		io_time_us;
 
 		INSTR_TIME_SET_CURRENT(io_time);
 		INSTR_TIME_SUBTRACT(io_time, start_time);
+		io_time_us = INSTR_TIME_GET_MICROSEC(io_time);
 
 		if (io_op == IOOP_WRITE || io_op == IOOP_EXTEND)
 		{
@@ -134,6 +220,11 @@ pgstat_count_io_op_time(IOObject io_object, IOContext io_context, IOOp io_op,
 
 		INSTR_TIME_ADD(PendingIOStats.pending_times[io_object][io_context][io_op],
 					   io_time);
+		PendingIOStats.hists[io_object][io_context][io_op][pgstat_io_hist_bucket(io_time_us)]++;
+
+		if (pgstat_track_io_relations && rlocator != NULL &&
+			io_object == IOOBJECT_RELATION)
+			pgstat_count_io_relation(rlocator, io_op, io_time_us, cnt);
 	}
 
 	pgstat_count_io_op_n(io_object, io_context, io_op, cnt);
@@ -188,6 +279,10 @@ pgstat_flush_io(bool nowait)
 
 				bktype_shstats->times[io_object][io_context][io_op] +=
 					INSTR_TIME_GET_MICROSEC(time);
+
+				for (int bucket = 0; bucket < PGSTAT_IO_HIST_BUCKETS; bucket++)
+					bktype_shstats->hists[io_object][io_context][io_op][bucket] +=
+						PendingIOStats.hists[io_object][io_context][io_op][bucket];
 			}
 		}
 	}
@@ -198,11 +293,126 @@ pgstat_flush_io(bool nowait)
 
 	memset(&PendingIOStats, 0, sizeof(PendingIOStats));
 
-	have_iostats = false;
+	/*
+	 * The per-relation stats have a lock of their own.  If we can't get it,
+	 * keep them, and report that stats are still pending.
+	 */
+	have_iostats = pgstat_flush_io_relations(nowait);
+
+	return have_iostats;
+}
+
+/*
+ * Add a relation's pending IO stats to the shared ones, which keep the
+ * relations with the most IO time using the Space-Saving algorithm: a
+ * relation that isn't kept replaces the one with the least IO time, and
+ * inherits that time as its rank, so that a relation that has been doing
+ * IO all along isn't evicted by a newcomer with a burst of IO.  Only the
+ * rank is inherited, the counters start from zero.
+ *
+ * Caller must hold rel_lock exclusively.
+ */
+static void
+pgstat_add_io_relation(PgStatShared_IO *shio, PgStat_RelationIO *pending)
+{
+	PgStat_RelationIO *entry = NULL;
+
+	for (int i = 0; i < shio->nrelations; i++)
+	{
+		if (RelFileLocatorEquals(shio->relations[i].locator, pending->locator))
+		{
+			entry = &shio->relations[i];
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		PgStat_Counter rank_time = 0;
+
+		if (shio->nrelations < PGSTAT_IO_NUM_RELATIONS)
+			entry = &shio->relations[shio->nrelations++];
+		else
+		{
+			entry = &shio->relations[0];
+			for (int i = 1; i < PGSTAT_IO_NUM_RELATIONS; i++)
+			{
+				if (shio->relations[i].rank_time < entry->rank_time)
+					entry = &shio->relations[i];
+			}
+			rank_time = entry->rank_time;
+		}
+
+		memset(entry, 0, sizeof(PgStat_RelationIO));
+		entry->locator = pending->locator;
+		entry->rank_time = rank_time;
+	}
+
+	entry->rank_time += pending->rank_time;
+	for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+	{
+		entry->counts[io_op] += pending->counts[io_op];
+		entry->times[io_op] += pending->times[io_op];
+		for (int bucket = 0; bucket < PGSTAT_IO_HIST_BUCKETS; bucket++)
+			entry->hists[io_op][bucket] += pending->hists[io_op][bucket];
+	}
+}
+
+/*
+ * Flush out locally pending per-relation IO statistics
+ *
+ * Returns true if some stats could not be flushed because nowait is true
+ * and the lock could not be acquired.
+ */
+static bool
+pgstat_flush_io_relations(bool nowait)
+{
+	PgStatShared_IO *shio = &pgStatLocal.shmem->io;
+	HASH_SEQ_STATUS hstat;
+	PgStat_RelationIO *pending;
+
+	if (PendingIORelations == NULL ||
+		hash_get_num_entries(PendingIORelations) == 0)
+		return false;
+
+	if (!nowait)
+		LWLockAcquire(&shio->rel_lock, LW_EXCLUSIVE);
+	else if (!LWLockConditionalAcquire(&shio->rel_lock, LW_EXCLUSIVE))
+		return true;
+
+	hash_seq_init(&hstat, PendingIORelations);
+	while ((pending = hash_seq_search(&hstat)) != NULL)
+	{
+		pgstat_add_io_relation(shio, pending);
+		hash_search(PendingIORelations, &pending->locator, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(&shio->rel_lock);
 
 	return false;
 }
 
+/*
+ * Copy the shared per-relation IO stats to the given array, which must have
+ * room for PGSTAT_IO_NUM_RELATIONS entries, and return how many there are.
+ *
+ * Unlike other stats, these are read from shared memory directly, not from
+ * a snapshot.
+ */
+int
+pgstat_fetch_stat_io_relations(PgStat_RelationIO *relations)
+{
+	PgStatShared_IO *shio = &pgStatLocal.shmem->io;
+	int			nrelations;
+
+	LWLockAcquire(&shio->rel_lock, LW_SHARED);
+	nrelations = shio->nrelations;
+	memcpy(relations, shio->relations, nrelations * sizeof(PgStat_RelationIO));
+	LWLockRelease(&shio->rel_lock);
+
+	return nrelations;
+}
+
 const char *
 pgstat_get_io_context_name(IOContext io_context)
 {
@@ -257,6 +467,10 @@ pgstat_io_reset_all_cb(TimestampTz ts)
 		memset(bktype_shstats, 0, sizeof(*bktype_shstats));
 		LWLockRelease(bktype_lock);
 	}
+
+	LWLockAcquire(&pgStatLocal.shmem->io.rel_lock, LW_EXCLUSIVE);
+	pgStatLocal.shmem->io.nrelations = 0;
+	LWLockRelease(&pgStatLocal.shmem->io.rel_lock);
 }
 
 void
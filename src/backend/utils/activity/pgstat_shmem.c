@@ -206,6 +206,7 @@ StatsShmemInit(void)
 		for (int i = 0; i < BACKEND_NUM_TYPES; i++)
 			LWLockInitialize(&ctl->io.locks[i],
 							 LWTRANCHE_PGSTATS_DATA);
+		LWLockInitialize(&ctl->io.rel_lock, LWTRANCHE_PGSTATS_DATA);
 	}
 	else
 	{
@@ -233,6 +233,9 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_MAIN:
 			event_name = "LogicalParallelApplyMain";
 			break;
+		case WAIT_EVENT_PARALLEL_WORKER_PRESTART:
+			event_name = "ParallelWorkerPrestart";
+			break;
 		case WAIT_EVENT_RECOVERY_WAL_STREAM:
 			event_name = "RecoveryWalStream";
 			break;
@@ -403,6 +406,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_LOGICAL_SYNC_STATE_CHANGE:
 			event_name = "LogicalSyncStateChange";
 			break;
+		case WAIT_EVENT_MEMORY_ADMISSION:
+			event_name = "MemoryAdmission";
+			break;
 		case WAIT_EVENT_MQ_INTERNAL:
 			event_name = "MessageQueueInternal";
 			break;
@@ -22,6 +22,7 @@
 #include "catalog/pg_collation.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "port/simd.h"
 #include "utils/builtins.h"
 #include "utils/pg_locale.h"
 #include "varatt.h"
@@ -46,6 +47,8 @@ static int	UTF8_MatchText(const char *t, int tlen, const char *p, int plen,
 static int	SB_IMatchText(const char *t, int tlen, const char *p, int plen,
 						  pg_locale_t locale, bool locale_is_c);
 
+static const char *like_find_literal(const char *t, int tlen,
+									 const char *lit, int litlen);
 static int	GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation);
 static int	Generic_Text_IC_like(text *str, text *pat, Oid collation);
 
@@ -103,6 +106,74 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 		return pg_tolower(c);
 }
 
+/*
+ * like_find_literal --- locate the leftmost occurrence of lit[0..litlen-1]
+ * within t[0..tlen-1], or return NULL if there is none.
+ *
+ * This is used by MatchText to resolve a "%literal%" pattern fragment in one
+ * pass over the text rather than attempting a recursive match at every text
+ * position.  Where SIMD is available we compare the first and last bytes of
+ * the literal against a whole vector's worth of candidate positions at once,
+ * and only fall back to memcmp() for positions at which both of them match.
+ * For the short literals typical of LIKE patterns that filter rejects nearly
+ * all positions, so the cost is close to that of a plain memchr().
+ */
+static const char *
+like_find_literal(const char *t, int tlen, const char *lit, int litlen)
+{
+	const char *end;
+	const char *s = t;
+
+	Assert(litlen > 0);
+
+	if (tlen < litlen)
+		return NULL;
+	end = t + tlen - litlen;	/* last possible starting position */
+
+#ifndef USE_NO_SIMD
+	if (litlen > 1)
+	{
+		const Vector8 first = vector8_broadcast((uint8) lit[0]);
+		const Vector8 last = vector8_broadcast((uint8) lit[litlen - 1]);
+
+		while (end - s >= (ptrdiff_t) sizeof(Vector8))
+		{
+			Vector8		chunk;
+			Vector8		tail;
+
+			vector8_load(&chunk, (const uint8 *) s);
+			vector8_load(&tail, (const uint8 *) s + litlen - 1);
+
+			if (vector8_is_highbit_set(vector8_and(vector8_eq(chunk, first),
+												   vector8_eq(tail, last))))
+			{
+				for (int i = 0; i < sizeof(Vector8); i++)
+				{
+					if (s[i] == lit[0] &&
+						s[i + litlen - 1] == lit[litlen - 1] &&
+						memcmp(s + i + 1, lit + 1, litlen - 2) == 0)
+						return s + i;
+				}
+			}
+			s += sizeof(Vector8);
+		}
+	}
+#endif
+
+	/* Handle the remaining positions (or everything, without SIMD) */
+	while (s <= end)
+	{
+		s = memchr(s, (unsigned char) lit[0], end - s + 1);
+		if (s == NULL)
+			return NULL;
+		if (memcmp(s + 1, lit + 1, litlen - 1) == 0)
+			return s;
+		s++;
+	}
+
+	return NULL;
+}
+
 
 #define NextByte(p, plen)	((p)++, (plen)--)
 
@@ -129,6 +200,7 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 
 #define MatchText	SB_MatchText
 #define do_like_escape	SB_do_like_escape
+#define MATCH_LITERAL_SEARCH
 
 #include "like_match.c"
 
@@ -144,6 +216,7 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 #define NextChar(p, plen) \
 	do { (p)++; (plen)--; } while ((plen) > 0 && (*(p) & 0xC0) == 0x80 )
 #define MatchText	UTF8_MatchText
+#define MATCH_LITERAL_SEARCH
 
 #include "like_match.c"
 
@@ -15,6 +15,9 @@
  * MatchText - to name of function wanted
  * do_like_escape - name of function if wanted - needs CHAREQ and CopyAdvChar
  * MATCH_LOWER - define for case (4) to specify case folding for 1-byte chars
+ * MATCH_LITERAL_SEARCH - define if a byte-wise substring search of the text
+ *		can only find matches that start on a character boundary, so that
+ *		literal pattern fragments may be located with like_find_literal()
  *
  * Copyright (c) 1996-2023, PostgreSQL Global Development Group
  *
@@ -151,6 +154,50 @@ MatchText(const char *t, int tlen, const char *p, int plen,
 			if (plen <= 0)
 				return LIKE_TRUE;
 
+#ifdef MATCH_LITERAL_SEARCH
+
+			/*
+			 * If the pattern continues with a run of plain literal bytes that
+			 * ends either at another % or at the end of the pattern, there's
+			 * no need for the recursive search below.  In the first case the
+			 * leftmost occurrence of the literal in the text is always the
+			 * best place to match it, since whatever follows can then match
+			 * against the longest possible remainder; so find it with a fast
+			 * substring search, and carry on matching from just past it.
+			 * Patterns such as '%foo%bar%' thus take just one pass over the
+			 * text.  In the second case, the literal can only match as a
+			 * suffix of the text.  Either way, failure means that no later
+			 * starting position can succeed either, so return LIKE_ABORT.
+			 */
+			{
+				int			litlen = 0;
+
+				while (litlen < plen &&
+					   p[litlen] != '%' && p[litlen] != '_' && p[litlen] != '\\')
+					litlen++;
+
+				if (litlen > 0 && litlen == plen)
+				{
+					if (tlen >= litlen &&
+						memcmp(t + tlen - litlen, p, litlen) == 0)
+						return LIKE_TRUE;
+					return LIKE_ABORT;
+				}
+				else if (litlen > 0 && p[litlen] == '%')
+				{
+					const char *found = like_find_literal(t, tlen, p, litlen);
+
+					if (found == NULL)
+						return LIKE_ABORT;
+					tlen -= (found - t) + litlen;
+					t = found + litlen;
+					p += litlen;
+					plen -= litlen;
+					continue;
+				}
+			}
+#endif							/* MATCH_LITERAL_SEARCH */
+
 			/*
 			 * Otherwise, scan for a text position at which we can match the
 			 * rest of the pattern.  The first remaining pattern char is known
@@ -354,6 +401,10 @@ do_like_escape(text *pat, text *esc)
 
 #undef GETCHAR
 
+#ifdef MATCH_LITERAL_SEARCH
+#undef MATCH_LITERAL_SEARCH
+#endif
+
 #ifdef MATCH_LOWER
 #undef MATCH_LOWER
 
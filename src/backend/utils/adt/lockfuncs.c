@@ -20,6 +20,7 @@
 #include "storage/predicate_internals.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/membroker.h"
 
 
 /*
@@ -605,7 +606,7 @@ pg_safe_snapshot_blocking_pids(PG_FUNCTION_ARGS)
  *
  * Check if specified PID is blocked by any of the PIDs listed in the second
  * argument.  Currently, this looks for blocking caused by waiting for
- * heavyweight locks or safe snapshots.  We ignore blockage caused by PIDs
+ * heavyweight locks, safe snapshots or query memory.  We ignore blockage caused by PIDs
  * not directly under the isolationtester's control, eg autovacuum.
  *
  * This is an undocumented function intended for use by the isolation tester,
@@ -674,6 +675,13 @@ pg_isolation_test_session_is_blocked(PG_FUNCTION_ARGS)
 	if (GetSafeSnapshotBlockingPids(blocked_pid, &dummy, 1) > 0)
 		PG_RETURN_BOOL(true);
 
+	/*
+	 * Likewise for a wait for query memory; only queries that hold memory can
+	 * keep it waiting, and those don't include autovacuum.
+	 */
+	if (MemoryBrokerIsWaiting(blocked_pid))
+		PG_RETURN_BOOL(true);
+
 	PG_RETURN_BOOL(false);
 }
 
@@ -128,6 +128,33 @@ pg_get_backend_memory_contexts(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * pg_get_backend_retained_memory
+ *		SQL function showing the backend's retained-block counters.
+ */
+Datum
+pg_get_backend_retained_memory(PG_FUNCTION_ARGS)
+{
+#define PG_GET_BACKEND_RETAINED_MEMORY_COLS	7
+	const RetainedMemoryStats *stats = GetRetainedMemoryStats();
+	TupleDesc	tupdesc;
+	Datum		values[PG_GET_BACKEND_RETAINED_MEMORY_COLS];
+	bool		nulls[PG_GET_BACKEND_RETAINED_MEMORY_COLS] = {0};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Int32GetDatum(stats->retained_blocks);
+	values[1] = Int64GetDatum(stats->retained_bytes);
+	values[2] = Int64GetDatum(stats->reused_blocks);
+	values[3] = Int64GetDatum(stats->reused_bytes);
+	values[4] = Int64GetDatum(stats->new_blocks);
+	values[5] = Int64GetDatum(stats->new_bytes);
+	values[6] = Int64GetDatum(stats->released_bytes);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * pg_log_backend_memory_contexts
  *		Signal a backend or an auxiliary process to log its memory contexts.
@@ -30,6 +30,7 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/inet.h"
 #include "utils/timestamp.h"
@@ -1456,6 +1457,160 @@ pg_stat_get_io(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Name of a timed IOOp, as shown in pg_stat_io_histogram and
+ * pg_stat_io_relation_histogram, or NULL if the IOOp is not timed.
+ */
+static const char *
+pgstat_get_io_timed_op_name(IOOp io_op)
+{
+	switch (io_op)
+	{
+		case IOOP_READ:
+			return "read";
+		case IOOP_WRITE:
+			return "write";
+		case IOOP_WRITEBACK:
+			return "writeback";
+		case IOOP_EXTEND:
+			return "extend";
+		case IOOP_FSYNC:
+			return "fsync";
+		case IOOP_EVICT:
+		case IOOP_HIT:
+		case IOOP_REUSE:
+			return NULL;
+	}
+
+	elog(ERROR, "unrecognized IOOp value: %d", io_op);
+	pg_unreachable();
+}
+
+static Datum
+pgstat_io_histogram_datum(const PgStat_Counter *hist)
+{
+	Datum		buckets[PGSTAT_IO_HIST_BUCKETS];
+
+	for (int i = 0; i < PGSTAT_IO_HIST_BUCKETS; i++)
+		buckets[i] = Int64GetDatum(hist[i]);
+
+	return PointerGetDatum(construct_array_builtin(buckets,
+												   PGSTAT_IO_HIST_BUCKETS,
+												   INT8OID));
+}
+
+/*
+ * Returns a latency histogram for each timed IOOp of each row of pg_stat_io
+ */
+Datum
+pg_stat_get_io_histogram(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo;
+	PgStat_IO  *backends_io_stats;
+	Datum		reset_time;
+
+	InitMaterializedSRF(fcinfo, 0);
+	rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	backends_io_stats = pgstat_fetch_stat_io();
+
+	reset_time = TimestampTzGetDatum(backends_io_stats->stat_reset_timestamp);
+
+	for (int bktype = 0; bktype < BACKEND_NUM_TYPES; bktype++)
+	{
+		Datum		bktype_desc = CStringGetTextDatum(GetBackendTypeDesc(bktype));
+		PgStat_BktypeIO *bktype_stats = &backends_io_stats->stats[bktype];
+
+		if (!pgstat_tracks_io_bktype(bktype))
+			continue;
+
+		for (int io_obj = 0; io_obj < IOOBJECT_NUM_TYPES; io_obj++)
+		{
+			const char *obj_name = pgstat_get_io_object_name(io_obj);
+
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+			{
+				const char *context_name = pgstat_get_io_context_name(io_context);
+
+				for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+				{
+					const char *op_name = pgstat_get_io_timed_op_name(io_op);
+					Datum		values[6];
+					bool		nulls[6] = {0};
+
+					/* same rows as pg_stat_io, where the op isn't NULL */
+					if (op_name == NULL ||
+						!pgstat_tracks_io_op(bktype, io_obj, io_context, io_op))
+						continue;
+
+					values[0] = bktype_desc;
+					values[1] = CStringGetTextDatum(obj_name);
+					values[2] = CStringGetTextDatum(context_name);
+					values[3] = CStringGetTextDatum(op_name);
+					values[4] = pgstat_io_histogram_datum(bktype_stats->hists[io_obj][io_context][io_op]);
+					values[5] = reset_time;
+
+					tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+										 values, nulls);
+				}
+			}
+		}
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns IO statistics of the relation files with the most IO time
+ */
+Datum
+pg_stat_get_io_relation_histogram(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo;
+	PgStat_RelationIO *relations;
+	int			nrelations;
+	Datum		reset_time;
+
+	InitMaterializedSRF(fcinfo, 0);
+	rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	reset_time = TimestampTzGetDatum(pgstat_fetch_stat_io()->stat_reset_timestamp);
+
+	relations = palloc(PGSTAT_IO_NUM_RELATIONS * sizeof(PgStat_RelationIO));
+	nrelations = pgstat_fetch_stat_io_relations(relations);
+
+	for (int i = 0; i < nrelations; i++)
+	{
+		PgStat_RelationIO *rel = &relations[i];
+
+		for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+		{
+			const char *op_name = pgstat_get_io_timed_op_name(io_op);
+			Datum		values[8];
+			bool		nulls[8] = {0};
+
+			if (op_name == NULL || rel->counts[io_op] == 0)
+				continue;
+
+			values[0] = ObjectIdGetDatum(rel->locator.relNumber);
+			values[1] = ObjectIdGetDatum(rel->locator.spcOid);
+			values[2] = ObjectIdGetDatum(rel->locator.dbOid);
+			values[3] = CStringGetTextDatum(op_name);
+			values[4] = Int64GetDatum(rel->counts[io_op]);
+			values[5] = Float8GetDatum(pg_stat_us_to_ms(rel->times[io_op]));
+			values[6] = pgstat_io_histogram_datum(rel->hists[io_op]);
+			values[7] = reset_time;
+
+			tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+								 values, nulls);
+		}
+	}
+
+	pfree(relations);
+
+	return (Datum) 0;
+}
+
 /*
  * Returns statistics of WAL activity
  */
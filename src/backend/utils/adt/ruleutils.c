@@ -8127,14 +8127,20 @@ find_param_referent(Param *param, deparse_context *context,
 			ListCell   *lc2;
 
 			/*
-			 * NestLoops transmit params to their inner child only.
+			 * NestLoops and AdaptiveJoins transmit params to their inner
+			 * child only.
 			 */
-			if (IsA(ancestor, NestLoop) &&
+			if ((IsA(ancestor, NestLoop) || IsA(ancestor, AdaptiveJoin)) &&
 				child_plan == innerPlan(ancestor))
 			{
-				NestLoop   *nl = (NestLoop *) ancestor;
+				List	   *nestParams;
 
-				foreach(lc2, nl->nestParams)
+				if (IsA(ancestor, NestLoop))
+					nestParams = ((NestLoop *) ancestor)->nestParams;
+				else
+					nestParams = ((AdaptiveJoin *) ancestor)->nestParams;
+
+				foreach(lc2, nestParams)
 				{
 					NestLoopParam *nlp = (NestLoopParam *) lfirst(lc2);
 
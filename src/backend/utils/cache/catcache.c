@@ -39,6 +39,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 /*
@@ -88,6 +89,9 @@ static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   Datum v1, Datum v2,
 											   Datum v3, Datum v4);
 
+static CatCTup *SearchCatCacheShared(CatCache *cache, uint32 hashValue,
+									 Index hashIndex, Datum *arguments,
+									 uint64 *generation);
 static pg_noinline HeapTuple SearchCatCacheMiss(CatCache *cache,
 												int nkeys,
 												uint32 hashValue,
@@ -1432,6 +1436,8 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	bool		stale;
+	bool		use_shared;
+	uint64		shared_generation = 0;
 	Datum		arguments[CATCACHE_MAXKEYS];
 
 	/* Initialize local parameter array */
@@ -1463,6 +1469,23 @@ SearchCatCacheMiss(CatCache *cache,
 	 */
 	relation = table_open(cache->cc_reloid, AccessShareLock);
 
+	/*
+	 * Before reading the catalog, see if another backend has already put the
+	 * tuple into the shared catalog cache.  We do this only after locking
+	 * the catalog, so that we have processed any pending invalidations.
+	 */
+	use_shared = SharedCatCacheEnabled();
+	if (use_shared)
+	{
+		ct = SearchCatCacheShared(cache, hashValue, hashIndex, arguments,
+								  &shared_generation);
+		if (ct != NULL)
+		{
+			table_close(relation, AccessShareLock);
+			return &ct->tuple;
+		}
+	}
+
 	do
 	{
 		/*
@@ -1508,6 +1531,10 @@ SearchCatCacheMiss(CatCache *cache,
 
 	table_close(relation, AccessShareLock);
 
+	/* Share what we found with other backends */
+	if (ct != NULL && use_shared)
+		SharedCatCacheInsert(cache, hashValue, &ct->tuple, shared_generation);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1554,6 +1581,45 @@ SearchCatCacheMiss(CatCache *cache,
 	return &ct->tuple;
 }
 
+/*
+ * Look for the tuple in the shared catalog cache, and if it's there, enter it
+ * into the local cache.  Returns the new local entry, with its refcount
+ * already incremented, or NULL if the caller has to read the catalog after
+ * all.  *generation is set for SharedCatCacheInsert() either way.
+ */
+static CatCTup *
+SearchCatCacheShared(CatCache *cache, uint32 hashValue, Index hashIndex,
+					 Datum *arguments, uint64 *generation)
+{
+	HeapTuple	stp;
+	CatCTup    *ct;
+
+	stp = SharedCatCacheLookup(cache, hashValue, arguments, generation);
+	if (stp == NULL)
+		return NULL;
+
+	ct = CatalogCacheCreateEntry(cache, stp, NULL, hashValue, hashIndex);
+	heap_freetuple(stp);
+
+	/*
+	 * The shared tuple has no toasted fields, so this can only fail in the
+	 * random failures of debug builds; the caller then reads the catalog.
+	 */
+	if (ct == NULL)
+		return NULL;
+
+	/* immediately set the refcount to 1 */
+	ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+	ct->refcount++;
+	ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+#ifdef CATCACHE_STATS
+	cache->cc_hits++;
+#endif
+
+	return ct;
+}
+
 /*
  *	ReleaseCatCache
  *
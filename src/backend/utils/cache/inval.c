@@ -125,6 +125,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
+#include "utils/sharedcatcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -1180,6 +1181,16 @@ CommandEndInvalidationMessages(void)
 	if (transInvalInfo == NULL)
 		return;
 
+	/*
+	 * The shared catalog cache must not keep handing out tuples that this
+	 * command has changed, even to us; see sharedcatcache.c.  This has to
+	 * come first: rebuilding relcache entries below looks up catcache
+	 * entries that have just been removed locally, and must not find the old
+	 * tuples again in the shared cache.
+	 */
+	ProcessInvalidationMessagesMulti(&transInvalInfo->CurrentCmdInvalidMsgs,
+									 SharedCatCacheInvalidateMessages);
+
 	ProcessInvalidationMessages(&transInvalInfo->CurrentCmdInvalidMsgs,
 								LocalExecuteInvalidationMessage);
 
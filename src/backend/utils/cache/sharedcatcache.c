@@ -0,0 +1,524 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Shared-memory second level for the system catalog caches.
+ *
+ * Every backend keeps its own catcache, and fills it by reading the catalogs
+ * on each cache miss.  With many backends, and many short-lived ones, most of
+ * those reads fetch the same few hundred tuples over and over.  When
+ * shared_catalog_cache_size is set, catcache.c looks in this cache on a miss
+ * before reading the catalog, and stores the tuples it does read here for
+ * the benefit of other backends.
+ *
+ * The cache is a fixed-size, set-associative table: the cache ID, database
+ * and key hash of an entry pick a bucket, which holds a few entries of a
+ * fixed size.  A full bucket evicts its least used entry.  Tuples too large
+ * for an entry are simply not cached here.  Negative entries and lists are
+ * never shared.
+ *
+ * Keeping the shared entries consistent relies on these rules:
+ *
+ * 1. Only tuples inserted by a committed transaction, and not deleted or
+ * updated by any transaction (committed or not), are stored.  So a tuple
+ * can't be stored while it is being changed.
+ *
+ * 2. Entries are removed as soon as their tuples could have changed: by the
+ * changing backend at the end of each command (along with its local
+ * invalidations), and by whoever sends the invalidation messages to the
+ * other backends, just before sending them.  The latter covers commands
+ * whose invalidations are only sent at commit, and WAL replay on a standby.
+ *
+ * 3. Every removal bumps the bucket's generation.  A backend that missed in
+ * the shared cache notes the generation before reading the catalog, and
+ * only stores what it read if the generation is still the same.  So a tuple
+ * read just before a removal can't be stored just after it.
+ *
+ * 4. An entry is only used if the transaction that inserted its tuple is
+ * visible to the backend's catalog snapshot, so we never see a catalog
+ * tuple earlier than reading the catalog itself would have.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "common/hashfn.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+/* GUC variable, in kB */
+int			shared_catalog_cache_size = 0;
+
+/* Size of one entry, including the tuple, and number of entries per bucket */
+#define SHARED_CATCACHE_SLOT_SIZE	512
+#define SHARED_CATCACHE_WAYS		8
+
+/* Number of locks protecting the buckets */
+#define SHARED_CATCACHE_PARTITIONS	128
+
+/* Saturation limit of an entry's usage count */
+#define SHARED_CATCACHE_MAX_USAGE	8
+
+typedef struct SharedCatCacheEntry
+{
+	int16		cacheId;		/* syscache ID, or -1 if the entry is unused */
+	uint16		usage;			/* recent use count, for eviction */
+	uint32		hashValue;		/* hash value of the cache keys */
+	Oid			dbId;			/* database, or InvalidOid if shared catalog */
+	Oid			tableOid;		/* catalog the tuple came from */
+	TransactionId xmin;			/* inserting transaction, or Frozen */
+	ItemPointerData t_self;		/* TID of the tuple */
+	uint16		len;			/* length of the tuple data */
+	/* tuple data follows, MAXALIGN'd */
+} SharedCatCacheEntry;
+
+#define SHARED_CATCACHE_TUPLE_SPACE \
+	(SHARED_CATCACHE_SLOT_SIZE - MAXALIGN(sizeof(SharedCatCacheEntry)))
+
+#define SharedCatCacheEntryData(entry) \
+	((char *) (entry) + MAXALIGN(sizeof(SharedCatCacheEntry)))
+
+typedef union SharedCatCacheSlot
+{
+	SharedCatCacheEntry entry;
+	char		pad[SHARED_CATCACHE_SLOT_SIZE];
+} SharedCatCacheSlot;
+
+typedef struct SharedCatCacheBucket
+{
+	uint64		generation;		/* bumped by every removal */
+	SharedCatCacheSlot slots[SHARED_CATCACHE_WAYS];
+} SharedCatCacheBucket;
+
+typedef struct SharedCatCacheControl
+{
+	int			nbuckets;
+	LWLockPadded locks[SHARED_CATCACHE_PARTITIONS];
+	SharedCatCacheBucket buckets[FLEXIBLE_ARRAY_MEMBER];
+} SharedCatCacheControl;
+
+static SharedCatCacheControl *SharedCatCache = NULL;
+
+static int	SharedCatCacheNumBuckets(void);
+static int	SharedCatCacheBucketIndex(int cacheId, Oid dbId, uint32 hashValue);
+static bool SharedCatCacheTupleIsStable(HeapTuple tuple);
+static void SharedCatCacheInvalidate(int cacheId, Oid dbId, uint32 hashValue);
+static void SharedCatCacheInvalidateCatalog(Oid dbId, Oid catId);
+
+#define SharedCatCacheDbId(cache) \
+	((cache)->cc_relisshared ? InvalidOid : MyDatabaseId)
+
+#define SharedCatCachePartitionLock(bucketno) \
+	(&SharedCatCache->locks[(bucketno) % SHARED_CATCACHE_PARTITIONS].lock)
+
+
+/*
+ * Number of buckets that fit in shared_catalog_cache_size.
+ */
+static int
+SharedCatCacheNumBuckets(void)
+{
+	Size		nbuckets;
+
+	if (shared_catalog_cache_size <= 0)
+		return 0;
+
+	nbuckets = ((Size) shared_catalog_cache_size * 1024) /
+		sizeof(SharedCatCacheBucket);
+
+	return (int) Max(nbuckets, 1);
+}
+
+/*
+ * Report shared-memory space needed by SharedCatCacheShmemInit
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	int			nbuckets = SharedCatCacheNumBuckets();
+
+	if (nbuckets == 0)
+		return 0;
+
+	return add_size(offsetof(SharedCatCacheControl, buckets),
+					mul_size(nbuckets, sizeof(SharedCatCacheBucket)));
+}
+
+/*
+ * Allocate and initialize the shared catalog cache, if enabled
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	int			nbuckets = SharedCatCacheNumBuckets();
+	bool		found;
+
+	if (nbuckets == 0)
+		return;
+
+	SharedCatCache = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catalog Cache", SharedCatCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		SharedCatCache->nbuckets = nbuckets;
+		for (int i = 0; i < SHARED_CATCACHE_PARTITIONS; i++)
+			LWLockInitialize(&SharedCatCache->locks[i].lock,
+							 LWTRANCHE_SHARED_CATCACHE);
+		for (int i = 0; i < nbuckets; i++)
+		{
+			SharedCatCacheBucket *bucket = &SharedCatCache->buckets[i];
+
+			bucket->generation = 0;
+			for (int j = 0; j < SHARED_CATCACHE_WAYS; j++)
+				bucket->slots[j].entry.cacheId = -1;
+		}
+	}
+}
+
+/*
+ * Can the shared catalog cache be used right now?
+ *
+ * Historic snapshots, used by logical decoding, see the catalogs as of some
+ * time in the past, which the shared entries know nothing about.
+ */
+bool
+SharedCatCacheEnabled(void)
+{
+	return SharedCatCache != NULL &&
+		!IsBootstrapProcessingMode() &&
+		!HistoricSnapshotActive();
+}
+
+static int
+SharedCatCacheBucketIndex(int cacheId, Oid dbId, uint32 hashValue)
+{
+	uint32		h;
+
+	h = hash_combine(murmurhash32((uint32) cacheId),
+					 hash_combine(murmurhash32(dbId), hashValue));
+
+	return (int) (h % (uint32) SharedCatCache->nbuckets);
+}
+
+/*
+ * SharedCatCacheLookup
+ *		Look for the tuple matching the given cache keys.
+ *
+ * Returns a palloc'd copy of the tuple, or NULL if there is no usable entry.
+ * *generation is set to the value the caller must pass to
+ * SharedCatCacheInsert() for anything it then reads from the catalog.
+ */
+HeapTuple
+SharedCatCacheLookup(CatCache *cache, uint32 hashValue,
+					 const Datum *arguments, uint64 *generation)
+{
+	Oid			dbId = SharedCatCacheDbId(cache);
+	int			bucketno;
+	SharedCatCacheBucket *bucket;
+	LWLock	   *lock;
+	Snapshot	snapshot;
+	PGAlignedBlock buf;
+	HeapTupleData found;
+	HeapTuple	result;
+
+	Assert(SharedCatCacheEnabled());
+	StaticAssertStmt(SHARED_CATCACHE_TUPLE_SPACE <= BLCKSZ,
+					 "shared catcache entries must fit in a block");
+
+	snapshot = GetCatalogSnapshot(cache->cc_reloid);
+
+	bucketno = SharedCatCacheBucketIndex(cache->id, dbId, hashValue);
+	bucket = &SharedCatCache->buckets[bucketno];
+	lock = SharedCatCachePartitionLock(bucketno);
+
+	found.t_data = NULL;
+
+	LWLockAcquire(lock, LW_SHARED);
+
+	for (int i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheEntry *entry = &bucket->slots[i].entry;
+		HeapTupleData tuple;
+		bool		match = true;
+
+		if (entry->cacheId != cache->id ||
+			entry->hashValue != hashValue ||
+			entry->dbId != dbId)
+			continue;
+
+		/* Check the keys, as the local cache would */
+		tuple.t_len = entry->len;
+		tuple.t_self = entry->t_self;
+		tuple.t_tableOid = entry->tableOid;
+		tuple.t_data = (HeapTupleHeader) SharedCatCacheEntryData(entry);
+
+		for (int k = 0; k < cache->cc_nkeys; k++)
+		{
+			Datum		key;
+			bool		isnull;
+
+			key = heap_getattr(&tuple, cache->cc_keyno[k],
+							   cache->cc_tupdesc, &isnull);
+			Assert(!isnull);
+			if (!(cache->cc_fastequal[k]) (key, arguments[k]))
+			{
+				match = false;
+				break;
+			}
+		}
+		if (!match)
+			continue;
+
+		/* Don't return anything our catalog snapshot couldn't see yet */
+		if (entry->xmin != FrozenTransactionId &&
+			XidInMVCCSnapshot(entry->xmin, snapshot))
+			break;
+
+		/*
+		 * Copy the tuple out, so that we don't hold the lock while the
+		 * caller builds its local entry.  The usage count is updated without
+		 * an exclusive lock; losing an increment now and then is harmless.
+		 */
+		memcpy(buf.data, tuple.t_data, entry->len);
+		found = tuple;
+		found.t_data = (HeapTupleHeader) buf.data;
+		if (entry->usage < SHARED_CATCACHE_MAX_USAGE)
+			entry->usage++;
+		break;
+	}
+
+	*generation = bucket->generation;
+
+	LWLockRelease(lock);
+
+	if (found.t_data == NULL)
+		return NULL;
+
+	result = (HeapTuple) palloc(HEAPTUPLESIZE + found.t_len);
+	result->t_len = found.t_len;
+	result->t_self = found.t_self;
+	result->t_tableOid = found.t_tableOid;
+	result->t_data = (HeapTupleHeader) ((char *) result + HEAPTUPLESIZE);
+	memcpy(result->t_data, found.t_data, found.t_len);
+
+	return result;
+}
+
+/*
+ * Is the tuple safe to share with other backends, according to rule 1 in
+ * the file header comment?
+ */
+static bool
+SharedCatCacheTupleIsStable(HeapTuple tuple)
+{
+	HeapTupleHeader tup = tuple->t_data;
+	TransactionId xmin;
+
+	/* Nobody may be deleting or updating it */
+	if (!(tup->t_infomask & HEAP_XMAX_INVALID) &&
+		TransactionIdIsValid(HeapTupleHeaderGetRawXmax(tup)) &&
+		!HEAP_XMAX_IS_LOCKED_ONLY(tup->t_infomask))
+		return false;
+
+	/* It must have been inserted by a committed transaction, not ours */
+	if (HeapTupleHeaderXminFrozen(tup))
+		return true;
+	if (HeapTupleHeaderXminInvalid(tup))
+		return false;
+	xmin = HeapTupleHeaderGetRawXmin(tup);
+	if (TransactionIdIsCurrentTransactionId(xmin))
+		return false;
+
+	return HeapTupleHeaderXminCommitted(tup) || TransactionIdDidCommit(xmin);
+}
+
+/*
+ * SharedCatCacheInsert
+ *		Store a tuple just read from the catalog into the shared cache.
+ *
+ * "generation" must come from the SharedCatCacheLookup() call that missed
+ * before the catalog was read.  The tuple must not contain any toasted
+ * fields.
+ */
+void
+SharedCatCacheInsert(CatCache *cache, uint32 hashValue, HeapTuple tuple,
+					 uint64 generation)
+{
+	Oid			dbId = SharedCatCacheDbId(cache);
+	int			bucketno;
+	SharedCatCacheBucket *bucket;
+	LWLock	   *lock;
+	SharedCatCacheEntry *victim = NULL;
+	TransactionId xmin;
+
+	Assert(SharedCatCacheEnabled());
+	Assert(!HeapTupleHasExternal(tuple));
+
+	if (tuple->t_len > SHARED_CATCACHE_TUPLE_SPACE ||
+		!SharedCatCacheTupleIsStable(tuple))
+		return;
+
+	if (HeapTupleHeaderXminFrozen(tuple->t_data))
+		xmin = FrozenTransactionId;
+	else
+		xmin = HeapTupleHeaderGetRawXmin(tuple->t_data);
+
+	bucketno = SharedCatCacheBucketIndex(cache->id, dbId, hashValue);
+	bucket = &SharedCatCache->buckets[bucketno];
+	lock = SharedCatCachePartitionLock(bucketno);
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	/* Something in this bucket was invalidated since we looked; give up */
+	if (bucket->generation != generation)
+	{
+		LWLockRelease(lock);
+		return;
+	}
+
+	for (int i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheEntry *entry = &bucket->slots[i].entry;
+
+		/* Another backend may have stored the same tuple already */
+		if (entry->cacheId == cache->id &&
+			entry->hashValue == hashValue &&
+			entry->dbId == dbId &&
+			ItemPointerEquals(&entry->t_self, &tuple->t_self))
+		{
+			LWLockRelease(lock);
+			return;
+		}
+
+		/* Prefer an unused entry, else the least used one */
+		if (entry->cacheId < 0)
+		{
+			if (victim == NULL || victim->cacheId >= 0)
+				victim = entry;
+		}
+		else if (victim == NULL ||
+				 (victim->cacheId >= 0 && entry->usage < victim->usage))
+			victim = entry;
+	}
+
+	/* Age the surviving entries whenever one gets evicted */
+	if (victim->cacheId >= 0)
+	{
+		for (int i = 0; i < SHARED_CATCACHE_WAYS; i++)
+			bucket->slots[i].entry.usage >>= 1;
+	}
+
+	victim->cacheId = (int16) cache->id;
+	victim->usage = 1;
+	victim->hashValue = hashValue;
+	victim->dbId = dbId;
+	victim->tableOid = tuple->t_tableOid;
+	victim->xmin = xmin;
+	victim->t_self = tuple->t_self;
+	victim->len = (uint16) tuple->t_len;
+	memcpy(SharedCatCacheEntryData(victim), tuple->t_data, tuple->t_len);
+
+	LWLockRelease(lock);
+}
+
+/*
+ * Remove the entries for one cache key hash value.
+ */
+static void
+SharedCatCacheInvalidate(int cacheId, Oid dbId, uint32 hashValue)
+{
+	int			bucketno = SharedCatCacheBucketIndex(cacheId, dbId, hashValue);
+	SharedCatCacheBucket *bucket = &SharedCatCache->buckets[bucketno];
+	LWLock	   *lock = SharedCatCachePartitionLock(bucketno);
+
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	bucket->generation++;
+	for (int i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheEntry *entry = &bucket->slots[i].entry;
+
+		if (entry->cacheId == cacheId &&
+			entry->hashValue == hashValue &&
+			entry->dbId == dbId)
+			entry->cacheId = -1;
+	}
+
+	LWLockRelease(lock);
+}
+
+/*
+ * Remove all the entries for tuples of one catalog, as after VACUUM FULL of
+ * that catalog.  Since tuples may have been read before their TIDs changed,
+ * every bucket's generation is bumped.
+ */
+static void
+SharedCatCacheInvalidateCatalog(Oid dbId, Oid catId)
+{
+	for (int p = 0; p < SHARED_CATCACHE_PARTITIONS; p++)
+	{
+		LWLock	   *lock = &SharedCatCache->locks[p].lock;
+
+		LWLockAcquire(lock, LW_EXCLUSIVE);
+
+		for (int b = p; b < SharedCatCache->nbuckets;
+			 b += SHARED_CATCACHE_PARTITIONS)
+		{
+			SharedCatCacheBucket *bucket = &SharedCatCache->buckets[b];
+
+			bucket->generation++;
+			for (int i = 0; i < SHARED_CATCACHE_WAYS; i++)
+			{
+				SharedCatCacheEntry *entry = &bucket->slots[i].entry;
+
+				if (entry->cacheId >= 0 &&
+					entry->tableOid == catId &&
+					entry->dbId == dbId)
+					entry->cacheId = -1;
+			}
+		}
+
+		LWLockRelease(lock);
+	}
+}
+
+/*
+ * SharedCatCacheInvalidateMessages
+ *		Remove the entries affected by a batch of invalidation messages.
+ *
+ * This is called for each batch of messages sent to the shared invalidation
+ * queue, and for the local invalidations at the end of each command; see
+ * rule 2 in the file header comment.  Messages other than catcache and
+ * catalog invalidations don't concern us.
+ */
+void
+SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs, int n)
+{
+	if (SharedCatCache == NULL)
+		return;
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+			SharedCatCacheInvalidate(msg->cc.id, msg->cc.dbId,
+									 msg->cc.hashValue);
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			SharedCatCacheInvalidateCatalog(msg->cat.dbId, msg->cat.catId);
+	}
+}
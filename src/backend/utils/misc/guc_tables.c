@@ -28,6 +28,7 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/parallel.h"
 #include "access/toast_compression.h"
 #include "access/twophase.h"
 #include "access/xlog_internal.h"
@@ -42,6 +43,8 @@
 #include "commands/user.h"
 #include "commands/vacuum.h"
 #include "common/scram-common.h"
+#include "executor/instrument.h"
+#include "executor/tqueue.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -69,6 +72,7 @@
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
+#include "storage/shm_prefault.h"
 #include "storage/standby.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
@@ -77,11 +81,13 @@
 #include "utils/float.h"
 #include "utils/guc_hooks.h"
 #include "utils/guc_tables.h"
+#include "utils/membroker.h"
 #include "utils/memutils.h"
 #include "utils/pg_locale.h"
 #include "utils/portal.h"
 #include "utils/ps_status.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
 #include "utils/xml.h"
 
 /* This value is normally passed in from the Makefile */
@@ -294,6 +300,13 @@ static const struct config_enum_entry backslash_quote_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry timing_clock_source_options[] = {
+	{"auto", TIMING_CLOCK_SOURCE_AUTO, false},
+	{"system", TIMING_CLOCK_SOURCE_SYSTEM, false},
+	{"tsc", TIMING_CLOCK_SOURCE_TSC, false},
+	{NULL, 0, false}
+};
+
 /*
  * Although only "on", "off", and "auto" are documented, we accept
  * all the likely variants of "on" and "off".
@@ -931,6 +944,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_adaptivejoin", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of adaptive join plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_adaptivejoin,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -1408,6 +1431,15 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"track_io_relations", PGC_SUSET, STATS_CUMULATIVE,
+			gettext_noop("Collects I/O timing statistics for the relations with the most I/O time."),
+			gettext_noop("Requires track_io_timing.")
+		},
+		&pgstat_track_io_relations,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"track_wal_io_timing", PGC_SUSET, STATS_CUMULATIVE,
 			gettext_noop("Collects timing statistics for WAL I/O activity."),
@@ -1902,6 +1934,18 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_tuple_zero_copy", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Passes tuples from parallel workers to their leader in shared memory chunks."),
+			gettext_noop("Workers build their batches of result tuples in chunks of the query's dynamic shared memory area, "
+						 "and the leader reads them in place instead of copying them through the tuple queues."),
+			GUC_EXPLAIN
+		},
+		&parallel_tuple_zero_copy,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Allow JIT compilation."),
@@ -1998,6 +2042,26 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"work_mem_huge_pages", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Backs large allocations of hash tables and sorts with huge pages."),
+			NULL
+		},
+		&work_mem_huge_pages,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_memory_prefault_background", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Lets startup proceed while shared memory is being prefaulted."),
+			NULL
+		},
+		&shared_memory_prefault_background,
+		false,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, false, NULL, NULL, NULL
@@ -2205,6 +2269,16 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"backend_pool_size", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of idle pre-forked backends kept ready for new connections."),
+			NULL
+		},
+		&backend_pool_size,
+		0, 0, MAX_BACKENDS,
+		check_backend_pool_size, NULL, NULL
+	},
+
 	{
 		{"min_dynamic_shared_memory", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Amount of dynamic shared memory reserved at startup."),
@@ -2231,6 +2305,17 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_catalog_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share catalog cache entries between sessions."),
+			gettext_noop("0 disables the shared catalog cache."),
+			GUC_UNIT_KB
+		},
+		&shared_catalog_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_buffer_usage_limit", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the buffer pool size for VACUUM, ANALYZE, and autovacuum."),
@@ -2342,6 +2427,43 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"query_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for the workspaces of a query."),
+			gettext_noop("If the sort operations and hash tables of a query could "
+						 "together use more than this, it is divided among them "
+						 "instead. Zero disables the limit."),
+			GUC_UNIT_KB | GUC_EXPLAIN
+		},
+		&query_work_mem,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"admission_memory_budget", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Sets the maximum work memory to be reserved by all running queries together."),
+			gettext_noop("Queries that would exceed it wait, or run with less memory. "
+						 "Zero disables the limit."),
+			GUC_UNIT_KB
+		},
+		&admission_memory_budget,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"admission_wait_timeout", PGC_SUSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum time a query waits for work memory to become available."),
+			gettext_noop("After that, the query runs with the memory that is available. "
+						 "0 means never wait."),
+			GUC_UNIT_MS
+		},
+		&admission_wait_timeout,
+		10000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"maintenance_work_mem", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used for maintenance operations."),
@@ -2365,6 +2487,28 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"retained_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory of large freed blocks each session keeps for reuse."),
+			gettext_noop("Zero returns all freed memory to the operating system."),
+			GUC_UNIT_KB
+		},
+		&retained_work_mem,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"retained_work_mem_idle_timeout", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the idle time after which a session releases the memory it keeps for reuse."),
+			gettext_noop("Zero keeps the memory until the session ends."),
+			GUC_UNIT_MS
+		},
+		&retained_work_mem_idle_timeout,
+		10000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -3270,6 +3414,38 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_worker_prestart", PGC_SUSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the number of idle parallel workers a session keeps started for its parallel queries."),
+			NULL
+		},
+		&parallel_worker_prestart,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, assign_parallel_worker_prestart, NULL
+	},
+
+	{
+		{"parallel_tuple_batch_size", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the amount of tuple data a parallel worker sends to its leader in one message."),
+			gettext_noop("Zero sends each tuple in a separate message."),
+			GUC_UNIT_KB | GUC_EXPLAIN
+		},
+		&parallel_tuple_batch_size,
+		8, 0, 1024,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"parallel_tuple_batch_delay", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the longest time a parallel worker holds back batched tuples."),
+			gettext_noop("Zero sends batches only once they are full."),
+			GUC_UNIT_MS | GUC_EXPLAIN
+		},
+		&parallel_tuple_batch_delay,
+		10, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"autovacuum_work_mem", PGC_SIGHUP, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used by each autovacuum worker process."),
@@ -3449,6 +3625,16 @@ struct config_int ConfigureNamesInt[] =
 		check_huge_page_size, NULL, NULL
 	},
 
+	{
+		{"shared_memory_prefault_workers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Number of processes used to fault in shared memory at server start."),
+			gettext_noop("A value of 0 disables prefaulting.")
+		},
+		&shared_memory_prefault_workers,
+		0, 0, MAX_SHMEM_PREFAULT_WORKERS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"debug_discard_caches", PGC_SUSET, DEVELOPER_OPTIONS,
 			gettext_noop("Aggressively flush system caches for debugging purposes."),
@@ -4611,6 +4797,18 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"timing_clock_source", PGC_POSTMASTER, STATS_MONITORING,
+			gettext_noop("Selects the clock used to time statement execution."),
+			gettext_noop("\"tsc\" reads the CPU's time stamp counter, \"system\" the "
+						 "operating system's monotonic clock; \"auto\" uses the "
+						 "time stamp counter if it is known to be reliable.")
+		},
+		&timing_clock_source,
+		TIMING_CLOCK_SOURCE_AUTO, timing_clock_source_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"constraint_exclusion", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Enables the planner to use constraints to optimize queries."),
@@ -4888,6 +5086,16 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"dynamic_shared_memory_huge_pages", PGC_SUSET, RESOURCES_MEM,
+			gettext_noop("Use of huge pages for dynamic shared memory segments."),
+			NULL
+		},
+		&dynamic_shared_memory_huge_pages,
+		HUGE_PAGES_OFF, huge_pages_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"recovery_prefetch", PGC_SIGHUP, WAL_RECOVERY,
 			gettext_noop("Prefetch referenced blocks during recovery."),
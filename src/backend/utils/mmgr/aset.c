@@ -46,7 +46,12 @@
 
 #include "postgres.h"
 
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
 #include "port/pg_bitutils.h"
+#include "storage/pg_shmem.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
 #include "utils/memutils_memorychunk.h"
@@ -104,6 +109,29 @@
 #define ALLOC_BLOCKHDRSZ	MAXALIGN(sizeof(AllocBlockData))
 #define ALLOC_CHUNKHDRSZ	sizeof(MemoryChunk)
 
+/*--------------------
+ * Sets that hold large, heavily accessed structures, such as hash tables and
+ * sort arrays, can ask for their big blocks to be backed by huge pages (see
+ * AllocSetUseHugePages).  In such a set, every block of at least a huge page
+ * is mmap'd rather than malloc'd, its mapping rounded up to a whole number of
+ * huge pages.  We use explicit huge pages if any are free and otherwise ask
+ * for transparent huge pages.  Whether a block was mmap'd follows from its
+ * size alone, so no per-block flag is needed.
+ *--------------------
+ */
+#if defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+#define ALLOCSET_HUGE_PAGES
+#endif
+
+/* GUC: back large blocks of work_mem-sized sets with huge pages? */
+bool		work_mem_huge_pages = false;
+
+#ifdef ALLOCSET_HUGE_PAGES
+/* Huge page size and mmap() flags, or 0 if not known yet. */
+static Size aset_huge_page_size = 0;
+static int	aset_huge_mmap_flags = 0;
+#endif
+
 typedef struct AllocBlockData *AllocBlock;	/* forward reference */
 
 /*
@@ -163,6 +191,7 @@ typedef struct AllocSetContext
 	AllocBlock	keeper;			/* keep this block over resets */
 	/* freelist this context could be put in, or -1 if not a candidate: */
 	int			freeListIndex;	/* index in context_freelists[], or -1 */
+	bool		hugePages;		/* mmap blocks of a huge page or more? */
 } AllocSetContext;
 
 typedef AllocSetContext *AllocSet;
@@ -201,6 +230,17 @@ typedef struct AllocBlockData
 #define AllocSetIsValid(set) \
 	(PointerIsValid(set) && IsA(set, AllocSetContext))
 
+/*
+ * AllocSetBlockIsHuge
+ *		True iff a block of the given size belongs in huge pages.
+ */
+#ifdef ALLOCSET_HUGE_PAGES
+#define AllocSetBlockIsHuge(set, blksize) \
+	((set)->hugePages && (blksize) >= aset_huge_page_size)
+#else
+#define AllocSetBlockIsHuge(set, blksize) false
+#endif
+
 /*
  * AllocBlockIsValid
  *		True iff block is valid block of allocation set.
@@ -315,6 +355,114 @@ AllocSetFreeIndex(Size size)
 	return idx;
 }
 
+/* ----------
+ * AllocSetMallocBlock -
+ *
+ *		Obtain memory for a block of the given size, from malloc() or, for
+ *		a big block in a set that uses huge pages, from mmap().  A retained
+ *		block (see mcxt.c) may be returned instead, in which case *blksize
+ *		is updated to its size.
+ * ----------
+ */
+static void *
+AllocSetMallocBlock(AllocSet set, Size *blksize)
+{
+	void	   *block;
+
+#ifdef ALLOCSET_HUGE_PAGES
+	if (AllocSetBlockIsHuge(set, *blksize))
+	{
+		Size		maplen = TYPEALIGN(aset_huge_page_size, *blksize);
+		char	   *ptr;
+		char	   *aligned;
+
+		ptr = mmap(NULL, maplen, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS | aset_huge_mmap_flags, -1, 0);
+		if (ptr != MAP_FAILED)
+			return FreshBlock(ptr, maplen);
+
+		/*
+		 * No explicit huge pages are free, so ask for transparent ones.  Map
+		 * an extra huge page so that we can trim the mapping to a huge page
+		 * boundary; otherwise the kernel can't back it with huge pages.
+		 */
+		ptr = mmap(NULL, maplen + aset_huge_page_size, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED)
+			return NULL;
+		aligned = (char *) TYPEALIGN(aset_huge_page_size, ptr);
+		if (aligned != ptr)
+			munmap(ptr, aligned - ptr);
+		munmap(aligned + maplen, (ptr + aset_huge_page_size) - aligned);
+		(void) madvise(aligned, maplen, MADV_HUGEPAGE);
+		return FreshBlock(aligned, maplen);
+	}
+#endif
+
+	/*
+	 * Sets using huge pages keep out of the retained blocks, lest a block
+	 * grow past the size at which we'd take it to be mmap'd.
+	 */
+	if (!set->hugePages)
+	{
+		block = RetainedBlockGet(blksize);
+		if (block != NULL)
+			return block;
+	}
+
+	return FreshBlock(malloc(*blksize), *blksize);
+}
+
+/* ----------
+ * AllocSetFreeBlock -
+ *
+ *		Release the memory of a block of the given size, or retain it for
+ *		reuse.
+ * ----------
+ */
+static void
+AllocSetFreeBlock(AllocSet set, void *block, Size blksize)
+{
+#ifdef ALLOCSET_HUGE_PAGES
+	if (AllocSetBlockIsHuge(set, blksize))
+	{
+		munmap(block, TYPEALIGN(aset_huge_page_size, blksize));
+		return;
+	}
+#endif
+
+	if (!set->hugePages)
+		RetainedBlockPut(block, blksize);
+	else
+		free(block);
+}
+
+/* ----------
+ * AllocSetReallocBlock -
+ *
+ *		Resize a block, returning its new address or NULL on failure.  Like
+ *		realloc(), the block's contents up to the smaller size are kept.
+ * ----------
+ */
+static void *
+AllocSetReallocBlock(AllocSet set, void *block, Size oldblksize,
+					 Size blksize)
+{
+	void	   *newblock;
+
+	if (!AllocSetBlockIsHuge(set, oldblksize) &&
+		!AllocSetBlockIsHuge(set, blksize))
+		return realloc(block, blksize);
+
+	newblock = AllocSetMallocBlock(set, &blksize);
+	if (newblock == NULL)
+		return NULL;
+	memcpy(newblock, block, Min(oldblksize, blksize));
+	AllocSetFreeBlock(set, block, oldblksize);
+
+	return newblock;
+}
+
 
 /*
  * Public routines
@@ -408,6 +556,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 
 			/* Update its maxBlockSize; everything else should be OK */
 			set->maxBlockSize = maxBlockSize;
+			set->hugePages = false;
 
 			/* Reinitialize its header, installing correct name and parent */
 			MemoryContextCreate((MemoryContext) set,
@@ -475,6 +624,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	set->maxBlockSize = maxBlockSize;
 	set->nextBlockSize = initBlockSize;
 	set->freeListIndex = freeListIndex;
+	set->hugePages = false;
 
 	/*
 	 * Compute the allocation chunk size limit for this context.  It can't be
@@ -517,6 +667,39 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	return (MemoryContext) set;
 }
 
+/*
+ * AllocSetUseHugePages
+ *		Back the set's large blocks with huge pages, if work_mem_huge_pages
+ *		is enabled.
+ *
+ * This is meant for sets holding work_mem-sized structures that are accessed
+ * randomly, such as hash tables and sort arrays, where using fewer, larger
+ * pages saves TLB misses.  It must be called before anything is allocated in
+ * the set.
+ */
+void
+AllocSetUseHugePages(MemoryContext context)
+{
+#ifdef ALLOCSET_HUGE_PAGES
+	AllocSet	set = (AllocSet) context;
+
+	Assert(AllocSetIsValid(set));
+	Assert(set->blocks == set->keeper);
+
+	if (!work_mem_huge_pages)
+		return;
+
+	if (aset_huge_page_size == 0)
+	{
+		GetHugePageSize(&aset_huge_page_size, &aset_huge_mmap_flags);
+		if (aset_huge_page_size == 0)
+			return;
+	}
+
+	set->hugePages = true;
+#endif
+}
+
 /*
  * AllocSetReset
  *		Frees all memory which is allocated in the given set.
@@ -576,12 +759,14 @@ AllocSetReset(MemoryContext context)
 		else
 		{
 			/* Normal case, release the block */
-			context->mem_allocated -= block->endptr - ((char *) block);
+			Size		blksize = block->endptr - ((char *) block);
+
+			context->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 			wipe_mem(block, block->freeptr - ((char *) block));
 #endif
-			free(block);
+			AllocSetFreeBlock(set, block, blksize);
 		}
 		block = next;
 	}
@@ -662,16 +847,17 @@ AllocSetDelete(MemoryContext context)
 	while (block != NULL)
 	{
 		AllocBlock	next = block->next;
+		Size		blksize = block->endptr - ((char *) block);
 
 		if (block != set->keeper)
-			context->mem_allocated -= block->endptr - ((char *) block);
+			context->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
 #endif
 
 		if (block != set->keeper)
-			free(block);
+			AllocSetFreeBlock(set, block, blksize);
 
 		block = next;
 	}
@@ -721,7 +907,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 #endif
 
 		blksize = chunk_size + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
-		block = (AllocBlock) malloc(blksize);
+		block = (AllocBlock) AllocSetMallocBlock(set, &blksize);
 		if (block == NULL)
 			return NULL;
 
@@ -921,7 +1107,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 			blksize <<= 1;
 
 		/* Try to allocate it */
-		block = (AllocBlock) malloc(blksize);
+		block = (AllocBlock) AllocSetMallocBlock(set, &blksize);
 
 		/*
 		 * We could be asking for pretty big blocks here, so cope if malloc
@@ -932,7 +1118,7 @@ AllocSetAlloc(MemoryContext context, Size size)
 			blksize >>= 1;
 			if (blksize < required_size)
 				break;
-			block = (AllocBlock) malloc(blksize);
+			block = (AllocBlock) AllocSetMallocBlock(set, &blksize);
 		}
 
 		if (block == NULL)
@@ -1007,6 +1193,7 @@ AllocSetFree(void *pointer)
 	{
 		/* Release single-chunk block. */
 		AllocBlock	block = ExternalChunkGetBlock(chunk);
+		Size		blksize;
 
 		/*
 		 * Try to verify that we have a sane block pointer: the block header
@@ -1035,12 +1222,13 @@ AllocSetFree(void *pointer)
 		if (block->next)
 			block->next->prev = block->prev;
 
-		set->header.mem_allocated -= block->endptr - ((char *) block);
+		blksize = block->endptr - ((char *) block);
+		set->header.mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
 #endif
-		free(block);
+		AllocSetFreeBlock(set, block, blksize);
 	}
 	else
 	{
@@ -1156,7 +1344,8 @@ AllocSetRealloc(void *pointer, Size size)
 		blksize = chksize + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
 		oldblksize = block->endptr - ((char *) block);
 
-		block = (AllocBlock) realloc(block, blksize);
+		block = (AllocBlock) AllocSetReallocBlock(set, block, oldblksize,
+												  blksize);
 		if (block == NULL)
 		{
 			/* Disallow access to the chunk header. */
@@ -53,6 +53,7 @@
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
 #include "storage/dsm.h"
+#include "storage/dsm_impl.h"
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/shmem.h"
@@ -409,6 +410,7 @@ static void add_span_to_fullness_class(dsa_area *area, dsa_area_span *span,
 									   dsa_pointer span_pointer, int fclass);
 static void unlink_segment(dsa_area *area, dsa_segment_map *segment_map);
 static dsa_segment_map *get_best_segment(dsa_area *area, size_t npages);
+static size_t dsa_round_segment_size(size_t size);
 static dsa_segment_map *make_new_segment(dsa_area *area, size_t requested_pages);
 static dsa_area *create_internal(void *place, size_t size,
 								 int tranche_id,
@@ -2056,6 +2058,27 @@ get_best_segment(dsa_area *area, size_t npages)
 	return NULL;
 }
 
+/*
+ * If DSM segments are backed by huge pages, round a segment size up to a
+ * whole number of them, as long as that at most doubles it.  Otherwise the
+ * rest of the last huge page would be allocated but unusable.
+ */
+static size_t
+dsa_round_segment_size(size_t size)
+{
+	size_t		hugepagesize = dsm_impl_huge_page_size();
+	size_t		rounded;
+
+	if (hugepagesize == 0 || size % hugepagesize == 0)
+		return size;
+
+	rounded = (size / hugepagesize + 1) * hugepagesize;
+	if (rounded > size * 2 || rounded > DSA_MAX_SEGMENT_SIZE)
+		return size;
+
+	return rounded;
+}
+
 /*
  * Create a new segment that can handle at least requested_pages.  Returns
  * NULL if the requested total size limit or maximum allowed number of
@@ -2101,12 +2124,13 @@ make_new_segment(dsa_area *area, size_t requested_pages)
 	 * we wouldn't need to use FreePageManager).
 	 *
 	 * We decide on a total segment size first, so that we produce tidy
-	 * power-of-two sized segments.  This is a good property to have if we
-	 * move to huge pages in the future.  Then we work back to the number of
+	 * power-of-two sized segments, which are a whole number of huge pages if
+	 * DSM segments are backed by them.  Then we work back to the number of
 	 * pages we can fit.
 	 */
 	total_size = DSA_INITIAL_SEGMENT_SIZE *
 		((size_t) 1 << (new_index / DSA_NUM_SEGMENTS_AT_EACH_SIZE));
+	total_size = dsa_round_segment_size(total_size);
 	total_size = Min(total_size, DSA_MAX_SEGMENT_SIZE);
 	total_size = Min(total_size,
 					 area->control->max_total_segment_size -
@@ -2152,6 +2176,34 @@ make_new_segment(dsa_area *area, size_t requested_pages)
 		if (total_size > area->control->max_total_segment_size -
 			area->control->total_segment_size)
 			return NULL;
+
+		/* Use the rest of the last huge page too, if we can. */
+		if (dsa_round_segment_size(total_size) != total_size)
+		{
+			size_t		rounded_size = dsa_round_segment_size(total_size);
+			size_t		rounded_metadata_bytes;
+			size_t		rounded_usable_pages;
+
+			rounded_metadata_bytes =
+				MAXALIGN(sizeof(dsa_segment_header)) +
+				MAXALIGN(sizeof(FreePageManager)) +
+				sizeof(dsa_pointer) * (rounded_size / FPM_PAGE_SIZE);
+			if (rounded_metadata_bytes % FPM_PAGE_SIZE != 0)
+				rounded_metadata_bytes +=
+					FPM_PAGE_SIZE - (rounded_metadata_bytes % FPM_PAGE_SIZE);
+			rounded_usable_pages =
+				(rounded_size - rounded_metadata_bytes) / FPM_PAGE_SIZE;
+
+			if (rounded_size <= DSA_MAX_SEGMENT_SIZE &&
+				rounded_size <= area->control->max_total_segment_size -
+				area->control->total_segment_size &&
+				rounded_usable_pages >= requested_pages)
+			{
+				total_size = rounded_size;
+				metadata_bytes = rounded_metadata_bytes;
+				usable_pages = rounded_usable_pages;
+			}
+		}
 	}
 
 	/* Create the segment. */
@@ -361,7 +361,9 @@ GenerationAlloc(MemoryContext context, Size size)
 	{
 		Size		blksize = required_size + Generation_BLOCKHDRSZ;
 
-		block = (GenerationBlock *) malloc(blksize);
+		block = (GenerationBlock *) RetainedBlockGet(&blksize);
+		if (block == NULL)
+			block = (GenerationBlock *) FreshBlock(malloc(blksize), blksize);
 		if (block == NULL)
 			return NULL;
 
@@ -463,7 +465,9 @@ GenerationAlloc(MemoryContext context, Size size)
 			if (blksize < required_size)
 				blksize = pg_nextpower2_size_t(required_size);
 
-			block = (GenerationBlock *) malloc(blksize);
+			block = (GenerationBlock *) RetainedBlockGet(&blksize);
+			if (block == NULL)
+				block = (GenerationBlock *) FreshBlock(malloc(blksize), blksize);
 
 			if (block == NULL)
 				return NULL;
@@ -593,6 +597,8 @@ GenerationBlockFreeBytes(GenerationBlock *block)
 static inline void
 GenerationBlockFree(GenerationContext *set, GenerationBlock *block)
 {
+	Size		blksize = block->blksize;
+
 	/* Make sure nobody tries to free the keeper block */
 	Assert(block != set->keeper);
 	/* We shouldn't be freeing the freeblock either */
@@ -601,13 +607,13 @@ GenerationBlockFree(GenerationContext *set, GenerationBlock *block)
 	/* release the block from the list of blocks */
 	dlist_delete(&block->node);
 
-	((MemoryContext) set)->mem_allocated -= block->blksize;
+	((MemoryContext) set)->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
-	wipe_mem(block, block->blksize);
+	wipe_mem(block, blksize);
 #endif
 
-	free(block);
+	RetainedBlockPut(block, blksize);
 }
 
 /*
@@ -721,7 +727,7 @@ GenerationFree(void *pointer)
 	dlist_delete(&block->node);
 
 	set->header.mem_allocated -= block->blksize;
-	free(block);
+	RetainedBlockPut(block, block->blksize);
 }
 
 /*
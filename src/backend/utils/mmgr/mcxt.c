@@ -85,6 +85,20 @@ static const MemoryContextMethods mcxt_methods[] = {
 	[MCTX_SLAB_ID].check = SlabCheck,
 #endif
 
+	/* bump.c */
+	[MCTX_BUMP_ID].alloc = BumpAlloc,
+	[MCTX_BUMP_ID].free_p = BumpFree,
+	[MCTX_BUMP_ID].realloc = BumpRealloc,
+	[MCTX_BUMP_ID].reset = BumpReset,
+	[MCTX_BUMP_ID].delete_context = BumpDelete,
+	[MCTX_BUMP_ID].get_chunk_context = BumpGetChunkContext,
+	[MCTX_BUMP_ID].get_chunk_space = BumpGetChunkSpace,
+	[MCTX_BUMP_ID].is_empty = BumpIsEmpty,
+	[MCTX_BUMP_ID].stats = BumpStats,
+#ifdef MEMORY_CONTEXT_CHECKING
+	[MCTX_BUMP_ID].check = BumpCheck,
+#endif
+
 	/* alignedalloc.c */
 	[MCTX_ALIGNED_REDIRECT_ID].alloc = NULL,	/* not required */
 	[MCTX_ALIGNED_REDIRECT_ID].free_p = AlignedAllocFree,
@@ -117,11 +131,6 @@ static const MemoryContextMethods mcxt_methods[] = {
 	[MCTX_UNUSED2_ID].get_chunk_context = BogusGetChunkContext,
 	[MCTX_UNUSED2_ID].get_chunk_space = BogusGetChunkSpace,
 
-	[MCTX_UNUSED3_ID].free_p = BogusFree,
-	[MCTX_UNUSED3_ID].realloc = BogusRealloc,
-	[MCTX_UNUSED3_ID].get_chunk_context = BogusGetChunkContext,
-	[MCTX_UNUSED3_ID].get_chunk_space = BogusGetChunkSpace,
-
 	[MCTX_UNUSED4_ID].free_p = BogusFree,
 	[MCTX_UNUSED4_ID].realloc = BogusRealloc,
 	[MCTX_UNUSED4_ID].get_chunk_context = BogusGetChunkContext,
@@ -149,6 +158,9 @@ MemoryContext CurTransactionContext = NULL;
 /* This is a transient link to the active portal's memory context: */
 MemoryContext PortalContext = NULL;
 
+/* Hook for blocks fresh from the operating system */
+fresh_block_hook_type fresh_block_hook = NULL;
+
 static void MemoryContextCallResetCallbacks(MemoryContext context);
 static void MemoryContextStatsInternal(MemoryContext context, int level,
 									   bool print, int max_children,
@@ -687,6 +699,135 @@ MemoryContextMemAllocated(MemoryContext context, bool recurse)
 	return total;
 }
 
+/*
+ * Retained blocks
+ *
+ * glibc returns allocations of more than about 128kB straight to the kernel
+ * when they are freed, so a query that builds big hash tables or sort arrays
+ * faults in fresh pages every time it runs.  Where first touch of a page is
+ * expensive, as in confidential VMs that must accept and validate each new
+ * page, it pays to keep the big blocks that memory contexts give back and
+ * hand them out again to the next query.  Up to retained_work_mem worth of
+ * blocks are kept, and they are released once the session has been idle for
+ * retained_work_mem_idle_timeout.
+ */
+#define RETAINED_BLOCK_MIN_SIZE		(128 * 1024)
+#define RETAINED_BLOCK_SLOTS		64
+
+typedef struct RetainedBlock
+{
+	void	   *block;
+	Size		size;
+} RetainedBlock;
+
+/* GUCs */
+int			retained_work_mem = 0;
+int			retained_work_mem_idle_timeout = 10000;
+
+static RetainedBlock retained_blocks[RETAINED_BLOCK_SLOTS];
+static RetainedMemoryStats retained_stats;
+
+/*
+ * RetainedBlockGet
+ *		Return a retained block of at least *size bytes, or NULL.
+ *
+ * To get more reuse, we accept a block up to a quarter larger than asked
+ * for; *size is set to the size of the block returned, which the caller
+ * should then treat as the block's size.  Callers should only ask for
+ * blocks they'd otherwise get from malloc(), and must give them back with
+ * RetainedBlockPut() or free().
+ */
+void *
+RetainedBlockGet(Size *size)
+{
+	int			best = -1;
+	void	   *block;
+
+	if (*size < RETAINED_BLOCK_MIN_SIZE)
+		return NULL;
+
+	for (int i = 0; i < retained_stats.retained_blocks; i++)
+	{
+		Size		blksize = retained_blocks[i].size;
+
+		if (blksize >= *size && blksize - *size <= *size / 4 &&
+			(best < 0 || blksize < retained_blocks[best].size))
+			best = i;
+	}
+
+	if (best < 0)
+	{
+		if (retained_work_mem > 0)
+		{
+			retained_stats.new_blocks++;
+			retained_stats.new_bytes += *size;
+		}
+		return NULL;
+	}
+
+	block = retained_blocks[best].block;
+	*size = retained_blocks[best].size;
+	retained_stats.retained_blocks--;
+	retained_stats.retained_bytes -= *size;
+	retained_blocks[best] = retained_blocks[retained_stats.retained_blocks];
+	retained_stats.reused_blocks++;
+	retained_stats.reused_bytes += *size;
+
+	return block;
+}
+
+/*
+ * RetainedBlockPut
+ *		Give back a block obtained from malloc() or RetainedBlockGet().
+ *
+ * The block is kept if it is big enough to be worth keeping and there is
+ * room for it; otherwise it is freed.
+ */
+void
+RetainedBlockPut(void *block, Size size)
+{
+	int			n = retained_stats.retained_blocks;
+
+	if (size >= RETAINED_BLOCK_MIN_SIZE &&
+		n < RETAINED_BLOCK_SLOTS &&
+		retained_stats.retained_bytes + size <= (Size) retained_work_mem * 1024)
+	{
+		retained_blocks[n].block = block;
+		retained_blocks[n].size = size;
+		retained_stats.retained_blocks++;
+		retained_stats.retained_bytes += size;
+		return;
+	}
+
+	free(block);
+}
+
+/*
+ * ReleaseRetainedBlocks
+ *		Return all retained blocks to the operating system.
+ */
+void
+ReleaseRetainedBlocks(void)
+{
+	for (int i = 0; i < retained_stats.retained_blocks; i++)
+	{
+		free(retained_blocks[i].block);
+		retained_stats.released_bytes += retained_blocks[i].size;
+	}
+	retained_stats.retained_blocks = 0;
+	retained_stats.retained_bytes = 0;
+}
+
+/*
+ * GetRetainedMemoryStats
+ *		Return this backend's retained-block counters.
+ */
+const RetainedMemoryStats *
+GetRetainedMemoryStats(void)
+{
+	return &retained_stats;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
@@ -0,0 +1,499 @@
+/*-------------------------------------------------------------------------
+ *
+ * membroker.c
+ *	  Instance-wide admission control for query work memory.
+ *
+ * Every sort and hash table of every query is limited by work_mem (or
+ * hash_mem), but nothing limits how many of them run at the same time, so
+ * a burst of concurrent analytic queries can use far more memory than the
+ * machine has.  When admission_memory_budget is set, each query reserves
+ * the memory its plan is expected to use (PlannedStmt.planMemory) from
+ * that budget at executor startup, and gives it back at executor shutdown.
+ *
+ * If the budget is exhausted, the query waits in a queue, first come first
+ * served, for up to admission_wait_timeout.  If the memory still isn't
+ * available by then, the query is "downgraded": it takes whatever is left,
+ * and the memory limits of all its nodes are scaled down by the same factor
+ * (see ExecGetWorkMem()), so that it spills to disk sooner instead.  A query
+ * started while its backend already holds memory (for example, from inside
+ * a function called by another query, or while a cursor is open) never
+ * waits, since it might be waiting for itself.
+ *
+ * Downgrading doesn't let a query jump the queue: while queries that came
+ * before it are still waiting, a downgraded query gets nothing at all, and
+ * runs with the minimum memory limits.  The wait is always bounded, since
+ * the query already holds its locks, and a query holding memory might be
+ * waiting for one of them.
+ *
+ * Parallel workers don't make reservations of their own; the estimate of
+ * the leader already includes them.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/membroker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "storage/backendid.h"
+#include "storage/condition_variable.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/membroker.h"
+#include "utils/timestamp.h"
+#include "utils/wait_event.h"
+
+/* GUC variables */
+int			admission_memory_budget = 0;
+int			admission_wait_timeout = 10000;
+
+typedef enum MemBrokerState
+{
+	MEMBROKER_IDLE,				/* holding no memory */
+	MEMBROKER_WAITING,			/* queued for memory */
+	MEMBROKER_ADMITTED,			/* holding all the memory asked for */
+	MEMBROKER_DOWNGRADED		/* holding less than was asked for */
+} MemBrokerState;
+
+/*
+ * Reservation state of one backend, indexed by BackendId.  Only the owning
+ * backend modifies its slot, always while holding MemoryBrokerLock.
+ */
+typedef struct MemBrokerSlot
+{
+	MemBrokerState state;
+	int			pid;
+	uint64		queryId;		/* query of the latest request */
+	uint64		ticket;			/* position in the queue, while waiting */
+	Size		requested;		/* bytes asked for by the latest request */
+	Size		reserved;		/* bytes currently reserved */
+	TimestampTz wait_start;		/* when the latest request was queued */
+} MemBrokerSlot;
+
+typedef struct MemBrokerShared
+{
+	Size		reserved_total; /* sum of reserved over all slots */
+	int			nwaiting;		/* number of slots in MEMBROKER_WAITING */
+	uint64		next_ticket;	/* next queue position to hand out */
+	ConditionVariable cv;		/* signaled when memory is released */
+	MemBrokerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} MemBrokerShared;
+
+static MemBrokerShared *MemBroker = NULL;
+
+static bool exit_callback_registered = false;
+
+static MemBrokerSlot *MyBrokerSlot(void);
+static bool broker_queued_ahead(MemBrokerSlot *slot);
+static bool broker_can_admit(MemBrokerSlot *slot, Size want, Size budget);
+static Size broker_grant(MemBrokerSlot *slot, Size grant,
+						 MemBrokerState state);
+static Size broker_downgrade(MemBrokerSlot *slot, Size want, Size budget);
+static void MemoryBrokerShmemExit(int code, Datum arg);
+
+
+/*
+ * Report shared-memory space needed by MemoryBrokerShmemInit
+ */
+Size
+MemoryBrokerShmemSize(void)
+{
+	return add_size(offsetof(MemBrokerShared, slots),
+					mul_size(MaxBackends, sizeof(MemBrokerSlot)));
+}
+
+/*
+ * Allocate and initialize the memory broker's shared state
+ */
+void
+MemoryBrokerShmemInit(void)
+{
+	bool		found;
+
+	MemBroker = (MemBrokerShared *)
+		ShmemInitStruct("Memory Broker", MemoryBrokerShmemSize(), &found);
+
+	if (!found)
+	{
+		memset(MemBroker, 0, MemoryBrokerShmemSize());
+		ConditionVariableInit(&MemBroker->cv);
+	}
+}
+
+/*
+ * Return this backend's slot, or NULL if it doesn't have one.
+ */
+static MemBrokerSlot *
+MyBrokerSlot(void)
+{
+	if (MemBroker == NULL ||
+		MyBackendId == InvalidBackendId || MyBackendId > MaxBackends)
+		return NULL;
+	return &MemBroker->slots[MyBackendId - 1];
+}
+
+/*
+ * Is anybody who queued before "slot" still waiting?  If "slot" is not in
+ * the queue, that means anybody at all.
+ *
+ * Caller must hold MemoryBrokerLock.
+ */
+static bool
+broker_queued_ahead(MemBrokerSlot *slot)
+{
+	if (slot->state != MEMBROKER_WAITING)
+		return MemBroker->nwaiting > 0;
+
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		MemBrokerSlot *other = &MemBroker->slots[i];
+
+		if (other->state == MEMBROKER_WAITING && other->ticket < slot->ticket)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Can "want" bytes be granted to "slot" now?  They can if they fit in the
+ * budget, and nobody queued before us is still waiting.
+ *
+ * Caller must hold MemoryBrokerLock.
+ */
+static bool
+broker_can_admit(MemBrokerSlot *slot, Size want, Size budget)
+{
+	if (MemBroker->reserved_total + want > budget)
+		return false;
+
+	return !broker_queued_ahead(slot);
+}
+
+/*
+ * Grant "grant" bytes to "slot", taking it out of the queue if it was
+ * waiting.  Returns "grant".
+ *
+ * Caller must hold MemoryBrokerLock.
+ */
+static Size
+broker_grant(MemBrokerSlot *slot, Size grant, MemBrokerState state)
+{
+	if (slot->state == MEMBROKER_WAITING)
+		MemBroker->nwaiting--;
+	slot->ticket = 0;
+	slot->state = state;
+	slot->reserved += grant;
+	MemBroker->reserved_total += grant;
+
+	return grant;
+}
+
+/*
+ * Downgrade "slot": grant it whatever is left of "want" bytes, unless that
+ * would take memory from queries queued before it, in which case it gets
+ * nothing.  Returns the number of bytes granted.
+ *
+ * Caller must hold MemoryBrokerLock.
+ */
+static Size
+broker_downgrade(MemBrokerSlot *slot, Size want, Size budget)
+{
+	Size		grant = 0;
+
+	if (!broker_queued_ahead(slot) && MemBroker->reserved_total < budget)
+		grant = Min(want, budget - MemBroker->reserved_total);
+
+	return broker_grant(slot, grant, MEMBROKER_DOWNGRADED);
+}
+
+/*
+ * MemoryBrokerReserve
+ *		Reserve "request" bytes of work memory for a query about to start,
+ *		waiting for them if necessary.
+ *
+ * Returns the number of bytes actually reserved, which the caller must pass
+ * to MemoryBrokerRelease() when the query is done.  *scale is set to the
+ * fraction of the request that was granted.
+ */
+Size
+MemoryBrokerReserve(Size request, uint64 queryId, double *scale)
+{
+	MemBrokerSlot *slot;
+	Size		budget;
+	Size		want;
+	Size		grant;
+	bool		nested;
+	bool		wakeup = false;
+
+	*scale = 1.0;
+
+	if (admission_memory_budget <= 0 || request == 0)
+		return 0;
+
+	slot = MyBrokerSlot();
+	if (slot == NULL)
+		return 0;
+
+	if (!exit_callback_registered)
+	{
+		on_shmem_exit(MemoryBrokerShmemExit, 0);
+		exit_callback_registered = true;
+	}
+
+	/* A query asking for more than the whole budget gets the whole budget */
+	budget = (Size) admission_memory_budget * 1024;
+	want = Min(request, budget);
+
+	/* Don't wait for memory that we ourselves are holding */
+	nested = (slot->reserved > 0);
+
+	LWLockAcquire(MemoryBrokerLock, LW_EXCLUSIVE);
+
+	slot->pid = MyProcPid;
+	slot->queryId = queryId;
+	slot->requested = request;
+
+	if (broker_can_admit(slot, want, budget))
+		grant = broker_grant(slot, want, MEMBROKER_ADMITTED);
+	else if (nested || admission_wait_timeout == 0)
+		grant = broker_downgrade(slot, want, budget);
+	else
+	{
+		/* Join the queue */
+		slot->state = MEMBROKER_WAITING;
+		slot->ticket = ++MemBroker->next_ticket;
+		slot->wait_start = GetCurrentTimestamp();
+		MemBroker->nwaiting++;
+		LWLockRelease(MemoryBrokerLock);
+
+		PG_TRY();
+		{
+			TimestampTz deadline;
+
+			deadline = TimestampTzPlusMilliseconds(slot->wait_start,
+												   admission_wait_timeout);
+
+			ConditionVariablePrepareToSleep(&MemBroker->cv);
+			for (;;)
+			{
+				long		timeout;
+
+				LWLockAcquire(MemoryBrokerLock, LW_EXCLUSIVE);
+
+				if (broker_can_admit(slot, want, budget))
+				{
+					grant = broker_grant(slot, want, MEMBROKER_ADMITTED);
+					break;
+				}
+
+				timeout = TimestampDifferenceMilliseconds(GetCurrentTimestamp(),
+														  deadline);
+				if (timeout <= 0)
+				{
+					grant = broker_downgrade(slot, want, budget);
+					break;
+				}
+
+				LWLockRelease(MemoryBrokerLock);
+
+				(void) ConditionVariableTimedSleep(&MemBroker->cv, timeout,
+												   WAIT_EVENT_MEMORY_ADMISSION);
+			}
+			ConditionVariableCancelSleep();
+		}
+		PG_CATCH();
+		{
+			/* Leave the queue, so as not to hold up the queries behind us */
+			LWLockAcquire(MemoryBrokerLock, LW_EXCLUSIVE);
+			if (slot->state == MEMBROKER_WAITING)
+			{
+				MemBroker->nwaiting--;
+				slot->ticket = 0;
+				slot->state = slot->reserved > 0 ?
+					MEMBROKER_ADMITTED : MEMBROKER_IDLE;
+			}
+			LWLockRelease(MemoryBrokerLock);
+			ConditionVariableBroadcast(&MemBroker->cv);
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		/* The next query in the queue may be able to go now */
+		wakeup = (MemBroker->nwaiting > 0);
+	}
+
+	LWLockRelease(MemoryBrokerLock);
+
+	if (wakeup)
+		ConditionVariableBroadcast(&MemBroker->cv);
+
+	*scale = (double) grant / request;
+	return grant;
+}
+
+/*
+ * MemoryBrokerRelease
+ *		Give back memory reserved by MemoryBrokerReserve().
+ */
+void
+MemoryBrokerRelease(Size reserved)
+{
+	MemBrokerSlot *slot = MyBrokerSlot();
+	bool		wakeup;
+
+	/* Nothing to do if we were not using the broker */
+	if (slot == NULL || slot->state == MEMBROKER_IDLE)
+		return;
+
+	LWLockAcquire(MemoryBrokerLock, LW_EXCLUSIVE);
+
+	/* The memory may already have been released at end of transaction */
+	reserved = Min(reserved, slot->reserved);
+	slot->reserved -= reserved;
+	MemBroker->reserved_total -= reserved;
+	if (slot->reserved == 0)
+	{
+		slot->state = MEMBROKER_IDLE;
+		slot->pid = 0;
+	}
+	wakeup = (reserved > 0 && MemBroker->nwaiting > 0);
+
+	LWLockRelease(MemoryBrokerLock);
+
+	if (wakeup)
+		ConditionVariableBroadcast(&MemBroker->cv);
+}
+
+/*
+ * AtEOXact_MemoryBroker
+ *		Release whatever this backend still holds at transaction end.
+ *
+ * Queries that failed never reach ExecutorEnd(), and no query survives the
+ * end of its transaction, so anything still reserved by then is ours to
+ * release.
+ */
+void
+AtEOXact_MemoryBroker(void)
+{
+	MemBrokerSlot *slot = MyBrokerSlot();
+	bool		wakeup;
+
+	if (slot == NULL || slot->state == MEMBROKER_IDLE)
+		return;
+
+	LWLockAcquire(MemoryBrokerLock, LW_EXCLUSIVE);
+
+	Assert(slot->state != MEMBROKER_WAITING);
+	MemBroker->reserved_total -= slot->reserved;
+	wakeup = (slot->reserved > 0 && MemBroker->nwaiting > 0);
+	slot->reserved = 0;
+	slot->state = MEMBROKER_IDLE;
+	slot->pid = 0;
+
+	LWLockRelease(MemoryBrokerLock);
+
+	if (wakeup)
+		ConditionVariableBroadcast(&MemBroker->cv);
+}
+
+/*
+ * MemoryBrokerIsWaiting
+ *		Is the backend with the given PID queued for memory?
+ */
+bool
+MemoryBrokerIsWaiting(int pid)
+{
+	bool		result = false;
+
+	if (MemBroker == NULL || pid == 0)
+		return false;
+
+	LWLockAcquire(MemoryBrokerLock, LW_SHARED);
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		MemBrokerSlot *slot = &MemBroker->slots[i];
+
+		if (slot->pid == pid && slot->state == MEMBROKER_WAITING)
+		{
+			result = true;
+			break;
+		}
+	}
+	LWLockRelease(MemoryBrokerLock);
+
+	return result;
+}
+
+/*
+ * Release our reservations at backend exit.
+ */
+static void
+MemoryBrokerShmemExit(int code, Datum arg)
+{
+	AtEOXact_MemoryBroker();
+}
+
+/*
+ * SQL SRF showing the reservations and waits of all backends.
+ */
+Datum
+pg_get_memory_reservations(PG_FUNCTION_ARGS)
+{
+#define PG_GET_MEMORY_RESERVATIONS_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	LWLockAcquire(MemoryBrokerLock, LW_SHARED);
+
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		MemBrokerSlot *slot = &MemBroker->slots[i];
+		Datum		values[PG_GET_MEMORY_RESERVATIONS_COLS];
+		bool		nulls[PG_GET_MEMORY_RESERVATIONS_COLS] = {0};
+		const char *state;
+
+		switch (slot->state)
+		{
+			case MEMBROKER_WAITING:
+				state = "waiting";
+				break;
+			case MEMBROKER_ADMITTED:
+				state = "admitted";
+				break;
+			case MEMBROKER_DOWNGRADED:
+				state = "downgraded";
+				break;
+			default:
+				continue;
+		}
+
+		values[0] = Int32GetDatum(slot->pid);
+		if (slot->queryId != 0)
+			values[1] = UInt64GetDatum(slot->queryId);
+		else
+			nulls[1] = true;
+		values[2] = CStringGetTextDatum(state);
+		values[3] = Int64GetDatum(slot->requested);
+		values[4] = Int64GetDatum(slot->reserved);
+		if (slot->state == MEMBROKER_WAITING)
+			values[5] = TimestampTzGetDatum(slot->wait_start);
+		else
+			nulls[5] = true;
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(MemoryBrokerLock);
+
+	return (Datum) 0;
+}
@@ -539,7 +539,8 @@ SlabAlloc(MemoryContext context, Size size)
 		}
 		else
 		{
-			block = (SlabBlock *) malloc(slab->blockSize);
+			block = (SlabBlock *) FreshBlock(malloc(slab->blockSize),
+											 slab->blockSize);
 
 			if (unlikely(block == NULL))
 				return NULL;
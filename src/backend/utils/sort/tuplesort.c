@@ -196,6 +196,11 @@ struct Tuplesortstate
 	int			bound;			/* if bounded, the maximum number of tuples */
 	int64		availMem;		/* remaining memory available, in bytes */
 	int64		allowedMem;		/* total memory allowed, in bytes */
+	int64		tupleMem;		/* memory consumed by individual tuples.
+								 * storing this separately from what we track
+								 * in availMem allows us to subtract the
+								 * memory consumed by all tuples when dumping
+								 * tuples to tape */
 	int			maxTapes;		/* max number of input tapes to merge in each
 								 * pass */
 	int64		maxSpace;		/* maximum amount of space occupied among sort
@@ -439,10 +444,12 @@ struct Sharedsort
  * the space used by the variable-size memtuples array.  Fixed-size space
  * is not counted; it's small enough to not be interesting.
  *
- * Note that we count actual space used (as shown by GetMemoryChunkSpace)
- * rather than the originally-requested size.  This is important since
- * palloc can add substantial overhead.  It's not a complete answer since
- * we won't count any wasted space in palloc allocation blocks, but it's
+ * Note that we count actual space used (as shown by GetMemoryChunkSpace,
+ * or, for tuples in a bump context, which have no chunk header, the
+ * MAXALIGN'd tuple size) rather than the originally-requested size.  This
+ * is important since palloc can add substantial overhead.  It's not a
+ * complete answer since we won't count any wasted space in palloc
+ * allocation blocks, but it's
  * a lot better than what we were doing before 7.3.  As of 9.6, a
  * separate memory context is used for caller passed tuples.  Resetting
  * it at certain key increments significantly ameliorates fragmentation.
@@ -661,6 +668,7 @@ tuplesort_begin_common(int workMem, SortCoordinate coordinate, int sortopt)
 	maincontext = AllocSetContextCreate(CurrentMemoryContext,
 										"TupleSort main",
 										ALLOCSET_DEFAULT_SIZES);
+	AllocSetUseHugePages(maincontext);
 
 	/*
 	 * Create a working memory context for one sort operation.  The content of
@@ -770,18 +778,18 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.  For bounded sorts, tuples may be pfreed in any
 	 * order, so we use a regular aset.c context so that it can make use of
-	 * free'd memory.  When the sort is not bounded, we make use of a
-	 * generation.c context as this keeps allocations more compact with less
-	 * wastage.  Allocations are also slightly more CPU efficient.
-	 */
-	if (state->base.sortopt & TUPLESORT_ALLOWBOUNDED)
+	 * free'd memory.  When the sort is not bounded, we make use of a bump.c
+	 * context as this keeps allocations more compact with less wastage.
+	 * Allocations are also slightly more CPU efficient.
+	 */
+	if (TupleSortUseBumpTupleCxt(state->base.sortopt))
+		state->base.tuplecontext = BumpContextCreate(state->base.sortcontext,
+													 "Caller tuples",
+													 ALLOCSET_DEFAULT_SIZES);
+	else
 		state->base.tuplecontext = AllocSetContextCreate(state->base.sortcontext,
 														 "Caller tuples",
 														 ALLOCSET_DEFAULT_SIZES);
-	else
-		state->base.tuplecontext = GenerationContextCreate(state->base.sortcontext,
-														   "Caller tuples",
-														   ALLOCSET_DEFAULT_SIZES);
 
 
 	state->status = TSS_INITIAL;
@@ -789,6 +797,7 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	state->boundUsed = false;
 
 	state->availMem = state->allowedMem;
+	state->tupleMem = 0;
 
 	state->tapeset = NULL;
 
@@ -1187,15 +1196,16 @@ noalloc:
  * Shared code for tuple and datum cases.
  */
 void
-tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple, bool useAbbrev)
+tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple,
+						  bool useAbbrev, Size tuplen)
 {
 	MemoryContext oldcontext = MemoryContextSwitchTo(state->base.sortcontext);
 
 	Assert(!LEADER(state));
 
-	/* Count the size of the out-of-line data */
-	if (tuple->tuple != NULL)
-		USEMEM(state, GetMemoryChunkSpace(tuple->tuple));
+	/* account for the memory used for this tuple */
+	USEMEM(state, tuplen);
+	state->tupleMem += tuplen;
 
 	if (!useAbbrev)
 	{
@@ -2403,13 +2413,6 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 		SortTuple  *stup = &state->memtuples[i];
 
 		WRITETUP(state, state->destTape, stup);
-
-		/*
-		 * Account for freeing the tuple, but no need to do the actual pfree
-		 * since the tuplecontext is being reset after the loop.
-		 */
-		if (stup->tuple != NULL)
-			FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
 	}
 
 	state->memtupcount = 0;
@@ -2423,6 +2426,13 @@ dumptuples(Tuplesortstate *state, bool alltuples)
 	 */
 	MemoryContextReset(state->base.tuplecontext);
 
+	/*
+	 * Now update the memory accounting to subtract the memory used by the
+	 * tuples.
+	 */
+	FREEMEM(state, state->tupleMem);
+	state->tupleMem = 0;
+
 	markrunend(state->destTape);
 
 #ifdef TRACE_SORT
@@ -2527,6 +2537,19 @@ tuplesort_restorepos(Tuplesortstate *state)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * tuplesort_memory_allocated - memory currently held by the sort
+ *
+ * Unlike the space reported by tuplesort_get_stats, this is what the memory
+ * contexts actually hold, including their overhead, and it can be called at
+ * any time.
+ */
+Size
+tuplesort_memory_allocated(Tuplesortstate *state)
+{
+	return MemoryContextMemAllocated(state->base.maincontext, true);
+}
+
 /*
  * tuplesort_get_stats - extract summary statistics
  *
@@ -3167,7 +3190,10 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 {
 	if (stup->tuple)
 	{
-		FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
+		Size		tuplen = GetMemoryChunkSpace(stup->tuple);
+
+		FREEMEM(state, tuplen);
+		state->tupleMem -= tuplen;
 		pfree(stup->tuple);
 		stup->tuple = NULL;
 	}
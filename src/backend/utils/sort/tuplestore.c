@@ -1457,6 +1457,20 @@ tuplestore_in_memory(Tuplestorestate *state)
 	return (state->status == TSS_INMEM);
 }
 
+/*
+ * tuplestore_memory_used
+ *
+ * Returns the memory currently charged against the tuplestore's limit, that
+ * is the in-memory tuples and the array of pointers to them.
+ */
+Size
+tuplestore_memory_used(Tuplestorestate *state)
+{
+	int64		used = state->allowedMem - state->availMem;
+
+	return (Size) Max(used, 0);
+}
+
 
 /*
  * Tape interface routines
@@ -1,7 +1,9 @@
 /*
  *	pg_test_timing.c
  *		tests overhead of timing calls and their monotonicity:	that
- *		they always move forward
+ *		they always move forward.  Both the system clock and, where
+ *		available, the CPU's time stamp counter are tested, unless
+ *		--clock-source picks one the way timing_clock_source would.
  */
 
 #include "postgres_fe.h"
@@ -15,7 +17,11 @@ static const char *progname;
 
 static unsigned int test_duration = 3;
 
+/* clock source to test, or -1 to test both clocks */
+static int	clock_source = -1;
+
 static void handle_args(int argc, char *argv[]);
+static void test_clock_source(TimingClockSource source);
 static uint64 test_timing(unsigned int duration);
 static void output(uint64 loop_count);
 
@@ -25,16 +31,18 @@ long long int histogram[32];
 int
 main(int argc, char *argv[])
 {
-	uint64		loop_count;
-
 	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_test_timing"));
 	progname = get_progname(argv[0]);
 
 	handle_args(argc, argv);
 
-	loop_count = test_timing(test_duration);
-
-	output(loop_count);
+	if (clock_source >= 0)
+		test_clock_source((TimingClockSource) clock_source);
+	else
+	{
+		test_clock_source(TIMING_CLOCK_SOURCE_SYSTEM);
+		test_clock_source(TIMING_CLOCK_SOURCE_TSC);
+	}
 
 	return 0;
 }
@@ -44,6 +52,7 @@ handle_args(int argc, char *argv[])
 {
 	static struct option long_options[] = {
 		{"duration", required_argument, NULL, 'd'},
+		{"clock-source", required_argument, NULL, 'c'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -56,7 +65,7 @@ handle_args(int argc, char *argv[])
 	{
 		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
 		{
-			printf(_("Usage: %s [-d DURATION]\n"), progname);
+			printf(_("Usage: %s [-d DURATION] [-c CLOCK_SOURCE]\n"), progname);
 			exit(0);
 		}
 		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
@@ -66,11 +75,28 @@ handle_args(int argc, char *argv[])
 		}
 	}
 
-	while ((option = getopt_long(argc, argv, "d:",
+	while ((option = getopt_long(argc, argv, "c:d:",
 								 long_options, &optindex)) != -1)
 	{
 		switch (option)
 		{
+			case 'c':
+				/* the same values as the timing_clock_source setting */
+				if (strcmp(optarg, "auto") == 0)
+					clock_source = TIMING_CLOCK_SOURCE_AUTO;
+				else if (strcmp(optarg, "system") == 0)
+					clock_source = TIMING_CLOCK_SOURCE_SYSTEM;
+				else if (strcmp(optarg, "tsc") == 0)
+					clock_source = TIMING_CLOCK_SOURCE_TSC;
+				else
+				{
+					fprintf(stderr, _("%s: invalid argument for option %s\n"),
+							progname, "--clock-source");
+					fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+					exit(1);
+				}
+				break;
+
 			case 'd':
 				errno = 0;
 				optval = strtoul(optarg, &endptr, 10);
@@ -112,10 +138,51 @@ handle_args(int argc, char *argv[])
 	}
 
 
-	printf(ngettext("Testing timing overhead for %u second.\n",
-					"Testing timing overhead for %u seconds.\n",
-					test_duration),
-		   test_duration);
+	if (clock_source >= 0)
+		printf(ngettext("Testing timing overhead for %u second.\n",
+						"Testing timing overhead for %u seconds.\n",
+						test_duration),
+			   test_duration);
+	else
+		printf(ngettext("Testing timing overhead for %u second per clock source.\n",
+						"Testing timing overhead for %u seconds per clock source.\n",
+						test_duration),
+			   test_duration);
+}
+
+/*
+ * Run the test and print the results for one clock source, if the machine
+ * has it.
+ */
+static void
+test_clock_source(TimingClockSource source)
+{
+	uint64		loop_count;
+
+	printf("\n");
+
+	if (!pg_initialize_timing(source))
+	{
+		if (source == TIMING_CLOCK_SOURCE_TSC)
+		{
+			printf(_("Time stamp counter is not available on this system.\n"));
+			return;
+		}
+		printf(_("System clock (%s):\n"), pg_timing_clock_source_name());
+	}
+	else
+	{
+#ifdef PG_INSTR_TSC
+		printf(_("Time stamp counter (%.3f GHz, %s):\n"),
+			   1.0 / pg_instr_tsc_ns_per_tick,
+			   pg_tsc_usable() ? _("reliable, used by default") :
+			   _("not known to be reliable, not used by default"));
+#endif
+	}
+
+	memset(histogram, 0, sizeof(histogram));
+	loop_count = test_timing(test_duration);
+	output(loop_count);
 }
 
 static uint64
@@ -25,5 +25,32 @@ command_fails_like(
 	[ 'pg_test_timing', '--duration', '0' ],
 	qr/\Qpg_test_timing: --duration must be in range 1..4294967295\E/,
 	'pg_test_timing: --duration must be in range');
+command_fails_like(
+	[ 'pg_test_timing', '--clock-source', 'hpet' ],
+	qr/\Qpg_test_timing: invalid argument for option --clock-source\E/,
+	'pg_test_timing: invalid argument for option --clock-source');
+
+#########################################
+# Test each clock source
+
+# The TSC may be missing, or not known to be reliable, so "tsc" might not
+# test anything, and "auto" might test either clock.
+my %expected = (
+	auto => qr/^(System clock|Time stamp counter) \(.*\):\n.*Histogram of timing durations/ms,
+	system => qr/^System clock \(.*\):\n.*Histogram of timing durations/ms,
+	tsc => qr/^(Time stamp counter \(.*\):\n.*Histogram of timing durations|Time stamp counter is not available)/ms);
+
+foreach my $source ('auto', 'system', 'tsc')
+{
+	command_like(
+		[ 'pg_test_timing', '--duration', '1', '--clock-source', $source ],
+		$expected{$source},
+		"pg_test_timing with clock source $source");
+}
+
+command_like(
+	[ 'pg_test_timing', '--duration', '1' ],
+	qr/^System clock \(.*^Time stamp counter/ms,
+	'pg_test_timing tests both clocks by default');
 
 done_testing();
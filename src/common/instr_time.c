@@ -0,0 +1,193 @@
+/*-------------------------------------------------------------------------
+ *
+ * instr_time.c
+ *	  Selection and calibration of the clock behind instr_time
+ *
+ * Most platforms only have one way to read the time, and instr_time.h
+ * handles those entirely with inline code.  On x86-64 we may instead use the
+ * CPU's time stamp counter, which has to be checked for reliability and
+ * have its frequency measured before use; that's what this file does.
+ *
+ * Copyright (c) 2001-2023, PostgreSQL Global Development Group
+ *
+ * src/common/instr_time.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
+
+#include "portability/instr_time.h"
+
+#ifdef PG_INSTR_TSC
+
+/* how long to compare the TSC against the system clock */
+#define TSC_CALIBRATION_NS	(10 * NS_PER_MS)
+
+bool		pg_instr_use_tsc = false;
+double		pg_instr_tsc_ns_per_tick = 0;
+
+/*
+ * Does the CPU have RDTSCP?  We also insist on that for plain RDTSC reads,
+ * because every CPU with an invariant TSC has it, and it's a cheap way to
+ * rule out very old or oddly configured (virtual) CPUs.
+ */
+static bool
+tsc_has_rdtscp(void)
+{
+#ifdef HAVE__GET_CPUID
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+
+	if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+		return (edx & (1 << 27)) != 0;
+#endif
+	return false;
+}
+
+/*
+ * Does the TSC tick at a constant rate, independent of frequency scaling and
+ * sleep states, and in step across all cores?
+ */
+static bool
+tsc_is_invariant(void)
+{
+#ifdef HAVE__GET_CPUID
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+
+	if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) &&
+		(edx & (1 << 8)) != 0)
+		return true;
+#endif
+
+#ifdef __linux__
+
+	/*
+	 * Hypervisors often hide the invariant-TSC flag even when the guest's TSC
+	 * is perfectly usable.  If the kernel has vetted the TSC and chose it as
+	 * its own clock source, that's good enough for us too.
+	 */
+	{
+		FILE	   *f;
+		char		buf[32];
+		bool		result = false;
+
+		f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+		if (f != NULL)
+		{
+			if (fgets(buf, sizeof(buf), f) != NULL)
+				result = (strcmp(buf, "tsc\n") == 0);
+			fclose(f);
+		}
+		return result;
+	}
+#else
+	return false;
+#endif
+}
+
+/*
+ * Measure the TSC's frequency by counting cycles across a known interval of
+ * the system clock, returning nanoseconds per cycle.  Each clock read costs
+ * at most a few microseconds even on slow virtual machines, which over the
+ * calibration interval is an error well below what matters for
+ * instrumentation.
+ */
+static double
+tsc_calibrate(void)
+{
+	instr_time	start,
+				now;
+	uint64		tsc_start,
+				tsc_now;
+	unsigned int aux;
+
+	start = pg_clock_gettime_ns();
+	tsc_start = __builtin_ia32_rdtscp(&aux);
+	do
+	{
+		now = pg_clock_gettime_ns();
+		tsc_now = __builtin_ia32_rdtscp(&aux);
+	} while (now.ticks - start.ticks < TSC_CALIBRATION_NS);
+
+	if (tsc_now <= tsc_start)
+		return 0;
+
+	return (double) (now.ticks - start.ticks) / (double) (tsc_now - tsc_start);
+}
+
+#endif							/* PG_INSTR_TSC */
+
+/*
+ * Can the TSC be trusted for interval timing on this machine?
+ */
+bool
+pg_tsc_usable(void)
+{
+#ifdef PG_INSTR_TSC
+	return tsc_has_rdtscp() && tsc_is_invariant();
+#else
+	return false;
+#endif
+}
+
+/*
+ * Choose the clock that instr_time readings come from, returning true if the
+ * TSC was selected.
+ *
+ * This must be called before any instr_time values are taken that will be
+ * compared with values taken afterwards, since the two clocks count in
+ * different units.  Child processes inherit the choice across fork().
+ *
+ * TIMING_CLOCK_SOURCE_TSC skips the invariance check, for machines where we
+ * can't detect it but the user knows better.
+ */
+bool
+pg_initialize_timing(TimingClockSource source)
+{
+#ifdef PG_INSTR_TSC
+	pg_instr_use_tsc = false;
+
+	if (source == TIMING_CLOCK_SOURCE_SYSTEM)
+		return false;
+	if (!tsc_has_rdtscp())
+		return false;
+	if (source == TIMING_CLOCK_SOURCE_AUTO && !tsc_is_invariant())
+		return false;
+
+	pg_instr_tsc_ns_per_tick = tsc_calibrate();
+	if (pg_instr_tsc_ns_per_tick <= 0)
+		return false;
+
+	pg_instr_use_tsc = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Describe the clock currently in use, for diagnostic output.
+ */
+const char *
+pg_timing_clock_source_name(void)
+{
+#ifdef PG_INSTR_TSC
+	if (pg_instr_use_tsc)
+		return "tsc";
+#endif
+#ifdef WIN32
+	return "QueryPerformanceCounter";
+#else
+	return "clock_gettime";
+#endif
+}
@@ -57,6 +57,7 @@ typedef struct ParallelWorkerContext
 extern PGDLLIMPORT volatile sig_atomic_t ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
+extern PGDLLIMPORT int parallel_worker_prestart;
 
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
@@ -76,7 +77,9 @@ extern void HandleParallelMessages(void);
 extern void AtEOXact_Parallel(bool isCommit);
 extern void AtEOSubXact_Parallel(bool isCommit, SubTransactionId mySubId);
 extern void ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end);
+extern void AdjustPrestartedWorkers(void);
 
 extern void ParallelWorkerMain(Datum main_arg);
+extern void ParallelWorkerPrestartMain(Datum main_arg);
 
 #endif							/* PARALLEL_H */
@@ -43,6 +43,9 @@ typedef struct QueryDesc
 	QueryEnvironment *queryEnv; /* query environment passed in */
 	int			instrument_options; /* OR of InstrumentOption flags */
 
+	/* Set to 1.0 by CreateQueryDesc; parallel workers get the leader's */
+	double		work_mem_scale; /* scale factor for node memory limits */
+
 	/* These fields are set by ExecutorStart */
 	TupleDesc	tupDesc;		/* descriptor for result tuples */
 	EState	   *estate;			/* executor's query-wide state */
@@ -328,6 +328,7 @@ typedef struct HashJoinTableData
 	int			nbatch_outstart;	/* nbatch when we started outer scan */
 
 	bool		growEnabled;	/* flag to shut off nbatch increases */
+	bool		stopWhenFull;	/* stop building rather than increase nbatch */
 
 	double		totalTuples;	/* # tuples obtained from inner plan */
 	double		partialTuples;	/* # tuples obtained from inner plan by me */
@@ -355,6 +356,7 @@ typedef struct HashJoinTableData
 
 	Size		spaceUsed;		/* memory space currently used by tuples */
 	Size		spaceAllowed;	/* upper limit for space used */
+	Size		hashMemLimit;	/* hash_mem, or the node's assigned limit */
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
 	Size		spaceAllowedSkew;	/* upper limit for skew hashtable */
@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeAdaptivejoin.h
+ *
+ *
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/nodeAdaptivejoin.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef NODEADAPTIVEJOIN_H
+#define NODEADAPTIVEJOIN_H
+
+#include "nodes/execnodes.h"
+
+extern AdaptiveJoinState *ExecInitAdaptiveJoin(AdaptiveJoin *node, EState *estate, int eflags);
+extern void ExecEndAdaptiveJoin(AdaptiveJoinState *node);
+extern void ExecReScanAdaptiveJoin(AdaptiveJoinState *node);
+
+#endif							/* NODEADAPTIVEJOIN_H */
@@ -66,6 +66,7 @@ extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 									bool try_combined_hash_mem,
 									int parallel_workers,
+									size_t hash_mem_limit,
 									size_t *space_allowed,
 									int *numbuckets,
 									int *numbatches,
@@ -14,19 +14,48 @@
 #ifndef TQUEUE_H
 #define TQUEUE_H
 
+#include <signal.h>
+
 #include "storage/shm_mq.h"
 #include "tcop/dest.h"
+#include "utils/dsa.h"
 
-/* Opaque struct, only known inside tqueue.c. */
+/* Opaque structs, only known inside tqueue.c. */
 typedef struct TupleQueueReader TupleQueueReader;
+typedef struct TupleQueueChunkPool TupleQueueChunkPool;
+
+/* GUC variables */
+extern PGDLLIMPORT int parallel_tuple_batch_size;
+extern PGDLLIMPORT int parallel_tuple_batch_delay;
+extern PGDLLIMPORT bool parallel_tuple_zero_copy;
 
 /* Use this to send tuples to a shm_mq. */
 extern DestReceiver *CreateTupleQueueDestReceiver(shm_mq_handle *handle);
+extern void TupleQueueDestReceiverUseChunks(DestReceiver *self,
+											dsa_area *area,
+											TupleQueueChunkPool *pool);
+
+/* Flush batched tuples once parallel_tuple_batch_delay has expired. */
+extern PGDLLIMPORT volatile sig_atomic_t TupleQueueFlushPending;
+extern void HandleTupleQueueFlush(void);
 
 /* Use these to receive tuples from a shm_mq. */
 extern TupleQueueReader *CreateTupleQueueReader(shm_mq_handle *handle);
+extern void TupleQueueReaderUseChunks(TupleQueueReader *reader,
+									  dsa_area *area,
+									  TupleQueueChunkPool *pool);
 extern void DestroyTupleQueueReader(TupleQueueReader *reader);
 extern MinimalTuple TupleQueueReaderNext(TupleQueueReader *reader,
 										 bool nowait, bool *done);
 
+/* Use these to manage DSA chunks for passing tuples without copying them. */
+extern dsa_pointer CreateTupleQueueChunkPools(dsa_area *area, int nqueues);
+extern void ResetTupleQueueChunkPools(dsa_area *area, dsa_pointer pools_dp,
+									  int nqueues);
+extern void FreeTupleQueueChunkPools(dsa_area *area, dsa_pointer pools_dp,
+									 int nqueues);
+extern TupleQueueChunkPool *GetTupleQueueChunkPool(dsa_area *area,
+												   dsa_pointer pools_dp,
+												   int n);
+
 #endif							/* TQUEUE_H */
@@ -717,6 +717,14 @@ typedef struct EState
 	 */
 	List	   *es_insert_pending_result_relations;
 	List	   *es_insert_pending_modifytables;
+
+	/*
+	 * Memory reserved for the query from the instance-wide memory broker, in
+	 * bytes, and the factor by which the memory limits of its nodes have to
+	 * be scaled down if the broker could not grant all of it.
+	 */
+	Size		es_mem_reserved;
+	double		es_work_mem_scale;
 } EState;
 
 
@@ -2129,6 +2137,56 @@ typedef struct HashJoinState
 	bool		hj_OuterNotEmpty;
 } HashJoinState;
 
+/* ----------------
+ *	 AdaptiveJoinState information
+ *
+ *		aj_NeedNewOuter			true if need new outer tuple on next call
+ *		aj_MatchedOuter			true if found a join match for current outer
+ *		aj_HashMode				true once the hash table has been built and
+ *								outer tuples are joined by probing it
+ *		aj_CanSwitch			false if the hash table turned out not to fit
+ *								in a single batch; stay a nested loop then
+ *		aj_OuterRows			outer tuples read since (re)start
+ *		aj_SwitchedAt			aj_OuterRows when the hash table was built,
+ *								for EXPLAIN ANALYZE (0 if never)
+ *		aj_HashState			state of the Hash node below us
+ *		aj_HashTable			hash table (NULL if not built yet)
+ *		aj_HashTupleSlot		tuple slot for inner (hashed) tuples
+ *		aj_CurHashValue			hash value for current outer tuple
+ *		aj_CurBucketNo			bucket# for current outer tuple
+ *		aj_CurTuple				last inner tuple matched to current outer
+ *								tuple, or NULL if starting search
+ *		aj_OuterHashKeys		the outer hash keys in the hash condition
+ *		aj_HashClauses			the hash condition
+ *		aj_HashJoinQual			join quals checked besides the hash condition
+ *		aj_NullInnerTupleSlot	prepared null tuple for left outer joins
+ *
+ *	js.joinqual holds the join quals of the nested loop mode.
+ * ----------------
+ */
+typedef struct AdaptiveJoinState
+{
+	pg_node_attr(nodetag_number(458))
+
+	JoinState	js;				/* its first field is NodeTag */
+	bool		aj_NeedNewOuter;
+	bool		aj_MatchedOuter;
+	bool		aj_HashMode;
+	bool		aj_CanSwitch;
+	int64		aj_OuterRows;
+	int64		aj_SwitchedAt;
+	struct HashState *aj_HashState;
+	HashJoinTable aj_HashTable;
+	TupleTableSlot *aj_HashTupleSlot;
+	uint32		aj_CurHashValue;
+	int			aj_CurBucketNo;
+	HashJoinTuple aj_CurTuple;
+	List	   *aj_OuterHashKeys;	/* list of ExprState nodes */
+	ExprState  *aj_HashClauses;
+	ExprState  *aj_HashJoinQual;
+	TupleTableSlot *aj_NullInnerTupleSlot;
+} AdaptiveJoinState;
+
 
 /* ----------------------------------------------------------------
  *				 Materialization State Information
@@ -2425,7 +2483,8 @@ typedef struct AggState
 	/* these fields are used in AGG_HASHED and AGG_MIXED modes: */
 	bool		table_filled;	/* hash table filled yet? */
 	int			num_hashes;
-	MemoryContext hash_metacxt; /* memory for hash table itself */
+	MemoryContext hash_metacxt; /* memory for hash table bucket array */
+	MemoryContext hash_tablecxt;	/* memory for hash table entries */
 	struct LogicalTapeSet *hash_tapeset;	/* tape set for hash spill tapes */
 	struct HashAggSpill *hash_spills;	/* HashAggSpill for each grouping set,
 										 * exists only during first pass */
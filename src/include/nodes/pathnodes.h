@@ -2120,6 +2120,30 @@ typedef struct HashPath
 	Cardinality inner_rows_total;	/* total inner rows expected */
 } HashPath;
 
+/*
+ * An adaptive join path runs as the nested loop described by jpath, whose
+ * inner path is parameterized by the outer relation, until more than
+ * crossover_rows outer rows have been seen; then it hashes hashinnerpath,
+ * an unparameterized path for the same inner relation, and joins the rest
+ * as a hash join would, with path_hashclauses and hash_restrictinfo taking
+ * the roles of HashPath's path_hashclauses and joinrestrictinfo.  (The
+ * nested loop's joinrestrictinfo lacks the clauses its inner path
+ * enforces, so the hash join needs its own list.)
+ *
+ * The hash table is expected to fit in a single batch.
+ */
+
+typedef struct AdaptiveJoinPath
+{
+	pg_node_attr(nodetag_number(457))
+
+	JoinPath	jpath;
+	Path	   *hashinnerpath;	/* unparameterized path for the inner rel */
+	List	   *path_hashclauses;	/* join clauses used for hashing */
+	List	   *hash_restrictinfo;	/* RestrictInfos to apply when hashing */
+	Cardinality crossover_rows; /* outer rows after which to hash */
+} AdaptiveJoinPath;
+
 /*
  * ProjectionPath represents a projection (that is, targetlist computation)
  *
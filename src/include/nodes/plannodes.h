@@ -68,6 +68,8 @@ typedef struct PlannedStmt
 
 	int			jitFlags;		/* which forms of JIT should be performed */
 
+	int			planMemory;		/* estimated work memory needed, in kB */
+
 	struct Plan *planTree;		/* tree of Plan nodes */
 
 	List	   *rtable;			/* list of RangeTblEntry nodes */
@@ -93,6 +95,13 @@ typedef struct PlannedStmt
 
 	List	   *paramExecTypes; /* type OIDs for PARAM_EXEC Params */
 
+	/*
+	 * Private data of extensions, added by their planner_hook: a list of
+	 * DefElems, each named after the extension that added it.  Unlike state
+	 * kept by the extension itself, this goes wherever the plan goes.
+	 */
+	List	   *extensionState;
+
 	Node	   *utilityStmt;	/* non-null if this is utility stmt */
 
 	/* statement location in source string (copied from Query) */
@@ -135,6 +144,12 @@ typedef struct Plan
 	Cardinality plan_rows;		/* number of rows plan is expected to emit */
 	int			plan_width;		/* average row width in bytes */
 
+	/*
+	 * memory limit assigned to this node out of query_work_mem, in kB; zero
+	 * means the node is limited by work_mem (or hash_mem) as usual
+	 */
+	int			workmem_limit;
+
 	/*
 	 * information needed for parallel query
 	 */
@@ -872,6 +887,35 @@ typedef struct HashJoin
 	List	   *hashkeys;
 } HashJoin;
 
+/* ----------------
+ *		adaptive join node
+ *
+ * An adaptive join starts as a nested loop: righttree is a plan for the
+ * inner relation parameterized by the outer one, fed through nestParams as
+ * in NestLoop, and joinqual holds the join clauses it doesn't enforce
+ * itself.  Once more than crossover_rows outer rows have been read, it
+ * builds a hash table with hashplan, a Hash node over an unparameterized
+ * plan for the same inner relation, and joins the remaining outer rows
+ * using hashclauses, hashkeys and hashjoinqual, as HashJoin would.  Each
+ * outer row is joined in just one of the two ways, so no result row is
+ * produced twice.  Both inner plans emit the same target list.
+ * ----------------
+ */
+typedef struct AdaptiveJoin
+{
+	pg_node_attr(nodetag_number(456))
+
+	Join		join;
+	List	   *nestParams;		/* list of NestLoopParam nodes */
+	Plan	   *hashplan;		/* Hash node over the unparameterized inner */
+	List	   *hashclauses;
+	List	   *hashoperators;
+	List	   *hashcollations;
+	List	   *hashkeys;		/* outer hash keys, as in HashJoin */
+	List	   *hashjoinqual;	/* join quals besides hashclauses */
+	Cardinality crossover_rows; /* outer rows after which to hash */
+} AdaptiveJoin;
+
 /* ----------------
  *		materialization node
  * ----------------
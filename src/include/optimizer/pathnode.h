@@ -208,6 +208,9 @@ extern HashPath *create_hashjoin_path(PlannerInfo *root,
 									  List *restrict_clauses,
 									  Relids required_outer,
 									  List *hashclauses);
+extern AdaptiveJoinPath *create_adaptivejoin_path(PlannerInfo *root,
+												  NestPath *nlpath,
+												  HashPath *hashpath);
 
 extern ProjectionPath *create_projection_path(PlannerInfo *root,
 											  RelOptInfo *rel,
@@ -20,6 +20,7 @@
 /* GUC parameters */
 #define DEFAULT_CURSOR_TUPLE_FRACTION 0.1
 extern PGDLLIMPORT double cursor_tuple_fraction;
+extern PGDLLIMPORT int query_work_mem;
 
 /* query_planner callback to compute query_pathkeys */
 typedef void (*query_pathkeys_callback) (PlannerInfo *root, void *extra);
@@ -120,4 +121,10 @@ extern void record_plan_function_dependency(PlannerInfo *root, Oid funcid);
 extern void record_plan_type_dependency(PlannerInfo *root, Oid typid);
 extern bool extract_query_dependencies_walker(Node *node, PlannerInfo *context);
 
+/*
+ * prototypes for plan/workmem.c
+ */
+extern void assign_query_work_mem(Plan *top_plan, List *subplans);
+extern int	estimate_plan_memory(Plan *top_plan, List *subplans);
+
 #endif							/* PLANMAIN_H */
@@ -14,6 +14,7 @@
 #include "datatype/timestamp.h"
 #include "portability/instr_time.h"
 #include "postmaster/pgarch.h"	/* for MAX_XFN_CHARS */
+#include "storage/relfilelocator.h"
 #include "utils/backend_progress.h" /* for backward compatibility */
 #include "utils/backend_status.h"	/* for backward compatibility */
 #include "utils/relcache.h"
@@ -235,7 +236,7 @@ typedef struct PgStat_TableXactStatus
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAC
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAD
 
 typedef struct PgStat_ArchiverStats
 {
@@ -305,10 +306,19 @@ typedef enum IOOp
 
 #define IOOP_NUM_TYPES (IOOP_WRITEBACK + 1)
 
+/*
+ * Timed IO operations are also counted in log-scale latency histograms:
+ * bucket i counts operations that took from 2^i to 2^(i+1) microseconds,
+ * except that the first and last buckets are open-ended.  An operation on
+ * several blocks counts once.
+ */
+#define PGSTAT_IO_HIST_BUCKETS 24
+
 typedef struct PgStat_BktypeIO
 {
 	PgStat_Counter counts[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
 	PgStat_Counter times[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
+	PgStat_Counter hists[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES][PGSTAT_IO_HIST_BUCKETS];
 } PgStat_BktypeIO;
 
 typedef struct PgStat_IO
@@ -317,6 +327,22 @@ typedef struct PgStat_IO
 	PgStat_BktypeIO stats[BACKEND_NUM_TYPES];
 } PgStat_IO;
 
+/*
+ * With track_io_relations, timed IO on permanent relations is also counted
+ * per relation file, for the PGSTAT_IO_NUM_RELATIONS relations with the most
+ * IO time.  These are kept in shared memory only, not in the stats file.
+ */
+#define PGSTAT_IO_NUM_RELATIONS 64
+
+typedef struct PgStat_RelationIO
+{
+	RelFileLocator locator;
+	PgStat_Counter rank_time;	/* estimated IO time, for keeping the top */
+	PgStat_Counter counts[IOOP_NUM_TYPES];
+	PgStat_Counter times[IOOP_NUM_TYPES];
+	PgStat_Counter hists[IOOP_NUM_TYPES][PGSTAT_IO_HIST_BUCKETS];
+} PgStat_RelationIO;
+
 
 typedef struct PgStat_StatDBEntry
 {
@@ -523,8 +549,12 @@ extern void pgstat_count_io_op_n(IOObject io_object, IOContext io_context, IOOp
 extern instr_time pgstat_prepare_io_time(void);
 extern void pgstat_count_io_op_time(IOObject io_object, IOContext io_context,
 									IOOp io_op, instr_time start_time, uint32 cnt);
+extern void pgstat_count_io_op_time_rel(IOObject io_object, IOContext io_context,
+										IOOp io_op, instr_time start_time, uint32 cnt,
+										const RelFileLocator *rlocator);
 
 extern PgStat_IO *pgstat_fetch_stat_io(void);
+extern int	pgstat_fetch_stat_io_relations(PgStat_RelationIO *relations);
 extern const char *pgstat_get_io_context_name(IOContext io_context);
 extern const char *pgstat_get_io_object_name(IOObject io_object);
 
@@ -727,6 +757,7 @@ extern PgStat_WalStats *pgstat_fetch_stat_wal(void);
 extern PGDLLIMPORT bool pgstat_track_counts;
 extern PGDLLIMPORT int pgstat_track_functions;
 extern PGDLLIMPORT int pgstat_fetch_consistency;
+extern PGDLLIMPORT bool pgstat_track_io_relations;
 
 
 /*
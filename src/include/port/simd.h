@@ -83,6 +83,7 @@ static inline bool vector32_is_highbit_set(const Vector32 v);
 
 /* arithmetic operations */
 static inline Vector8 vector8_or(const Vector8 v1, const Vector8 v2);
+static inline Vector8 vector8_and(const Vector8 v1, const Vector8 v2);
 #ifndef USE_NO_SIMD
 static inline Vector32 vector32_or(const Vector32 v1, const Vector32 v2);
 static inline Vector8 vector8_ssub(const Vector8 v1, const Vector8 v2);
@@ -314,6 +315,21 @@ vector8_or(const Vector8 v1, const Vector8 v2)
 #endif
 }
 
+/*
+ * Return the bitwise AND of the inputs
+ */
+static inline Vector8
+vector8_and(const Vector8 v1, const Vector8 v2)
+{
+#ifdef USE_SSE2
+	return _mm_and_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vandq_u8(v1, v2);
+#else
+	return v1 & v2;
+#endif
+}
+
 #ifndef USE_NO_SIMD
 static inline Vector32
 vector32_or(const Vector32 v1, const Vector32 v2)
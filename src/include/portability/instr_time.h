@@ -5,8 +5,10 @@
  *
  * This file provides an abstraction layer to hide portability issues in
  * interval timing.  On Unix we use clock_gettime(), and on Windows we use
- * QueryPerformanceCounter().  These macros also give some breathing room to
- * use other high-precision-timing APIs.
+ * QueryPerformanceCounter().  On x86-64 we can instead read the CPU's time
+ * stamp counter directly, if pg_initialize_timing() found it to be usable.
+ * These macros also give some breathing room to use other high-precision-timing
+ * APIs.
  *
  * The basic data type is instr_time, which all callers should treat as an
  * opaque typedef.  instr_time can store either an absolute time (of
@@ -19,8 +21,12 @@
  *
  * INSTR_TIME_SET_CURRENT(t)		set t to current time
  *
+ * INSTR_TIME_SET_CURRENT_FAST(t)	set t to current time, without waiting
+ *									for preceding instructions to complete
+ *
  * INSTR_TIME_SET_CURRENT_LAZY(t)	set t to current time if t is zero,
- *									evaluates to whether t changed
+ *									evaluates to whether t changed; uses
+ *									INSTR_TIME_SET_CURRENT_FAST
  *
  * INSTR_TIME_ADD(x, y)				x += y
  *
@@ -79,6 +85,19 @@ typedef struct instr_time
 #define NS_PER_US	INT64CONST(1000)
 
 
+/* Clock sources that pg_initialize_timing() can be asked to use */
+typedef enum TimingClockSource
+{
+	TIMING_CLOCK_SOURCE_AUTO,	/* TSC if known to be reliable, else system */
+	TIMING_CLOCK_SOURCE_SYSTEM, /* always use the operating system's clock */
+	TIMING_CLOCK_SOURCE_TSC,	/* TSC whenever the CPU has one */
+} TimingClockSource;
+
+extern bool pg_initialize_timing(TimingClockSource source);
+extern bool pg_tsc_usable(void);
+extern const char *pg_timing_clock_source_name(void);
+
+
 #ifndef WIN32
 
 
@@ -119,12 +138,89 @@ pg_clock_gettime_ns(void)
 	return now;
 }
 
+/*
+ * On x86-64 we can read the time stamp counter with a single instruction,
+ * which is much cheaper than clock_gettime() when the latter isn't served by
+ * the vDSO, as is common in virtual machines.  Whether the TSC is used is
+ * decided once per process by pg_initialize_timing(), before any times are
+ * taken; until then (and in programs that never call it) we use
+ * clock_gettime().  In TSC mode, ticks are TSC cycles and are converted to
+ * nanoseconds using a factor calibrated against PG_INSTR_CLOCK.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PG_INSTR_TSC 1
+#endif
+
+#ifdef PG_INSTR_TSC
+
+extern PGDLLIMPORT bool pg_instr_use_tsc;
+extern PGDLLIMPORT double pg_instr_tsc_ns_per_tick;
+
+/*
+ * RDTSCP waits for all earlier instructions to execute before reading the
+ * counter, so that the work being timed can't leak past the reading.
+ */
+static inline instr_time
+pg_get_ticks(void)
+{
+	if (likely(pg_instr_use_tsc))
+	{
+		instr_time	now;
+		unsigned int aux;
+
+		now.ticks = __builtin_ia32_rdtscp(&aux);
+		return now;
+	}
+	return pg_clock_gettime_ns();
+}
+
+/*
+ * Plain RDTSC has no such ordering guarantee, but is cheaper still; good
+ * enough where the timed work is much longer than the instruction pipeline.
+ */
+static inline instr_time
+pg_get_ticks_fast(void)
+{
+	if (likely(pg_instr_use_tsc))
+	{
+		instr_time	now;
+
+		now.ticks = __builtin_ia32_rdtsc();
+		return now;
+	}
+	return pg_clock_gettime_ns();
+}
+
+static inline int64
+pg_ticks_to_ns(int64 ticks)
+{
+	if (pg_instr_use_tsc)
+		return (int64) (ticks * pg_instr_tsc_ns_per_tick);
+	return ticks;
+}
+
+#define INSTR_TIME_SET_CURRENT(t) \
+	((t) = pg_get_ticks())
+
+#define INSTR_TIME_SET_CURRENT_FAST(t) \
+	((t) = pg_get_ticks_fast())
+
+#define INSTR_TIME_GET_NANOSEC(t) \
+	pg_ticks_to_ns((t).ticks)
+
+#else							/* !PG_INSTR_TSC */
+
 #define INSTR_TIME_SET_CURRENT(t) \
 	((t) = pg_clock_gettime_ns())
 
+#define INSTR_TIME_SET_CURRENT_FAST(t) \
+	INSTR_TIME_SET_CURRENT(t)
+
 #define INSTR_TIME_GET_NANOSEC(t) \
 	((int64) (t).ticks)
 
+#endif							/* PG_INSTR_TSC */
+
 
 #else							/* WIN32 */
 
@@ -156,6 +252,9 @@ GetTimerFrequency(void)
 #define INSTR_TIME_SET_CURRENT(t) \
 	((t) = pg_query_performance_counter())
 
+#define INSTR_TIME_SET_CURRENT_FAST(t) \
+	INSTR_TIME_SET_CURRENT(t)
+
 #define INSTR_TIME_GET_NANOSEC(t) \
 	((int64) ((t).ticks * ((double) NS_PER_S / GetTimerFrequency())))
 
@@ -172,7 +271,7 @@ GetTimerFrequency(void)
 #define INSTR_TIME_SET_ZERO(t)	((t).ticks = 0)
 
 #define INSTR_TIME_SET_CURRENT_LAZY(t) \
-	(INSTR_TIME_IS_ZERO(t) ? INSTR_TIME_SET_CURRENT(t), true : false)
+	(INSTR_TIME_IS_ZERO(t) ? INSTR_TIME_SET_CURRENT_FAST(t), true : false)
 
 
 #define INSTR_TIME_ADD(x,y) \
@@ -41,6 +41,7 @@
 /* GUC. */
 extern PGDLLIMPORT int dynamic_shared_memory_type;
 extern PGDLLIMPORT int min_dynamic_shared_memory;
+extern PGDLLIMPORT int dynamic_shared_memory_huge_pages;
 
 /*
  * Directory for on-disk state.
@@ -71,6 +72,12 @@ extern bool dsm_impl_op(dsm_op op, dsm_handle handle, Size request_size,
 						void **impl_private, void **mapped_address, Size *mapped_size,
 						int elevel);
 
+/* Huge page size used for new segments, or 0. */
+extern Size dsm_impl_huge_page_size(void);
+
+/* Number of bytes of a mapped segment that are backed by huge pages. */
+extern Size dsm_impl_huge_pages_mapped(void *address, Size size);
+
 /* Implementation-dependent actions required to keep segment until shutdown. */
 extern void dsm_impl_pin_segment(dsm_handle handle, void *impl_private,
 								 void **impl_private_pm_handle);
@@ -71,6 +71,15 @@ extern PGDLLIMPORT int io_direct_flags;
  */
 extern PGDLLIMPORT int max_safe_fds;
 
+/*
+ * Hook called with the data transferred by each successful FileRead(), and
+ * by each FileWrite() before it's issued, e.g. to emulate copying through
+ * bounce buffers.
+ */
+typedef void (*file_io_hook_type) (File file, const void *buffer,
+								   size_t amount, bool is_write);
+extern PGDLLIMPORT file_io_hook_type file_io_hook;
+
 /*
  * On Windows, we have to interpret EACCES as possibly meaning the same as
  * ENOENT, because if a file is unlinked-but-not-yet-gone on that platform,
@@ -43,6 +43,14 @@ extern void mdtruncate(SMgrRelation reln, ForkNumber forknum,
 					   BlockNumber old_blocks, BlockNumber nblocks);
 extern void mdimmedsync(SMgrRelation reln, ForkNumber forknum);
 
+/*
+ * Hook called for each block read, written or extended by md.c, e.g. to
+ * emulate per-block I/O latency.
+ */
+typedef void (*md_io_hook_type) (SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber blocknum, bool is_write);
+extern PGDLLIMPORT md_io_hook_type md_io_hook;
+
 extern void ForgetDatabaseSyncRequests(Oid dbid);
 extern void DropRelationFiles(RelFileLocator *delrels, int ndelrels, bool isRedo);
 
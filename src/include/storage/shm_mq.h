@@ -83,4 +83,8 @@ extern shm_mq_result shm_mq_wait_for_attach(shm_mq_handle *mqh);
 /* Smallest possible queue. */
 extern PGDLLIMPORT const Size shm_mq_minimum_size;
 
+/* Hook called before each message sent is written, with its size. */
+typedef void (*shm_mq_send_hook_type) (shm_mq_handle *mqh, Size nbytes);
+extern PGDLLIMPORT shm_mq_send_hook_type shm_mq_send_hook;
+
 #endif							/* SHM_MQ_H */
@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ *
+ * shm_prefault.h
+ *	  pre-touching of the main shared memory segment
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/shm_prefault.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHM_PREFAULT_H
+#define SHM_PREFAULT_H
+
+/* upper limit for shared_memory_prefault_workers */
+#define MAX_SHMEM_PREFAULT_WORKERS	64
+
+/* GUC variables */
+extern PGDLLIMPORT int shared_memory_prefault_workers;
+extern PGDLLIMPORT bool shared_memory_prefault_background;
+
+extern void PrefaultSharedMemory(void *base, Size size);
+extern bool PrefaultChildExited(int pid, int exitstatus);
+extern void PrefaultPageTables(void);
+
+#endif							/* SHM_PREFAULT_H */
@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * membroker.h
+ *	  instance-wide admission control for query work memory
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/membroker.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef MEMBROKER_H
+#define MEMBROKER_H
+
+/* GUC variables */
+extern PGDLLIMPORT int admission_memory_budget;
+extern PGDLLIMPORT int admission_wait_timeout;
+
+extern Size MemoryBrokerShmemSize(void);
+extern void MemoryBrokerShmemInit(void);
+
+extern Size MemoryBrokerReserve(Size request, uint64 queryId, double *scale);
+extern void MemoryBrokerRelease(Size reserved);
+extern void AtEOXact_MemoryBroker(void);
+extern bool MemoryBrokerIsWaiting(int pid);
+
+#endif							/* MEMBROKER_H */
@@ -104,11 +104,45 @@ extern void MemoryContextCheck(MemoryContext context);
 extern void HandleLogMemoryContextInterrupt(void);
 extern void ProcessLogMemoryContextInterrupt(void);
 
+/*
+ * Large blocks that memory contexts give back may be retained for reuse by
+ * later queries; see mcxt.c.  These are the counters for that.
+ */
+typedef struct RetainedMemoryStats
+{
+	int			retained_blocks;	/* blocks currently retained */
+	Size		retained_bytes;		/* and their total size */
+	uint64		reused_blocks;		/* requests served from retained blocks */
+	uint64		reused_bytes;
+	uint64		new_blocks;		/* requests that had to be malloc'd */
+	uint64		new_bytes;
+	uint64		released_bytes; /* retained bytes later given back */
+} RetainedMemoryStats;
+
+extern PGDLLIMPORT int retained_work_mem;
+extern PGDLLIMPORT int retained_work_mem_idle_timeout;
+
+extern void *RetainedBlockGet(Size *size);
+extern void RetainedBlockPut(void *block, Size size);
+extern void ReleaseRetainedBlocks(void);
+extern const RetainedMemoryStats *GetRetainedMemoryStats(void);
+
+/*
+ * Hook called whenever a memory context obtains a block fresh from malloc()
+ * or mmap(), i.e. memory whose pages the process has probably never touched.
+ * It's called from inside the allocator, so it must not allocate memory or
+ * throw an error.
+ */
+typedef void (*fresh_block_hook_type) (void *block, Size size);
+extern PGDLLIMPORT fresh_block_hook_type fresh_block_hook;
+
 /*
  * Memory-context-type-specific functions
  */
 
 /* aset.c */
+extern PGDLLIMPORT bool work_mem_huge_pages;
+
 extern MemoryContext AllocSetContextCreateInternal(MemoryContext parent,
 												   const char *name,
 												   Size minContextSize,
@@ -130,6 +164,8 @@ extern MemoryContext AllocSetContextCreateInternal(MemoryContext parent,
 	AllocSetContextCreateInternal
 #endif
 
+extern void AllocSetUseHugePages(MemoryContext context);
+
 /* slab.c */
 extern MemoryContext SlabContextCreate(MemoryContext parent,
 									   const char *name,
@@ -143,6 +179,13 @@ extern MemoryContext GenerationContextCreate(MemoryContext parent,
 											 Size initBlockSize,
 											 Size maxBlockSize);
 
+/* bump.c */
+extern MemoryContext BumpContextCreate(MemoryContext parent,
+									   const char *name,
+									   Size minContextSize,
+									   Size initBlockSize,
+									   Size maxBlockSize);
+
 /*
  * Recommended default alloc parameters, suitable for "ordinary" contexts
  * that might hold quite a lot of data.
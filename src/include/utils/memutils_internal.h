@@ -70,6 +70,23 @@ extern void SlabStats(MemoryContext context,
 extern void SlabCheck(MemoryContext context);
 #endif
 
+/* These functions implement the MemoryContext API for Bump context. */
+extern void *BumpAlloc(MemoryContext context, Size size);
+extern void BumpFree(void *pointer);
+extern void *BumpRealloc(void *pointer, Size size);
+extern void BumpReset(MemoryContext context);
+extern void BumpDelete(MemoryContext context);
+extern MemoryContext BumpGetChunkContext(void *pointer);
+extern Size BumpGetChunkSpace(void *pointer);
+extern bool BumpIsEmpty(MemoryContext context);
+extern void BumpStats(MemoryContext context,
+					  MemoryStatsPrintFunc printfunc, void *passthru,
+					  MemoryContextCounters *totals,
+					  bool print_to_stderr);
+#ifdef MEMORY_CONTEXT_CHECKING
+extern void BumpCheck(MemoryContext context);
+#endif
+
 /*
  * These functions support the implementation of palloc_aligned() and are not
  * part of a fully-fledged MemoryContext type.
@@ -101,12 +118,17 @@ extern Size AlignedAllocGetChunkSpace(void *pointer);
  * malloc not palloc.  (We can't tell that for most malloc implementations,
  * but it happens that glibc stores flag bits in the same place where we put
  * the MemoryContextMethodID, so the possible values are predictable for it.)
+ *
+ * MCTX_BUMP_ID takes the 010 pattern.  Bump contexts store no chunk header
+ * at all (except in MEMORY_CONTEXT_CHECKING builds), and every bump.c
+ * function reachable through a chunk pointer raises an error, so a malloc'd
+ * chunk matching this pattern is still reported rather than misinterpreted.
  */
 typedef enum MemoryContextMethodID
 {
 	MCTX_UNUSED1_ID,			/* 000 occurs in never-used memory */
 	MCTX_UNUSED2_ID,			/* glibc malloc'd chunks usually match 001 */
-	MCTX_UNUSED3_ID,			/* glibc malloc'd chunks > 128kB match 010 */
+	MCTX_BUMP_ID,				/* glibc malloc'd chunks > 128kB match 010 */
 	MCTX_ASET_ID,
 	MCTX_GENERATION_ID,
 	MCTX_SLAB_ID,
@@ -133,4 +155,16 @@ extern void MemoryContextCreate(MemoryContext node,
 								MemoryContext parent,
 								const char *name);
 
+/*
+ * Report a block just obtained from the operating system to
+ * fresh_block_hook, if any.  Returns the block for convenience.
+ */
+static inline void *
+FreshBlock(void *block, Size size)
+{
+	if (unlikely(fresh_block_hook != NULL) && block != NULL)
+		fresh_block_hook(block, size);
+	return block;
+}
+
 #endif							/* MEMUTILS_INTERNAL_H */
@@ -357,6 +357,11 @@ typedef struct PgStatShared_IO
 	 */
 	LWLock		locks[BACKEND_NUM_TYPES];
 	PgStat_IO	stats;
+
+	/* rel_lock protects the per-relation stats */
+	LWLock		rel_lock;
+	int			nrelations;
+	PgStat_RelationIO relations[PGSTAT_IO_NUM_RELATIONS];
 } PgStatShared_IO;
 
 typedef struct PgStatShared_SLRU
@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Shared-memory second level for the system catalog caches.
+ *
+ * Portions Copyright (c) 1996-2023, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+#include "utils/catcache.h"
+
+/* GUC variable */
+extern PGDLLIMPORT int shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheEnabled(void);
+extern HeapTuple SharedCatCacheLookup(CatCache *cache, uint32 hashValue,
+									  const Datum *arguments,
+									  uint64 *generation);
+extern void SharedCatCacheInsert(CatCache *cache, uint32 hashValue,
+								 HeapTuple tuple, uint64 generation);
+extern void SharedCatCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+											 int n);
+
+#endif							/* SHAREDCATCACHE_H */
@@ -0,0 +1,12 @@
+/* src/test/modules/cvm_emulator/cvm_emulator--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION cvm_emulator" to load this file. \quit
+
+CREATE FUNCTION cvm_emulator_counters(OUT block_io int8,
+    OUT file_io int8,
+    OUT fresh_blocks int8,
+    OUT shm_mq_sends int8)
+RETURNS record
+AS 'MODULE_PATHNAME', 'cvm_emulator_counters'
+LANGUAGE C STRICT VOLATILE PARALLEL SAFE;
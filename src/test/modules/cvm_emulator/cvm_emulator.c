@@ -0,0 +1,311 @@
+/*-------------------------------------------------------------------------
+ *
+ * cvm_emulator.c
+ *		Test module that emulates the overheads of a confidential VM.
+ *
+ * Inside a confidential VM (AMD SEV-SNP, Intel TDX) guest memory is
+ * encrypted, so devices can't DMA into it: every disk read or write is
+ * copied through an unencrypted bounce buffer, and takes extra exits to the
+ * hypervisor.  Memory newly handed to the guest has to be validated before
+ * its first use, which makes the first touch of fresh pages expensive.  And
+ * communication between processes pays for the encrypted cache lines moving
+ * between cores.
+ *
+ * This module injects synthetic costs at the corresponding places (md.c
+ * block I/O, fd.c file I/O, memory blocks fresh from malloc(), and shm_mq
+ * sends), so that plan-quality problems seen in confidential VMs can be
+ * reproduced, and the TEE-aware planner modules validated, on ordinary
+ * machines.  Delays are spent spinning rather than sleeping, since the real
+ * costs are CPU time too.  Every cost defaults to zero.
+ *
+ * Load it through shared_preload_libraries to also slow down background
+ * processes such as the checkpointer, or with LOAD for a single session
+ * (parallel workers load it as well).  When preloaded, it also counts how
+ * often each hook has been called in any process, which the
+ * cvm_emulator_counters() function of the extension shows.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/test/modules/cvm_emulator/cvm_emulator.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "portability/instr_time.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/md.h"
+#include "storage/shm_mq.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+
+PG_MODULE_MAGIC;
+
+/* size of the pages whose first touch we charge for */
+#define CVM_PAGE_SIZE		4096
+
+/* size of the bounce buffer file I/O is copied through, in pieces */
+#define CVM_BOUNCE_SIZE		(16 * BLCKSZ)
+
+/* GUC variables; delays are in milliseconds */
+static double block_io_delay = 0;
+static double file_io_delay = 0;
+static bool bounce_buffers = false;
+static double first_touch_delay = 0;
+static int	first_touch_min_size = 64;	/* kB */
+static double shm_mq_send_delay = 0;
+
+/* static, so that it costs nothing unless used, and is safe to use anywhere */
+static char bounce_buffer[CVM_BOUNCE_SIZE];
+
+/* Number of calls of each hook, in shared memory if we were preloaded */
+typedef struct CvmCounters
+{
+	pg_atomic_uint64 block_io;
+	pg_atomic_uint64 file_io;
+	pg_atomic_uint64 fresh_blocks;
+	pg_atomic_uint64 shm_mq_sends;
+} CvmCounters;
+
+static CvmCounters *counters = NULL;
+
+/* Saved hook values */
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static md_io_hook_type prev_md_io_hook = NULL;
+static file_io_hook_type prev_file_io_hook = NULL;
+static fresh_block_hook_type prev_fresh_block_hook = NULL;
+static shm_mq_send_hook_type prev_shm_mq_send_hook = NULL;
+
+PG_FUNCTION_INFO_V1(cvm_emulator_counters);
+
+/* Count a hook call, if we have somewhere to count it */
+#define CVM_COUNT(field) \
+	do { \
+		if (counters) \
+			pg_atomic_fetch_add_u64(&counters->field, 1); \
+	} while (0)
+
+
+/*
+ * Burn the given number of milliseconds of CPU time.
+ *
+ * This must not allocate memory or throw errors, because it's called from
+ * inside the memory allocator.
+ */
+static void
+cvm_spin(double delay_ms)
+{
+	instr_time	start,
+				now;
+
+	if (delay_ms <= 0)
+		return;
+
+	INSTR_TIME_SET_CURRENT(start);
+	do
+	{
+		INSTR_TIME_SET_CURRENT(now);
+		INSTR_TIME_SUBTRACT(now, start);
+	} while (INSTR_TIME_GET_MILLISEC(now) < delay_ms);
+}
+
+/* Per-block latency of relation I/O */
+static void
+cvm_md_io(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  bool is_write)
+{
+	if (prev_md_io_hook)
+		prev_md_io_hook(reln, forknum, blocknum, is_write);
+
+	CVM_COUNT(block_io);
+	cvm_spin(block_io_delay);
+}
+
+/* Bounce-buffer copy and per-call latency of all file I/O */
+static void
+cvm_file_io(File file, const void *buffer, size_t amount, bool is_write)
+{
+	if (prev_file_io_hook)
+		prev_file_io_hook(file, buffer, amount, is_write);
+
+	CVM_COUNT(file_io);
+
+	if (bounce_buffers)
+	{
+		for (size_t off = 0; off < amount; off += CVM_BOUNCE_SIZE)
+			memcpy(bounce_buffer, (const char *) buffer + off,
+				   Min(amount - off, CVM_BOUNCE_SIZE));
+	}
+
+	cvm_spin(file_io_delay);
+}
+
+/* Validation of fresh pages on first touch */
+static void
+cvm_fresh_block(void *block, Size size)
+{
+	if (prev_fresh_block_hook)
+		prev_fresh_block_hook(block, size);
+
+	CVM_COUNT(fresh_blocks);
+
+	if (size >= (Size) first_touch_min_size * 1024)
+		cvm_spin(first_touch_delay * (size / CVM_PAGE_SIZE));
+}
+
+/* Cross-process message passing */
+static void
+cvm_shm_mq_send(shm_mq_handle *mqh, Size nbytes)
+{
+	if (prev_shm_mq_send_hook)
+		prev_shm_mq_send_hook(mqh, nbytes);
+
+	CVM_COUNT(shm_mq_sends);
+	cvm_spin(shm_mq_send_delay);
+}
+
+/* Reserve shared memory for the counters */
+static void
+cvm_shmem_request(void)
+{
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
+
+	RequestAddinShmemSpace(sizeof(CvmCounters));
+}
+
+/* Create or attach to the counters */
+static void
+cvm_shmem_startup(void)
+{
+	CvmCounters *shared;
+	bool		found;
+
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	shared = ShmemInitStruct("cvm_emulator", sizeof(CvmCounters), &found);
+	if (!found)
+	{
+		pg_atomic_init_u64(&shared->block_io, 0);
+		pg_atomic_init_u64(&shared->file_io, 0);
+		pg_atomic_init_u64(&shared->fresh_blocks, 0);
+		pg_atomic_init_u64(&shared->shm_mq_sends, 0);
+	}
+	LWLockRelease(AddinShmemInitLock);
+
+	counters = shared;
+}
+
+/*
+ * Return the number of calls of each hook so far, in all processes.
+ */
+Datum
+cvm_emulator_counters(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[4];
+	bool		nulls[4] = {0};
+
+	if (counters == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("cvm_emulator must be loaded via shared_preload_libraries")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&counters->block_io));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&counters->file_io));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&counters->fresh_blocks));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&counters->shm_mq_sends));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/* Module load function */
+void
+_PG_init(void)
+{
+	DefineCustomRealVariable("cvm_emulator.block_io_delay",
+							 "Sets the extra latency of each relation block read or written.",
+							 NULL,
+							 &block_io_delay,
+							 0, 0, 1000,
+							 PGC_SUSET,
+							 GUC_UNIT_MS,
+							 NULL, NULL, NULL);
+
+	DefineCustomRealVariable("cvm_emulator.file_io_delay",
+							 "Sets the extra latency of each file read or write.",
+							 "This applies to relation, temporary and other files alike.",
+							 &file_io_delay,
+							 0, 0, 1000,
+							 PGC_SUSET,
+							 GUC_UNIT_MS,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("cvm_emulator.bounce_buffers",
+							 "Copies the data of each file read or write through a bounce buffer.",
+							 NULL,
+							 &bounce_buffers,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL, NULL, NULL);
+
+	DefineCustomRealVariable("cvm_emulator.first_touch_delay",
+							 "Sets the cost of each 4kB page of memory newly obtained from the operating system.",
+							 "Only blocks of at least cvm_emulator.first_touch_min_size are charged.",
+							 &first_touch_delay,
+							 0, 0, 1000,
+							 PGC_SUSET,
+							 GUC_UNIT_MS,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("cvm_emulator.first_touch_min_size",
+							"Sets the smallest fresh memory block that is charged for first touch.",
+							NULL,
+							&first_touch_min_size,
+							64, 0, MAX_KILOBYTES,
+							PGC_SUSET,
+							GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	DefineCustomRealVariable("cvm_emulator.shm_mq_send_delay",
+							 "Sets the extra latency of each message sent through a shared memory queue.",
+							 "This mainly affects tuples sent from parallel workers to their leader.",
+							 &shm_mq_send_delay,
+							 0, 0, 1000,
+							 PGC_SUSET,
+							 GUC_UNIT_MS,
+							 NULL, NULL, NULL);
+
+	MarkGUCPrefixReserved("cvm_emulator");
+
+	/* Install hooks. */
+	if (process_shared_preload_libraries_in_progress)
+	{
+		prev_shmem_request_hook = shmem_request_hook;
+		shmem_request_hook = cvm_shmem_request;
+		prev_shmem_startup_hook = shmem_startup_hook;
+		shmem_startup_hook = cvm_shmem_startup;
+	}
+	prev_md_io_hook = md_io_hook;
+	md_io_hook = cvm_md_io;
+	prev_file_io_hook = file_io_hook;
+	file_io_hook = cvm_file_io;
+	prev_fresh_block_hook = fresh_block_hook;
+	fresh_block_hook = cvm_fresh_block;
+	prev_shm_mq_send_hook = shm_mq_send_hook;
+	shm_mq_send_hook = cvm_shm_mq_send;
+}
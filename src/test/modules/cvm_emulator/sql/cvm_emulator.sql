@@ -0,0 +1,41 @@
+CREATE EXTENSION cvm_emulator;
+
+-- Hook calls so far, to check that each hook is called
+CREATE TEMP TABLE cvm_before AS SELECT * FROM cvm_emulator_counters();
+
+-- Use small costs, so that the test stays fast but every hook does something
+SET cvm_emulator.block_io_delay = '10us';
+SET cvm_emulator.file_io_delay = '10us';
+SET cvm_emulator.bounce_buffers = on;
+SET cvm_emulator.first_touch_delay = '1us';
+SET cvm_emulator.first_touch_min_size = '8kB';
+SET cvm_emulator.shm_mq_send_delay = '1us';
+SHOW cvm_emulator.block_io_delay;
+
+CREATE TABLE cvm_t AS
+  SELECT g AS a, md5(g::text) AS b FROM generate_series(1, 10000) g;
+
+-- External sort, for temporary file I/O through the bounce buffer
+SET work_mem = '64kB';
+SELECT count(*), count(DISTINCT b) FROM (SELECT * FROM cvm_t ORDER BY b) s;
+RESET work_mem;
+
+-- Parallel query, for tuple queue sends from the workers
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT count(*) FROM cvm_t WHERE a % 7 = 0;
+SELECT sum(a) FROM cvm_t WHERE a % 3 = 0;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+SELECT c.block_io > b.block_io AS block_io,
+       c.file_io > b.file_io AS file_io,
+       c.fresh_blocks > b.fresh_blocks AS fresh_blocks,
+       c.shm_mq_sends > b.shm_mq_sends AS shm_mq_sends
+  FROM cvm_emulator_counters() c, cvm_before b;
+
+DROP TABLE cvm_t;
@@ -0,0 +1,73 @@
+# Tests for admission control of query work memory
+#
+# Each session's sort is estimated to need all of its 1MB of work_mem,
+# and the budget (see memory_admission.conf) leaves room for one and a
+# half of them.  A query reserves its memory when its cursor is declared,
+# and gives it back when the transaction ends.
+
+setup
+{
+  CREATE FUNCTION wait_for_waiters(n int) RETURNS void
+  LANGUAGE plpgsql AS $$
+  BEGIN
+    WHILE (SELECT count(*) FROM pg_memory_reservations
+           WHERE state = 'waiting') <> n
+    LOOP
+      PERFORM pg_sleep(0.01);
+    END LOOP;
+  END $$;
+}
+
+teardown
+{
+  DROP FUNCTION wait_for_waiters(int);
+}
+
+session s1
+setup		{ SET work_mem = '1MB'; }
+step s1_begin	{
+  BEGIN;
+  DECLARE c1 CURSOR FOR SELECT g FROM generate_series(1, 100000) g ORDER BY g DESC;
+  FETCH 1 FROM c1;
+}
+step s1_commit	{ COMMIT; }
+
+session s2
+setup		{ SET work_mem = '1MB'; SET admission_wait_timeout = '5min'; }
+step s2_timeout	{ SET admission_wait_timeout = '10ms'; }
+step s2_begin	{
+  BEGIN;
+  DECLARE c2 CURSOR FOR SELECT g FROM generate_series(1, 100000) g ORDER BY g DESC;
+  FETCH 1 FROM c2;
+}
+step s2_commit	{ COMMIT; }
+
+session s3
+setup		{ SET work_mem = '1MB'; SET admission_wait_timeout = 0; }
+step s3_begin	{
+  BEGIN;
+  DECLARE c3 CURSOR FOR SELECT g FROM generate_series(1, 100000) g ORDER BY g DESC;
+  FETCH 1 FROM c3;
+}
+step s3_commit	{ COMMIT; }
+
+# The monitor must not queue behind the sessions it watches
+session monitor
+setup		{ SET admission_wait_timeout = 0; }
+step queued	{ SELECT wait_for_waiters(1); }
+step settled	{ SELECT wait_for_waiters(0); }
+step show	{
+  SELECT string_agg(format('%s %s/%skB', state, reserved_bytes / 1024, requested_bytes / 1024),
+                    ', ' ORDER BY state, reserved_bytes)
+    FROM pg_memory_reservations
+   WHERE pid <> pg_backend_pid();
+}
+
+# s2 waits for s1 to give back its memory
+permutation s1_begin s2_begin(*) queued show s1_commit settled(s2_begin) show s2_commit show
+
+# s2 stops waiting after admission_wait_timeout, and takes what is left
+permutation s2_timeout s1_begin s2_begin(*) settled(s2_begin) show s1_commit s2_commit
+
+# s3 doesn't wait, but may not take the memory s2 is waiting for
+permutation s1_begin s2_begin(*) queued s3_begin show s1_commit settled(s2_begin) show s2_commit s3_commit
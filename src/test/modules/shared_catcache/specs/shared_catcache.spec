@@ -0,0 +1,43 @@
+# Tests for invalidation of the shared catalog cache
+#
+# s1 looks up a function and a type, which puts them in the shared cache as
+# well as in its local cache.  ddl then changes both in a transaction.
+# Until that commits, the others must still see the old definitions: s1 from
+# its local cache, and s2, which hasn't looked them up before, from wherever
+# it finds them.  Once it has committed, everyone must see the new ones,
+# including fresh, whose first lookups come after the commit and would be
+# satisfied from the shared cache if it had kept stale entries.
+
+setup
+{
+  CREATE SCHEMA scc;
+  CREATE FUNCTION scc.f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+  CREATE DOMAIN scc.d AS int;
+  CREATE TABLE scc.tab (x scc.d);
+  INSERT INTO scc.tab VALUES (1);
+}
+
+teardown
+{
+  DROP SCHEMA scc CASCADE;
+}
+
+session s1
+step s1_lookup	{ SELECT scc.f(), pg_typeof(x) FROM scc.tab; }
+
+session s2
+step s2_lookup	{ SELECT scc.f(), pg_typeof(x) FROM scc.tab; }
+
+session ddl
+step ddl_begin	{ BEGIN; }
+step ddl_change	{
+  CREATE OR REPLACE FUNCTION scc.f() RETURNS int LANGUAGE sql AS 'SELECT 2';
+  ALTER DOMAIN scc.d RENAME TO d2;
+}
+step ddl_lookup	{ SELECT scc.f(), pg_typeof(x) FROM scc.tab; }
+step ddl_commit	{ COMMIT; }
+
+session fresh
+step fresh_lookup	{ SELECT scc.f(), pg_typeof(x) FROM scc.tab; }
+
+permutation s1_lookup ddl_begin ddl_change ddl_lookup s1_lookup s2_lookup ddl_commit s1_lookup s2_lookup fresh_lookup
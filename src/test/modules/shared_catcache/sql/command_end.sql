@@ -0,0 +1,38 @@
+--
+-- Changes made by a command must be visible to the rest of the transaction,
+-- even where the old catalog tuples are in the shared catalog cache.
+--
+
+-- Attaching the last partition of an index validates the partitioned
+-- index, and then its parent, which looks at pg_index again after the
+-- relcache entry of the first one has been rebuilt.
+CREATE TABLE scc_parted (a int) PARTITION BY RANGE (a);
+CREATE TABLE scc_parted1 PARTITION OF scc_parted
+  FOR VALUES FROM (1) TO (1000) PARTITION BY RANGE (a);
+CREATE TABLE scc_parted11 PARTITION OF scc_parted1 FOR VALUES FROM (1) TO (100);
+CREATE INDEX scc_parted1_a_idx ON ONLY scc_parted1 (a);
+CREATE INDEX scc_parted_a_idx ON ONLY scc_parted (a);
+ALTER INDEX scc_parted_a_idx ATTACH PARTITION scc_parted1_a_idx;
+SELECT relname, indisvalid FROM pg_class JOIN pg_index ON indexrelid = oid
+  WHERE relname LIKE 'scc_parted%' ORDER BY relname;
+CREATE INDEX scc_parted11_a_idx ON scc_parted11 (a);
+ALTER INDEX scc_parted1_a_idx ATTACH PARTITION scc_parted11_a_idx;
+SELECT relname, indisvalid FROM pg_class JOIN pg_index ON indexrelid = oid
+  WHERE relname LIKE 'scc_parted%' ORDER BY relname;
+DROP TABLE scc_parted;
+
+-- A function replaced in a transaction, used before and after
+CREATE FUNCTION scc_f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+SELECT scc_f();
+BEGIN;
+CREATE OR REPLACE FUNCTION scc_f() RETURNS int LANGUAGE sql AS 'SELECT 2';
+SELECT scc_f();
+ROLLBACK;
+SELECT scc_f();
+BEGIN;
+CREATE OR REPLACE FUNCTION scc_f() RETURNS int LANGUAGE sql AS 'SELECT 3';
+COMMIT;
+SELECT scc_f();
+\c
+SELECT scc_f();
+DROP FUNCTION scc_f();
@@ -0,0 +1,56 @@
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Run the standard regression tests with the shared catalog cache enabled.
+# It is kept small, so that entries are evicted as well as invalidated.
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use File::Basename;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+
+# Increase some settings that Cluster->new makes too low by default.
+$node->adjust_conf('postgresql.conf', 'max_connections', '25');
+$node->append_conf('postgresql.conf', 'max_prepared_transactions = 10');
+$node->append_conf('postgresql.conf', 'shared_catalog_cache_size = 256kB');
+
+# See 027_stream_regress.pl
+$node->append_conf('postgresql.conf', 'synchronize_seqscans = off');
+$node->start;
+
+my $dlpath = dirname($ENV{REGRESS_SHLIB});
+my $outputdir = $PostgreSQL::Test::Utils::tmp_check;
+
+my $extra_opts = $ENV{EXTRA_REGRESS_OPTS} || "";
+my $rc =
+  system($ENV{PG_REGRESS}
+	  . " $extra_opts "
+	  . "--dlpath=\"$dlpath\" "
+	  . "--bindir= "
+	  . "--host="
+	  . $node->host . " "
+	  . "--port="
+	  . $node->port . " "
+	  . "--schedule=../../regress/parallel_schedule "
+	  . "--max-concurrent-tests=20 "
+	  . "--inputdir=../../regress "
+	  . "--outputdir=\"$outputdir\"");
+if ($rc != 0)
+{
+	# Dump out the regression diffs file, if there is one
+	my $diffs = "$outputdir/regression.diffs";
+	if (-e $diffs)
+	{
+		print "=== dumping $diffs ===\n";
+		print slurp_file($diffs);
+		print "=== EOF ===\n";
+	}
+}
+is($rc, 0, 'regression tests pass');
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,85 @@
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Exercise the pool of pre-forked backends (backend_pool_size).
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use Time::HiRes qw(usleep);
+
+# Wait until the server log shows $n pooled backends forked after $offset,
+# and return the offset of the end of the log.  wait_for_log() can't count
+# matches, and returns the end of the log after the first one.
+sub wait_for_pooled_backends
+{
+	my ($node, $n, $offset) = @_;
+
+	for (my $i = 0; $i < 10 * $PostgreSQL::Test::Utils::timeout_default; $i++)
+	{
+		my $log = slurp_file($node->logfile, $offset);
+		my $forked = () = $log =~ /forked new pooled backend/g;
+
+		return $offset + length($log) if $forked >= $n;
+		usleep(100_000);
+	}
+	die "timed out waiting for $n pooled backends";
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', "log_min_messages = debug2");
+$node->start;
+
+# Builds that use EXEC_BACKEND can't have a pool, and must say so.
+my ($ret, $stdout, $stderr) =
+  $node->psql('postgres', "ALTER SYSTEM SET backend_pool_size = 3");
+if ($ret != 0)
+{
+	like(
+		$stderr,
+		qr/pre-forked backends are not supported by this build/,
+		'backend_pool_size is rejected without fork()');
+	$node->stop;
+	done_testing();
+	exit;
+}
+
+# The pool fills up after a reload.
+my $offset = -s $node->logfile;
+$node->reload;
+$offset = wait_for_pooled_backends($node, 3, $offset);
+
+# Connections are taken by pooled backends, whatever database and role
+# they are for, and behave as usual.
+$node->safe_psql('postgres',
+	"CREATE DATABASE pooldb; CREATE ROLE pooluser LOGIN");
+$offset = -s $node->logfile;
+is( $node->safe_psql(
+		'pooldb',
+		"SELECT current_database(), current_user, backend_type
+		   FROM pg_stat_activity WHERE pid = pg_backend_pid()",
+		extra_params => [ '-U', 'pooluser' ]),
+	'pooldb|pooluser|client backend',
+	'pooled backend serves a session');
+ok($node->log_contains(qr/passed connection to pooled backend/, $offset),
+	'connection was passed to a pooled backend');
+
+# Used backends are replaced.
+$offset = $node->wait_for_log(qr/forked new pooled backend/, $offset);
+
+# Lowering backend_pool_size empties the pool, and connections are forked
+# as before.
+$node->safe_psql('postgres', "ALTER SYSTEM SET backend_pool_size = 0");
+$node->reload;
+$node->poll_query_until('postgres', "SELECT current_setting('backend_pool_size') = '0'")
+  or die "timed out waiting for reload";
+$offset = -s $node->logfile;
+is($node->safe_psql('postgres', "SELECT 1"), '1', 'connect without pool');
+ok(!$node->log_contains(qr/passed connection to pooled backend/, $offset),
+	'connection was not passed to a pooled backend');
+
+$node->stop;
+
+done_testing();
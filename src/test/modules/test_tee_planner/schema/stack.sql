@@ -0,0 +1,137 @@
+-- Schema of the Stack Exchange workload, with fabricated statistics.
+
+CREATE TABLE site (
+    site_id integer NOT NULL PRIMARY KEY,
+    site_name character varying(100) NOT NULL
+);
+
+CREATE TABLE account (
+    id integer NOT NULL PRIMARY KEY,
+    display_name character varying(100),
+    location character varying(200),
+    website_url character varying(200)
+);
+
+CREATE TABLE so_user (
+    id integer NOT NULL,
+    site_id integer NOT NULL,
+    reputation integer NOT NULL,
+    creation_date timestamp,
+    last_access_date timestamp,
+    website_url character varying(200),
+    location character varying(200),
+    about_me text,
+    views integer,
+    upvotes integer,
+    downvotes integer,
+    account_id integer,
+    PRIMARY KEY (id, site_id)
+);
+
+CREATE TABLE tag (
+    id integer NOT NULL,
+    site_id integer NOT NULL,
+    name character varying(100) NOT NULL,
+    PRIMARY KEY (id, site_id)
+);
+
+CREATE TABLE question (
+    id integer NOT NULL,
+    site_id integer NOT NULL,
+    accepted_answer_id integer,
+    creation_date timestamp NOT NULL,
+    deletion_date timestamp,
+    score integer NOT NULL,
+    view_count integer NOT NULL,
+    body text,
+    owner_user_id integer,
+    last_editor_id integer,
+    last_edit_date timestamp,
+    last_activity_date timestamp,
+    title character varying(300),
+    tags character varying(300),
+    answer_count integer,
+    comment_count integer,
+    favorite_count integer,
+    closed_date timestamp,
+    community_owned_date timestamp,
+    PRIMARY KEY (id, site_id)
+);
+
+CREATE TABLE answer (
+    id integer NOT NULL,
+    site_id integer NOT NULL,
+    question_id integer,
+    creation_date timestamp NOT NULL,
+    deletion_date timestamp,
+    score integer NOT NULL,
+    view_count integer,
+    body text,
+    owner_user_id integer,
+    last_editor_id integer,
+    last_edit_date timestamp,
+    last_activity_date timestamp,
+    title character varying(300),
+    PRIMARY KEY (id, site_id)
+);
+
+CREATE TABLE tag_question (
+    question_id integer NOT NULL,
+    tag_id integer NOT NULL,
+    site_id integer NOT NULL,
+    PRIMARY KEY (site_id, question_id, tag_id)
+);
+
+CREATE TABLE badge (
+    site_id integer NOT NULL,
+    user_id integer NOT NULL,
+    name character varying(100) NOT NULL,
+    date timestamp NOT NULL
+);
+
+CREATE TABLE comment (
+    id integer NOT NULL,
+    site_id integer NOT NULL,
+    post_id integer NOT NULL,
+    user_id integer,
+    score integer NOT NULL,
+    body text NOT NULL,
+    date timestamp NOT NULL
+);
+
+CREATE TABLE post_link (
+    site_id integer NOT NULL,
+    post_id_from integer NOT NULL,
+    post_id_to integer NOT NULL,
+    link_type integer NOT NULL,
+    date timestamp NOT NULL
+);
+
+CREATE INDEX so_user_account_id ON so_user (account_id);
+CREATE INDEX so_user_creation_date ON so_user (creation_date);
+CREATE INDEX question_owner ON question (owner_user_id, site_id);
+CREATE INDEX question_creation_date ON question (creation_date);
+CREATE INDEX question_site_id ON question (site_id);
+CREATE INDEX answer_question ON answer (question_id, site_id);
+CREATE INDEX answer_owner ON answer (owner_user_id, site_id);
+CREATE INDEX answer_creation_date ON answer (creation_date);
+CREATE INDEX answer_site_id ON answer (site_id);
+CREATE INDEX tag_question_tag ON tag_question (tag_id, site_id);
+CREATE INDEX badge_user ON badge (user_id, site_id);
+CREATE INDEX comment_post ON comment (post_id, site_id);
+CREATE INDEX comment_user ON comment (user_id, site_id);
+CREATE INDEX comment_date ON comment (date);
+CREATE INDEX post_link_from ON post_link (post_id_from, site_id);
+
+SELECT test_tee_planner_set_stats(relname::regclass, reltuples) FROM (VALUES
+    ('account', 13872153),
+    ('answer', 6347553),
+    ('badge', 51236903),
+    ('comment', 103459956),
+    ('post_link', 2264333),
+    ('question', 12666441),
+    ('site', 173),
+    ('so_user', 21097302),
+    ('tag', 186770),
+    ('tag_question', 36883819)
+) AS v(relname, reltuples);
@@ -0,0 +1,162 @@
+
+# Copyright (c) 2023, PostgreSQL Global Development Group
+
+# Check that the TEE planner modules don't make planning much more
+# expensive.  Every query of the workloads is planned, but not executed,
+# under each combination of modules, and the total planner memory is
+# compared with that of the stock planner.  Planning time depends too much on
+# the machine and its load to be checked by default; it's compared as well
+# when PG_TEST_EXTRA contains "tee_planner_timing".  The tables are empty;
+# their statistics are fabricated by test_tee_planner.
+
+use strict;
+use warnings;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $check_time = ($ENV{PG_TEST_EXTRA} // '') =~ /\btee_planner_timing\b/;
+
+# Largest acceptable overhead, as ratios to stock planning
+my $max_time_ratio = $ENV{TEE_PLANNER_MAX_TIME_RATIO} // 2.0;
+my $max_memory_ratio = $ENV{TEE_PLANNER_MAX_MEMORY_RATIO} // 2.0;
+
+# Each planning time is the best of this many runs
+my $loops = $ENV{TEE_PLANNER_LOOPS} // 3;
+
+my $workload_dir = '../../../../workloads';
+
+# Workloads, with the database holding their schema
+my @workloads = (
+	[ 'job', 'imdb' ],
+	[ 'ceb', 'imdb' ],
+	[ 'so', 'stack' ],
+	[ 'tpcds', 'tpcds' ]);
+
+# Module combinations: CE, CM, JN, adaptive selector
+my %combinations = (
+	stock => [ 0, 0, 0, 0 ],
+	ce => [ 1, 0, 0, 0 ],
+	cm => [ 0, 1, 0, 0 ],
+	jn => [ 0, 0, 1, 0 ],
+	ce_cm => [ 1, 1, 0, 0 ],
+	ce_jn => [ 1, 0, 1, 0 ],
+	cm_jn => [ 0, 1, 1, 0 ],
+	ce_cm_jn => [ 1, 1, 1, 0 ],
+	selector => [ 0, 0, 0, 1 ]);
+
+# test_tee_planner comes last, so that its get_relation_info hook runs first
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_preload_libraries = 'tee_cardinality_estimation, tee_cost_model, tee_join_enumerator, tee_adaptive_selector, test_tee_planner'
+autovacuum = off
+tee_adaptive_selector.use_cache = off
+tee_adaptive_selector.log_decisions = off
+});
+$node->start;
+
+# Create the schemas, and load the queries into each database
+my %databases;
+foreach my $workload (@workloads)
+{
+	my ($name, $dbname) = @$workload;
+
+	if (!$databases{$dbname}++)
+	{
+		$node->safe_psql('postgres', "CREATE DATABASE $dbname");
+		$node->safe_psql($dbname,
+			q{CREATE EXTENSION test_tee_planner;
+			  CREATE TABLE tee_queries (workload text, name text, query text);
+			  CREATE TABLE tee_results (workload text, name text,
+				combination text, planning_time float8, planning_memory int8);}
+		);
+		$node->command_ok(
+			[
+				'psql', '-X', '-q', '-v', 'ON_ERROR_STOP=1',
+				'-d', $node->connstr($dbname),
+				'-f', "schema/$dbname.sql"
+			],
+			"schema $dbname loaded");
+	}
+
+	my @files = sort glob("$workload_dir/${name}_queries/*.sql");
+	ok(@files > 0, "workload $name has queries");
+
+	my $inserts = '';
+	foreach my $file (@files)
+	{
+		my $query = slurp_file($file);
+		my ($qname) = $file =~ m{([^/]+)\.sql$};
+
+		die "query $file contains the quoting delimiter" if $query =~ /\$q\$/;
+		$query =~ s/;\s*$//;
+		$inserts .=
+		  "INSERT INTO tee_queries VALUES ('$name', '$qname', \$q\$$query\$q\$);\n";
+	}
+	$node->safe_psql($dbname, $inserts);
+}
+
+# Plan everything under each combination
+foreach my $workload (@workloads)
+{
+	my ($name, $dbname) = @$workload;
+
+	foreach my $combination (sort keys %combinations)
+	{
+		my ($ce, $cm, $jn, $as) =
+		  map { $_ ? 'on' : 'off' } @{ $combinations{$combination} };
+
+		$node->safe_psql(
+			$dbname, qq{
+SET tee_cardinality_estimation.enable_sev_snp_ce = $ce;
+SET tee_cost_model.enable = $cm;
+SET tee_join_enumerator.jn_enabled = $jn;
+SET tee_adaptive_selector.enable = $as;
+INSERT INTO tee_results
+  SELECT q.workload, q.name, '$combination', m.planning_time, m.planning_memory
+  FROM tee_queries q, test_tee_planner_measure(q.query, $loops) m
+  WHERE q.workload = '$name';
+});
+	}
+}
+
+# Compare the totals of each workload with stock planning
+foreach my $workload (@workloads)
+{
+	my ($name, $dbname) = @$workload;
+
+	my $result = $node->safe_psql(
+		$dbname, qq{
+SELECT c.combination,
+       round((sum(c.planning_time) / sum(s.planning_time))::numeric, 2),
+       round(sum(c.planning_memory)::numeric / sum(s.planning_memory), 2),
+       (array_agg(c.name ORDER BY c.planning_time / s.planning_time DESC))[1],
+       round(max(c.planning_time / s.planning_time)::numeric, 2)
+FROM tee_results c JOIN tee_results s USING (workload, name)
+WHERE c.workload = '$name' AND s.combination = 'stock'
+  AND c.combination <> 'stock'
+GROUP BY c.combination
+ORDER BY c.combination;
+});
+
+	foreach my $line (split /\n/, $result)
+	{
+		my ($combination, $time_ratio, $memory_ratio, $worst, $worst_ratio) =
+		  split /\|/, $line;
+
+		note "$name/$combination: planning time x$time_ratio, "
+		  . "memory x$memory_ratio, slowest query $worst (x$worst_ratio)";
+
+		cmp_ok($time_ratio, '<=', $max_time_ratio,
+			"$name/$combination planning time overhead")
+		  if $check_time;
+		cmp_ok($memory_ratio, '<=', $max_memory_ratio,
+			"$name/$combination planning memory overhead");
+	}
+}
+
+$node->stop;
+
+done_testing();
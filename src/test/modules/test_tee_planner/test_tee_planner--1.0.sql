@@ -0,0 +1,15 @@
+/* src/test/modules/test_tee_planner/test_tee_planner--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_tee_planner" to load this file. \quit
+
+CREATE FUNCTION test_tee_planner_measure(query text, loops int4 DEFAULT 1,
+    OUT planning_time float8, OUT planning_memory int8)
+RETURNS record
+AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
+
+CREATE FUNCTION test_tee_planner_set_stats(rel regclass, reltuples float8)
+RETURNS void
+AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
+
+REVOKE ALL ON FUNCTION test_tee_planner_set_stats(regclass, float8) FROM PUBLIC;
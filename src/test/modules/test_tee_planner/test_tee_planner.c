@@ -0,0 +1,260 @@
+/*-------------------------------------------------------------------------
+ *
+ * test_tee_planner.c
+ *		Measure the planning overhead of the TEE planner modules.
+ *
+ * test_tee_planner_measure() plans a query the same way exec_simple_query
+ * does, and reports how long planning took and how much memory the planner
+ * allocated.  The TAP test uses it to compare the TEE modules' planning
+ * cost with that of the stock planner.
+ *
+ * So that the suite runs without loading any data, test_tee_planner_set_stats()
+ * fabricates pg_class statistics for a table and its indexes, and a
+ * get_relation_info hook makes the planner believe them although the
+ * relations are physically empty.
+ *
+ * Copyright (c) 2023, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_tee_planner/test_tee_planner.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/itup.h"
+#include "access/multixact.h"
+#include "access/table.h"
+#include "commands/vacuum.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "optimizer/plancat.h"
+#include "portability/instr_time.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_tee_planner_measure);
+PG_FUNCTION_INFO_V1(test_tee_planner_set_stats);
+
+/* GUC variable */
+static bool fabricated_stats = true;
+
+/* Saved hook value */
+static get_relation_info_hook_type prev_get_relation_info_hook = NULL;
+
+
+/*
+ * Substitute the pg_class statistics of an empty relation for the physical
+ * size the planner measured.  A relation whose statistics were fabricated is
+ * recognizable as one that has relpages > 0 but no blocks, which is the only
+ * case in which estimate_rel_size() comes up with zero pages.
+ */
+static void
+ttp_get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
+					  RelOptInfo *rel)
+{
+	if (fabricated_stats && !inhparent && rel->pages == 0)
+	{
+		Relation	relation = table_open(relationObjectId, NoLock);
+
+		if (relation->rd_rel->relpages > 0)
+		{
+			ListCell   *lc;
+
+			rel->pages = relation->rd_rel->relpages;
+			rel->tuples = Max(relation->rd_rel->reltuples, 0);
+			rel->allvisfrac = 0;
+
+			foreach(lc, rel->indexlist)
+			{
+				IndexOptInfo *info = (IndexOptInfo *) lfirst(lc);
+				Relation	indexRelation = index_open(info->indexoid, NoLock);
+
+				info->pages = indexRelation->rd_rel->relpages;
+				info->tuples = Min(Max(indexRelation->rd_rel->reltuples, 0),
+								   rel->tuples);
+				index_close(indexRelation, NoLock);
+			}
+		}
+
+		table_close(relation, NoLock);
+	}
+
+	if (prev_get_relation_info_hook)
+		prev_get_relation_info_hook(root, relationObjectId, inhparent, rel);
+}
+
+/*
+ * Estimate how many pages a relation with the given number of tuples of
+ * typical width would occupy.
+ */
+static BlockNumber
+estimate_pages(Relation rel, double tuples)
+{
+	double		tuple_size;
+	double		pages;
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+		tuple_size = MAXALIGN(sizeof(IndexTupleData));
+	else
+		tuple_size = MAXALIGN(SizeofHeapTupleHeader);
+	tuple_size += MAXALIGN(get_rel_data_width(rel, NULL)) + sizeof(ItemIdData);
+
+	pages = ceil(tuples * tuple_size / (BLCKSZ - SizeOfPageHeaderData));
+	return (BlockNumber) Max(pages, 1);
+}
+
+/*
+ * test_tee_planner_set_stats(rel regclass, reltuples float8)
+ *
+ * Record fabricated statistics in pg_class for a table and all its indexes,
+ * as if ANALYZE had found the given number of rows.
+ */
+Datum
+test_tee_planner_set_stats(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	double		reltuples = PG_GETARG_FLOAT8(1);
+	Relation	rel;
+	List	   *indexoids;
+	ListCell   *lc;
+
+	if (reltuples < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of tuples must not be negative")));
+
+	rel = table_open(relid, ShareUpdateExclusiveLock);
+	indexoids = RelationGetIndexList(rel);
+
+	vac_update_relstats(rel, estimate_pages(rel, reltuples), reltuples, 0,
+						indexoids != NIL, InvalidTransactionId,
+						InvalidMultiXactId, NULL, NULL, true);
+
+	foreach(lc, indexoids)
+	{
+		Relation	indexRelation = index_open(lfirst_oid(lc),
+											   ShareUpdateExclusiveLock);
+
+		vac_update_relstats(indexRelation,
+							estimate_pages(indexRelation, reltuples),
+							reltuples, 0, false, InvalidTransactionId,
+							InvalidMultiXactId, NULL, NULL, true);
+		index_close(indexRelation, NoLock);
+	}
+
+	table_close(rel, NoLock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * test_tee_planner_measure(query text, loops int4,
+ *							OUT planning_time float8, OUT planning_memory int8)
+ *
+ * Parse, analyze and plan the query "loops" times, reporting the shortest
+ * planning time in milliseconds and the memory allocated in the planner's
+ * memory context in bytes.  Only the planning step is measured.
+ */
+Datum
+test_tee_planner_measure(PG_FUNCTION_ARGS)
+{
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32		loops = PG_GETARG_INT32(1);
+	double		best_time = -1;
+	int64		memory = 0;
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2] = {false, false};
+
+	if (loops < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of loops must be at least 1")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	for (int i = 0; i < loops; i++)
+	{
+		MemoryContext querycxt;
+		MemoryContext plancxt;
+		MemoryContext oldcxt;
+		List	   *parsetrees;
+		List	   *querytrees = NIL;
+		ListCell   *lc;
+		instr_time	start,
+					duration;
+		double		time;
+
+		querycxt = AllocSetContextCreate(CurrentMemoryContext,
+										 "test_tee_planner query",
+										 ALLOCSET_DEFAULT_SIZES);
+		oldcxt = MemoryContextSwitchTo(querycxt);
+
+		parsetrees = pg_parse_query(query);
+		foreach(lc, parsetrees)
+		{
+			RawStmt    *parsetree = lfirst_node(RawStmt, lc);
+
+			querytrees = list_concat(querytrees,
+									 pg_analyze_and_rewrite_fixedparams(parsetree,
+																		query,
+																		NULL, 0,
+																		NULL));
+		}
+
+		plancxt = AllocSetContextCreate(querycxt,
+										"test_tee_planner planner",
+										ALLOCSET_DEFAULT_SIZES);
+		MemoryContextSwitchTo(plancxt);
+
+		INSTR_TIME_SET_CURRENT(start);
+		(void) pg_plan_queries(querytrees, query, CURSOR_OPT_PARALLEL_OK, NULL);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		/* memory use is deterministic, so just keep the last value */
+		memory = (int64) MemoryContextMemAllocated(plancxt, true);
+
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(querycxt);
+
+		time = INSTR_TIME_GET_MILLISEC(duration);
+		if (best_time < 0 || time < best_time)
+			best_time = time;
+	}
+
+	values[0] = Float8GetDatum(best_time);
+	values[1] = Int64GetDatum(memory);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+void
+_PG_init(void)
+{
+	DefineCustomBoolVariable("test_tee_planner.fabricated_stats",
+							 "Makes the planner use pg_class statistics of empty relations.",
+							 NULL,
+							 &fabricated_stats,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL, NULL, NULL);
+
+	MarkGUCPrefixReserved("test_tee_planner");
+
+	prev_get_relation_info_hook = get_relation_info_hook;
+	get_relation_info_hook = ttp_get_relation_info;
+}
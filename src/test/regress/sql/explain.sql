@@ -154,3 +154,21 @@ select explain_filter('explain (verbose) select * from t1 where pg_temp.mysin(f1
 -- Test compute_query_id
 set compute_query_id = on;
 select explain_filter('explain (verbose) select * from int8_tbl i8');
+
+-- Test display of memory limits assigned out of query_work_mem
+begin;
+set local query_work_mem = '256kB';
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+select explain_filter('explain (costs off) select * from tenk1 a join onek b on a.thousand = b.thousand order by a.ten');
+select explain_filter('explain (costs off) with w as materialized (select unique1, ten from tenk1) select ten, sum(unique1) over (partition by ten) from w');
+rollback;
+
+-- MEMORY and FAULTS options
+-- should fail
+explain (memory) select * from int8_tbl i8;
+explain (faults) select * from int8_tbl i8;
+select explain_filter('explain (analyze, memory, costs off, timing off, summary off) select * from int8_tbl i8 order by q1');
+-- fault counts vary, so only check that the fields are present
+select explain_filter_to_json('explain (analyze, memory, faults, format json) select * from int8_tbl i8 order by q1') #> '{0,Plan}'
+  ?& array['Peak Node Memory', 'Minor Page Faults', 'Major Page Faults'] as ok;
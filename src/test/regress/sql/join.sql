@@ -2941,3 +2941,94 @@ SELECT 1 FROM group_tbl t1
 GROUP BY s.c1, s.c2;
 
 DROP TABLE group_tbl;
+
+--
+-- Adaptive joins
+--
+
+-- The hash table's memory usage and, if it's abandoned, the number of rows
+-- read into it vary between machines
+create function explain_adaptive(query text, hide_rows bool) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off, summary off) %s',
+            query)
+    loop
+        if hide_rows then
+            ln := regexp_replace(ln, 'actual rows=\d+', 'actual rows=N');
+            ln := regexp_replace(ln, 'Rows Removed by Filter: \d+',
+                                 'Rows Removed by Filter: N');
+        end if;
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+create table aj_outer as
+  select g, g % 100 as x, g % 100 as y, g % 1500 as k
+  from generate_series(1, 10000) g;
+create table aj_inner (id int primary key, v int);
+insert into aj_inner select g, g * 2 from generate_series(1, 1000) g;
+analyze aj_outer;
+analyze aj_inner;
+
+set enable_adaptivejoin = on;
+set enable_mergejoin = off;
+
+-- x and y are correlated, so the outer side is badly underestimated and
+-- the join has to switch to hashing midway through
+explain (costs off)
+select count(*), sum(i.v) from aj_outer o join aj_inner i on i.id = o.k
+where o.x = 1 and o.y = 1;
+select explain_adaptive('
+select count(*), sum(i.v) from aj_outer o join aj_inner i on i.id = o.k
+where o.x = 1 and o.y = 1', false);
+select count(*), sum(i.v) from aj_outer o join aj_inner i on i.id = o.k
+where o.x = 1 and o.y = 1;
+select count(*), sum(i.v) from aj_outer o join aj_inner i
+  on i.id = o.k and i.v > o.g % 700
+where o.x = 1 and o.y = 1;
+select count(*), count(i.id) from aj_outer o left join aj_inner i on i.id = o.k
+where o.x = 1 and o.y = 1;
+select count(*) from aj_outer o
+where o.x = 1 and o.y = 1 and
+  exists (select 1 from aj_inner i where i.id = o.k);
+select count(*) from aj_outer o
+where o.x = 1 and o.y = 1 and
+  not exists (select 1 from aj_inner i where i.id = o.k);
+
+-- On a rescan that leaves the inner relation alone, the hash table is kept
+select explain_adaptive('
+select t.n, (select count(*) from aj_outer o join aj_inner i on i.id = o.k
+             where o.x = t.n and o.y = 1)
+from (values (1), (2)) t(n)', false);
+select t.n, (select count(*) from aj_outer o join aj_inner i on i.id = o.k
+             where o.x = t.n and o.y = 1)
+from (values (1), (2)) t(n);
+
+-- a and b are correlated too, so the inner side is underestimated, and the
+-- hash table is abandoned once it outgrows work_mem
+create table aj_wide (id int primary key, a int, b int, pad text);
+insert into aj_wide
+  select g, g % 10, g % 10, repeat('x', 1000) from generate_series(1, 2000) g;
+analyze aj_wide;
+set work_mem = '64kB';
+select explain_adaptive('
+select count(*), sum(length(i.pad)) from aj_outer o join aj_wide i
+  on i.id = o.k
+where o.x = 1 and o.y = 1 and i.a = 1 and i.b = 1', true);
+select count(*), sum(length(i.pad)) from aj_outer o join aj_wide i
+  on i.id = o.k
+where o.x = 1 and o.y = 1 and i.a = 1 and i.b = 1;
+reset work_mem;
+
+reset enable_adaptivejoin;
+reset enable_mergejoin;
+drop table aj_outer, aj_inner, aj_wide;
+drop function explain_adaptive(text, bool);
@@ -138,6 +138,20 @@ $$
 $$);
 rollback to settings;
 
+-- parallel-aware hash join with dynamic shared memory segments backed by
+-- huge pages where possible; and where required, with a build side small
+-- enough not to need a segment that large
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local work_mem = '4MB';
+set local hash_mem_multiplier = 1.0;
+set local enable_parallel_hash = on;
+set local dynamic_shared_memory_huge_pages = try;
+select count(*) from simple r join simple s using (id);
+set local dynamic_shared_memory_huge_pages = on;
+select count(*) from simple r join (select * from simple limit 100) s using (id);
+rollback to settings;
+
 -- The "good" case: batches required, but we plan the right number; we
 -- plan for some number of batches, and we stick to that number, and
 -- peak memory usage says within our work_mem budget
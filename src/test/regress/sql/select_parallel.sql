@@ -78,6 +78,75 @@ select count(*) from tenk1 where stringu1 = 'GRAAAA';
 reset max_parallel_workers;
 reset parallel_leader_participation;
 
+-- test tuple batching in the queues between workers and leader; with leader
+-- participation disabled, every row has to pass through a queue
+set parallel_leader_participation = off;
+set parallel_tuple_batch_size = 0;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+set parallel_tuple_batch_size = 1;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+-- likewise, with the batches passed in DSA chunks
+set parallel_tuple_zero_copy = on;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+reset parallel_tuple_batch_size;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+-- wide rows fill a chunk a few at a time, so the pool runs dry and chunks
+-- are reused, and rows wider than a batch are sent on their own in between;
+-- the result must be the same as without chunks
+select count(*), md5(string_agg(t, '' order by unique1)) from
+  (select unique1, repeat(stringu1::text, case when unique1 % 100 = 0
+                                               then 2000 else 200 end) as t
+   from tenk1 offset 0) s;
+-- the leader stops reading early, leaving workers to find the queue detached
+select sum(length(t)) from
+  (select repeat(stringu1::text, 200) as t from tenk1 offset 0 limit 10) s;
+reset parallel_tuple_zero_copy;
+select count(*), md5(string_agg(t, '' order by unique1)) from
+  (select unique1, repeat(stringu1::text, case when unique1 % 100 = 0
+                                               then 2000 else 200 end) as t
+   from tenk1 offset 0) s;
+-- rows produced slowly are sent once parallel_tuple_batch_delay expires
+set parallel_tuple_batch_size = '1MB';
+set parallel_tuple_batch_delay = 1;
+select unique1 from tenk1
+  where unique1 % 2500 = 0 and pg_sleep(0.01)::text = '' order by unique1;
+reset parallel_tuple_batch_delay;
+-- the first row reaches the leader while the worker sleeps over the second,
+-- unless the delay is disabled
+create function sp_leader_clock() returns timestamptz as
+  $$begin return clock_timestamp(); end$$ language plpgsql parallel restricted;
+create table batch_delay_tab as select g as a from generate_series(1, 2) g;
+select a, sp_leader_clock() - w < '1s' as prompt
+  from (select a, clock_timestamp() as w from batch_delay_tab
+        where a = 1 or pg_sleep(2)::text = '') s;
+set parallel_tuple_batch_delay = 0;
+select a, sp_leader_clock() - w < '1s' as prompt
+  from (select a, clock_timestamp() as w from batch_delay_tab
+        where a = 1 or pg_sleep(2)::text = '') s;
+reset parallel_tuple_batch_delay;
+drop table batch_delay_tab;
+drop function sp_leader_clock();
+reset parallel_tuple_batch_size;
+-- queries run by workers that were started ahead of time
+set parallel_worker_prestart = 2;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+select sum(sp_parallel_restricted(unique1)), count(*) from tenk1;
+reset parallel_worker_prestart;
+-- resetting the setting retires the waiting workers
+do $$
+begin
+  for i in 1..300 loop
+    exit when not exists (select from pg_stat_activity
+                          where wait_event = 'ParallelWorkerPrestart');
+    perform pg_sleep(0.1);
+    perform pg_stat_clear_snapshot();
+  end loop;
+end
+$$;
+select count(*) from pg_stat_activity
+  where wait_event = 'ParallelWorkerPrestart';
+reset parallel_leader_participation;
+
 -- test that parallel_restricted function doesn't run in worker
 alter table tenk1 set (parallel_workers = 4);
 explain (verbose, costs off)
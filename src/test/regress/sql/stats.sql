@@ -749,6 +749,25 @@ SELECT sum(extends) AS io_sum_bulkwrite_strategy_extends_after
   FROM pg_stat_io WHERE context = 'bulkwrite' \gset
 SELECT :io_sum_bulkwrite_strategy_extends_after > :io_sum_bulkwrite_strategy_extends_before;
 
+-- Test that timed IO is counted in the latency histograms, per backend type
+-- and for the relation
+SET track_io_timing = on;
+SET track_io_relations = on;
+SELECT sum(h) AS io_hist_extends_before
+  FROM pg_stat_io_histogram, unnest(histogram) h
+  WHERE backend_type = 'client backend' AND context = 'bulkwrite' AND op = 'extend' \gset
+CREATE TABLE test_io_histogram AS SELECT i FROM generate_series(1,100)i;
+SELECT pg_stat_force_next_flush();
+SELECT sum(h) AS io_hist_extends_after
+  FROM pg_stat_io_histogram, unnest(histogram) h
+  WHERE backend_type = 'client backend' AND context = 'bulkwrite' AND op = 'extend' \gset
+SELECT :io_hist_extends_after > :io_hist_extends_before;
+SELECT operations > 0 AS counted, array_length(histogram, 1) AS buckets
+  FROM pg_stat_io_relation_histogram
+  WHERE relfilenode = pg_relation_filenode('test_io_histogram') AND op = 'extend';
+RESET track_io_timing;
+RESET track_io_relations;
+
 -- Test IO stats reset
 SELECT pg_stat_have_stats('io', 0, 0);
 SELECT sum(evictions) + sum(reuses) + sum(extends) + sum(fsyncs) + sum(reads) + sum(writes) + sum(writebacks) + sum(hits) AS io_stats_pre_reset
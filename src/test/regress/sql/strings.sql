@@ -511,6 +511,16 @@ SELECT 'foo' LIKE '%__' as t, 'foo' LIKE '%___' as t, 'foo' LIKE '%____' as f;
 
 SELECT 'jack' LIKE '%____%' AS t;
 
+--
+-- test %literal% fragments, which are located by substring search
+--
+
+SELECT repeat('ab', 20) || 'needle' || repeat('cd', 20) LIKE '%needle%' as t, repeat('ab', 20) || 'needl' || repeat('cd', 20) LIKE '%needle%' as f;
+SELECT repeat('x', 40) || 'abc' LIKE '%abc' as t, repeat('x', 40) || 'abcx' LIKE '%abc' as f, 'bc' LIKE '%abc' as f;
+SELECT 'the quick brown fox jumps over the lazy dog' LIKE '%quick%fox%dog' as t, 'the quick brown fox jumps over the lazy dog' LIKE '%fox%quick%' as f;
+SELECT 'the quick brown fox jumps over the lazy dog' LIKE '%o%o%o%o%' as t, 'the quick brown fox jumps over the lazy dog' LIKE '%o%o%o%o%o%' as f;
+SELECT repeat('a', 30) || 'b' LIKE '%aab%' as t, repeat('a', 30) || 'b' LIKE '%aab_%' as f, repeat('a', 30) || 'bc' LIKE '%aab_%' as t;
+
 
 --
 -- basic tests of LIKE with indexes
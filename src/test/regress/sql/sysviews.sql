@@ -17,6 +17,16 @@ select count(*) >= 0 as ok from pg_available_extensions;
 select name, ident, parent, level, total_bytes >= free_bytes
   from pg_backend_memory_contexts where level = 0;
 
+-- Large blocks freed by one query are kept for the next one
+set retained_work_mem = '64MB';
+select count(*) from (select g from generate_series(1, 200000) g
+  order by g desc offset 0) s;
+select retained_bytes > 0 as retained from pg_get_backend_retained_memory();
+select count(*) from (select g from generate_series(1, 200000) g
+  order by g desc offset 0) s;
+select reused_blocks > 0 as reused from pg_get_backend_retained_memory();
+reset retained_work_mem;
+
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
@@ -42,6 +52,14 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- admission_memory_budget is off by default, so nothing is reserved
+select count(*) = 0 as ok from pg_memory_reservations;
+
+-- Other sessions may have segments, but none can have more huge pages than
+-- bytes
+select count(*) >= 0 as ok, count(*) filter (where huge_page_bytes > size) = 0 as sane
+  from pg_dsm_segments;
+
 -- There will surely be at least one SLRU cache
 select count(*) > 0 as ok from pg_stat_slru;
 
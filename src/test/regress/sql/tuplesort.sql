@@ -296,3 +296,14 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+-- sorts and hash tables with their large allocations in huge pages
+SET work_mem_huge_pages = on;
+SET work_mem = '64MB';
+SELECT sum(x * r) FROM
+  (SELECT x, row_number() OVER (ORDER BY x DESC) r
+   FROM generate_series(1, 300000) x) s;
+SELECT count(*) FROM
+  (SELECT x % 200000 FROM generate_series(1, 400000) x GROUP BY 1) s;
+RESET work_mem;
+RESET work_mem_huge_pages;